@@ -1,192 +1,520 @@
-/**
- * @file
- * @brief Console inferface program from user space to use capgemini mic driver
- *
- * @details [Optional: More detailed description of the file]
- *
- * @author Victor M.
- * @date 14-08-2025
- *
- * @version 1.0
- * @note Changelog:
- * - 14-08-2025: User space program draft - Victor M. (vmartin2-cap)
- */
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <alsa/asoundlib.h> 
-/* Placeholder for PCM */
-#define CS_DEFAULT_DURATION 5U
-#define CS_DEFAULT_RATE 48000UL
-#define CS_DEFAULT_CHANNELS 1U
-#define CS_DEFAULT_FORMAT SND_PCM_FORMAT_S16_LE
-#define CS_DEFAULT_FRAMES 1024U
-#define CS_DEFAULT_DEVICE "default"
-
-char last_recording_path[256] = "~/capgeminiSound_tmp/lastRecording.wav";
-const char CS_Arg_Record[] = "--record";
-const char CS_Arg_Play[] ="--play";
-FILE *wav_file;
-char usage[] = "Usage run on your shell: capgeminiSound --record <file.wav> | --play [file.wav]\n \
-            default temporal folder: ~/capgeminiSound_tmp/lastRecording.wav";
-/* Internal operations */
-void CS_record_audio(const char *filepath);
-void CS_play_audio(const char *filepath);
-/* End of intenal */
-int main(int argc, char *argv[]);
-
-/**
- * @brief Entry point for the capgeminiSound CLI application.
- *
- * This function parses command-line arguments and invokes either the
- * recording or playback functionality based on the provided options.
- *
- * Supported options:
- * - --record <file.wav>: Records 5 seconds of audio and saves it to the specified file.
- * - --play [file.wav]: Plays the specified file or the last recorded file if none is provided.
- *
- * @param argc Argument count.
- * @param argv Argument vector.
- * @return int Returns 0 on success, 1 on error.
- */
-int main(int argc, char *argv[]) 
-{
-    if (argc < 2) 
-    {
-        fprintf(stderr, "%s\n",usage);
-        return 1;
-    }
-
-    if (strcmp(argv[1], CS_Arg_Record) == 0) 
-    {
-        if (argc < 3) {
-            fprintf(stderr, "Missing file path for recording.\n");
-            return 1;
-        }
-        CS_record_audio(argv[2]);
-    } 
-    else if (strcmp(argv[1], CS_Arg_Play) == 0)
-    {
-        CS_play_audio(argc >= 3 ? argv[2] : NULL);
-    }
-    else
-    {
-        fprintf(stderr, "Unknown option: %s\n", argv[1]);
-        return 1;
-    }
-
-    return 0;
-}
-
-/**
- * @brief Records audio from the default input device and saves it to a WAV file.
- *
- * This function Records audio using xxx API and writes it to the specified file path.
- *
- * @param filepath Path to the output WAV file.
- */
-void CS_record_audio(const char *filepath) 
-{
-    
-
-    snd_pcm_t *pcm_handle = NULL;
-    snd_pcm_hw_params_t *params;
-    snd_pcm_uframes_t frames = CS_DEFAULT_FRAMES; /* TODO assuming 1024 bu */
-    /* defs for WAV file write */
-    unsigned int rate = CS_DEFAULT_RATE;
-    int dir;
-    /* Open PCM device for recording */
-    /* TODO Configure capture ie */
-    if (snd_pcm_open(&pcm_handle, "default", SND_PCM_STREAM_CAPTURE, 0) < 0) {
-        fprintf(stderr, "CapgeminiSound ERR: Error opening PCM device. check if sound card is available\n");
-        return;
-    }
-
-    snd_pcm_hw_params_malloc(&params);
-    snd_pcm_hw_params_any(pcm_handle, params);
-    snd_pcm_hw_params_set_access(pcm_handle, params, SND_PCM_ACCESS_RW_INTERLEAVED);
-    snd_pcm_hw_params_set_format(pcm_handle, params, SND_PCM_FORMAT_S16_LE);
-    snd_pcm_hw_params_set_channels(pcm_handle, params, CS_DEFAULT_CHANNELS);
-    snd_pcm_hw_params_set_rate_near(pcm_handle, params, &rate, &dir);
-    snd_pcm_hw_params(pcm_handle, params);
-    snd_pcm_hw_params_get_period_size(params, &frames, &dir); 
-    snd_pcm_hw_params_free(params);
-    
-    int bytes_per_sample = 2; /* 16-bit*/ 
-    int total_frames = CS_DEFAULT_DURATION * rate; /* TODO to modify this duration */
-    int buffer_size = frames * CS_DEFAULT_CHANNELS * bytes_per_sample;
-    char *buffer;
-    
-   
-
-    buffer = (char *)malloc(buffer_size);
-
-
-    printf("Recording to: %s\n", filepath);
-    /* TODO: Implement play with micdriver */
-    strncpy(last_recording_path, filepath, sizeof(last_recording_path));
-    /* Open PCM device for recording */
-    /* Allocate hardware parameters */
-    /* Open WAV file */
-    wav_file = fopen(filepath, "wb");
-    if (!wav_file) {
-        fprintf(stderr, "Error opening WAV file.\n");
-        /* handle pcm close: snd_pcm_close(pcm_handle);*/
-        /*free(buffer);*/
-        return;
-    }
-    /* Write WAV header */
-    int data_chunk_pos = 44;
-    int data_chunk_size = total_frames * CS_DEFAULT_CHANNELS * bytes_per_sample; /* TODO to modify this size */
-    int file_size = data_chunk_pos + data_chunk_size - 8;
-
-    fwrite("RIFF", 1, 4, wav_file);
-    fwrite(&file_size, 4, 1, wav_file);
-    fwrite("WAVEfmt ", 1, 8, wav_file);
-    int fmt_chunk_size = 16;
-    short audio_format = 1;
-    short num_channels = CS_DEFAULT_CHANNELS;
-    int byte_rate = rate * num_channels * bytes_per_sample;
-    short block_align = num_channels * bytes_per_sample;
-    short bits_per_sample = 16;
-
-    fwrite(&fmt_chunk_size, 4, 1, wav_file);
-    fwrite(&audio_format, 2, 1, wav_file);
-    fwrite(&num_channels, 2, 1, wav_file);
-    fwrite(&rate, 4, 1, wav_file);
-    fwrite(&byte_rate, 4, 1, wav_file);
-    fwrite(&block_align, 2, 1, wav_file);
-    fwrite(&bits_per_sample, 2, 1, wav_file);
-    fwrite("data", 1, 4, wav_file);
-    fwrite(&data_chunk_size, 4, 1, wav_file);
-
-    /* Record and write audio data */ 
-    for (int i = 0; i < total_frames / frames; ++i) {
-        /* snd_pcm_readi(pcm_handle, buffer, frames); */
-        fwrite(buffer, buffer_size, 1, wav_file);
-    }
-
-    fclose(wav_file);
-    snd_pcm_close(pcm_handle);
-    free(buffer);
-
-    printf("Recording saved to %s\n", filepath);
-
-
-
-
-}
-
-/**
- * @brief Plays audio from the default input device and saves it to a WAV file.
- *
- * This function captures audio using xxx API and writes it to the specified file path.
- *
- * @param filepath Path to the output WAV file.
- */
-void CS_play_audio(const char *filepath)
-{
-    const char *target = filepath ? filepath : last_recording_path;
-    printf("Playing: %s\n", target);
-    /*TODO: Implement play with micdriver */
+/**
+ * @file
+ * @brief Console inferface program from user space to use capgemini mic driver
+ *
+ * @details [Optional: More detailed description of the file]
+ *
+ * @author Victor M.
+ * @date 14-08-2025
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 14-08-2025: User space program draft - Victor M. (vmartin2-cap)
+ * - 19-10-2026: Add --monitor full-duplex talk-back mode
+ * - 19-10-2026: Real capture loop with optional on-the-fly resampling
+ * - 19-10-2026: Add --bridge drift-compensated monitor
+ * - 19-10-2026: Add --publish shared-memory capture fan-out
+ * - 19-10-2026: 24/32-bit recording, --play with seek, --info overview
+ * - 19-10-2026: Add --analyze spectrum/level QA mode
+ * - 19-10-2026: Add --lowpower timer-driven background capture
+ * - 19-10-2026: --record keeps the granted channels and marks 24-in-32 data
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <alsa/asoundlib.h> 
+#include "capgeminiSound.h"
+#include "cs_analyzer.h"
+#include "cs_dsp.h"
+#include "cs_lowwake.h"
+#include "cs_monitor.h"
+#include "cs_pcm.h"
+#include "cs_publish.h"
+#include "cs_resampler.h"
+#include "cs_shm_ring.h"
+#include "cs_wav.h"
+
+char last_recording_path[256] = "~/capgeminiSound_tmp/lastRecording.wav";
+const char CS_Arg_Record[] = "--record";
+const char CS_Arg_Play[] ="--play";
+const char CS_Arg_Monitor[] = "--monitor";
+const char CS_Arg_Bridge[] = "--bridge";
+const char CS_Arg_Publish[] = "--publish";
+const char CS_Arg_Info[] = "--info";
+const char CS_Arg_Analyze[] = "--analyze";
+const char CS_Arg_Lowpower[] = "--lowpower";
+const char CS_Arg_Lowpower_Baseline[] = "--lowpower-baseline";
+char usage[] = "Usage run on your shell: capgeminiSound --record <file.wav> [rate [bits]]\n \
+            | --play [file.wav [start_seconds]] | --info <file.wav>\n \
+            | --monitor [capture_dev playback_dev [period_frames]]\n \
+            | --bridge [capture_dev playback_dev [period_frames]]\n \
+            | --publish [capture_dev [socket]]\n \
+            | --analyze [seconds [tone_hz [capture_dev [channels]]]]\n \
+            | --lowpower[-baseline] [file.wav|- [seconds [interval_ms [capture_dev]]]]\n \
+            default temporal folder: ~/capgeminiSound_tmp/lastRecording.wav";
+/* Internal operations */
+void CS_record_audio(const char *filepath, unsigned int out_rate, unsigned int bits);
+void CS_play_audio(const char *filepath, double start_seconds);
+int CS_info_audio(const char *filepath);
+int CS_analyze_audio(double seconds, double tone_hz, const char *device, unsigned int channels);
+/* End of intenal */
+int main(int argc, char *argv[]);
+
+/**
+ * @brief Entry point for the capgeminiSound CLI application.
+ *
+ * This function parses command-line arguments and invokes either the
+ * recording or playback functionality based on the provided options.
+ *
+ * Supported options:
+ * - --record <file.wav> [rate [bits]]: Records 5 seconds of audio and saves it to the specified
+ *   file, resampled to @c rate Hz (e.g. 16000) when given; @c bits is 16 (default),
+ *   24 (packed, 3 bytes per sample) or 32 (24 valid bits with the INMP441). The
+ *   file has one channel per slot the device delivers.
+ * - --play [file.wav [start_seconds]]: Plays the specified file or the last recorded file
+ *   if none is provided, optionally starting at a capture time.
+ * - --info <file.wav>: Prints the format, seek table size and a peak overview.
+ * - --monitor [capture_dev playback_dev [period_frames]]: Live mic-to-speaker
+ *   talk-back until Ctrl+C; the period is auto-detected when not given.
+ * - --bridge [capture_dev playback_dev [period_frames]]: Same as --monitor for
+ *   devices on different clocks; an adaptive resampler absorbs the drift.
+ * - --publish [capture_dev [socket]]: Captures into a shared-memory ring that
+ *   any number of local readers (cs_shm_ring) consume without copies.
+ * - --analyze [seconds [tone_hz [capture_dev [channels]]]]: Live spectrum and level
+ *   analysis for mic QA, printed as JSON on stdout.
+ * - --lowpower [file.wav|- [seconds [interval_ms [capture_dev]]]]: Background capture
+ *   with the largest buffer, no period interrupts and a timer every interval_ms;
+ *   reports wakeups and CPU time per hour. --lowpower-baseline runs the same
+ *   capture with period-driven reads for comparison.
+ *
+ * @param argc Argument count.
+ * @param argv Argument vector.
+ * @return int Returns 0 on success, 1 on error.
+ */
+int main(int argc, char *argv[]) 
+{
+    if (argc < 2) 
+    {
+        fprintf(stderr, "%s\n",usage);
+        return 1;
+    }
+
+    if (strcmp(argv[1], CS_Arg_Record) == 0) 
+    {
+        if (argc < 3) {
+            fprintf(stderr, "Missing file path for recording.\n");
+            return 1;
+        }
+        CS_record_audio(argv[2], argc >= 4 ? strtoul(argv[3], NULL, 0) : 0,
+                        argc >= 5 ? strtoul(argv[4], NULL, 0) : 16);
+    } 
+    else if (strcmp(argv[1], CS_Arg_Play) == 0)
+    {
+        CS_play_audio(argc >= 3 ? argv[2] : NULL, argc >= 4 ? strtod(argv[3], NULL) : 0.0);
+    }
+    else if (strcmp(argv[1], CS_Arg_Info) == 0)
+    {
+        if (argc < 3) {
+            fprintf(stderr, "Missing file path.\n");
+            return 1;
+        }
+        return CS_info_audio(argv[2]) < 0 ? 1 : 0;
+    }
+    else if (strcmp(argv[1], CS_Arg_Monitor) == 0 || strcmp(argv[1], CS_Arg_Bridge) == 0)
+    {
+        struct cs_monitor_options opts = {
+            .capture_device = argc >= 4 ? argv[2] : CS_MONITOR_CAPTURE_DEVICE,
+            .playback_device = argc >= 4 ? argv[3] : CS_MONITOR_PLAYBACK_DEVICE,
+            .period_frames = argc >= 5 ? strtoul(argv[4], NULL, 0) : 0,
+            .gain = 1.0f,
+            .drift = strcmp(argv[1], CS_Arg_Bridge) == 0,
+        };
+        return CS_monitor_run(&opts) < 0 ? 1 : 0;
+    }
+    else if (strcmp(argv[1], CS_Arg_Publish) == 0)
+    {
+        struct cs_publish_options opts = {
+            .device = argc >= 3 ? argv[2] : CS_DEFAULT_DEVICE,
+            .socket_path = argc >= 4 ? argv[3] : CS_SHM_RING_SOCKET,
+        };
+        return CS_publish_run(&opts) < 0 ? 1 : 0;
+    }
+    else if (strcmp(argv[1], CS_Arg_Lowpower) == 0 || strcmp(argv[1], CS_Arg_Lowpower_Baseline) == 0)
+    {
+        struct cs_lowwake_options opts = {
+            .device = argc >= 6 ? argv[5] : CS_DEFAULT_DEVICE,
+            .path = argc >= 3 && strcmp(argv[2], "-") != 0 ? argv[2] : NULL,
+            .seconds = argc >= 4 ? strtod(argv[3], NULL) : 0.0,
+            .interval_ms = argc >= 5 ? strtoul(argv[4], NULL, 0) : 0,
+            .baseline = strcmp(argv[1], CS_Arg_Lowpower_Baseline) == 0,
+        };
+        return CS_lowwake_run(&opts) < 0 ? 1 : 0;
+    }
+    else if (strcmp(argv[1], CS_Arg_Analyze) == 0)
+    {
+        return CS_analyze_audio(argc >= 3 ? strtod(argv[2], NULL) : CS_DEFAULT_DURATION,
+                                argc >= 4 ? strtod(argv[3], NULL) : CS_ANALYZER_TONE_HZ,
+                                argc >= 5 ? argv[4] : CS_DEFAULT_DEVICE,
+                                argc >= 6 ? strtoul(argv[5], NULL, 0) : CS_DEFAULT_CHANNELS) < 0 ? 1 : 0;
+    }
+    else
+    {
+        fprintf(stderr, "Unknown option: %s\n", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Records audio from the default input device and saves it to a WAV file.
+ *
+ * Captures CS_DEFAULT_DURATION seconds at the native rate (48 kHz on the
+ * SAI) and runs every period through the DSP path. The file keeps the
+ * channel layout the device granted, one WAV channel per slot, and marks
+ * only the microphone's CS_MIC_VALID_BITS as valid, so a 32-bit file of
+ * INMP441 data says 24-in-32. When @p out_rate differs from the capture
+ * rate, one polyphase resampler per channel converts on the fly, so e.g. a
+ * 16 kHz speech recording needs no offline pass. Frames lost in an xrun
+ * are reflected in the file's seek table, so seeking by time stays aligned
+ * with the capture clock.
+ *
+ * @param filepath Path to the output WAV file.
+ * @param out_rate Sample rate of the file, 0 to keep the capture rate.
+ * @param bits     Sample size of the file: 16, 24 (packed S24_3LE) or 32.
+ */
+void CS_record_audio(const char *filepath, unsigned int out_rate, unsigned int bits)
+{
+    snd_pcm_t *pcm_handle = NULL;
+    struct cs_pcm_config cfg = {
+        SND_PCM_FORMAT_UNKNOWN, CS_DEFAULT_CHANNELS, CS_DEFAULT_RATE, CS_DEFAULT_FRAMES, 0, 0, 0
+    };
+    struct cs_resampler **resamplers = NULL;
+    struct cs_wav_writer writer;
+    struct cs_wav_format wav_fmt;
+    snd_pcm_format_t out_format = bits == 16 ? SND_PCM_FORMAT_S16_LE :
+                                  bits == 24 ? SND_PCM_FORMAT_S24_3LE : SND_PCM_FORMAT_S32_LE;
+    struct timespec t0, now;
+    unsigned long total_frames, captured = 0;
+    unsigned int channels, valid_bits;
+    size_t out_max, out_frames = 0;
+    char *buffer = NULL;
+    float *work = NULL, *mono_in = NULL, *mono_out = NULL, *resampled = NULL;
+    void *samples = NULL;
+    int err;
+
+    if (bits != 16 && bits != 24 && bits != 32) {
+        fprintf(stderr, "CapgeminiSound ERR: bits must be 16, 24 or 32\n");
+        return;
+    }
+
+    /* Open PCM device for recording */
+    if (CS_pcm_open(&pcm_handle, CS_DEFAULT_DEVICE, SND_PCM_STREAM_CAPTURE, &cfg) < 0) {
+        fprintf(stderr, "CapgeminiSound ERR: Error opening PCM device. check if sound card is available\n");
+        return;
+    }
+    channels = cfg.channels;
+    if (!out_rate)
+        out_rate = cfg.rate;
+    if (out_rate != cfg.rate) {
+        resamplers = calloc(channels, sizeof(*resamplers));
+        for (unsigned int c = 0; resamplers && c < channels; ++c) {
+            resamplers[c] = CS_resampler_create(cfg.rate, out_rate, 0);
+            if (!resamplers[c]) {
+                fprintf(stderr, "CapgeminiSound ERR: cannot resample %u -> %u Hz\n", cfg.rate, out_rate);
+                goto out;
+            }
+        }
+        if (!resamplers) {
+            fprintf(stderr, "CapgeminiSound ERR: out of memory\n");
+            goto out;
+        }
+        printf("Resampling %u -> %u Hz\n", cfg.rate, out_rate);
+    }
+
+    total_frames = CS_DEFAULT_DURATION * cfg.rate; /* TODO to modify this duration */
+    out_max = resamplers ? CS_resampler_max_output(resamplers[0], cfg.period_frames) : cfg.period_frames;
+    buffer = malloc(snd_pcm_frames_to_bytes(pcm_handle, cfg.period_frames));
+    work = malloc(cfg.period_frames * channels * sizeof(float));
+    mono_in = malloc(cfg.period_frames * sizeof(float));
+    mono_out = malloc(out_max * sizeof(float));
+    resampled = malloc(out_max * channels * sizeof(float));
+    samples = malloc(out_max * channels * snd_pcm_format_physical_width(out_format) / 8);
+    if (!buffer || !work || !mono_in || !mono_out || !resampled || !samples) {
+        fprintf(stderr, "CapgeminiSound ERR: out of memory\n");
+        goto out;
+    }
+
+    /* What the capture format carries, capped by what the mic resolves */
+    valid_bits = (unsigned int)snd_pcm_format_width(cfg.format);
+    if (valid_bits > CS_MIC_VALID_BITS)
+        valid_bits = CS_MIC_VALID_BITS;
+    if (valid_bits > bits)
+        valid_bits = bits;
+
+    printf("Recording to: %s (%u ch, %u-bit, %u valid)\n", filepath, channels, bits, valid_bits);
+    strncpy(last_recording_path, filepath, sizeof(last_recording_path) - 1);
+    /* Placeholder header, sizes are patched on close */
+    wav_fmt.rate = out_rate;
+    wav_fmt.channels = (uint16_t)channels;
+    wav_fmt.bits = (uint16_t)bits;
+    wav_fmt.valid_bits = (uint16_t)valid_bits;
+    err = CS_wav_writer_open(&writer, filepath, &wav_fmt);
+    if (err < 0) {
+        fprintf(stderr, "Error opening WAV file: %s\n", strerror(-err));
+        goto out;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    /* Record and write audio data */
+    while (captured < total_frames) {
+        snd_pcm_sframes_t n = snd_pcm_readi(pcm_handle, buffer, cfg.period_frames);
+        const float *stage = work;
+        size_t count;
+
+        if (n < 0) {
+            if (snd_pcm_recover(pcm_handle, (int)n, 0) < 0) {
+                fprintf(stderr, "CapgeminiSound ERR: capture failed: %s\n", snd_strerror((int)n));
+                break;
+            }
+            for (unsigned int c = 0; resamplers && c < channels; ++c)
+                CS_resampler_reset(resamplers[c]);
+            /* The gap is lost audio: keep the seek table on the capture clock */
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            CS_wav_writer_set_time(&writer, (uint64_t)(now.tv_sec - t0.tv_sec) * 1000000ULL +
+                                            (now.tv_nsec - t0.tv_nsec) / 1000);
+            continue;
+        }
+        captured += n;
+
+        CS_dsp_to_float_interleaved(buffer, cfg.format, channels, work, n);
+        count = n;
+        if (resamplers) {
+            /* The resampler is mono: run each slot through its own */
+            for (unsigned int c = 0; c < channels; ++c) {
+                for (snd_pcm_sframes_t i = 0; i < n; ++i)
+                    mono_in[i] = work[i * channels + c];
+                count = CS_resampler_process(resamplers[c], mono_in, n, mono_out, out_max);
+                for (size_t i = 0; i < count; ++i)
+                    resampled[i * channels + c] = mono_out[i];
+            }
+            stage = resampled;
+        }
+        CS_dsp_from_float_interleaved(stage, 1.0f, out_format, channels, samples, count);
+        err = CS_wav_writer_write(&writer, samples, count);
+        if (err < 0) {
+            fprintf(stderr, "CapgeminiSound ERR: write failed: %s\n", strerror(-err));
+            break;
+        }
+        out_frames += count;
+    }
+
+    err = CS_wav_writer_close(&writer);
+    if (err < 0)
+        fprintf(stderr, "CapgeminiSound ERR: cannot finish %s: %s\n", filepath, strerror(-err));
+    else
+        printf("Recording saved to %s (%zu frames)\n", filepath, out_frames);
+
+out:
+    snd_pcm_close(pcm_handle);
+    for (unsigned int c = 0; resamplers && c < channels; ++c)
+        CS_resampler_destroy(resamplers[c]);
+    free(resamplers);
+    free(buffer);
+    free(work);
+    free(mono_in);
+    free(mono_out);
+    free(resampled);
+    free(samples);
+}
+
+/**
+ * @brief Plays a WAV file on the default device.
+ *
+ * The seek table puts playback at @p start_seconds of capture time with a
+ * handful of small reads, whatever the recording length.
+ *
+ * @param filepath      WAV file, NULL for the last recording.
+ * @param start_seconds Capture time to start from.
+ */
+void CS_play_audio(const char *filepath, double start_seconds)
+{
+    const char *target = filepath ? filepath : last_recording_path;
+    struct cs_wav_reader reader;
+    struct cs_pcm_config cfg = { SND_PCM_FORMAT_UNKNOWN, 0, 0, CS_DEFAULT_FRAMES, 0, 0, 0 };
+    snd_pcm_t *pcm = NULL;
+    char *buffer = NULL;
+    int err;
+
+    err = CS_wav_reader_open(&reader, target);
+    if (err < 0) {
+        fprintf(stderr, "CapgeminiSound ERR: cannot open %s: %s\n", target, strerror(-err));
+        return;
+    }
+    if (start_seconds > 0.0 && CS_wav_reader_seek_time(&reader, (uint32_t)(start_seconds * 1000.0)) < 0) {
+        fprintf(stderr, "CapgeminiSound ERR: seek failed\n");
+        goto out;
+    }
+
+    cfg.format = reader.fmt.bits == 16 ? SND_PCM_FORMAT_S16_LE :
+                 reader.fmt.bits == 24 ? SND_PCM_FORMAT_S24_3LE : SND_PCM_FORMAT_S32_LE;
+    cfg.channels = reader.fmt.channels;
+    cfg.rate = reader.fmt.rate;
+    if (CS_pcm_open(&pcm, CS_DEFAULT_DEVICE, SND_PCM_STREAM_PLAYBACK, &cfg) < 0) {
+        fprintf(stderr, "CapgeminiSound ERR: Error opening PCM device. check if sound card is available\n");
+        goto out;
+    }
+    if (cfg.rate != reader.fmt.rate || cfg.channels != reader.fmt.channels) {
+        fprintf(stderr, "CapgeminiSound ERR: device does not take %u Hz, %u ch\n",
+                reader.fmt.rate, reader.fmt.channels);
+        goto out;
+    }
+    buffer = malloc((size_t)cfg.period_frames * reader.block_align);
+    if (!buffer)
+        goto out;
+
+    printf("Playing: %s from %.1f s\n", target, (double)reader.position / reader.fmt.rate);
+    for (;;) {
+        long n = CS_wav_reader_read(&reader, buffer, cfg.period_frames);
+        char *p = buffer;
+
+        if (n <= 0)
+            break;
+        while (n > 0) {
+            snd_pcm_sframes_t w = snd_pcm_writei(pcm, p, (snd_pcm_uframes_t)n);
+
+            if (w < 0) {
+                if (snd_pcm_recover(pcm, (int)w, 0) < 0) {
+                    fprintf(stderr, "CapgeminiSound ERR: playback failed: %s\n", snd_strerror((int)w));
+                    goto out;
+                }
+                continue;
+            }
+            p += w * reader.block_align;
+            n -= w;
+        }
+    }
+    snd_pcm_drain(pcm);
+
+out:
+    if (pcm)
+        snd_pcm_close(pcm);
+    free(buffer);
+    CS_wav_reader_close(&reader);
+}
+
+/**
+ * @brief Prints a WAV file's format and an overview drawn from its peaks.
+ *
+ * Only the header, the seek table size and the peak chunk are read, so this
+ * is instant even for hours of audio.
+ *
+ * @param filepath WAV file.
+ * @return int 0 on success, negative error code otherwise.
+ */
+int CS_info_audio(const char *filepath)
+{
+    static const char levels[] = " .:-=+*#%@";
+    struct cs_wav_reader reader;
+    uint16_t points[64];
+    long n;
+    int err;
+
+    err = CS_wav_reader_open(&reader, filepath);
+    if (err < 0) {
+        fprintf(stderr, "CapgeminiSound ERR: cannot open %s: %s\n", filepath, strerror(-err));
+        return err;
+    }
+    printf("%s: %u Hz, %u ch, %u-bit (%u valid), %.2f s\n", filepath, reader.fmt.rate,
+           reader.fmt.channels, reader.fmt.bits, reader.fmt.valid_bits,
+           (double)reader.frames / reader.fmt.rate);
+    printf("Seek entries: %u, peak blocks: %u\n", reader.seek_count, reader.peak_count);
+
+    n = CS_wav_reader_overview(&reader, points, sizeof(points) / sizeof(points[0]));
+    if (n > 0) {
+        putchar('|');
+        for (long i = 0; i < n; ++i)
+            putchar(levels[(unsigned int)points[i] * (sizeof(levels) - 2) / 32767]);
+        printf("|\n");
+    }
+    CS_wav_reader_close(&reader);
+    return 0;
+}
+
+/**
+ * @brief Analyses the live capture and prints the result as JSON.
+ *
+ * Every period goes through the analyzer as it arrives, so the verdict is
+ * ready as soon as the capture ends; the spectrum work costs well under a
+ * percent of the A7 at 48 kHz. Progress and timing go to stderr so stdout
+ * stays machine-readable for the test station.
+ *
+ * @param seconds  Capture length.
+ * @param tone_hz  Test tone played to the mic, 0 for none (no THD).
+ * @param device   Capture device.
+ * @param channels Channels to capture; each is analysed on its own.
+ * @return int 0 on success, negative error code otherwise.
+ */
+int CS_analyze_audio(double seconds, double tone_hz, const char *device, unsigned int channels)
+{
+    struct cs_pcm_config cfg = {
+        SND_PCM_FORMAT_UNKNOWN, channels, CS_DEFAULT_RATE, CS_DEFAULT_FRAMES, 0, 0, 0
+    };
+    struct cs_analyzer *an = NULL;
+    snd_pcm_t *pcm = NULL;
+    unsigned long long captured = 0, total;
+    struct timespec t0, t1;
+    double cpu = 0.0;
+    char *buffer = NULL;
+    float *work = NULL;
+    int err;
+
+    err = CS_pcm_open(&pcm, device, SND_PCM_STREAM_CAPTURE, &cfg);
+    if (err < 0) {
+        fprintf(stderr, "CapgeminiSound ERR: Error opening PCM device. check if sound card is available\n");
+        return err;
+    }
+    an = CS_analyzer_create(cfg.rate, cfg.channels, 0);
+    buffer = malloc(snd_pcm_frames_to_bytes(pcm, cfg.period_frames));
+    work = malloc(cfg.period_frames * cfg.channels * sizeof(float));
+    if (!an || !buffer || !work) {
+        err = -ENOMEM;
+        goto out;
+    }
+
+    total = (unsigned long long)(seconds * cfg.rate);
+    fprintf(stderr, "Analysing %s: %u Hz, %u ch, %s, %.1f s\n", device, cfg.rate, cfg.channels,
+            snd_pcm_format_name(cfg.format), seconds);
+    while (captured < total) {
+        snd_pcm_sframes_t n = snd_pcm_readi(pcm, buffer, cfg.period_frames);
+
+        if (n < 0) {
+            err = snd_pcm_recover(pcm, (int)n, 0);
+            if (err < 0) {
+                fprintf(stderr, "CapgeminiSound ERR: capture failed: %s\n", snd_strerror((int)n));
+                goto out;
+            }
+            continue;
+        }
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+        CS_dsp_to_float_interleaved(buffer, cfg.format, cfg.channels, work, n);
+        CS_analyzer_feed(an, work, n);
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+        cpu += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+        captured += n;
+    }
+
+    err = CS_analyzer_report(an, tone_hz, stdout);
+    fprintf(stderr, "Analysis: %.1f s of audio, %.1f ms CPU (%.2f %% of real time)\n",
+            (double)captured / cfg.rate, cpu * 1e3, 100.0 * cpu * cfg.rate / (captured ? captured : 1));
+
+out:
+    snd_pcm_close(pcm);
+    CS_analyzer_destroy(an);
+    free(buffer);
+    free(work);
+    return err;
 }
\ No newline at end of file
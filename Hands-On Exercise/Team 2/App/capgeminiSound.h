@@ -0,0 +1,26 @@
+/**
+ * @file
+ * @brief Defaults shared by the capgeminiSound modules
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Moved PCM defaults out of capgeminiSound.c
+ * - 19-10-2026: Microphone resolution for the WAV valid bits
+ */
+#ifndef CAPGEMINISOUND_H
+#define CAPGEMINISOUND_H
+
+/* Placeholder for PCM */
+#define CS_DEFAULT_DURATION 5U
+#define CS_DEFAULT_RATE 48000UL
+#define CS_DEFAULT_CHANNELS 1U
+#define CS_DEFAULT_FORMAT SND_PCM_FORMAT_S16_LE
+#define CS_DEFAULT_FRAMES 1024U
+#define CS_DEFAULT_DEVICE "default"
+/* INMP441 output word: 24 significant bits, MSB-first in a 32-bit slot */
+#define CS_MIC_VALID_BITS 24U
+
+#endif /* CAPGEMINISOUND_H */
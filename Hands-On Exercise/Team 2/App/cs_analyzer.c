@@ -0,0 +1,363 @@
+/**
+ * @file
+ * @brief Spectrum and level analysis of a capture stream for mic QA
+ *
+ * @details Each channel is buffered into CS_fft_size() blocks with a hop
+ * of half a block; the power spectra are summed and averaged at report
+ * time, which also averages out the noise so the floor and the harmonics
+ * read steady after a few seconds. Everything the report needs is kept
+ * incrementally, so feeding costs one FFT per hop per channel and no
+ * allocation.
+ *
+ * THD sums the window main lobe (+/- CS_FFT_LOBE_BINS) around each
+ * harmonic of the measured fundamental, minus the noise floor in the same
+ * bins; THD+N is everything from 20 Hz to 20 kHz outside the fundamental's
+ * lobe.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial analyzer for the production-line mic test
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cs_analyzer.h"
+#include "cs_fft.h"
+
+#define CS_ANALYZER_CLIP 0.999f
+#define CS_ANALYZER_LOW_HZ 20.0
+#define CS_ANALYZER_HIGH_HZ 20000.0
+/* Harmonic peaks are searched this many bins around the expected bin */
+#define CS_ANALYZER_SEARCH_BINS 2
+
+const double CS_analyzer_band_hz[CS_ANALYZER_BANDS] = {
+    63.0, 125.0, 250.0, 500.0, 1000.0, 2000.0, 4000.0, 8000.0, 16000.0
+};
+
+struct cs_analyzer_channel {
+    float *block;                   /* fft size samples, fill valid */
+    unsigned int fill;
+    double *spectrum;               /* summed power, bins */
+    double sum;
+    double sum_sq;
+    float peak;
+    float last;
+    unsigned long clipped;
+    unsigned long run;
+    unsigned long max_run;
+};
+
+struct cs_analyzer {
+    unsigned int rate;
+    unsigned int channels;
+    unsigned int size;
+    unsigned int bins;              /* size / 2 + 1 */
+    unsigned long blocks;           /* per channel */
+    unsigned long long frames;
+    struct cs_fft *fft;
+    float *power;
+    double *avg;                    /* bins, averaged spectrum at report time */
+    double *scratch;                /* bins, for the median */
+    struct cs_analyzer_channel ch[];
+};
+
+static double cs_analyzer_dbfs(double mean_square)
+{
+    /* Full-scale sine (mean square 0.5) is 0 dBFS; floor keeps JSON finite */
+    return 10.0 * log10(2.0 * (mean_square > 1e-20 ? mean_square : 1e-20));
+}
+
+static int cs_analyzer_cmp(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Creates an analyzer for @p channels interleaved channels.
+ *
+ * @param rate     Sample rate in Hz.
+ * @param channels Channel count.
+ * @param fft_size FFT block size (0 = CS_FFT_DEFAULT_SIZE).
+ * @return struct cs_analyzer* New analyzer or NULL on error.
+ */
+struct cs_analyzer *CS_analyzer_create(unsigned int rate, unsigned int channels,
+                                       unsigned int fft_size)
+{
+    struct cs_analyzer *an;
+    struct cs_fft *fft;
+
+    if (!rate || !channels)
+        return NULL;
+    fft = CS_fft_create(fft_size);
+    if (!fft)
+        return NULL;
+    an = calloc(1, sizeof(*an) + channels * sizeof(an->ch[0]));
+    if (!an) {
+        CS_fft_destroy(fft);
+        return NULL;
+    }
+    an->rate = rate;
+    an->channels = channels;
+    an->fft = fft;
+    an->size = CS_fft_size(fft);
+    an->bins = an->size / 2 + 1;
+    an->power = malloc(an->bins * sizeof(*an->power));
+    an->avg = malloc(an->bins * sizeof(*an->avg));
+    an->scratch = malloc(an->bins * sizeof(*an->scratch));
+    if (!an->power || !an->avg || !an->scratch)
+        goto fail;
+    for (unsigned int c = 0; c < channels; ++c) {
+        an->ch[c].block = malloc(an->size * sizeof(float));
+        an->ch[c].spectrum = calloc(an->bins, sizeof(double));
+        if (!an->ch[c].block || !an->ch[c].spectrum)
+            goto fail;
+    }
+    return an;
+
+fail:
+    CS_analyzer_destroy(an);
+    return NULL;
+}
+
+void CS_analyzer_destroy(struct cs_analyzer *an)
+{
+    if (!an)
+        return;
+    for (unsigned int c = 0; c < an->channels; ++c) {
+        free(an->ch[c].block);
+        free(an->ch[c].spectrum);
+    }
+    CS_fft_destroy(an->fft);
+    free(an->power);
+    free(an->avg);
+    free(an->scratch);
+    free(an);
+}
+
+/**
+ * @brief Adds interleaved frames in [-1, 1) to the running analysis.
+ */
+void CS_analyzer_feed(struct cs_analyzer *an, const float *frames, size_t count)
+{
+    const unsigned int hop = an->size / 2;
+
+    for (unsigned int c = 0; c < an->channels; ++c) {
+        struct cs_analyzer_channel *ch = &an->ch[c];
+
+        for (size_t i = 0; i < count; ++i) {
+            float s = frames[i * an->channels + c];
+            float mag = fabsf(s);
+
+            ch->sum += s;
+            ch->sum_sq += (double)s * s;
+            if (mag > ch->peak)
+                ch->peak = mag;
+            if (mag >= CS_ANALYZER_CLIP)
+                ch->clipped++;
+            if (s == ch->last) {
+                if (++ch->run > ch->max_run)
+                    ch->max_run = ch->run;
+            } else {
+                ch->run = 1;
+                ch->last = s;
+            }
+
+            ch->block[ch->fill++] = s;
+            if (ch->fill == an->size) {
+                CS_fft_power(an->fft, ch->block, an->power);
+                for (unsigned int k = 0; k < an->bins; ++k)
+                    ch->spectrum[k] += an->power[k];
+                memmove(ch->block, ch->block + hop, hop * sizeof(float));
+                ch->fill = hop;
+                if (c == 0)
+                    an->blocks++;
+            }
+        }
+    }
+    an->frames += count;
+}
+
+/* Power in +/- CS_FFT_LOBE_BINS around the largest bin near @p k; *peak gets its bin */
+static double cs_analyzer_lobe(const double *p, unsigned int bins, long k, unsigned int *peak)
+{
+    long best = k;
+    double sum = 0.0;
+
+    for (long j = k - CS_ANALYZER_SEARCH_BINS; j <= k + CS_ANALYZER_SEARCH_BINS; ++j)
+        if (j > 0 && j < (long)bins && p[j] > p[best])
+            best = j;
+    for (long j = best - (long)CS_FFT_LOBE_BINS; j <= best + (long)CS_FFT_LOBE_BINS; ++j)
+        if (j > 0 && j < (long)bins)
+            sum += p[j];
+    if (peak)
+        *peak = (unsigned int)best;
+    return sum;
+}
+
+static int cs_analyzer_near_harmonic(double hz, double tone_hz, double bin_hz)
+{
+    double h = floor(hz / tone_hz + 0.5);
+
+    return tone_hz > 0.0 && h >= 1.0 && h <= CS_ANALYZER_HARMONICS &&
+           fabs(hz - h * tone_hz) <= (CS_FFT_LOBE_BINS + CS_ANALYZER_SEARCH_BINS) * bin_hz;
+}
+
+/**
+ * @brief Computes the figures for one channel from everything fed so far.
+ *
+ * @param an      Analyzer.
+ * @param channel Channel index.
+ * @param tone_hz Frequency of the test tone, 0 for none (no THD).
+ * @param res     Output.
+ * @return int 0 on success, -EINVAL for a bad channel.
+ */
+int CS_analyzer_result(struct cs_analyzer *an, unsigned int channel, double tone_hz,
+                       struct cs_analyzer_result *res)
+{
+    struct cs_analyzer_channel *ch;
+    const double bin_hz = (double)an->rate / an->size;
+    const double nyquist = an->rate / 2.0;
+    double *p = an->avg, mean, var, fund = 0.0, floor_bin;
+    unsigned int lo = (unsigned int)ceil(CS_ANALYZER_LOW_HZ / bin_hz);
+    unsigned int hi = (unsigned int)fmin(CS_ANALYZER_HIGH_HZ / bin_hz, an->bins - 1.0);
+    unsigned int n_floor = 0, peak = 0;
+
+    if (channel >= an->channels)
+        return -EINVAL;
+    ch = &an->ch[channel];
+    memset(res, 0, sizeof(*res));
+
+    if (!an->frames) {
+        res->status = "no_data";
+        return 0;
+    }
+    mean = ch->sum / an->frames;
+    var = ch->sum_sq / an->frames - mean * mean;
+    res->dc = mean;
+    res->rms_dbfs = cs_analyzer_dbfs(ch->sum_sq / an->frames);
+    res->peak_dbfs = 20.0 * log10(ch->peak > 1e-10f ? ch->peak : 1e-10f);
+    res->clipped = ch->clipped;
+    res->max_run = ch->max_run;
+    if (cs_analyzer_dbfs(var) < CS_ANALYZER_DEAD_DBFS)
+        res->status = fabs(mean) < 1e-6 ? "dead" : "stuck";
+    else if (ch->max_run >= (unsigned long)an->rate * CS_ANALYZER_STUCK_MS / 1000U)
+        res->status = "stuck";
+    else
+        res->status = "ok";
+
+    if (!an->blocks) {
+        res->noise_floor_dbfs = cs_analyzer_dbfs(0.0);
+        for (unsigned int b = 0; b < CS_ANALYZER_BANDS; ++b)
+            res->band_dbfs[b] = cs_analyzer_dbfs(0.0);
+        return 0;
+    }
+    for (unsigned int k = 0; k < an->bins; ++k)
+        p[k] = ch->spectrum[k] / an->blocks;
+
+    for (unsigned int b = 0; b < CS_ANALYZER_BANDS; ++b) {
+        double f_lo = CS_analyzer_band_hz[b] / M_SQRT2, f_hi = CS_analyzer_band_hz[b] * M_SQRT2;
+        double sum = 0.0;
+
+        for (unsigned int k = (unsigned int)ceil(f_lo / bin_hz); k < an->bins && k * bin_hz < f_hi; ++k)
+            sum += p[k];
+        res->band_dbfs[b] = f_lo < nyquist ? cs_analyzer_dbfs(sum) : cs_analyzer_dbfs(0.0);
+    }
+
+    /* Fundamental first: the noise floor excludes its harmonics */
+    if (tone_hz > 0.0 && tone_hz < nyquist) {
+        fund = cs_analyzer_lobe(p, an->bins, lround(tone_hz / bin_hz), &peak);
+        res->tone_dbfs = cs_analyzer_dbfs(fund);
+        res->tone_present = res->tone_dbfs >= CS_ANALYZER_TONE_MIN_DBFS;
+        if (res->tone_present) {
+            double w = 0.0, c = 0.0;
+
+            /* Power-weighted centroid of the lobe: sub-bin frequency */
+            for (long j = (long)peak - 2; j <= (long)peak + 2; ++j) {
+                if (j > 0 && j < (long)an->bins) {
+                    w += p[j];
+                    c += p[j] * j;
+                }
+            }
+            res->tone_hz = c / w * bin_hz;
+        }
+    }
+
+    for (unsigned int k = lo; k <= hi; ++k)
+        if (!cs_analyzer_near_harmonic(k * bin_hz, res->tone_present ? res->tone_hz : 0.0, bin_hz))
+            an->scratch[n_floor++] = p[k];
+    qsort(an->scratch, n_floor, sizeof(*an->scratch), cs_analyzer_cmp);
+    floor_bin = n_floor ? an->scratch[n_floor / 2] : 0.0;
+    res->noise_floor_dbfs = cs_analyzer_dbfs(floor_bin);
+
+    if (res->tone_present) {
+        double harmonics = 0.0, total = 0.0;
+
+        fund = cs_analyzer_lobe(p, an->bins, peak, NULL);
+        for (unsigned int h = 2; h <= CS_ANALYZER_HARMONICS; ++h) {
+            double hz = h * res->tone_hz, lobe;
+
+            if (hz + CS_FFT_LOBE_BINS * bin_hz >= nyquist)
+                break;
+            lobe = cs_analyzer_lobe(p, an->bins, lround(hz / bin_hz), NULL) -
+                   (2 * CS_FFT_LOBE_BINS + 1) * floor_bin;
+            if (lobe > 0.0)
+                harmonics += lobe;
+        }
+        for (unsigned int k = lo; k <= hi; ++k)
+            if (k + CS_FFT_LOBE_BINS < peak || k > peak + CS_FFT_LOBE_BINS)
+                total += p[k];
+        res->thd_percent = 100.0 * sqrt(harmonics / fund);
+        res->thdn_percent = 100.0 * sqrt(total / fund);
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes the analysis of every channel as one JSON object.
+ *
+ * @param an      Analyzer.
+ * @param tone_hz Test tone frequency, 0 for none.
+ * @param out     Destination stream.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int CS_analyzer_report(struct cs_analyzer *an, double tone_hz, FILE *out)
+{
+    fprintf(out, "{\"rate\":%u,\"channel_count\":%u,\"fft_size\":%u,\"bin_hz\":%.3f,"
+            "\"seconds\":%.3f,\"blocks\":%lu,\"tone_hz\":%.1f,\"channels\":[",
+            an->rate, an->channels, an->size, (double)an->rate / an->size,
+            (double)an->frames / an->rate, an->blocks, tone_hz);
+
+    for (unsigned int c = 0; c < an->channels; ++c) {
+        struct cs_analyzer_result res;
+        int err = CS_analyzer_result(an, c, tone_hz, &res);
+
+        if (err < 0)
+            return err;
+        fprintf(out, "%s{\"channel\":%u,\"status\":\"%s\",\"rms_dbfs\":%.2f,\"peak_dbfs\":%.2f,"
+                "\"dc\":%.6f,\"clipped\":%lu,\"max_run\":%lu,\"noise_floor_dbfs\":%.2f,\"bands\":[",
+                c ? "," : "", c, res.status, res.rms_dbfs, res.peak_dbfs, res.dc, res.clipped,
+                res.max_run, res.noise_floor_dbfs);
+        for (unsigned int b = 0; b < CS_ANALYZER_BANDS; ++b)
+            fprintf(out, "%s{\"hz\":%.0f,\"dbfs\":%.2f}", b ? "," : "",
+                    CS_analyzer_band_hz[b], res.band_dbfs[b]);
+        fprintf(out, "]");
+        if (tone_hz > 0.0) {
+            fprintf(out, ",\"tone\":{\"present\":%s,\"dbfs\":%.2f", res.tone_present ? "true" : "false",
+                    res.tone_dbfs);
+            if (res.tone_present)
+                fprintf(out, ",\"hz\":%.2f,\"thd_percent\":%.4f,\"thdn_percent\":%.4f",
+                        res.tone_hz, res.thd_percent, res.thdn_percent);
+            fprintf(out, "}");
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "]}\n");
+    return ferror(out) ? -EIO : 0;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file
+ * @brief Spectrum and level analysis of a capture stream for mic QA
+ *
+ * @details Fed with interleaved float frames, the analyzer keeps running
+ * per-channel level statistics and an averaged power spectrum (50 %
+ * overlapped CS_fft blocks). From these it derives octave band levels, the
+ * noise floor, THD against a test tone, and flags dead or stuck channels.
+ * It has no ALSA dependency, so the same code runs in capgeminiSound
+ * --analyze and in the host-side cs_bench.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial analyzer for the production-line mic test
+ */
+#ifndef CS_ANALYZER_H
+#define CS_ANALYZER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/* Default test tone of the production-line fixture */
+#define CS_ANALYZER_TONE_HZ 1000.0
+/* Octave bands 63 Hz .. 16 kHz */
+#define CS_ANALYZER_BANDS 9U
+/* Harmonics 2..N counted in THD */
+#define CS_ANALYZER_HARMONICS 9U
+/* Quieter than this RMS the capsule is not delivering anything */
+#define CS_ANALYZER_DEAD_DBFS -100.0
+/* Identical consecutive samples for this long mean a stuck data line */
+#define CS_ANALYZER_STUCK_MS 100U
+/* A test tone below this level counts as absent */
+#define CS_ANALYZER_TONE_MIN_DBFS -60.0
+
+struct cs_analyzer;
+
+struct cs_analyzer_result {
+    const char *status;             /* "ok", "dead", "stuck" or "no_data" */
+    double rms_dbfs;
+    double peak_dbfs;
+    double dc;
+    unsigned long clipped;
+    unsigned long max_run;          /* longest run of identical samples */
+    double noise_floor_dbfs;        /* median bin, excluding tone and harmonics */
+    double band_dbfs[CS_ANALYZER_BANDS];
+    int tone_present;
+    double tone_hz;                 /* measured */
+    double tone_dbfs;
+    double thd_percent;
+    double thdn_percent;
+};
+
+extern const double CS_analyzer_band_hz[CS_ANALYZER_BANDS];
+
+struct cs_analyzer *CS_analyzer_create(unsigned int rate, unsigned int channels,
+                                       unsigned int fft_size);
+void CS_analyzer_destroy(struct cs_analyzer *an);
+void CS_analyzer_feed(struct cs_analyzer *an, const float *frames, size_t count);
+int CS_analyzer_result(struct cs_analyzer *an, unsigned int channel, double tone_hz,
+                       struct cs_analyzer_result *res);
+int CS_analyzer_report(struct cs_analyzer *an, double tone_hz, FILE *out);
+
+#endif /* CS_ANALYZER_H */
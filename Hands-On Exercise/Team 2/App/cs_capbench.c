@@ -0,0 +1,197 @@
+/**
+ * @file
+ * @brief CPU cost per second of audio: capgemini-mic ring vs. ALSA capture
+ *
+ * @details Runs on the board. Both paths capture mono S32_LE at 48 kHz in
+ * 1024-frame blocks and apply the same processing (float conversion + RMS),
+ * so the difference is the cost of the transport:
+ *   cs_capbench ring [seconds [device]]   default /dev/capgemini-mic
+ *   cs_capbench alsa [seconds [device]]   default CS_MONITOR_CAPTURE_DEVICE
+ * CPU time is user + system time of the process from getrusage(); the
+ * wakeups column counts blocking calls (poll or readi).
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Ring vs. ALSA capture benchmark
+ * - 19-10-2026: Refuse an ALSA device that is not mono S32_LE 48 kHz
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "cs_dsp.h"
+#include "cs_micring.h"
+#include "cs_monitor.h"
+#include "cs_pcm.h"
+
+#define CS_CAPBENCH_SECONDS 10U
+#define CS_CAPBENCH_RATE 48000U
+#define CS_CAPBENCH_BLOCK 1024U
+
+struct cs_capbench_result {
+    unsigned long long frames;
+    unsigned long wakeups;
+    unsigned long overruns;
+    double sum_squares;
+};
+
+static double cs_capbench_cpu(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6 +
+           ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+}
+
+static double cs_capbench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* The common "signal processing" of both paths */
+static void cs_capbench_process(struct cs_capbench_result *res, const void *data,
+                                snd_pcm_uframes_t frames, float *scratch)
+{
+    CS_dsp_to_float(data, SND_PCM_FORMAT_S32_LE, 1, scratch, frames);
+    for (snd_pcm_uframes_t i = 0; i < frames; ++i)
+        res->sum_squares += (double)scratch[i] * scratch[i];
+    res->frames += frames;
+}
+
+static int cs_capbench_ring(const char *device, unsigned long long total,
+                            struct cs_capbench_result *res)
+{
+    static float scratch[CS_CAPBENCH_BLOCK];
+    struct cs_micring ring;
+    int err;
+
+    err = CS_micring_open(&ring, device, CS_CAPBENCH_BLOCK * sizeof(int32_t));
+    if (err < 0)
+        return err;
+    err = CS_micring_start(&ring);
+    if (err < 0) {
+        fprintf(stderr, "CapgeminiSound ERR: cannot start ring (%s)\n", strerror(-err));
+        CS_micring_close(&ring);
+        return err;
+    }
+
+    while (res->frames < total) {
+        const void *data;
+        long bytes = CS_micring_peek(&ring, &data);
+
+        if (bytes == -EPIPE) {
+            res->overruns++;
+            CS_micring_recover(&ring);
+            continue;
+        }
+        if (bytes < (long)sizeof(int32_t)) {
+            res->wakeups++;
+            err = CS_micring_wait(&ring, 1000);
+            if (err <= 0) {
+                fprintf(stderr, "CapgeminiSound ERR: ring stalled (%s)\n",
+                        err ? strerror(-err) : "timeout");
+                break;
+            }
+            continue;
+        }
+        if (bytes > (long)sizeof(scratch))
+            bytes = sizeof(scratch);
+        cs_capbench_process(res, data, bytes / sizeof(int32_t), scratch);
+        CS_micring_consume(&ring, bytes - bytes % sizeof(int32_t));
+    }
+
+    CS_micring_stop(&ring);
+    CS_micring_close(&ring);
+    return err < 0 ? err : 0;
+}
+
+static int cs_capbench_alsa(const char *device, unsigned long long total,
+                            struct cs_capbench_result *res)
+{
+    static int32_t buffer[CS_CAPBENCH_BLOCK];
+    static float scratch[CS_CAPBENCH_BLOCK];
+    struct cs_pcm_config cfg = {
+        .format = SND_PCM_FORMAT_S32_LE,
+        .channels = 1,
+        .rate = CS_CAPBENCH_RATE,
+        .period_frames = CS_CAPBENCH_BLOCK,
+        .periods = 16,
+    };
+    snd_pcm_t *pcm;
+    int err;
+
+    err = CS_pcm_open(&pcm, device, SND_PCM_STREAM_CAPTURE, &cfg);
+    if (err < 0)
+        return err;
+    /* Channels and rate are negotiated "near": only mono S32 48 kHz fits buffer[] and the ring */
+    if (cfg.channels != 1 || cfg.format != SND_PCM_FORMAT_S32_LE || cfg.rate != CS_CAPBENCH_RATE) {
+        fprintf(stderr, "CapgeminiSound ERR: %s gives %u ch, %s, %u Hz; need mono S32_LE at %u Hz\n",
+                device, cfg.channels, snd_pcm_format_name(cfg.format), cfg.rate, CS_CAPBENCH_RATE);
+        snd_pcm_close(pcm);
+        return -EINVAL;
+    }
+
+    while (res->frames < total) {
+        snd_pcm_sframes_t n = snd_pcm_readi(pcm, buffer, CS_CAPBENCH_BLOCK);
+
+        res->wakeups++;
+        if (n == -EPIPE) {
+            res->overruns++;
+            snd_pcm_prepare(pcm);
+            continue;
+        }
+        if (n < 0) {
+            fprintf(stderr, "CapgeminiSound ERR: read failed: %s\n", snd_strerror((int)n));
+            err = (int)n;
+            break;
+        }
+        cs_capbench_process(res, buffer, n, scratch);
+    }
+
+    snd_pcm_close(pcm);
+    return err < 0 ? err : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct cs_capbench_result res = { 0 };
+    unsigned int seconds = argc >= 3 ? strtoul(argv[2], NULL, 0) : CS_CAPBENCH_SECONDS;
+    unsigned long long total = (unsigned long long)seconds * CS_CAPBENCH_RATE;
+    double cpu, wall, audio;
+    int ring, err;
+
+    if (argc < 2 || (strcmp(argv[1], "ring") != 0 && strcmp(argv[1], "alsa") != 0) || !seconds) {
+        fprintf(stderr, "Usage: %s ring|alsa [seconds [device]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    ring = strcmp(argv[1], "ring") == 0;
+
+    cpu = cs_capbench_cpu();
+    wall = cs_capbench_now();
+    if (ring)
+        err = cs_capbench_ring(argc >= 4 ? argv[3] : NULL, total, &res);
+    else
+        err = cs_capbench_alsa(argc >= 4 ? argv[3] : CS_MONITOR_CAPTURE_DEVICE, total, &res);
+    cpu = cs_capbench_cpu() - cpu;
+    wall = cs_capbench_now() - wall;
+    if (err < 0 || !res.frames)
+        return EXIT_FAILURE;
+
+    audio = (double)res.frames / CS_CAPBENCH_RATE;
+    printf("%-4s audio %.1f s wall %.1f s cpu %.3f s -> %.2f ms CPU per s of audio, "
+           "%lu wakeups, %lu overruns, rms %.1f dBFS\n",
+           argv[1], audio, wall, cpu, cpu * 1e3 / audio, res.wakeups, res.overruns,
+           10.0 * log10(res.sum_squares / res.frames + 1e-20));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+/**
+ * @file
+ * @brief Clock drift tracking for capture -> playback bridges
+ *
+ * @details Two terms make up the ratio handed to the resampler:
+ * - estimate: frames the playback hardware consumed per second divided by
+ *   the frames the capture hardware produced per second, both measured from
+ *   snd_pcm_status() positions at their hardware timestamps since a
+ *   reference point. This converges to the real clock ratio and removes
+ *   the steady-state drift.
+ * - a PI correction on the filtered playback fill, which pulls the queue
+ *   back to its target after start-up, jitter or a wrong estimate.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial drift estimator / PI controller
+ */
+#include <errno.h>
+#include <string.h>
+#include "cs_drift.h"
+
+/* Periods ignored after (re)start before positions are trusted */
+#define CS_DRIFT_WARMUP_UPDATES 50UL
+/* Minimum time span before the timestamp estimate replaces the nominal ratio */
+#define CS_DRIFT_MIN_SPAN_S 1.0
+/* Low-pass on the fill level; it saw-tooths by one period every cycle */
+#define CS_DRIFT_FILL_ALPHA 0.02
+/* PI gains, error in seconds of excess fill */
+#define CS_DRIFT_KP 0.5
+#define CS_DRIFT_KI 0.05
+/* Clamp of the PI correction (+/- 0.5 %, far above real crystal drift) */
+#define CS_DRIFT_MAX_CORRECTION 0.005
+
+static double cs_drift_seconds(const snd_htimestamp_t *ts)
+{
+    return (double)ts->tv_sec + (double)ts->tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Initialises the controller.
+ *
+ * @param d           Controller.
+ * @param in_rate     Capture rate.
+ * @param out_rate    Playback rate.
+ * @param target_fill Playback frames to keep queued.
+ * @return int 0 on success, -ENOMEM otherwise.
+ */
+int CS_drift_init(struct cs_drift *d, unsigned int in_rate, unsigned int out_rate,
+                  snd_pcm_uframes_t target_fill)
+{
+    memset(d, 0, sizeof(*d));
+    if (snd_pcm_status_malloc(&d->status) < 0)
+        return -ENOMEM;
+    d->nominal = (double)out_rate / in_rate;
+    d->out_rate = out_rate;
+    d->target_fill = (double)target_fill;
+    CS_drift_restart(d);
+    return 0;
+}
+
+void CS_drift_free(struct cs_drift *d)
+{
+    snd_pcm_status_free(d->status);
+    d->status = NULL;
+}
+
+/**
+ * @brief Forgets positions and the integrator, e.g. after an xrun.
+ *
+ * The timestamp estimate is kept: the clocks did not change, only the
+ * stream positions did.
+ */
+void CS_drift_restart(struct cs_drift *d)
+{
+    if (d->estimate == 0.0)
+        d->estimate = d->nominal;
+    d->ratio = d->estimate;
+    d->fill = d->target_fill;
+    d->integral = 0.0;
+    d->last_time = 0.0;
+    d->updates = 0;
+}
+
+/**
+ * @brief Reads the hardware position of a stream at its timestamp.
+ *
+ * For capture that is what was read plus what is waiting; for playback it is
+ * what was written minus what is still queued. @p queued returns the latter.
+ */
+static int cs_drift_position(struct cs_drift *d, snd_pcm_t *pcm, int capture,
+                             unsigned long long app_frames, struct cs_drift_point *pt,
+                             double *queued)
+{
+    snd_htimestamp_t ts;
+    int err = snd_pcm_status(pcm, d->status);
+
+    if (err < 0)
+        return err;
+    snd_pcm_status_get_htstamp(d->status, &ts);
+    pt->time = cs_drift_seconds(&ts);
+    if (capture) {
+        pt->frames = (double)app_frames + (double)snd_pcm_status_get_avail(d->status);
+    } else {
+        double delay = (double)snd_pcm_status_get_delay(d->status);
+
+        pt->frames = (double)app_frames - delay;
+        *queued = delay;
+    }
+    return 0;
+}
+
+/**
+ * @brief Updates the ratio after one bridge cycle.
+ *
+ * @param d        Controller.
+ * @param capture  Capture PCM (timestamps enabled).
+ * @param captured Total frames read from it since the last (re)start.
+ * @param playback Playback PCM (timestamps enabled).
+ * @param written  Total frames written to it since the last (re)start.
+ * @return double Out/in ratio to program into the adaptive resampler.
+ */
+double CS_drift_update(struct cs_drift *d, snd_pcm_t *capture, unsigned long long captured,
+                       snd_pcm_t *playback, unsigned long long written)
+{
+    struct cs_drift_point cap, play;
+    double queued = d->target_fill;
+    double err, corr, dt;
+
+    if (cs_drift_position(d, capture, 1, captured, &cap, NULL) < 0 ||
+        cs_drift_position(d, playback, 0, written, &play, &queued) < 0)
+        return d->ratio;
+
+    d->fill += CS_DRIFT_FILL_ALPHA * (queued - d->fill);
+
+    if (++d->updates == CS_DRIFT_WARMUP_UPDATES) {
+        d->cap_ref = cap;
+        d->play_ref = play;
+    } else if (d->updates > CS_DRIFT_WARMUP_UPDATES &&
+               cap.time - d->cap_ref.time > CS_DRIFT_MIN_SPAN_S &&
+               play.time - d->play_ref.time > CS_DRIFT_MIN_SPAN_S) {
+        double cap_rate = (cap.frames - d->cap_ref.frames) / (cap.time - d->cap_ref.time);
+        double play_rate = (play.frames - d->play_ref.frames) / (play.time - d->play_ref.time);
+
+        if (cap_rate > 0.0 && play_rate > 0.0)
+            d->estimate = play_rate / cap_rate;
+    }
+
+    /* Too much queued means the producer side runs fast: lower the ratio */
+    dt = d->last_time > 0.0 ? play.time - d->last_time : 0.0;
+    d->last_time = play.time;
+    err = (d->fill - d->target_fill) / d->out_rate;
+    d->integral += err * dt;
+    corr = -(CS_DRIFT_KP * err + CS_DRIFT_KI * d->integral);
+    if (corr > CS_DRIFT_MAX_CORRECTION)
+        corr = CS_DRIFT_MAX_CORRECTION;
+    else if (corr < -CS_DRIFT_MAX_CORRECTION)
+        corr = -CS_DRIFT_MAX_CORRECTION;
+
+    d->ratio = d->estimate * (1.0 + corr);
+    return d->ratio;
+}
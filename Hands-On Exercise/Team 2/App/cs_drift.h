@@ -0,0 +1,51 @@
+/**
+ * @file
+ * @brief Clock drift tracking for capture -> playback bridges
+ *
+ * @details When the mic and the speaker are clocked from different
+ * oscillators (another board, another PLL), the bridge between them gains
+ * or loses a few samples per second and ends in an overrun or underrun.
+ * This module estimates the true rate ratio from snd_pcm_status timestamps
+ * (feed-forward) and trims it with a PI loop on the playback fill level, so
+ * the adaptive resampler keeps the fill, and with it the latency, constant.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial drift estimator / PI controller
+ */
+#ifndef CS_DRIFT_H
+#define CS_DRIFT_H
+
+#include <alsa/asoundlib.h>
+
+/* Position of one stream at a hardware timestamp */
+struct cs_drift_point {
+    double time;
+    double frames;
+};
+
+struct cs_drift {
+    double nominal;          /* out/in rate ratio from the negotiated rates */
+    double estimate;         /* out/in ratio measured from timestamps */
+    double ratio;            /* ratio handed to the resampler */
+    double target_fill;      /* playback frames queued, wanted */
+    double fill;             /* low-pass filtered queued frames */
+    double integral;
+    double out_rate;
+    double last_time;
+    unsigned long updates;
+    struct cs_drift_point cap_ref, play_ref;
+    snd_pcm_status_t *status;
+};
+
+int CS_drift_init(struct cs_drift *d, unsigned int in_rate, unsigned int out_rate,
+                  snd_pcm_uframes_t target_fill);
+void CS_drift_free(struct cs_drift *d);
+void CS_drift_restart(struct cs_drift *d);
+double CS_drift_update(struct cs_drift *d, snd_pcm_t *capture, unsigned long long captured,
+                       snd_pcm_t *playback, unsigned long long written);
+
+#endif /* CS_DRIFT_H */
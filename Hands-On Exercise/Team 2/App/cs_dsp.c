@@ -0,0 +1,214 @@
+/**
+ * @file
+ * @brief Sample conversion and gain stage of the capgeminiSound DSP path
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial DSP path for monitor mode
+ * - 19-10-2026: Per-channel float conversion for the analyzer
+ * - 19-10-2026: Packed S24_3LE for 24-bit files
+ * - 19-10-2026: Interleaved float to PCM for multichannel recordings
+ * - 19-10-2026: Mono mixdown skips silent slots instead of averaging them in
+ */
+#include <stdint.h>
+#include "cs_dsp.h"
+
+#define CS_DSP_S16_SCALE 32768.0f
+#define CS_DSP_S24_SCALE 8388608.0f
+#define CS_DSP_S32_SCALE 2147483648.0f
+/* Slots tracked by the mono mixdown; more are averaged blindly */
+#define CS_DSP_MAX_CHANNELS 8U
+/* Mean square of a silent slot: -100 dBFS, below the INMP441's -87 dBFS noise */
+#define CS_DSP_SILENT_MS 1e-10f
+
+/**
+ * @brief Tells whether the DSP path can convert a given PCM format.
+ *
+ * @param format ALSA sample format.
+ * @return int 1 if supported, 0 otherwise.
+ */
+int CS_dsp_format_supported(snd_pcm_format_t format)
+{
+    return format == SND_PCM_FORMAT_S16_LE ||
+           format == SND_PCM_FORMAT_S24_LE ||
+           format == SND_PCM_FORMAT_S24_3LE ||
+           format == SND_PCM_FORMAT_S32_LE;
+}
+
+static inline float cs_dsp_sample(const void *in, snd_pcm_format_t format, size_t idx)
+{
+    switch (format) {
+    case SND_PCM_FORMAT_S16_LE:
+        return (float)((const int16_t *)in)[idx] / CS_DSP_S16_SCALE;
+    case SND_PCM_FORMAT_S24_LE:
+        /* 24 bits right-justified in 32, sign-extend from bit 23 */
+        return (float)((int32_t)((uint32_t)((const int32_t *)in)[idx] << 8) >> 8)
+               / CS_DSP_S24_SCALE;
+    case SND_PCM_FORMAT_S24_3LE: {
+        const uint8_t *p = (const uint8_t *)in + idx * 3;
+
+        return (float)((int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 |
+                                 (uint32_t)p[2] << 24) >> 8) / CS_DSP_S24_SCALE;
+    }
+    case SND_PCM_FORMAT_S32_LE:
+        return (float)((const int32_t *)in)[idx] / CS_DSP_S32_SCALE;
+    default:
+        return 0.0f;
+    }
+}
+
+/**
+ * @brief Converts interleaved PCM samples to a mono float buffer.
+ *
+ * Multichannel input is mixed down to mono from the slots that carry
+ * signal in this block: a single INMP441 on a stereo SAI frame comes out at
+ * its own level instead of 6 dB down against a silent slot, and two live
+ * mics are averaged. A slot counts as silent below CS_DSP_SILENT_MS, under
+ * the capsule's self-noise, so a live mic never flips between the two.
+ *
+ * @param in       Interleaved input samples.
+ * @param format   Input format (see CS_dsp_format_supported()).
+ * @param channels Input channel count.
+ * @param out      Output buffer, @p frames floats in [-1, 1).
+ * @param frames   Number of frames to convert.
+ */
+void CS_dsp_to_float(const void *in, snd_pcm_format_t format, unsigned int channels,
+                     float *out, snd_pcm_uframes_t frames)
+{
+    float energy[CS_DSP_MAX_CHANNELS] = { 0.0f };
+    int live[CS_DSP_MAX_CHANNELS];
+    unsigned int n_live = 0;
+    float norm;
+
+    if (channels == 1) {
+        for (snd_pcm_uframes_t i = 0; i < frames; ++i)
+            out[i] = cs_dsp_sample(in, format, i);
+        return;
+    }
+    if (channels <= CS_DSP_MAX_CHANNELS && frames) {
+        for (snd_pcm_uframes_t i = 0; i < frames; ++i) {
+            for (unsigned int c = 0; c < channels; ++c) {
+                float v = cs_dsp_sample(in, format, i * channels + c);
+
+                energy[c] += v * v;
+            }
+        }
+        for (unsigned int c = 0; c < channels; ++c) {
+            live[c] = energy[c] > CS_DSP_SILENT_MS * (float)frames;
+            n_live += live[c];
+        }
+    }
+    /* All silent, or too many slots to track: plain average */
+    if (!n_live) {
+        for (unsigned int c = 0; c < channels && c < CS_DSP_MAX_CHANNELS; ++c)
+            live[c] = 1;
+        n_live = channels;
+    }
+    norm = 1.0f / (float)n_live;
+
+    for (snd_pcm_uframes_t i = 0; i < frames; ++i) {
+        float acc = 0.0f;
+
+        for (unsigned int c = 0; c < channels; ++c)
+            if (c >= CS_DSP_MAX_CHANNELS || live[c])
+                acc += cs_dsp_sample(in, format, i * channels + c);
+        out[i] = acc * norm;
+    }
+}
+
+/**
+ * @brief Converts interleaved PCM samples to interleaved float, channels kept.
+ *
+ * For stages that look at each slot on its own, e.g. the analyzer telling
+ * a dead mic from a live one on the same SAI frame.
+ *
+ * @param in       Interleaved input samples.
+ * @param format   Input format (see CS_dsp_format_supported()).
+ * @param channels Channel count.
+ * @param out      Output buffer, @p frames * @p channels floats in [-1, 1).
+ * @param frames   Number of frames to convert.
+ */
+void CS_dsp_to_float_interleaved(const void *in, snd_pcm_format_t format, unsigned int channels,
+                                 float *out, snd_pcm_uframes_t frames)
+{
+    for (size_t i = 0; i < (size_t)frames * channels; ++i)
+        out[i] = cs_dsp_sample(in, format, i);
+}
+
+static inline void cs_dsp_store(void *out, snd_pcm_format_t format, size_t idx, float s)
+{
+    if (s > 0.999999f)
+        s = 0.999999f;
+    else if (s < -1.0f)
+        s = -1.0f;
+
+    switch (format) {
+    case SND_PCM_FORMAT_S16_LE:
+        ((int16_t *)out)[idx] = (int16_t)(s * CS_DSP_S16_SCALE);
+        break;
+    case SND_PCM_FORMAT_S24_LE:
+        ((int32_t *)out)[idx] = (int32_t)(s * CS_DSP_S24_SCALE);
+        break;
+    case SND_PCM_FORMAT_S24_3LE: {
+        uint8_t *p = (uint8_t *)out + idx * 3;
+        uint32_t v = (uint32_t)(int32_t)(s * CS_DSP_S24_SCALE);
+
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+        p[2] = (uint8_t)(v >> 16);
+        break;
+    }
+    case SND_PCM_FORMAT_S32_LE:
+        ((int32_t *)out)[idx] = (int32_t)((double)s * CS_DSP_S32_SCALE);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Applies gain and converts a mono float buffer to interleaved PCM.
+ *
+ * The mono signal is copied to every output channel and clipped to full
+ * scale.
+ *
+ * @param in       Mono float input.
+ * @param gain     Linear gain applied before clipping.
+ * @param format   Output format (see CS_dsp_format_supported()).
+ * @param channels Output channel count.
+ * @param out      Interleaved output buffer.
+ * @param frames   Number of frames to convert.
+ */
+void CS_dsp_from_float(const float *in, float gain, snd_pcm_format_t format,
+                       unsigned int channels, void *out, snd_pcm_uframes_t frames)
+{
+    for (snd_pcm_uframes_t i = 0; i < frames; ++i) {
+        float s = in[i] * gain;
+
+        for (unsigned int c = 0; c < channels; ++c)
+            cs_dsp_store(out, format, i * channels + c, s);
+    }
+}
+
+/**
+ * @brief Applies gain and converts interleaved float to interleaved PCM.
+ *
+ * The counterpart of CS_dsp_to_float_interleaved(): every channel keeps
+ * its own signal, clipped to full scale.
+ *
+ * @param in       Interleaved float input, @p frames * @p channels values.
+ * @param gain     Linear gain applied before clipping.
+ * @param format   Output format (see CS_dsp_format_supported()).
+ * @param channels Channel count.
+ * @param out      Interleaved output buffer.
+ * @param frames   Number of frames to convert.
+ */
+void CS_dsp_from_float_interleaved(const float *in, float gain, snd_pcm_format_t format,
+                                   unsigned int channels, void *out, snd_pcm_uframes_t frames)
+{
+    for (size_t i = 0; i < (size_t)frames * channels; ++i)
+        cs_dsp_store(out, format, i, in[i] * gain);
+}
@@ -0,0 +1,35 @@
+/**
+ * @file
+ * @brief Sample conversion and gain stage of the capgeminiSound DSP path
+ *
+ * @details Capture data is brought into a mono float work buffer, processed
+ * there and written back in whatever format/channel count the playback or
+ * file side negotiated. Keeping one internal representation means new stages
+ * only have to handle float.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial DSP path for monitor mode
+ * - 19-10-2026: Per-channel float conversion for the analyzer
+ * - 19-10-2026: Packed S24_3LE for 24-bit files
+ * - 19-10-2026: Interleaved float to PCM for multichannel recordings
+ */
+#ifndef CS_DSP_H
+#define CS_DSP_H
+
+#include <alsa/asoundlib.h>
+
+int CS_dsp_format_supported(snd_pcm_format_t format);
+void CS_dsp_to_float(const void *in, snd_pcm_format_t format, unsigned int channels,
+                     float *out, snd_pcm_uframes_t frames);
+void CS_dsp_to_float_interleaved(const void *in, snd_pcm_format_t format, unsigned int channels,
+                                 float *out, snd_pcm_uframes_t frames);
+void CS_dsp_from_float(const float *in, float gain, snd_pcm_format_t format,
+                       unsigned int channels, void *out, snd_pcm_uframes_t frames);
+void CS_dsp_from_float_interleaved(const float *in, float gain, snd_pcm_format_t format,
+                                   unsigned int channels, void *out, snd_pcm_uframes_t frames);
+
+#endif /* CS_DSP_H */
@@ -0,0 +1,235 @@
+/**
+ * @file
+ * @brief Windowed real FFT for the capgeminiSound analysis stage
+ *
+ * @details The N real samples are packed as N/2 complex values
+ * z[k] = x[2k] + i x[2k+1] straight into bit-reversed order, transformed by
+ * an iterative radix-2 DIT FFT, then split into the spectrum of the real
+ * signal with X[k] = E[k] + W^k O[k], where E and O are the transforms of
+ * the even and odd samples recovered from Z[k] and conj(Z[N/2 - k]).
+ *
+ * Data is kept split (separate re[] / im[]) so a stage with half-size
+ * m >= 4 is a run of contiguous butterflies with contiguous twiddles: each
+ * stage has its own twiddle table at offset m (aligned once m >= 4), and
+ * four butterflies map onto one set of 4-wide SIMD loads.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial real FFT for analysis mode
+ */
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cs_fft.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CS_FFT_NEON 1
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define CS_FFT_SSE 1
+#endif
+
+#define CS_FFT_SIMD_WIDTH 4U
+#define CS_FFT_ALIGN 16U
+
+struct cs_fft {
+    unsigned int n;      /* real input size */
+    unsigned int half;   /* complex FFT size, n / 2 */
+    float *re;           /* half, work buffer */
+    float *im;
+    float *tw_re;        /* half, per-stage twiddles, stage m at m */
+    float *tw_im;
+    float *post_re;      /* half + 1, cos(2 pi k / n) */
+    float *post_im;      /* sin(2 pi k / n) */
+    float *window;       /* n */
+    unsigned int *bitrev;
+    float scale;         /* 2 / (n * sum(window^2)) */
+};
+
+static float *cs_fft_alloc(size_t count)
+{
+    void *mem;
+
+    if (posix_memalign(&mem, CS_FFT_ALIGN, count * sizeof(float)))
+        return NULL;
+    return mem;
+}
+
+/* All butterflies of one stage: pairs (j, j + m) in every group of 2m */
+static void cs_fft_stage(float *re, float *im, unsigned int n, unsigned int m,
+                         const float *twr, const float *twi)
+{
+    for (unsigned int g = 0; g < n; g += 2 * m) {
+        float *ar = re + g, *ai = im + g, *br = re + g + m, *bi = im + g + m;
+        unsigned int j = 0;
+
+#if defined(CS_FFT_NEON)
+        for (; j + CS_FFT_SIMD_WIDTH <= m; j += CS_FFT_SIMD_WIDTH) {
+            float32x4_t xr = vld1q_f32(ar + j), xi = vld1q_f32(ai + j);
+            float32x4_t yr = vld1q_f32(br + j), yi = vld1q_f32(bi + j);
+            float32x4_t wr = vld1q_f32(twr + j), wi = vld1q_f32(twi + j);
+            float32x4_t tr = vmlsq_f32(vmulq_f32(yr, wr), yi, wi);
+            float32x4_t ti = vmlaq_f32(vmulq_f32(yr, wi), yi, wr);
+
+            vst1q_f32(ar + j, vaddq_f32(xr, tr));
+            vst1q_f32(ai + j, vaddq_f32(xi, ti));
+            vst1q_f32(br + j, vsubq_f32(xr, tr));
+            vst1q_f32(bi + j, vsubq_f32(xi, ti));
+        }
+#elif defined(CS_FFT_SSE)
+        for (; j + CS_FFT_SIMD_WIDTH <= m; j += CS_FFT_SIMD_WIDTH) {
+            __m128 xr = _mm_load_ps(ar + j), xi = _mm_load_ps(ai + j);
+            __m128 yr = _mm_load_ps(br + j), yi = _mm_load_ps(bi + j);
+            __m128 wr = _mm_load_ps(twr + j), wi = _mm_load_ps(twi + j);
+            __m128 tr = _mm_sub_ps(_mm_mul_ps(yr, wr), _mm_mul_ps(yi, wi));
+            __m128 ti = _mm_add_ps(_mm_mul_ps(yr, wi), _mm_mul_ps(yi, wr));
+
+            _mm_store_ps(ar + j, _mm_add_ps(xr, tr));
+            _mm_store_ps(ai + j, _mm_add_ps(xi, ti));
+            _mm_store_ps(br + j, _mm_sub_ps(xr, tr));
+            _mm_store_ps(bi + j, _mm_sub_ps(xi, ti));
+        }
+#endif
+        for (; j < m; ++j) {
+            float tr = br[j] * twr[j] - bi[j] * twi[j];
+            float ti = br[j] * twi[j] + bi[j] * twr[j];
+
+            br[j] = ar[j] - tr;
+            bi[j] = ai[j] - ti;
+            ar[j] += tr;
+            ai[j] += ti;
+        }
+    }
+}
+
+/**
+ * @brief Creates an FFT of @p size real points with its window and tables.
+ *
+ * @param size Power of two, at least 16 (0 = CS_FFT_DEFAULT_SIZE).
+ * @return struct cs_fft* New FFT or NULL on error.
+ */
+struct cs_fft *CS_fft_create(unsigned int size)
+{
+    struct cs_fft *fft;
+    unsigned int bits = 0;
+    double sum_sq = 0.0;
+
+    if (!size)
+        size = CS_FFT_DEFAULT_SIZE;
+    if (size < CS_FFT_MIN_SIZE || (size & (size - 1)))
+        return NULL;
+
+    fft = calloc(1, sizeof(*fft));
+    if (!fft)
+        return NULL;
+    fft->n = size;
+    fft->half = size / 2;
+    fft->re = cs_fft_alloc(fft->half);
+    fft->im = cs_fft_alloc(fft->half);
+    fft->tw_re = cs_fft_alloc(fft->half);
+    fft->tw_im = cs_fft_alloc(fft->half);
+    fft->post_re = cs_fft_alloc(fft->half + 1);
+    fft->post_im = cs_fft_alloc(fft->half + 1);
+    fft->window = cs_fft_alloc(size);
+    fft->bitrev = malloc(fft->half * sizeof(*fft->bitrev));
+    if (!fft->re || !fft->im || !fft->tw_re || !fft->tw_im || !fft->post_re ||
+        !fft->post_im || !fft->window || !fft->bitrev) {
+        CS_fft_destroy(fft);
+        return NULL;
+    }
+
+    while ((1U << bits) < fft->half)
+        bits++;
+    for (unsigned int k = 0; k < fft->half; ++k) {
+        unsigned int r = 0;
+
+        for (unsigned int b = 0; b < bits; ++b)
+            r |= ((k >> b) & 1U) << (bits - 1 - b);
+        fft->bitrev[k] = r;
+    }
+
+    for (unsigned int m = 1; m < fft->half; m *= 2) {
+        for (unsigned int j = 0; j < m; ++j) {
+            fft->tw_re[m + j] = (float)cos(M_PI * j / m);
+            fft->tw_im[m + j] = (float)-sin(M_PI * j / m);
+        }
+    }
+    for (unsigned int k = 0; k <= fft->half; ++k) {
+        fft->post_re[k] = (float)cos(2.0 * M_PI * k / size);
+        fft->post_im[k] = (float)sin(2.0 * M_PI * k / size);
+    }
+
+    /* 4-term Blackman-Harris, periodic form */
+    for (unsigned int i = 0; i < size; ++i) {
+        double t = 2.0 * M_PI * i / size;
+        double w = 0.35875 - 0.48829 * cos(t) + 0.14128 * cos(2.0 * t) - 0.01168 * cos(3.0 * t);
+
+        fft->window[i] = (float)w;
+        sum_sq += w * w;
+    }
+    fft->scale = (float)(2.0 / (size * sum_sq));
+    return fft;
+}
+
+void CS_fft_destroy(struct cs_fft *fft)
+{
+    if (!fft)
+        return;
+    free(fft->re);
+    free(fft->im);
+    free(fft->tw_re);
+    free(fft->tw_im);
+    free(fft->post_re);
+    free(fft->post_im);
+    free(fft->window);
+    free(fft->bitrev);
+    free(fft);
+}
+
+unsigned int CS_fft_size(const struct cs_fft *fft)
+{
+    return fft->n;
+}
+
+/**
+ * @brief Windows a block and computes its one-sided power spectrum.
+ *
+ * @param fft   FFT instance.
+ * @param in    CS_fft_size() mono samples.
+ * @param power Output, CS_fft_size() / 2 + 1 bins in mean-square units
+ *              (bin k is k * rate / size Hz).
+ */
+void CS_fft_power(struct cs_fft *fft, const float *in, float *power)
+{
+    const unsigned int half = fft->half;
+    float *re = fft->re, *im = fft->im;
+
+    for (unsigned int k = 0; k < half; ++k) {
+        unsigned int r = fft->bitrev[k];
+
+        re[r] = in[2 * k] * fft->window[2 * k];
+        im[r] = in[2 * k + 1] * fft->window[2 * k + 1];
+    }
+    for (unsigned int m = 1; m < half; m *= 2)
+        cs_fft_stage(re, im, half, m, fft->tw_re + m, fft->tw_im + m);
+
+    /* Bins 0 and N/2 are real: E[0] +/- O[0] */
+    power[0] = (re[0] + im[0]) * (re[0] + im[0]) * fft->scale * 0.5f;
+    power[half] = (re[0] - im[0]) * (re[0] - im[0]) * fft->scale * 0.5f;
+    for (unsigned int k = 1; k < half; ++k) {
+        float zr = re[k], zi = im[k], cr = re[half - k], ci = -im[half - k];
+        float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+        /* O = (Z[k] - conj(Z[N/2 - k])) / 2i */
+        float or_ = 0.5f * (zi - ci), oi = -0.5f * (zr - cr);
+        float c = fft->post_re[k], s = fft->post_im[k];
+        float xr = er + or_ * c + oi * s;
+        float xi = ei + oi * c - or_ * s;
+
+        power[k] = (xr * xr + xi * xi) * fft->scale;
+    }
+}
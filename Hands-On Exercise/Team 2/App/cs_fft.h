@@ -0,0 +1,41 @@
+/**
+ * @file
+ * @brief Windowed real FFT for the capgeminiSound analysis stage
+ *
+ * @details Turns a block of CS_fft_size() mono float samples into a
+ * one-sided power spectrum. A real FFT of size N is computed as a complex
+ * FFT of N/2 points plus one post-processing pass, and the radix-2
+ * butterflies run four at a time on NEON (Cortex-A7) or SSE (x86), with a
+ * scalar fallback elsewhere.
+ *
+ * The window is a 4-term Blackman-Harris (-92 dB sidelobes), so harmonics
+ * 60-80 dB under a test tone are not buried in leakage. Power is scaled to
+ * mean-square units: summing the bins of a band gives the band's power, and
+ * a full-scale sine sums to 0.5 (0 dBFS).
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial real FFT for analysis mode
+ */
+#ifndef CS_FFT_H
+#define CS_FFT_H
+
+#include <stddef.h>
+
+/* Default block: 4096 points is 11.7 Hz bins at 48 kHz */
+#define CS_FFT_DEFAULT_SIZE 4096U
+#define CS_FFT_MIN_SIZE 16U
+/* Main lobe half-width of the window, in bins */
+#define CS_FFT_LOBE_BINS 4U
+
+struct cs_fft;
+
+struct cs_fft *CS_fft_create(unsigned int size);
+void CS_fft_destroy(struct cs_fft *fft);
+unsigned int CS_fft_size(const struct cs_fft *fft);
+void CS_fft_power(struct cs_fft *fft, const float *in, float *power);
+
+#endif /* CS_FFT_H */
@@ -0,0 +1,284 @@
+/**
+ * @file
+ * @brief Low-wakeup background capture for battery-powered units
+ *
+ * @details Without period interrupts nothing moves the PCM's hardware
+ * pointer between our reads, so every timer tick starts with
+ * snd_pcm_avail(), which syncs it with the DMA position, and
+ * snd_pcm_htimestamp(), which stamps that position. The stamps give the
+ * real capture rate over the run and, after an xrun, the time to put in the
+ * file's seek table. When the driver cannot disable period wakeups the mode
+ * still works with the largest buffer and fewest periods; the report says
+ * which one ran.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial low-wakeup capture mode
+ */
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <alsa/asoundlib.h>
+#include "capgeminiSound.h"
+#include "cs_lowwake.h"
+#include "cs_pcm.h"
+#include "cs_wav.h"
+
+struct cs_lowwake_stats {
+    unsigned long long frames;
+    unsigned long wakeups;
+    unsigned long xruns;
+    snd_pcm_uframes_t max_fill;
+    /* first and last stamped hardware position, for the measured rate */
+    unsigned long long pos0, pos1;
+    struct timespec ts0, ts1;
+};
+
+static volatile sig_atomic_t cs_lowwake_running = 1;
+
+static void cs_lowwake_signal(int sig)
+{
+    (void)sig;
+    cs_lowwake_running = 0;
+}
+
+static double cs_lowwake_elapsed(const struct timespec *a, const struct timespec *b)
+{
+    return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) * 1e-9;
+}
+
+static double cs_lowwake_cpu(const struct rusage *ru)
+{
+    return ru->ru_utime.tv_sec + ru->ru_stime.tv_sec +
+           (ru->ru_utime.tv_usec + ru->ru_stime.tv_usec) * 1e-6;
+}
+
+/* Samples as the file stores them; S24_LE is moved to the top of its slot */
+static int cs_lowwake_store(struct cs_wav_writer *wav, snd_pcm_format_t format, void *buf,
+                            size_t frames, unsigned int channels)
+{
+    if (!wav->file)
+        return 0;
+    if (format == SND_PCM_FORMAT_S24_LE) {
+        int32_t *s = buf;
+
+        for (size_t i = 0; i < frames * channels; ++i)
+            s[i] = (int32_t)((uint32_t)s[i] << 8);
+    }
+    return CS_wav_writer_write(wav, buf, frames);
+}
+
+static void cs_lowwake_xrun(snd_pcm_t *pcm, int err, struct cs_lowwake_stats *st,
+                            struct cs_wav_writer *wav, const struct timespec *t0)
+{
+    struct timespec now;
+
+    st->xruns++;
+    if (snd_pcm_recover(pcm, err, 1) < 0 || snd_pcm_start(pcm) < 0)
+        cs_lowwake_running = 0;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (wav->file)
+        CS_wav_writer_set_time(wav, (uint64_t)(cs_lowwake_elapsed(t0, &now) * 1e6));
+}
+
+/**
+ * @brief Captures in low-wakeup (or baseline) mode and reports the cost.
+ *
+ * @param opts Device, output, duration and timer interval.
+ * @return int 0 on success, negative error code otherwise.
+ */
+int CS_lowwake_run(const struct cs_lowwake_options *opts)
+{
+    struct cs_pcm_config cfg = {
+        SND_PCM_FORMAT_UNKNOWN, CS_DEFAULT_CHANNELS, CS_DEFAULT_RATE, 0, 0, 0,
+        CS_PCM_MAX_BUFFER | CS_PCM_NO_PERIOD_WAKEUP
+    };
+    struct cs_lowwake_stats st = { 0 };
+    struct cs_wav_writer wav = { 0 };
+    struct itimerspec its = { 0 };
+    struct rusage ru0, ru1;
+    struct timespec t0, t1;
+    struct sigaction sa;
+    snd_pcm_t *pcm = NULL;
+    unsigned long long limit;
+    unsigned int interval_ms = 0, max_ms;
+    char *buffer = NULL;
+    double wall, cpu, per_hour;
+    int tfd = -1, err;
+
+    if (opts->baseline) {
+        cfg.period_frames = CS_DEFAULT_FRAMES;
+        cfg.flags = 0;
+    }
+
+    /* No SA_RESTART: the timerfd read / readi has to return on Ctrl+C */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = cs_lowwake_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    err = CS_pcm_open(&pcm, opts->device, SND_PCM_STREAM_CAPTURE, &cfg);
+    if (err < 0)
+        return err;
+    CS_pcm_enable_tstamp(pcm);
+
+    buffer = malloc(snd_pcm_frames_to_bytes(pcm, cfg.buffer_frames));
+    if (!buffer) {
+        err = -ENOMEM;
+        goto out;
+    }
+    if (opts->path) {
+        struct cs_wav_format fmt = {
+            cfg.rate, (uint16_t)cfg.channels,
+            (uint16_t)snd_pcm_format_physical_width(cfg.format),
+            (uint16_t)snd_pcm_format_width(cfg.format)
+        };
+
+        err = CS_wav_writer_open(&wav, opts->path, &fmt);
+        if (err < 0) {
+            fprintf(stderr, "CapgeminiSound ERR: cannot create %s: %s\n", opts->path, strerror(-err));
+            goto out;
+        }
+    }
+
+    if (!opts->baseline) {
+        max_ms = (unsigned int)(cfg.buffer_frames * 1000ULL / cfg.rate / CS_LOWWAKE_MAX_FILL_DIVISOR);
+        interval_ms = opts->interval_ms ? opts->interval_ms : max_ms;
+        if (interval_ms > max_ms) {
+            fprintf(stderr, "CapgeminiSound WARN: %u ms would overrun a %lu-frame buffer, using %u ms\n",
+                    interval_ms, cfg.buffer_frames, max_ms);
+            interval_ms = max_ms;
+        }
+        if (!interval_ms)
+            interval_ms = 1;
+        tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        if (tfd < 0) {
+            err = -errno;
+            goto out;
+        }
+        its.it_interval.tv_sec = interval_ms / 1000U;
+        its.it_interval.tv_nsec = (long)(interval_ms % 1000U) * 1000000L;
+        its.it_value = its.it_interval;
+    }
+
+    printf("%s capture: %s, %u Hz, %u ch, %s, buffer %lu frames (%.0f ms), period wakeups %s",
+           opts->baseline ? "Baseline" : "Low-wakeup", opts->device, cfg.rate, cfg.channels,
+           snd_pcm_format_name(cfg.format), cfg.buffer_frames, cfg.buffer_frames * 1000.0 / cfg.rate,
+           cfg.flags & CS_PCM_NO_PERIOD_WAKEUP ? "off" : "on");
+    if (opts->baseline)
+        printf(", %lu-frame reads\n", cfg.period_frames);
+    else
+        printf(", timer %u ms\n", interval_ms);
+    fflush(stdout);
+
+    limit = (unsigned long long)(opts->seconds * cfg.rate);
+    getrusage(RUSAGE_SELF, &ru0);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    err = snd_pcm_start(pcm);
+    if (err < 0)
+        goto out;
+    if (tfd >= 0)
+        timerfd_settime(tfd, 0, &its, NULL);
+
+    while (cs_lowwake_running && (!limit || st.frames < limit)) {
+        snd_pcm_sframes_t avail, n;
+        snd_pcm_uframes_t stamped;
+        snd_htimestamp_t ts;
+        uint64_t expirations;
+
+        if (opts->baseline) {
+            n = snd_pcm_readi(pcm, buffer, cfg.period_frames);
+            st.wakeups++;
+            if (n == -EINTR)
+                continue;
+            if (n < 0) {
+                cs_lowwake_xrun(pcm, (int)n, &st, &wav, &t0);
+                continue;
+            }
+            if (cs_lowwake_store(&wav, cfg.format, buffer, n, cfg.channels) < 0) {
+                err = -EIO;
+                break;
+            }
+            st.frames += n;
+            continue;
+        }
+
+        if (read(tfd, &expirations, sizeof(expirations)) < 0) {
+            if (errno == EINTR)
+                continue;
+            err = -errno;
+            break;
+        }
+        st.wakeups++;
+
+        /* Sync the hardware pointer: there was no interrupt to do it */
+        avail = snd_pcm_avail(pcm);
+        if (avail < 0) {
+            cs_lowwake_xrun(pcm, (int)avail, &st, &wav, &t0);
+            continue;
+        }
+        if (snd_pcm_htimestamp(pcm, &stamped, &ts) == 0 && (ts.tv_sec || ts.tv_nsec)) {
+            if (!st.ts0.tv_sec && !st.ts0.tv_nsec) {
+                st.pos0 = st.frames + stamped;
+                st.ts0 = ts;
+            }
+            st.pos1 = st.frames + stamped;
+            st.ts1 = ts;
+        }
+        if ((snd_pcm_uframes_t)avail > st.max_fill)
+            st.max_fill = avail;
+
+        while (avail > 0) {
+            n = snd_pcm_readi(pcm, buffer, (snd_pcm_uframes_t)avail);
+            if (n == -EAGAIN)
+                break;
+            if (n < 0) {
+                cs_lowwake_xrun(pcm, (int)n, &st, &wav, &t0);
+                break;
+            }
+            if (cs_lowwake_store(&wav, cfg.format, buffer, n, cfg.channels) < 0) {
+                err = -EIO;
+                cs_lowwake_running = 0;
+                break;
+            }
+            st.frames += n;
+            avail -= n;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    getrusage(RUSAGE_SELF, &ru1);
+    wall = cs_lowwake_elapsed(&t0, &t1);
+    cpu = cs_lowwake_cpu(&ru1) - cs_lowwake_cpu(&ru0);
+    per_hour = wall > 0.0 ? 3600.0 / wall : 0.0;
+
+    printf("Captured %.1f s, %lu xrun(s)", (double)st.frames / cfg.rate, st.xruns);
+    if (!opts->baseline)
+        printf(", max fill %.0f %%", 100.0 * st.max_fill / cfg.buffer_frames);
+    if (st.ts1.tv_sec > st.ts0.tv_sec + 1)
+        printf(", measured rate %.2f Hz", (st.pos1 - st.pos0) / cs_lowwake_elapsed(&st.ts0, &st.ts1));
+    printf("\nWakeups %lu (%.0f/h), context switches %ld (%.0f/h), CPU %.1f ms (%.2f s/h)\n",
+           st.wakeups, st.wakeups * per_hour,
+           (ru1.ru_nvcsw + ru1.ru_nivcsw) - (ru0.ru_nvcsw + ru0.ru_nivcsw),
+           ((ru1.ru_nvcsw + ru1.ru_nivcsw) - (ru0.ru_nvcsw + ru0.ru_nivcsw)) * per_hour,
+           cpu * 1e3, cpu * per_hour);
+
+out:
+    if (wav.file && CS_wav_writer_close(&wav) < 0 && !err)
+        err = -EIO;
+    if (tfd >= 0)
+        close(tfd);
+    snd_pcm_close(pcm);
+    free(buffer);
+    return err;
+}
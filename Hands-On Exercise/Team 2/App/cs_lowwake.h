@@ -0,0 +1,34 @@
+/**
+ * @file
+ * @brief Low-wakeup background capture for battery-powered units
+ *
+ * @details Requests the largest buffer the SAI allows with period
+ * interrupts disabled, then drains it from a timerfd every interval_ms
+ * instead of once per CS_DEFAULT_FRAMES period. The same loop run in
+ * baseline mode (period-driven blocking reads) gives the numbers to compare
+ * against: wakeups, context switches and CPU time, each scaled per hour.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial low-wakeup capture mode
+ */
+#ifndef CS_LOWWAKE_H
+#define CS_LOWWAKE_H
+
+/* Timer interval as a fraction of the buffer: drain at half full */
+#define CS_LOWWAKE_MAX_FILL_DIVISOR 2U
+
+struct cs_lowwake_options {
+    const char *device;
+    const char *path;           /* WAV output, NULL to discard the samples */
+    double seconds;             /* 0: until SIGINT/SIGTERM */
+    unsigned int interval_ms;   /* 0: half the negotiated buffer */
+    int baseline;               /* period-driven reads, for comparison */
+};
+
+int CS_lowwake_run(const struct cs_lowwake_options *opts);
+
+#endif /* CS_LOWWAKE_H */
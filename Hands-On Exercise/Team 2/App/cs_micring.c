@@ -0,0 +1,151 @@
+/**
+ * @file
+ * @brief Client side of the capgemini-mic mmap'd ring (/dev/capgemini-mic)
+ *
+ * @details See capgemini-mic.h for the shared layout. write_pos is loaded
+ * with acquire semantics so the samples it covers are visible; read_pos is
+ * stored with release semantics so the driver never sees a slot freed
+ * before the reader is done with it.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial ring client
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include "cs_micring.h"
+
+/**
+ * @brief Opens and maps the ring device.
+ *
+ * @param r         Ring handle to initialise.
+ * @param device    Device node, NULL for CMIC_DEVICE.
+ * @param watermark Pending bytes that wake CS_micring_wait(), 0 for the
+ *                  driver default (one DMA period).
+ * @return int 0 on success, negative errno otherwise.
+ */
+int CS_micring_open(struct cs_micring *r, const char *device, uint32_t watermark)
+{
+    void *map;
+    int err;
+
+    memset(r, 0, sizeof(*r));
+    r->fd = open(device ? device : CMIC_DEVICE, O_RDWR | O_CLOEXEC);
+    if (r->fd < 0) {
+        err = -errno;
+        fprintf(stderr, "CapgeminiSound ERR: cannot open %s (%s)\n",
+                device ? device : CMIC_DEVICE, strerror(errno));
+        return err;
+    }
+
+    map = mmap(NULL, CMIC_CTRL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, 0);
+    if (map == MAP_FAILED)
+        goto err_errno;
+    r->ctrl = map;
+    if (r->ctrl->abi_version != CMIC_ABI_VERSION || r->ctrl->format != CMIC_FORMAT_S32_LE) {
+        fprintf(stderr, "CapgeminiSound ERR: unsupported ring ABI %u\n", r->ctrl->abi_version);
+        CS_micring_close(r);
+        return -EPROTO;
+    }
+
+    map = mmap(NULL, r->ctrl->ring_bytes, PROT_READ, MAP_SHARED, r->fd, r->ctrl->ring_offset);
+    if (map == MAP_FAILED)
+        goto err_errno;
+    r->ring = map;
+    r->mask = r->ctrl->ring_bytes - 1;
+
+    if (watermark && ioctl(r->fd, CMIC_IOC_SET_WATERMARK, &watermark) < 0)
+        goto err_errno;
+    return 0;
+
+err_errno:
+    err = -errno;
+    fprintf(stderr, "CapgeminiSound ERR: ring setup failed (%s)\n", strerror(errno));
+    CS_micring_close(r);
+    return err;
+}
+
+void CS_micring_close(struct cs_micring *r)
+{
+    if (r->ring)
+        munmap((void *)r->ring, r->ctrl->ring_bytes);
+    if (r->ctrl)
+        munmap(r->ctrl, CMIC_CTRL_SIZE);
+    if (r->fd >= 0)
+        close(r->fd);
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+}
+
+int CS_micring_start(struct cs_micring *r)
+{
+    return ioctl(r->fd, CMIC_IOC_START) < 0 ? -errno : 0;
+}
+
+int CS_micring_stop(struct cs_micring *r)
+{
+    return ioctl(r->fd, CMIC_IOC_STOP) < 0 ? -errno : 0;
+}
+
+/**
+ * @brief Sleeps until the watermark is reached.
+ *
+ * @return int 1 when data is pending, 0 on timeout, -EPIPE once the capture
+ *         was stopped, negative errno otherwise.
+ */
+int CS_micring_wait(struct cs_micring *r, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = r->fd, .events = POLLIN };
+    int ret = poll(&pfd, 1, timeout_ms);
+
+    if (ret < 0)
+        return -errno;
+    if (ret > 0 && !(pfd.revents & POLLIN))
+        return -EPIPE;
+    return ret;
+}
+
+/**
+ * @brief Returns the unread bytes that are contiguous in the ring.
+ *
+ * @param r    Ring handle.
+ * @param data Out: start of the unread data (valid until consumed).
+ * @return long Contiguous bytes available, 0 if none, -EPIPE on overrun
+ *         (call CS_micring_recover()).
+ */
+long CS_micring_peek(struct cs_micring *r, const void **data)
+{
+    uint32_t write_pos = __atomic_load_n(&r->ctrl->write_pos, __ATOMIC_ACQUIRE);
+    uint32_t read_pos = r->ctrl->read_pos;
+    uint32_t fill = write_pos - read_pos;
+    uint32_t offset = read_pos & r->mask;
+
+    if (fill > r->ctrl->ring_bytes)
+        return -EPIPE;
+    *data = r->ring + offset;
+    return fill < r->ctrl->ring_bytes - offset ? fill : r->ctrl->ring_bytes - offset;
+}
+
+void CS_micring_consume(struct cs_micring *r, size_t bytes)
+{
+    __atomic_store_n(&r->ctrl->read_pos, r->ctrl->read_pos + (uint32_t)bytes, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Drops everything but the newest half ring after an overrun.
+ */
+void CS_micring_recover(struct cs_micring *r)
+{
+    uint32_t write_pos = __atomic_load_n(&r->ctrl->write_pos, __ATOMIC_ACQUIRE);
+
+    __atomic_store_n(&r->ctrl->read_pos, write_pos - r->ctrl->ring_bytes / 2, __ATOMIC_RELEASE);
+}
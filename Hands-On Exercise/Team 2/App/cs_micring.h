@@ -0,0 +1,40 @@
+/**
+ * @file
+ * @brief Client side of the capgemini-mic mmap'd ring (/dev/capgemini-mic)
+ *
+ * @details Maps the control page and the sample ring once; afterwards
+ * reading is CS_micring_peek() / CS_micring_consume() on shared memory, and
+ * CS_micring_wait() is the only syscall, made when less than the watermark
+ * is pending.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial ring client
+ */
+#ifndef CS_MICRING_H
+#define CS_MICRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../capgemini-mic.h"
+
+struct cs_micring {
+    int fd;
+    struct cmic_ctrl *ctrl;
+    const uint8_t *ring;
+    uint32_t mask;                  /* ring_bytes - 1 */
+};
+
+int CS_micring_open(struct cs_micring *r, const char *device, uint32_t watermark);
+void CS_micring_close(struct cs_micring *r);
+int CS_micring_start(struct cs_micring *r);
+int CS_micring_stop(struct cs_micring *r);
+int CS_micring_wait(struct cs_micring *r, int timeout_ms);
+long CS_micring_peek(struct cs_micring *r, const void **data);
+void CS_micring_consume(struct cs_micring *r, size_t bytes);
+void CS_micring_recover(struct cs_micring *r);
+
+#endif /* CS_MICRING_H */
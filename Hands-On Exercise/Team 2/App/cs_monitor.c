@@ -0,0 +1,404 @@
+/**
+ * @file
+ * @brief Full-duplex monitor (talk-back) mode: INMP441 capture to MAX98357A playback
+ *
+ * @details Latency budget: one capture period (the data has to be complete
+ * before it can be read) plus CS_MONITOR_PREFILL_PERIODS playback periods
+ * queued in front of it. With the smallest stable period found by the
+ * start-up probe this is ~3 periods, i.e. 4 ms at 64 frames / 48 kHz.
+ * Bridge mode adds the adaptive resampler's group delay (half its taps).
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial low-latency monitor mode
+ * - 19-10-2026: Drift-compensated bridge mode
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "capgeminiSound.h"
+#include "cs_drift.h"
+#include "cs_dsp.h"
+#include "cs_monitor.h"
+#include "cs_pcm.h"
+#include "cs_resampler.h"
+
+#define CS_MONITOR_CAPTURE_CHANNELS 1U
+#define CS_MONITOR_PLAYBACK_CHANNELS 2U
+#define CS_MONITOR_CAPTURE_PERIODS 4U
+#define CS_MONITOR_PLAYBACK_PERIODS 3U
+#define CS_MONITOR_PREFILL_PERIODS 2U
+#define CS_MONITOR_PROBE_MS 1000U
+#define CS_MONITOR_RT_PRIORITY 80
+/* Extra output room per cycle for the adaptive resampler's ratio swings */
+#define CS_MONITOR_DRIFT_SLACK 16U
+
+/* Period sizes tried by the auto-detection, smallest first */
+static const snd_pcm_uframes_t cs_monitor_periods[] = { 32, 64, 128, 256, 512, 1024 };
+
+struct cs_monitor {
+    const struct cs_monitor_options *opts;
+    snd_pcm_t *capture;
+    snd_pcm_t *playback;
+    struct cs_pcm_config ccfg;
+    struct cs_pcm_config pcfg;
+    void *cbuf;
+    void *pbuf;
+    float *work;
+    float *resampled;
+    size_t resampled_max;
+    struct cs_resampler *rs;
+    struct cs_drift drift;
+    unsigned long long captured;
+    unsigned long long written;
+    int linked;
+    unsigned long cycles;
+    unsigned long xruns;
+    int result;
+};
+
+static volatile sig_atomic_t cs_monitor_running = 1;
+
+static void cs_monitor_signal(int sig)
+{
+    (void)sig;
+    cs_monitor_running = 0;
+}
+
+static void cs_monitor_close(struct cs_monitor *m)
+{
+    if (m->linked)
+        snd_pcm_unlink(m->capture);
+    if (m->capture)
+        snd_pcm_close(m->capture);
+    if (m->playback)
+        snd_pcm_close(m->playback);
+    free(m->cbuf);
+    free(m->pbuf);
+    free(m->work);
+    free(m->resampled);
+    if (m->rs) {
+        CS_resampler_destroy(m->rs);
+        CS_drift_free(&m->drift);
+    }
+    m->capture = NULL;
+    m->playback = NULL;
+    m->cbuf = NULL;
+    m->pbuf = NULL;
+    m->work = NULL;
+    m->resampled = NULL;
+    m->rs = NULL;
+    m->linked = 0;
+}
+
+/**
+ * @brief Opens and links both PCMs for one candidate period size.
+ *
+ * @return int 0 on success, negative error if this period is not usable.
+ */
+static int cs_monitor_open(struct cs_monitor *m, snd_pcm_uframes_t period)
+{
+    snd_pcm_uframes_t out_frames;
+    int err;
+
+    m->ccfg = (struct cs_pcm_config){ SND_PCM_FORMAT_UNKNOWN, CS_MONITOR_CAPTURE_CHANNELS,
+                                      CS_DEFAULT_RATE, period, CS_MONITOR_CAPTURE_PERIODS, 0, 0 };
+    m->pcfg = (struct cs_pcm_config){ SND_PCM_FORMAT_UNKNOWN, CS_MONITOR_PLAYBACK_CHANNELS,
+                                      CS_DEFAULT_RATE, period, CS_MONITOR_PLAYBACK_PERIODS, 0, 0 };
+
+    err = CS_pcm_open(&m->capture, m->opts->capture_device, SND_PCM_STREAM_CAPTURE, &m->ccfg);
+    if (err < 0)
+        return err;
+    err = CS_pcm_open(&m->playback, m->opts->playback_device, SND_PCM_STREAM_PLAYBACK, &m->pcfg);
+    if (err < 0)
+        goto fail;
+
+    if (!CS_dsp_format_supported(m->ccfg.format) || !CS_dsp_format_supported(m->pcfg.format)) {
+        err = -EINVAL;
+        goto fail;
+    }
+    /* Same rate and period on both sides, otherwise the bridge drifts apart */
+    if (!m->opts->drift &&
+        (m->ccfg.rate != m->pcfg.rate || m->ccfg.period_frames != m->pcfg.period_frames)) {
+        err = -EINVAL;
+        goto fail;
+    }
+
+    err = CS_pcm_set_manual_start(m->capture, &m->ccfg);
+    if (err < 0)
+        goto fail;
+    err = CS_pcm_set_manual_start(m->playback, &m->pcfg);
+    if (err < 0)
+        goto fail;
+
+    /* Linked streams share one trigger: capture and playback start in sync */
+    m->linked = snd_pcm_link(m->capture, m->playback) == 0;
+    if (!m->linked)
+        fprintf(stderr, "CapgeminiSound WARN: cannot link PCMs, starting them separately\n");
+
+    out_frames = m->pcfg.period_frames;
+    if (m->opts->drift) {
+        if (CS_pcm_enable_tstamp(m->capture) < 0 || CS_pcm_enable_tstamp(m->playback) < 0 ||
+            CS_drift_init(&m->drift, m->ccfg.rate, m->pcfg.rate,
+                          CS_MONITOR_PREFILL_PERIODS * m->pcfg.period_frames) < 0) {
+            err = -EINVAL;
+            goto fail;
+        }
+        m->rs = CS_resampler_create_adaptive(m->drift.nominal, 0);
+        if (!m->rs) {
+            CS_drift_free(&m->drift);
+            err = -ENOMEM;
+            goto fail;
+        }
+        m->resampled_max = CS_resampler_max_output(m->rs, m->ccfg.period_frames) +
+                           CS_MONITOR_DRIFT_SLACK;
+        m->resampled = malloc(m->resampled_max * sizeof(float));
+        if (m->resampled_max > out_frames)
+            out_frames = m->resampled_max;
+    }
+
+    m->cbuf = malloc(snd_pcm_frames_to_bytes(m->capture, m->ccfg.period_frames));
+    m->pbuf = malloc(snd_pcm_frames_to_bytes(m->playback, out_frames));
+    m->work = malloc(m->ccfg.period_frames * sizeof(float));
+    if (!m->cbuf || !m->pbuf || !m->work || (m->opts->drift && !m->resampled)) {
+        err = -ENOMEM;
+        goto fail;
+    }
+    return 0;
+
+fail:
+    cs_monitor_close(m);
+    return err;
+}
+
+/**
+ * @brief Pre-fills playback with silence and starts the (linked) streams.
+ */
+static int cs_monitor_start(struct cs_monitor *m)
+{
+    snd_pcm_uframes_t period = m->pcfg.period_frames;
+    int err;
+
+    snd_pcm_prepare(m->capture);
+    snd_pcm_prepare(m->playback);
+
+    snd_pcm_format_set_silence(m->pcfg.format, m->pbuf, period * m->pcfg.channels);
+    for (unsigned int i = 0; i < CS_MONITOR_PREFILL_PERIODS; ++i) {
+        err = snd_pcm_writei(m->playback, m->pbuf, period);
+        if (err < 0)
+            return err;
+    }
+    m->captured = 0;
+    m->written = CS_MONITOR_PREFILL_PERIODS * period;
+    if (m->rs) {
+        CS_resampler_reset(m->rs);
+        CS_drift_restart(&m->drift);
+        CS_resampler_set_ratio(m->rs, m->drift.ratio);
+    }
+
+    err = snd_pcm_start(m->capture);
+    if (err < 0 || m->linked)
+        return err;
+    return snd_pcm_start(m->playback);
+}
+
+/**
+ * @brief Moves one period capture -> DSP -> playback.
+ */
+static int cs_monitor_cycle(struct cs_monitor *m)
+{
+    snd_pcm_uframes_t period = m->ccfg.period_frames;
+    snd_pcm_sframes_t n;
+
+    n = snd_pcm_readi(m->capture, m->cbuf, period);
+    if (n < 0)
+        return (int)n;
+
+    m->captured += n;
+
+    CS_dsp_to_float(m->cbuf, m->ccfg.format, m->ccfg.channels, m->work, n);
+    if (m->rs) {
+        n = CS_resampler_process(m->rs, m->work, n, m->resampled, m->resampled_max);
+        CS_dsp_from_float(m->resampled, m->opts->gain, m->pcfg.format, m->pcfg.channels,
+                          m->pbuf, n);
+    } else {
+        CS_dsp_from_float(m->work, m->opts->gain, m->pcfg.format, m->pcfg.channels, m->pbuf, n);
+    }
+
+    n = snd_pcm_writei(m->playback, m->pbuf, n);
+    if (n < 0)
+        return (int)n;
+    m->written += n;
+
+    if (m->rs)
+        CS_resampler_set_ratio(m->rs, CS_drift_update(&m->drift, m->capture, m->captured,
+                                                      m->playback, m->written));
+    m->cycles++;
+    return 0;
+}
+
+/**
+ * @brief Restarts both streams after an over/underrun on either side.
+ */
+static int cs_monitor_recover(struct cs_monitor *m)
+{
+    m->xruns++;
+    snd_pcm_drop(m->capture);
+    if (!m->linked)
+        snd_pcm_drop(m->playback);
+    return cs_monitor_start(m);
+}
+
+/**
+ * @brief Runs @p cycles periods and reports whether the stream stayed clean.
+ *
+ * @return int 0 if no xrun happened, 1 if at least one did, negative on error.
+ */
+static int cs_monitor_probe(struct cs_monitor *m, unsigned long cycles)
+{
+    unsigned long xruns = m->xruns;
+    int err = cs_monitor_start(m);
+
+    while (err == 0 && cycles-- && cs_monitor_running) {
+        err = cs_monitor_cycle(m);
+        if (err == -EPIPE || err == -ESTRPIPE)
+            err = cs_monitor_recover(m);
+    }
+    if (err < 0)
+        return err;
+    return m->xruns != xruns;
+}
+
+static void cs_monitor_report_latency(struct cs_monitor *m)
+{
+    snd_pcm_sframes_t pdelay = 0;
+    double ms;
+
+    snd_pcm_delay(m->playback, &pdelay);
+    ms = (double)(m->ccfg.period_frames + pdelay) * 1000.0 / m->ccfg.rate;
+    printf("Monitor: period %lu frames, %s -> %s, estimated latency %.2f ms%s\n",
+           (unsigned long)m->ccfg.period_frames,
+           snd_pcm_format_name(m->ccfg.format), snd_pcm_format_name(m->pcfg.format),
+           ms, m->linked ? "" : " (unlinked)");
+}
+
+/**
+ * @brief Thread body: period auto-detection followed by the steady-state loop.
+ */
+static void *cs_monitor_thread(void *arg)
+{
+    struct cs_monitor *m = arg;
+    const snd_pcm_uframes_t *candidates = cs_monitor_periods;
+    size_t count = sizeof(cs_monitor_periods) / sizeof(cs_monitor_periods[0]);
+    int err = -EINVAL;
+
+    if (m->opts->period_frames) {
+        candidates = &m->opts->period_frames;
+        count = 1;
+    }
+
+    for (size_t i = 0; i < count && cs_monitor_running; ++i) {
+        unsigned long cycles;
+
+        if (cs_monitor_open(m, candidates[i]) < 0)
+            continue;
+
+        cycles = (unsigned long)m->ccfg.rate * CS_MONITOR_PROBE_MS / 1000U / m->ccfg.period_frames;
+        err = cs_monitor_probe(m, cycles);
+        if (err == 0 || count == 1)
+            break;
+
+        printf("Monitor: period %lu frames not stable, trying larger\n",
+               (unsigned long)m->ccfg.period_frames);
+        cs_monitor_close(m);
+        err = -EPIPE;
+    }
+
+    if (err < 0) {
+        fprintf(stderr, "CapgeminiSound ERR: no usable monitor configuration: %s\n",
+                snd_strerror(err));
+        m->result = err;
+        return NULL;
+    }
+
+    cs_monitor_report_latency(m);
+    m->xruns = 0;
+    while (cs_monitor_running) {
+        err = cs_monitor_cycle(m);
+        if (err == -EPIPE || err == -ESTRPIPE)
+            err = cs_monitor_recover(m);
+        if (err < 0 && err != -EINTR) {
+            fprintf(stderr, "CapgeminiSound ERR: monitor stream error: %s\n", snd_strerror(err));
+            m->result = err;
+            break;
+        }
+    }
+
+    printf("Monitor: %lu periods, %lu xruns\n", m->cycles, m->xruns);
+    if (m->rs)
+        printf("Monitor: clock drift %+.1f ppm, playback fill %.0f/%.0f frames\n",
+               (m->drift.estimate / m->drift.nominal - 1.0) * 1e6,
+               m->drift.fill, m->drift.target_fill);
+    snd_pcm_drop(m->capture);
+    if (!m->linked)
+        snd_pcm_drop(m->playback);
+    cs_monitor_close(m);
+    return NULL;
+}
+
+/**
+ * @brief Runs monitor mode until SIGINT/SIGTERM.
+ *
+ * The audio loop runs in a SCHED_FIFO thread with memory locked so page
+ * faults and normal-priority tasks cannot stretch a period. Without the
+ * privileges for that (CAP_SYS_NICE / rtprio limit) it falls back to a normal
+ * thread and says so.
+ *
+ * @param opts Devices, period (0 = auto) and gain.
+ * @return int 0 on success, negative error code otherwise.
+ */
+int CS_monitor_run(const struct cs_monitor_options *opts)
+{
+    struct cs_monitor m = { .opts = opts };
+    struct sched_param sp = { .sched_priority = CS_MONITOR_RT_PRIORITY };
+    struct sigaction sa;
+    pthread_attr_t attr;
+    pthread_t thread;
+    int err;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = cs_monitor_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+        fprintf(stderr, "CapgeminiSound WARN: mlockall failed: %s\n", strerror(errno));
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    pthread_attr_setschedparam(&attr, &sp);
+
+    err = pthread_create(&thread, &attr, cs_monitor_thread, &m);
+    if (err == EPERM) {
+        fprintf(stderr, "CapgeminiSound WARN: no RT priority allowed, latency may suffer\n");
+        err = pthread_create(&thread, NULL, cs_monitor_thread, &m);
+    }
+    pthread_attr_destroy(&attr);
+    if (err) {
+        fprintf(stderr, "CapgeminiSound ERR: cannot start monitor thread: %s\n", strerror(err));
+        return -err;
+    }
+
+    pthread_join(thread, NULL);
+    munlockall();
+    return m.result;
+}
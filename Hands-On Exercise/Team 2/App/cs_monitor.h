@@ -0,0 +1,44 @@
+/**
+ * @file
+ * @brief Full-duplex monitor (talk-back) mode: INMP441 capture to MAX98357A playback
+ *
+ * @details The DTS exposes the mic (sai2b) and the amplifier (sai2a) as two
+ * simple-audio-cards. Monitor mode opens one PCM on each, links them so they
+ * start on the same trigger and moves every captured period through the DSP
+ * path to the speaker from a single SCHED_FIFO thread.
+ *
+ * With drift compensation enabled (bridge mode) the two sides may run from
+ * different clocks and rates: an adaptive resampler driven by cs_drift sits
+ * in the DSP path and keeps the playback fill constant.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial low-latency monitor mode
+ * - 19-10-2026: Drift-compensated bridge mode
+ */
+#ifndef CS_MONITOR_H
+#define CS_MONITOR_H
+
+#include <alsa/asoundlib.h>
+
+/*
+ * ALSA card ids are the alphanumeric part of simple-audio-card,name,
+ * truncated to 15 characters ("stm32mp1-inmp441" -> "stm32mp1inmp441").
+ */
+#define CS_MONITOR_CAPTURE_DEVICE "hw:CARD=stm32mp1inmp441,DEV=0"
+#define CS_MONITOR_PLAYBACK_DEVICE "hw:CARD=stm32mp1max9835,DEV=0"
+
+struct cs_monitor_options {
+    const char *capture_device;
+    const char *playback_device;
+    snd_pcm_uframes_t period_frames; /* 0: auto-detect smallest stable */
+    float gain;
+    int drift;                       /* track clock drift with an adaptive resampler */
+};
+
+int CS_monitor_run(const struct cs_monitor_options *opts);
+
+#endif /* CS_MONITOR_H */
@@ -0,0 +1,194 @@
+/**
+ * @file
+ * @brief ALSA PCM open/configure helpers shared by the capgeminiSound modes
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Split PCM setup out of capgeminiSound.c for monitor mode
+ * - 19-10-2026: Monotonic status timestamps for drift tracking
+ * - 19-10-2026: Largest-buffer / no-period-wakeup options for low-power capture
+ */
+#include <errno.h>
+#include <stdio.h>
+#include "cs_pcm.h"
+
+/* Native formats tried in order when the caller does not force one */
+static const snd_pcm_format_t cs_pcm_native_formats[] = {
+    SND_PCM_FORMAT_S32_LE,
+    SND_PCM_FORMAT_S24_LE,
+    SND_PCM_FORMAT_S16_LE,
+};
+
+/**
+ * @brief Opens and configures a PCM for interleaved read/write access.
+ *
+ * The PCM is left in the PREPARED state with hw and sw params applied.
+ * Stream start is automatic (ALSA defaults); use CS_pcm_set_manual_start()
+ * when the caller wants to start several linked PCMs explicitly. With
+ * CS_PCM_NO_PERIOD_WAKEUP requested the PCM is opened non-blocking; if
+ * the device cannot drop period wakeups the flag is cleared and the PCM is
+ * switched back to blocking mode, so it behaves like any other PCM.
+ *
+ * @param pcm    Returned PCM handle.
+ * @param device ALSA device name, e.g. "hw:0,0".
+ * @param stream SND_PCM_STREAM_CAPTURE or SND_PCM_STREAM_PLAYBACK.
+ * @param cfg    Requested configuration, updated with negotiated values.
+ * @return int 0 on success, negative ALSA error code otherwise.
+ */
+int CS_pcm_open(snd_pcm_t **pcm, const char *device, snd_pcm_stream_t stream,
+                struct cs_pcm_config *cfg)
+{
+    snd_pcm_hw_params_t *params = NULL;
+    snd_pcm_uframes_t buffer_frames;
+    int dir = 0;
+    int err;
+
+    /* alsa-lib only lets non-blocking PCMs run without period wakeups */
+    err = snd_pcm_open(pcm, device, stream,
+                       cfg->flags & CS_PCM_NO_PERIOD_WAKEUP ? SND_PCM_NONBLOCK : 0);
+    if (err < 0) {
+        fprintf(stderr, "CapgeminiSound ERR: cannot open %s: %s\n",
+                device, snd_strerror(err));
+        return err;
+    }
+
+    snd_pcm_hw_params_malloc(&params);
+    snd_pcm_hw_params_any(*pcm, params);
+
+    err = snd_pcm_hw_params_set_access(*pcm, params, SND_PCM_ACCESS_RW_INTERLEAVED);
+    if (err < 0)
+        goto fail;
+
+    if (cfg->format == SND_PCM_FORMAT_UNKNOWN) {
+        err = -EINVAL;
+        for (size_t i = 0; i < sizeof(cs_pcm_native_formats) / sizeof(cs_pcm_native_formats[0]); ++i) {
+            if (snd_pcm_hw_params_test_format(*pcm, params, cs_pcm_native_formats[i]) == 0) {
+                cfg->format = cs_pcm_native_formats[i];
+                err = 0;
+                break;
+            }
+        }
+        if (err < 0)
+            goto fail;
+    }
+    err = snd_pcm_hw_params_set_format(*pcm, params, cfg->format);
+    if (err < 0)
+        goto fail;
+
+    err = snd_pcm_hw_params_set_channels_near(*pcm, params, &cfg->channels);
+    if (err < 0)
+        goto fail;
+
+    /* No hidden resampling: a rate mismatch must be visible to the caller */
+    snd_pcm_hw_params_set_rate_resample(*pcm, params, 0);
+    err = snd_pcm_hw_params_set_rate_near(*pcm, params, &cfg->rate, &dir);
+    if (err < 0)
+        goto fail;
+
+    if ((cfg->flags & CS_PCM_NO_PERIOD_WAKEUP) &&
+        (!snd_pcm_hw_params_can_disable_period_wakeup(params) ||
+         snd_pcm_hw_params_set_period_wakeup(*pcm, params, 0) < 0)) {
+        cfg->flags &= ~CS_PCM_NO_PERIOD_WAKEUP;
+        /* Period interrupts stay on, so a blocking read can sleep on them */
+        err = snd_pcm_nonblock(*pcm, 0);
+        if (err < 0)
+            goto fail;
+    }
+    if (cfg->flags & CS_PCM_MAX_BUFFER) {
+        err = snd_pcm_hw_params_set_buffer_size_last(*pcm, params, &buffer_frames);
+        if (err < 0)
+            goto fail;
+        /* Fewest periods: if wakeups stay on, they are at least rare */
+        err = snd_pcm_hw_params_set_periods_first(*pcm, params, &cfg->periods, &dir);
+        if (err < 0)
+            goto fail;
+    }
+
+    if (cfg->period_frames) {
+        err = snd_pcm_hw_params_set_period_size_near(*pcm, params, &cfg->period_frames, &dir);
+        if (err < 0)
+            goto fail;
+    }
+    if (cfg->periods) {
+        err = snd_pcm_hw_params_set_periods_near(*pcm, params, &cfg->periods, &dir);
+        if (err < 0)
+            goto fail;
+    }
+
+    err = snd_pcm_hw_params(*pcm, params);
+    if (err < 0)
+        goto fail;
+
+    snd_pcm_hw_params_get_period_size(params, &cfg->period_frames, &dir);
+    snd_pcm_hw_params_get_buffer_size(params, &buffer_frames);
+    cfg->buffer_frames = buffer_frames;
+    cfg->periods = (unsigned int)(buffer_frames / cfg->period_frames);
+    snd_pcm_hw_params_free(params);
+    return 0;
+
+fail:
+    fprintf(stderr, "CapgeminiSound ERR: cannot configure %s: %s\n",
+            device, snd_strerror(err));
+    snd_pcm_hw_params_free(params);
+    snd_pcm_close(*pcm);
+    *pcm = NULL;
+    return err;
+}
+
+/**
+ * @brief Disables automatic start so the stream only runs on snd_pcm_start().
+ *
+ * Needed for linked PCMs: a playback stream must not start on its own while
+ * it is being pre-filled, and wake-ups are requested once per period.
+ *
+ * @param pcm PCM configured by CS_pcm_open().
+ * @param cfg Negotiated configuration of that PCM.
+ * @return int 0 on success, negative ALSA error code otherwise.
+ */
+int CS_pcm_set_manual_start(snd_pcm_t *pcm, const struct cs_pcm_config *cfg)
+{
+    snd_pcm_sw_params_t *sw = NULL;
+    snd_pcm_uframes_t boundary;
+    int err;
+
+    snd_pcm_sw_params_malloc(&sw);
+    err = snd_pcm_sw_params_current(pcm, sw);
+    if (err < 0)
+        goto out;
+    snd_pcm_sw_params_get_boundary(sw, &boundary);
+    snd_pcm_sw_params_set_start_threshold(pcm, sw, boundary);
+    snd_pcm_sw_params_set_avail_min(pcm, sw, cfg->period_frames);
+    err = snd_pcm_sw_params(pcm, sw);
+out:
+    snd_pcm_sw_params_free(sw);
+    return err;
+}
+
+/**
+ * @brief Enables CLOCK_MONOTONIC timestamps in snd_pcm_status().
+ *
+ * Capture and playback positions can only be compared when both streams
+ * stamp them with the same clock.
+ *
+ * @param pcm Configured PCM.
+ * @return int 0 on success, negative ALSA error code otherwise.
+ */
+int CS_pcm_enable_tstamp(snd_pcm_t *pcm)
+{
+    snd_pcm_sw_params_t *sw = NULL;
+    int err;
+
+    snd_pcm_sw_params_malloc(&sw);
+    err = snd_pcm_sw_params_current(pcm, sw);
+    if (err < 0)
+        goto out;
+    snd_pcm_sw_params_set_tstamp_mode(pcm, sw, SND_PCM_TSTAMP_ENABLE);
+    snd_pcm_sw_params_set_tstamp_type(pcm, sw, SND_PCM_TSTAMP_TYPE_MONOTONIC);
+    err = snd_pcm_sw_params(pcm, sw);
+out:
+    snd_pcm_sw_params_free(sw);
+    return err;
+}
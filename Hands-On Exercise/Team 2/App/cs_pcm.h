@@ -0,0 +1,54 @@
+/**
+ * @file
+ * @brief ALSA PCM open/configure helpers shared by the capgeminiSound modes
+ *
+ * @details Every mode of capgeminiSound (record, monitor, ...) needs the same
+ * open + hw_params + sw_params sequence. This module keeps that sequence in
+ * one place and reports back what the driver actually negotiated.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Split PCM setup out of capgeminiSound.c for monitor mode
+ * - 19-10-2026: Monotonic status timestamps for drift tracking
+ * - 19-10-2026: Largest-buffer / no-period-wakeup options for low-power capture
+ */
+#ifndef CS_PCM_H
+#define CS_PCM_H
+
+#include <alsa/asoundlib.h>
+
+/* cs_pcm_config.flags */
+#define CS_PCM_MAX_BUFFER 0x1U        /* largest buffer the driver allows, fewest periods */
+#define CS_PCM_NO_PERIOD_WAKEUP 0x2U  /* no period interrupts; cleared if unsupported */
+
+/**
+ * @brief Requested / negotiated PCM configuration.
+ *
+ * Fill in the wanted values before calling CS_pcm_open(); on success the
+ * structure holds what the hardware accepted. A format of
+ * SND_PCM_FORMAT_UNKNOWN lets CS_pcm_open() pick the widest native format
+ * (S32_LE, then S24_LE, then S16_LE), which avoids a plug conversion on the
+ * SAI where the INMP441 delivers 24 bits in a 32-bit slot.
+ *
+ * With CS_PCM_MAX_BUFFER, leave period_frames and periods at 0. On return
+ * flags only keeps the options the driver actually honoured.
+ */
+struct cs_pcm_config {
+    snd_pcm_format_t format;
+    unsigned int channels;
+    unsigned int rate;
+    snd_pcm_uframes_t period_frames;
+    unsigned int periods;
+    snd_pcm_uframes_t buffer_frames; /* out: negotiated ring size */
+    unsigned int flags;              /* CS_PCM_* */
+};
+
+int CS_pcm_open(snd_pcm_t **pcm, const char *device, snd_pcm_stream_t stream,
+                struct cs_pcm_config *cfg);
+int CS_pcm_set_manual_start(snd_pcm_t *pcm, const struct cs_pcm_config *cfg);
+int CS_pcm_enable_tstamp(snd_pcm_t *pcm);
+
+#endif /* CS_PCM_H */
@@ -0,0 +1,153 @@
+/**
+ * @file
+ * @brief Publish mode: one INMP441 capture fanned out to local readers
+ *
+ * @details snd_pcm_readi() writes each period directly into its slot of the
+ * shared ring, so the capture copy is the only copy: readers map the same
+ * pages. Reads are sized to end on a period boundary, which keeps periods
+ * from straddling the ring wrap even after a short read. A helper thread
+ * accepts reader connections and passes them the memfd.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial publish mode
+ * - 19-10-2026: Remove the socket when the accept thread cannot start
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <alsa/asoundlib.h>
+#include "capgeminiSound.h"
+#include "cs_pcm.h"
+#include "cs_publish.h"
+#include "cs_shm_ring.h"
+
+struct cs_publish_server {
+    int listen_fd;
+    int ring_fd;
+    unsigned long readers;
+};
+
+static volatile sig_atomic_t cs_publish_running = 1;
+
+static void cs_publish_signal(int sig)
+{
+    (void)sig;
+    cs_publish_running = 0;
+}
+
+/* Hands the memfd to every reader that connects; ends on shutdown() */
+static void *cs_publish_accept_thread(void *arg)
+{
+    struct cs_publish_server *srv = arg;
+
+    for (;;) {
+        int client = accept(srv->listen_fd, NULL, NULL);
+
+        if (client < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (CS_shm_ring_send_fd(client, srv->ring_fd) == 0)
+            srv->readers++;
+        close(client);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Publishes the capture until SIGINT/SIGTERM.
+ *
+ * @param opts Capture device and socket path.
+ * @return int 0 on success, negative error code otherwise.
+ */
+int CS_publish_run(const struct cs_publish_options *opts)
+{
+    struct cs_pcm_config cfg = {
+        SND_PCM_FORMAT_UNKNOWN, CS_DEFAULT_CHANNELS, CS_DEFAULT_RATE, CS_DEFAULT_FRAMES, 4, 0, 0
+    };
+    struct cs_publish_server srv = { .listen_fd = -1 };
+    struct cs_shm_ring ring;
+    struct sigaction sa;
+    snd_pcm_t *pcm = NULL;
+    unsigned long long published = 0;
+    unsigned long xruns = 0;
+    pthread_t thread;
+    int err;
+
+    /* No SA_RESTART: readi has to return on Ctrl+C */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = cs_publish_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    err = CS_pcm_open(&pcm, opts->device, SND_PCM_STREAM_CAPTURE, &cfg);
+    if (err < 0)
+        return err;
+    err = CS_shm_ring_create(&ring, cfg.rate, cfg.channels, cfg.format,
+                             (unsigned int)snd_pcm_frames_to_bytes(pcm, 1),
+                             (unsigned int)cfg.period_frames, CS_PUBLISH_PERIODS);
+    if (err < 0) {
+        fprintf(stderr, "CapgeminiSound ERR: cannot create shared ring: %s\n", strerror(-err));
+        snd_pcm_close(pcm);
+        return err;
+    }
+    srv.ring_fd = ring.fd;
+    srv.listen_fd = CS_shm_ring_listen(opts->socket_path);
+    if (srv.listen_fd < 0) {
+        err = srv.listen_fd;
+        fprintf(stderr, "CapgeminiSound ERR: cannot listen on %s: %s\n",
+                opts->socket_path, strerror(-err));
+        goto out;
+    }
+    err = -pthread_create(&thread, NULL, cs_publish_accept_thread, &srv);
+    if (err < 0) {
+        fprintf(stderr, "CapgeminiSound ERR: cannot start accept thread: %s\n", strerror(-err));
+        close(srv.listen_fd);
+        unlink(opts->socket_path);
+        goto out;
+    }
+
+    printf("Publishing %s: %u Hz, %u ch, %s, %u-frame ring on %s\n", opts->device, cfg.rate,
+           cfg.channels, snd_pcm_format_name(cfg.format), ring.hdr->capacity_frames,
+           opts->socket_path);
+
+    while (cs_publish_running) {
+        snd_pcm_uframes_t room = cfg.period_frames - (ring.hdr->write_pos % cfg.period_frames);
+        snd_pcm_sframes_t n = snd_pcm_readi(pcm, CS_shm_ring_write_ptr(&ring), room);
+
+        if (n < 0) {
+            if (n == -EINTR)
+                continue;
+            if (snd_pcm_recover(pcm, (int)n, 1) < 0) {
+                fprintf(stderr, "CapgeminiSound ERR: capture failed: %s\n", snd_strerror((int)n));
+                err = (int)n;
+                break;
+            }
+            xruns++;
+            continue;
+        }
+        CS_shm_ring_publish(&ring, (uint32_t)n);
+        published += n;
+    }
+
+    shutdown(srv.listen_fd, SHUT_RDWR);
+    pthread_join(thread, NULL);
+    close(srv.listen_fd);
+    unlink(opts->socket_path);
+    printf("Published %.1f s to %lu reader(s), %lu xrun(s)\n",
+           (double)published / cfg.rate, srv.readers, xruns);
+
+out:
+    CS_shm_ring_close(&ring);
+    snd_pcm_close(pcm);
+    return err;
+}
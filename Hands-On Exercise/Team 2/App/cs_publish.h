@@ -0,0 +1,29 @@
+/**
+ * @file
+ * @brief Publish mode: one INMP441 capture fanned out to local readers
+ *
+ * @details Captures into a cs_shm_ring and serves its memfd on a Unix
+ * socket; recorders, level meters and the speech front-end attach with
+ * CS_shm_ring_attach() and read the same samples without copies.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial publish mode
+ */
+#ifndef CS_PUBLISH_H
+#define CS_PUBLISH_H
+
+/* Ring length; 64 periods of 1024 frames is ~1.4 s at 48 kHz */
+#define CS_PUBLISH_PERIODS 64U
+
+struct cs_publish_options {
+    const char *device;
+    const char *socket_path;
+};
+
+int CS_publish_run(const struct cs_publish_options *opts);
+
+#endif /* CS_PUBLISH_H */
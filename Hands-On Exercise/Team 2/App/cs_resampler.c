@@ -0,0 +1,368 @@
+/**
+ * @file
+ * @brief Polyphase FIR sample-rate converter for the capgeminiSound DSP path
+ *
+ * @details Output sample n sits at input position n * M / L. With the
+ * prototype filter h[] designed at the virtual rate in * L, branch
+ * p = (n * M) mod L holds h[p], h[p + L], h[p + 2L], ... and is applied to the
+ * most recent real input samples. Branches are stored time-reversed and
+ * zero-padded to a multiple of 4 taps so the dot product maps directly onto
+ * 4-wide SIMD loads.
+ *
+ * In adaptive mode the read position advances by a 32.32 fixed-point step
+ * (1 / ratio input samples per output). Its fraction selects branch b of
+ * CS_RESAMPLER_ADAPTIVE_PHASES and the output is interpolated between
+ * branches b and b + 1; an extra last branch (the first one shifted by one
+ * sample) makes b + 1 always valid.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial polyphase resampler
+ * - 19-10-2026: Adaptive (variable-ratio) mode for clock drift compensation
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cs_resampler.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CS_RESAMPLER_NEON 1
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define CS_RESAMPLER_SSE 1
+#endif
+
+/* Passband edge as a fraction of the output Nyquist frequency */
+#define CS_RESAMPLER_ROLLOFF 0.90
+/* Kaiser beta for ~80 dB stopband attenuation: 0.1102 * (80 - 8.7) */
+#define CS_RESAMPLER_KAISER_BETA 7.857
+#define CS_RESAMPLER_SIMD_WIDTH 4U
+#define CS_RESAMPLER_ALIGN 16U
+#define CS_RESAMPLER_FRAC_ONE 4294967296.0
+
+struct cs_resampler {
+    unsigned int up;     /* L */
+    unsigned int down;   /* M */
+    unsigned int taps;   /* per branch, padded to CS_RESAMPLER_SIMD_WIDTH */
+    float *bank;         /* up * taps coefficients, branch-major, reversed */
+    float *buf;          /* taps - 1 history samples followed by pending input */
+    size_t buf_len;
+    size_t buf_cap;
+    size_t pos;          /* index in buf of the newest input sample for the next output */
+    unsigned int phase;  /* current branch, 0 .. up - 1 */
+    int adaptive;
+    uint64_t step;       /* adaptive: input advance per output, 32.32 */
+    uint32_t frac;       /* adaptive: fractional read position */
+};
+
+static unsigned int cs_gcd(unsigned int a, unsigned int b)
+{
+    while (b) {
+        unsigned int t = a % b;
+
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* Zeroth-order modified Bessel function, power series */
+static double cs_bessel_i0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+static inline float cs_dot(const float *coef, const float *x, unsigned int n)
+{
+#if defined(CS_RESAMPLER_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    float32x2_t sum;
+
+    for (unsigned int i = 0; i < n; i += CS_RESAMPLER_SIMD_WIDTH)
+        acc = vmlaq_f32(acc, vld1q_f32(coef + i), vld1q_f32(x + i));
+    sum = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    sum = vpadd_f32(sum, sum);
+    return vget_lane_f32(sum, 0);
+#elif defined(CS_RESAMPLER_SSE)
+    __m128 acc = _mm_setzero_ps();
+
+    for (unsigned int i = 0; i < n; i += CS_RESAMPLER_SIMD_WIDTH)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(coef + i), _mm_loadu_ps(x + i)));
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 0x55));
+    return _mm_cvtss_f32(acc);
+#else
+    float acc = 0.0f;
+
+    for (unsigned int i = 0; i < n; ++i)
+        acc += coef[i] * x[i];
+    return acc;
+#endif
+}
+
+/**
+ * @brief Designs the Kaiser-windowed sinc prototype and splits it into branches.
+ *
+ * @param rs       Resampler with up/taps/bank set.
+ * @param raw_taps Non-padded taps per branch.
+ * @param rows     Branches to fill: up, or up + 1 for the adaptive mode.
+ * @param fc       Cutoff relative to the virtual rate in * up.
+ * @return int 0 on success, -ENOMEM if the prototype cannot be allocated.
+ */
+static int cs_resampler_design(struct cs_resampler *rs, unsigned int raw_taps,
+                                unsigned int rows, double fc)
+{
+    unsigned int len = raw_taps * rs->up + rows - rs->up;
+    double center = (len - 1) / 2.0;
+    double i0_beta = cs_bessel_i0(CS_RESAMPLER_KAISER_BETA);
+    double *h = malloc(len * sizeof(*h));
+    double sum = 0.0;
+
+    if (!h)
+        return -ENOMEM;
+
+    for (unsigned int n = 0; n < len; ++n) {
+        double t = n - center;
+        double r = t / center;
+        double sinc = t == 0.0 ? 1.0 : sin(2.0 * M_PI * fc * t) / (M_PI * t) / (2.0 * fc);
+        double win = cs_bessel_i0(CS_RESAMPLER_KAISER_BETA * sqrt(fmax(0.0, 1.0 - r * r))) / i0_beta;
+
+        h[n] = 2.0 * fc * sinc * win;
+        sum += h[n];
+    }
+
+    /* Each branch sees 1/L of the taps: unity DC gain needs a total of L */
+    for (unsigned int p = 0; p < rows; ++p) {
+        float *row = rs->bank + (size_t)p * rs->taps;
+
+        for (unsigned int k = 0; k < raw_taps; ++k)
+            row[rs->taps - 1 - k] = (float)(h[p + k * rs->up] * rs->up / sum);
+    }
+    free(h);
+    return 0;
+}
+
+static struct cs_resampler *cs_resampler_alloc(unsigned int up, unsigned int down,
+                                               unsigned int taps, unsigned int rows)
+{
+    struct cs_resampler *rs = calloc(1, sizeof(*rs));
+    void *mem;
+
+    if (!rs)
+        return NULL;
+
+    rs->up = up;
+    rs->down = down;
+    rs->taps = (taps + CS_RESAMPLER_SIMD_WIDTH - 1) & ~(CS_RESAMPLER_SIMD_WIDTH - 1);
+
+    if (posix_memalign(&mem, CS_RESAMPLER_ALIGN, (size_t)rows * rs->taps * sizeof(float))) {
+        free(rs);
+        return NULL;
+    }
+    rs->bank = mem;
+    memset(rs->bank, 0, (size_t)rows * rs->taps * sizeof(float));
+    return rs;
+}
+
+/**
+ * @brief Creates a resampler for a fixed in -> out rate pair.
+ *
+ * @param in_rate  Input sample rate in Hz.
+ * @param out_rate Output sample rate in Hz.
+ * @param taps     Taps per polyphase branch (0 = CS_RESAMPLER_DEFAULT_TAPS).
+ * @return struct cs_resampler* New resampler or NULL on error.
+ */
+struct cs_resampler *CS_resampler_create(unsigned int in_rate, unsigned int out_rate,
+                                         unsigned int taps)
+{
+    struct cs_resampler *rs;
+    unsigned int g, max_rate;
+
+    if (!in_rate || !out_rate)
+        return NULL;
+    if (!taps)
+        taps = CS_RESAMPLER_DEFAULT_TAPS;
+
+    g = cs_gcd(in_rate, out_rate);
+    rs = cs_resampler_alloc(out_rate / g, in_rate / g, taps, out_rate / g);
+    if (!rs)
+        return NULL;
+
+    /* Cutoff relative to the virtual rate in * L, below both Nyquists */
+    max_rate = rs->up > rs->down ? rs->up : rs->down;
+    if (cs_resampler_design(rs, taps, rs->up, 0.5 * CS_RESAMPLER_ROLLOFF / max_rate) < 0) {
+        CS_resampler_destroy(rs);
+        return NULL;
+    }
+    CS_resampler_reset(rs);
+    return rs;
+}
+
+/**
+ * @brief Creates a variable-ratio resampler.
+ *
+ * The anti-aliasing cutoff is designed for @p ratio; CS_resampler_set_ratio()
+ * can then move the ratio freely by small amounts (clock drift is in the
+ * order of 100 ppm).
+ *
+ * @param ratio Nominal out/in rate ratio.
+ * @param taps  Taps per branch (0 = CS_RESAMPLER_DEFAULT_TAPS).
+ * @return struct cs_resampler* New resampler or NULL on error.
+ */
+struct cs_resampler *CS_resampler_create_adaptive(double ratio, unsigned int taps)
+{
+    struct cs_resampler *rs;
+
+    if (ratio <= 0.0)
+        return NULL;
+    if (!taps)
+        taps = CS_RESAMPLER_DEFAULT_TAPS;
+
+    rs = cs_resampler_alloc(CS_RESAMPLER_ADAPTIVE_PHASES, 1, taps,
+                            CS_RESAMPLER_ADAPTIVE_PHASES + 1);
+    if (!rs)
+        return NULL;
+
+    rs->adaptive = 1;
+    if (cs_resampler_design(rs, taps, rs->up + 1,
+                            0.5 * CS_RESAMPLER_ROLLOFF * fmin(1.0, ratio) / rs->up) < 0) {
+        CS_resampler_destroy(rs);
+        return NULL;
+    }
+    CS_resampler_set_ratio(rs, ratio);
+    CS_resampler_reset(rs);
+    return rs;
+}
+
+/**
+ * @brief Changes the out/in ratio of an adaptive resampler.
+ *
+ * Takes effect with the next output sample; no state is reset, so the
+ * ratio can be updated every period without clicks.
+ *
+ * @param rs    Resampler created by CS_resampler_create_adaptive().
+ * @param ratio New out/in ratio.
+ */
+void CS_resampler_set_ratio(struct cs_resampler *rs, double ratio)
+{
+    if (rs->adaptive && ratio > 0.0)
+        rs->step = (uint64_t)(CS_RESAMPLER_FRAC_ONE / ratio);
+}
+
+void CS_resampler_destroy(struct cs_resampler *rs)
+{
+    if (!rs)
+        return;
+    free(rs->bank);
+    free(rs->buf);
+    free(rs);
+}
+
+/**
+ * @brief Drops buffered input and restarts from silence (e.g. after an xrun).
+ */
+void CS_resampler_reset(struct cs_resampler *rs)
+{
+    rs->buf_len = rs->taps - 1;
+    rs->pos = rs->taps - 1;
+    rs->phase = 0;
+    rs->frac = 0;
+    if (rs->buf)
+        memset(rs->buf, 0, rs->buf_len * sizeof(float));
+}
+
+/**
+ * @brief Upper bound of the frames produced by the next process call.
+ *
+ * @param rs        Resampler.
+ * @param in_frames Frames that will be passed in.
+ * @return size_t Output buffer size (in frames) that is always sufficient.
+ */
+size_t CS_resampler_max_output(const struct cs_resampler *rs, size_t in_frames)
+{
+    if (rs->adaptive)
+        return (size_t)((double)(rs->buf_len - rs->pos + in_frames) * CS_RESAMPLER_FRAC_ONE / rs->step) + 2;
+    return ((rs->buf_len - rs->pos + in_frames) * rs->up) / rs->down + 1;
+}
+
+/**
+ * @brief Converts a block of mono float samples.
+ *
+ * Input that cannot be consumed yet (filter look-ahead or a too small
+ * @p out_max) is kept internally for the next call.
+ *
+ * @param rs        Resampler.
+ * @param in        Input samples.
+ * @param in_frames Number of input samples.
+ * @param out       Output buffer.
+ * @param out_max   Capacity of @p out; see CS_resampler_max_output().
+ * @return size_t Number of output samples written.
+ */
+size_t CS_resampler_process(struct cs_resampler *rs, const float *in, size_t in_frames,
+                            float *out, size_t out_max)
+{
+    const size_t hist = rs->taps - 1;
+    size_t produced = 0;
+    size_t discard;
+
+    if (rs->buf_len + in_frames > rs->buf_cap) {
+        size_t cap = rs->buf_len + in_frames;
+        float *buf = realloc(rs->buf, cap * sizeof(float));
+
+        if (!buf)
+            return 0;
+        if (!rs->buf)
+            memset(buf, 0, rs->buf_len * sizeof(float));
+        rs->buf = buf;
+        rs->buf_cap = cap;
+    }
+    memcpy(rs->buf + rs->buf_len, in, in_frames * sizeof(float));
+    rs->buf_len += in_frames;
+
+    while (rs->adaptive && rs->pos < rs->buf_len && produced < out_max) {
+        uint64_t idx = (uint64_t)rs->frac * rs->up;
+        const float *row = rs->bank + (size_t)(idx >> 32) * rs->taps;
+        const float *x = rs->buf + rs->pos - hist;
+        float w = (float)((uint32_t)idx / CS_RESAMPLER_FRAC_ONE);
+        float y0 = cs_dot(row, x, rs->taps);
+        float y1 = cs_dot(row + rs->taps, x, rs->taps);
+        uint64_t next = (uint64_t)rs->frac + rs->step;
+
+        out[produced++] = y0 + w * (y1 - y0);
+        rs->pos += next >> 32;
+        rs->frac = (uint32_t)next;
+    }
+
+    while (!rs->adaptive && rs->pos < rs->buf_len && produced < out_max) {
+        out[produced++] = cs_dot(rs->bank + (size_t)rs->phase * rs->taps,
+                                 rs->buf + rs->pos - hist, rs->taps);
+        rs->phase += rs->down;
+        rs->pos += rs->phase / rs->up;
+        rs->phase %= rs->up;
+    }
+
+    /* Keep only the history needed by the next output */
+    discard = rs->pos - hist;
+    if (discard > rs->buf_len)
+        discard = rs->buf_len;
+    memmove(rs->buf, rs->buf + discard, (rs->buf_len - discard) * sizeof(float));
+    rs->buf_len -= discard;
+    rs->pos -= discard;
+    return produced;
+}
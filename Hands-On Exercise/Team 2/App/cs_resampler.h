@@ -0,0 +1,47 @@
+/**
+ * @file
+ * @brief Polyphase FIR sample-rate converter for the capgeminiSound DSP path
+ *
+ * @details Converts a mono float stream by any rational ratio out/in (after
+ * reduction by the GCD), e.g. 48 kHz -> 16 kHz for speech front-ends. The
+ * prototype is a Kaiser-windowed sinc split into L polyphase branches, so
+ * only the taps that land on a real input sample are computed. The inner
+ * dot product uses NEON on the Cortex-A7 and SSE on x86, with a scalar
+ * fallback elsewhere.
+ *
+ * The adaptive variant runs at a continuously variable ratio instead: it
+ * uses CS_RESAMPLER_ADAPTIVE_PHASES branches and interpolates linearly
+ * between the two branches around each fractional input position, which is
+ * what a drift-compensating bridge needs.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial polyphase resampler
+ * - 19-10-2026: Adaptive (variable-ratio) mode for clock drift compensation
+ */
+#ifndef CS_RESAMPLER_H
+#define CS_RESAMPLER_H
+
+#include <stddef.h>
+
+/* Taps per polyphase branch; 32 gives ~80 dB stopband for 48k -> 16k */
+#define CS_RESAMPLER_DEFAULT_TAPS 32U
+/* Fractional-delay resolution of the adaptive mode before interpolation */
+#define CS_RESAMPLER_ADAPTIVE_PHASES 128U
+
+struct cs_resampler;
+
+struct cs_resampler *CS_resampler_create(unsigned int in_rate, unsigned int out_rate,
+                                         unsigned int taps);
+struct cs_resampler *CS_resampler_create_adaptive(double ratio, unsigned int taps);
+void CS_resampler_set_ratio(struct cs_resampler *rs, double ratio);
+void CS_resampler_destroy(struct cs_resampler *rs);
+void CS_resampler_reset(struct cs_resampler *rs);
+size_t CS_resampler_max_output(const struct cs_resampler *rs, size_t in_frames);
+size_t CS_resampler_process(struct cs_resampler *rs, const float *in, size_t in_frames,
+                            float *out, size_t out_max);
+
+#endif /* CS_RESAMPLER_H */
@@ -0,0 +1,429 @@
+/**
+ * @file
+ * @brief Shared-memory capture ring: one publisher, many zero-copy readers
+ *
+ * @details Positions are 32-bit frame counters, so they stay atomic on the
+ * A7. They run modulo wrap_frames, the largest power-of-two multiple of
+ * the ring below 2^31, so any period size the hardware grants (960, 1000
+ * frames...) works and an index is always position % capacity. The
+ * publisher stores write_pos with release semantics after the samples are
+ * in place; readers load it with acquire semantics. The futex lives in the
+ * shared mapping, so waits and wakes use the non-private futex ops.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial shared ring and reader library
+ * - 19-10-2026: Read-only reader mappings, private reader cursors
+ * - 19-10-2026: Any period size; seqlock fence before the lap check
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include "cs_shm_ring.h"
+
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010      /* Linux 5.1 */
+#endif
+
+static long cs_shm_ring_futex(uint32_t *uaddr, int op, uint32_t val,
+                              const struct timespec *timeout)
+{
+    return syscall(SYS_futex, uaddr, op, val, timeout, NULL, 0);
+}
+
+/* Frames from @p from to @p to, both below wrap */
+static inline uint32_t cs_shm_ring_dist(const struct cs_shm_ring *r, uint32_t from, uint32_t to)
+{
+    return to >= from ? to - from : to + (r->wrap - from);
+}
+
+static inline uint32_t cs_shm_ring_add(const struct cs_shm_ring *r, uint32_t pos, uint32_t frames)
+{
+    return frames < r->wrap - pos ? pos + frames : frames - (r->wrap - pos);
+}
+
+static size_t cs_shm_ring_header_bytes(void)
+{
+    long page = sysconf(_SC_PAGESIZE);
+
+    return (sizeof(struct cs_shm_ring_header) + page - 1) / page * page;
+}
+
+static int cs_shm_ring_map(struct cs_shm_ring *r, size_t bytes, int prot)
+{
+    void *map = mmap(NULL, bytes, prot, MAP_SHARED, r->fd, 0);
+
+    if (map == MAP_FAILED)
+        return -errno;
+    r->hdr = map;
+    r->map_bytes = bytes;
+    return 0;
+}
+
+/**
+ * @brief Creates the ring in a sealed memfd (publisher side).
+ *
+ * @param r             Ring handle to initialise.
+ * @param rate          Sample rate of the published stream.
+ * @param channels      Channels per frame.
+ * @param format        snd_pcm_format_t of the samples.
+ * @param frame_bytes   Bytes per frame.
+ * @param period_frames Frames per published period.
+ * @param periods       Ring length in periods, at least 2.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int CS_shm_ring_create(struct cs_shm_ring *r, unsigned int rate, unsigned int channels,
+                       int format, unsigned int frame_bytes, unsigned int period_frames,
+                       unsigned int periods)
+{
+    size_t header_bytes = cs_shm_ring_header_bytes(), bytes;
+    uint32_t capacity, wrap;
+    int err;
+
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+    r->publisher = 1;
+    if (periods < 2)
+        periods = 2;
+    /* Whole periods in the ring and in a lap: a period never straddles the wrap */
+    if (!period_frames || !frame_bytes || period_frames > (1U << 30) / periods)
+        return -EINVAL;
+    capacity = period_frames * periods;
+    for (wrap = capacity; wrap <= (1U << 30); wrap <<= 1)
+        ;
+    bytes = header_bytes + (size_t)capacity * frame_bytes;
+
+    r->fd = memfd_create("capgeminiSound-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (r->fd < 0)
+        return -errno;
+    if (ftruncate(r->fd, bytes) < 0) {
+        err = -errno;
+        CS_shm_ring_close(r);
+        return err;
+    }
+    err = cs_shm_ring_map(r, bytes, PROT_READ | PROT_WRITE);
+    if (err < 0) {
+        CS_shm_ring_close(r);
+        return err;
+    }
+    /* Ours is the last writable mapping: whoever gets the fd can only read */
+    if (fcntl(r->fd, F_ADD_SEALS,
+              F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_FUTURE_WRITE | F_SEAL_SEAL) < 0) {
+        err = -errno;
+        CS_shm_ring_close(r);
+        return err;
+    }
+
+    r->hdr->version = CS_SHM_RING_VERSION;
+    r->hdr->rate = rate;
+    r->hdr->channels = channels;
+    r->hdr->format = format;
+    r->hdr->frame_bytes = frame_bytes;
+    r->hdr->capacity_frames = capacity;
+    r->hdr->period_frames = period_frames;
+    r->hdr->data_offset = header_bytes;
+    r->hdr->wrap_frames = wrap;
+    __atomic_store_n(&r->hdr->magic, CS_SHM_RING_MAGIC, __ATOMIC_RELEASE);
+    r->data = (uint8_t *)r->hdr + header_bytes;
+    r->capacity = capacity;
+    r->wrap = wrap;
+    return 0;
+}
+
+/**
+ * @brief Where the next period goes; valid for period_frames frames.
+ */
+void *CS_shm_ring_write_ptr(struct cs_shm_ring *r)
+{
+    return r->data + (size_t)(r->hdr->write_pos % r->capacity) * r->hdr->frame_bytes;
+}
+
+/**
+ * @brief Makes @p frames written at CS_shm_ring_write_ptr() visible to readers.
+ *
+ * Readers cannot write to the ring, so there is no waiter count to skip
+ * the wake-up with; FUTEX_WAKE with nobody waiting is one cheap syscall.
+ */
+void CS_shm_ring_publish(struct cs_shm_ring *r, uint32_t frames)
+{
+    struct cs_shm_ring_header *hdr = r->hdr;
+
+    __atomic_store_n(&hdr->write_pos, cs_shm_ring_add(r, hdr->write_pos, frames), __ATOMIC_RELEASE);
+    __atomic_add_fetch(&hdr->futex_seq, 1, __ATOMIC_SEQ_CST);
+    cs_shm_ring_futex(&hdr->futex_seq, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+/**
+ * @brief Opens the Unix socket readers connect to for the memfd.
+ *
+ * @return int Listening socket, negative errno otherwise.
+ */
+int CS_shm_ring_listen(const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int sock, err;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return -ENAMETOOLONG;
+    strcpy(addr.sun_path, path);
+
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0)
+        return -errno;
+    unlink(path);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(sock, 8) < 0) {
+        err = -errno;
+        close(sock);
+        return err;
+    }
+    return sock;
+}
+
+int CS_shm_ring_send_fd(int sock, int fd)
+{
+    char token = 'R';
+    struct iovec iov = { .iov_base = &token, .iov_len = 1 };
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctrl;
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = ctrl.buf,
+        .msg_controllen = sizeof(ctrl.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    return sendmsg(sock, &msg, MSG_NOSIGNAL) < 0 ? -errno : 0;
+}
+
+static int cs_shm_ring_recv_fd(int sock)
+{
+    char token;
+    struct iovec iov = { .iov_base = &token, .iov_len = 1 };
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctrl;
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = ctrl.buf,
+        .msg_controllen = sizeof(ctrl.buf),
+    };
+    struct cmsghdr *cmsg;
+    int fd;
+
+    if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) <= 0)
+        return -EPROTO;
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+        return -EPROTO;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
+
+/**
+ * @brief Connects to a publisher and maps its ring (reader side).
+ *
+ * The reader starts at the publisher's current position, i.e. it sees
+ * samples captured from now on.
+ *
+ * @param r    Ring handle to initialise.
+ * @param path Publisher socket, NULL for CS_SHM_RING_SOCKET.
+ * @return int 0 on success, negative errno otherwise.
+ */
+int CS_shm_ring_attach(struct cs_shm_ring *r, const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    struct cs_shm_ring_header hdr;
+    int sock, err;
+
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+    if (!path)
+        path = CS_SHM_RING_SOCKET;
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return -ENAMETOOLONG;
+    strcpy(addr.sun_path, path);
+
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0)
+        return -errno;
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        err = -errno;
+        close(sock);
+        return err;
+    }
+    r->fd = cs_shm_ring_recv_fd(sock);
+    close(sock);
+    if (r->fd < 0)
+        return r->fd;
+
+    if (pread(r->fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+        hdr.magic != CS_SHM_RING_MAGIC || hdr.version != CS_SHM_RING_VERSION ||
+        !hdr.period_frames || hdr.capacity_frames < 2 * hdr.period_frames ||
+        hdr.wrap_frames % hdr.capacity_frames) {
+        CS_shm_ring_close(r);
+        return -EPROTO;
+    }
+    err = cs_shm_ring_map(r, hdr.data_offset + (size_t)hdr.capacity_frames * hdr.frame_bytes,
+                          PROT_READ);
+    if (err < 0) {
+        CS_shm_ring_close(r);
+        return err;
+    }
+    r->data = (uint8_t *)r->hdr + hdr.data_offset;
+    r->capacity = hdr.capacity_frames;
+    r->wrap = hdr.wrap_frames;
+    r->read_pos = __atomic_load_n(&r->hdr->write_pos, __ATOMIC_ACQUIRE);
+    return 0;
+}
+
+/**
+ * @brief Returns the unread frames that are contiguous in the ring.
+ *
+ * @param r    Attached reader.
+ * @param data Out: first unread frame, valid until consumed.
+ * @return long Frames available, 0 if none, -EPIPE when the publisher lapped
+ *         this reader, -ESHUTDOWN once the publisher stopped and all data was
+ *         read.
+ */
+long CS_shm_ring_peek(struct cs_shm_ring *r, const void **data)
+{
+    uint32_t write_pos = __atomic_load_n(&r->hdr->write_pos, __ATOMIC_ACQUIRE);
+    uint32_t read_pos = r->read_pos;
+    uint32_t fill = cs_shm_ring_dist(r, read_pos, write_pos);
+    uint32_t offset = read_pos % r->capacity;
+    uint32_t contiguous = r->capacity - offset;
+
+    /* The period being captured next overwrites the oldest frames */
+    if (fill > r->capacity - r->hdr->period_frames) {
+        r->overruns++;
+        return -EPIPE;
+    }
+    if (!fill)
+        return __atomic_load_n(&r->hdr->closed, __ATOMIC_ACQUIRE) ? -ESHUTDOWN : 0;
+    *data = r->data + (size_t)offset * r->hdr->frame_bytes;
+    return fill < contiguous ? fill : contiguous;
+}
+
+/**
+ * @brief Releases @p frames after use.
+ *
+ * @return int 0, or -EPIPE when the publisher caught up while they were being
+ *         read, i.e. they may have been overwritten (call CS_shm_ring_recover()).
+ */
+int CS_shm_ring_consume(struct cs_shm_ring *r, uint32_t frames)
+{
+    uint32_t read_pos = r->read_pos;
+    uint32_t write_pos;
+
+    /*
+     * Seqlock read side: the samples were read with plain loads, and an
+     * acquire load of write_pos alone would not keep them before it.
+     */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    write_pos = __atomic_load_n(&r->hdr->write_pos, __ATOMIC_RELAXED);
+
+    r->read_pos = cs_shm_ring_add(r, read_pos, frames);
+    if (cs_shm_ring_dist(r, read_pos, write_pos) > r->capacity - r->hdr->period_frames) {
+        r->overruns++;
+        return -EPIPE;
+    }
+    return 0;
+}
+
+/**
+ * @brief Sleeps until at least @p min_frames are unread.
+ *
+ * @return int 1 when the frames are there, 0 on timeout (-1 waits forever),
+ *         -ESHUTDOWN once the publisher is gone.
+ */
+int CS_shm_ring_wait(struct cs_shm_ring *r, uint32_t min_frames, int timeout_ms)
+{
+    struct cs_shm_ring_header *hdr = r->hdr;
+    struct timespec deadline, left;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    for (;;) {
+        uint32_t seq = __atomic_load_n(&hdr->futex_seq, __ATOMIC_SEQ_CST);
+        struct timespec now;
+
+        if (cs_shm_ring_dist(r, r->read_pos, __atomic_load_n(&hdr->write_pos, __ATOMIC_ACQUIRE)) >=
+            min_frames)
+            return 1;
+        if (__atomic_load_n(&hdr->closed, __ATOMIC_ACQUIRE))
+            return -ESHUTDOWN;
+
+        if (timeout_ms >= 0) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            left.tv_sec = deadline.tv_sec - now.tv_sec;
+            left.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+            if (left.tv_nsec < 0) {
+                left.tv_sec--;
+                left.tv_nsec += 1000000000L;
+            }
+            if (left.tv_sec < 0)
+                return 0;
+        }
+
+        /* A publish after the load above changed futex_seq: the wait returns at once */
+        cs_shm_ring_futex(&hdr->futex_seq, FUTEX_WAIT, seq, timeout_ms >= 0 ? &left : NULL);
+    }
+}
+
+/**
+ * @brief Skips to half a ring behind the publisher after an overrun.
+ */
+void CS_shm_ring_recover(struct cs_shm_ring *r)
+{
+    uint32_t write_pos = __atomic_load_n(&r->hdr->write_pos, __ATOMIC_ACQUIRE);
+
+    r->read_pos = cs_shm_ring_add(r, write_pos, r->wrap - r->capacity / 2);
+}
+
+/**
+ * @brief Unmaps; the publisher first marks the ring closed and wakes every
+ *        reader.
+ */
+void CS_shm_ring_close(struct cs_shm_ring *r)
+{
+    if (r->hdr) {
+        if (r->publisher && r->data) {
+            __atomic_store_n(&r->hdr->closed, 1, __ATOMIC_RELEASE);
+            __atomic_add_fetch(&r->hdr->futex_seq, 1, __ATOMIC_SEQ_CST);
+            cs_shm_ring_futex(&r->hdr->futex_seq, FUTEX_WAKE, INT_MAX, NULL);
+        }
+        munmap(r->hdr, r->map_bytes);
+    }
+    if (r->fd >= 0)
+        close(r->fd);
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+}
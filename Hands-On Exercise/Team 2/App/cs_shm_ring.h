@@ -0,0 +1,88 @@
+/**
+ * @file
+ * @brief Shared-memory capture ring: one publisher, many zero-copy readers
+ *
+ * @details capgeminiSound --publish captures straight into a memfd-backed
+ * ring and hands the memfd to local readers over a Unix socket (SCM_RIGHTS).
+ * Every reader maps the same pages and reads the samples in place:
+ * - the memfd is sealed with F_SEAL_FUTURE_WRITE once the publisher has
+ *   mapped it, so readers can only map it read-only and cannot touch the
+ *   header, write_pos or the samples.
+ * - write_pos (frames, free-running) is owned by the publisher; periods are
+ *   published whole and never straddle the wrap.
+ * - each reader keeps its cursor in its own struct cs_shm_ring; the publisher
+ *   never waits for readers. A reader that falls (almost) a full ring behind
+ *   gets -EPIPE from peek/consume and resynchronises with
+ *   CS_shm_ring_recover().
+ * - readers with nothing to read sleep on a futex in the shared header.
+ * One capture plus N readers therefore costs one capture and one FUTEX_WAKE
+ * per period; with nobody waiting the wake returns without switching.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial shared ring and reader library
+ * - 19-10-2026: Read-only reader mappings, private reader cursors
+ * - 19-10-2026: Any period size: positions wrap at a multiple of the ring
+ */
+#ifndef CS_SHM_RING_H
+#define CS_SHM_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CS_SHM_RING_SOCKET "/tmp/capgeminiSound.sock"
+#define CS_SHM_RING_MAGIC 0x52485343U   /* "CSHR" */
+#define CS_SHM_RING_VERSION 3U
+
+struct cs_shm_ring_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t rate;
+    uint32_t channels;
+    int32_t format;                     /* snd_pcm_format_t */
+    uint32_t frame_bytes;
+    uint32_t capacity_frames;           /* periods * period_frames */
+    uint32_t period_frames;
+    uint32_t data_offset;
+    uint32_t wrap_frames;               /* positions run modulo this, capacity * 2^k */
+
+    /* Publisher line, the only part of the header that changes */
+    uint32_t write_pos __attribute__((aligned(64)));
+    uint32_t futex_seq;                 /* bumped on every publish */
+    uint32_t closed;                    /* publisher gone */
+};
+
+struct cs_shm_ring {
+    int fd;
+    struct cs_shm_ring_header *hdr;     /* mapped read-only on the reader side */
+    uint8_t *data;
+    size_t map_bytes;
+    int publisher;
+    uint32_t capacity;                  /* private copies of the geometry */
+    uint32_t wrap;
+    uint32_t read_pos;                  /* reader: frames consumed, modulo wrap */
+    uint32_t overruns;                  /* reader: times it was lapped */
+};
+
+/* Publisher side */
+int CS_shm_ring_create(struct cs_shm_ring *r, unsigned int rate, unsigned int channels,
+                       int format, unsigned int frame_bytes, unsigned int period_frames,
+                       unsigned int periods);
+void *CS_shm_ring_write_ptr(struct cs_shm_ring *r);
+void CS_shm_ring_publish(struct cs_shm_ring *r, uint32_t frames);
+int CS_shm_ring_listen(const char *path);
+int CS_shm_ring_send_fd(int sock, int fd);
+
+/* Reader side */
+int CS_shm_ring_attach(struct cs_shm_ring *r, const char *path);
+long CS_shm_ring_peek(struct cs_shm_ring *r, const void **data);
+int CS_shm_ring_consume(struct cs_shm_ring *r, uint32_t frames);
+int CS_shm_ring_wait(struct cs_shm_ring *r, uint32_t min_frames, int timeout_ms);
+void CS_shm_ring_recover(struct cs_shm_ring *r);
+
+void CS_shm_ring_close(struct cs_shm_ring *r);
+
+#endif /* CS_SHM_RING_H */
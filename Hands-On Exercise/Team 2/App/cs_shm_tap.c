@@ -0,0 +1,92 @@
+/**
+ * @file
+ * @brief Example reader of capgeminiSound --publish: level meter
+ *
+ * @details Attaches to the shared capture ring and prints the level once a
+ * second, reading the samples in place. Start several to see N readers cost
+ * next to nothing next to the capture:
+ *   capgeminiSound --publish &
+ *   cs_shm_tap [socket [seconds]]
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Initial level meter reader
+ */
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "cs_dsp.h"
+#include "cs_shm_ring.h"
+
+#define CS_SHM_TAP_BLOCK 1024U
+
+int main(int argc, char *argv[])
+{
+    static float work[CS_SHM_TAP_BLOCK];
+    struct cs_shm_ring ring;
+    const char *path = argc >= 2 ? argv[1] : CS_SHM_RING_SOCKET;
+    unsigned long seconds = argc >= 3 ? strtoul(argv[2], NULL, 0) : 0;
+    unsigned long long frames = 0, second = 0;
+    double sum_squares = 0.0;
+    int err;
+
+    err = CS_shm_ring_attach(&ring, path);
+    if (err < 0) {
+        fprintf(stderr, "CapgeminiSound ERR: cannot attach to %s: %s\n", path, strerror(-err));
+        return EXIT_FAILURE;
+    }
+    if (!CS_dsp_format_supported(ring.hdr->format)) {
+        fprintf(stderr, "CapgeminiSound ERR: unsupported published format\n");
+        CS_shm_ring_close(&ring);
+        return EXIT_FAILURE;
+    }
+    printf("Reader %d: %u Hz, %u ch\n", (int)getpid(), ring.hdr->rate, ring.hdr->channels);
+
+    while (!seconds || second < seconds) {
+        const void *data;
+        long n = CS_shm_ring_peek(&ring, &data);
+
+        if (n == -EPIPE) {
+            CS_shm_ring_recover(&ring);
+            continue;
+        }
+        if (n == 0) {
+            err = CS_shm_ring_wait(&ring, ring.hdr->period_frames, 1000);
+            if (err < 0)
+                break;
+            continue;
+        }
+        if (n < 0)
+            break;
+        if (n > (long)CS_SHM_TAP_BLOCK)
+            n = CS_SHM_TAP_BLOCK;
+
+        CS_dsp_to_float(data, ring.hdr->format, ring.hdr->channels, work, n);
+        if (CS_shm_ring_consume(&ring, (uint32_t)n) < 0) {
+            /* Publisher lapped us while converting: the block is garbage */
+            CS_shm_ring_recover(&ring);
+            continue;
+        }
+        for (long i = 0; i < n; ++i)
+            sum_squares += (double)work[i] * work[i];
+        frames += n;
+
+        if (frames >= ring.hdr->rate) {
+            printf("%4llu s  %6.1f dBFS  overruns %u\n", ++second,
+                   10.0 * log10(sum_squares / frames + 1e-20),
+                   ring.overruns);
+            fflush(stdout);
+            frames = 0;
+            sum_squares = 0.0;
+        }
+    }
+
+    CS_shm_ring_close(&ring);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,505 @@
+/**
+ * @file
+ * @brief Seekable WAV writer/reader shared by capgeminiSound and the recording service
+ *
+ * @details See cs_wav.h for the file layout. The writer keeps the seek table
+ * and the peaks in memory (about 300 KB for three hours at the defaults) and
+ * appends them after the samples on close, then rewrites the header block
+ * with the final sizes.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Moved header writer out of capgeminiSound.c
+ * - 19-10-2026: Writer/reader library with extensible format, seek table and peaks
+ * - 19-10-2026: 64-bit file offsets (fseeko/ftello), close fails on a lost position
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include "cs_wav.h"
+
+#define CS_WAV_FORMAT_PCM 0x0001U
+#define CS_WAV_FORMAT_EXTENSIBLE 0xFFFEU
+#define CS_WAV_CHUNK_VERSION 1U
+/* RIFF sizes are 32-bit; keep room for the trailing chunks */
+#define CS_WAV_MAX_DATA_BYTES 0xF0000000ULL
+
+/* KSDATAFORMAT_SUBTYPE_PCM */
+static const uint8_t cs_wav_pcm_guid[16] = {
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+    0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71
+};
+
+static void cs_wav_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void cs_wav_le32(uint8_t *p, uint32_t v)
+{
+    cs_wav_le16(p, (uint16_t)v);
+    cs_wav_le16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t cs_wav_get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t cs_wav_get32(const uint8_t *p)
+{
+    return cs_wav_get16(p) | (uint32_t)cs_wav_get16(p + 2) << 16;
+}
+
+static void cs_wav_build_header(uint8_t *hdr, const struct cs_wav_format *fmt,
+                                uint32_t block_align, uint32_t data_bytes, uint32_t riff_bytes)
+{
+    int extensible = fmt->bits > 16 || fmt->channels > 2 || fmt->valid_bits != fmt->bits;
+    uint32_t fmt_bytes = extensible ? 40 : 16;
+    uint32_t junk = 20 + fmt_bytes;
+
+    memset(hdr, 0, CS_WAV_DATA_OFFSET);
+    memcpy(hdr, "RIFF", 4);
+    cs_wav_le32(hdr + 4, riff_bytes);
+    memcpy(hdr + 8, "WAVEfmt ", 8);
+    cs_wav_le32(hdr + 16, fmt_bytes);
+    cs_wav_le16(hdr + 20, extensible ? CS_WAV_FORMAT_EXTENSIBLE : CS_WAV_FORMAT_PCM);
+    cs_wav_le16(hdr + 22, fmt->channels);
+    cs_wav_le32(hdr + 24, fmt->rate);
+    cs_wav_le32(hdr + 28, fmt->rate * block_align);
+    cs_wav_le16(hdr + 32, (uint16_t)block_align);
+    cs_wav_le16(hdr + 34, fmt->bits);
+    if (extensible) {
+        cs_wav_le16(hdr + 36, 22);
+        cs_wav_le16(hdr + 38, fmt->valid_bits);
+        /* Front centre for the single capsule, FL|FR for a pair, else unassigned */
+        cs_wav_le32(hdr + 40, fmt->channels == 1 ? 0x4U : fmt->channels == 2 ? 0x3U : 0U);
+        memcpy(hdr + 44, cs_wav_pcm_guid, sizeof(cs_wav_pcm_guid));
+    }
+    /* JUNK pads the header so the samples start page aligned */
+    memcpy(hdr + junk, "JUNK", 4);
+    cs_wav_le32(hdr + junk + 4, CS_WAV_DATA_OFFSET - 8 - junk - 8);
+    memcpy(hdr + CS_WAV_DATA_OFFSET - 8, "data", 4);
+    cs_wav_le32(hdr + CS_WAV_DATA_OFFSET - 4, data_bytes);
+}
+
+static int cs_wav_write_block(FILE *file, const uint8_t *hdr)
+{
+    if (fseeko(file, 0, SEEK_SET) < 0 || fwrite(hdr, CS_WAV_DATA_OFFSET, 1, file) != 1)
+        return -EIO;
+    return 0;
+}
+
+static int cs_wav_grow(void **array, size_t *cap, size_t count, size_t elem)
+{
+    void *p;
+
+    if (count < *cap)
+        return 0;
+    p = realloc(*array, (*cap ? *cap * 2 : 256) * elem);
+    if (!p)
+        return -ENOMEM;
+    *array = p;
+    *cap = *cap ? *cap * 2 : 256;
+    return 0;
+}
+
+/* Largest magnitude in one frame, Q15 */
+static uint16_t cs_wav_frame_peak(const uint8_t *frame, const struct cs_wav_format *fmt)
+{
+    uint32_t peak = 0;
+
+    for (unsigned int c = 0; c < fmt->channels; ++c) {
+        int64_t v;
+        uint32_t mag;
+
+        switch (fmt->bits) {
+        case 16:
+            v = (int16_t)cs_wav_get16(frame + 2 * c);
+            mag = (uint32_t)(v < 0 ? -v : v);
+            break;
+        case 24:
+            v = (int32_t)((uint32_t)(frame[3 * c] | frame[3 * c + 1] << 8 |
+                                     frame[3 * c + 2] << 16) << 8) >> 8;
+            mag = (uint32_t)(v < 0 ? -v : v) >> 8;
+            break;
+        default:
+            v = (int32_t)cs_wav_get32(frame + 4 * c);
+            mag = (uint32_t)((v < 0 ? -v : v) >> 16);
+            break;
+        }
+        if (mag > peak)
+            peak = mag;
+    }
+    return (uint16_t)(peak > 32767 ? 32767 : peak);
+}
+
+/**
+ * @brief Creates @p path and writes the placeholder header block.
+ *
+ * @param w    Writer to initialise.
+ * @param path Output file.
+ * @param fmt  Sample format of the frames passed to CS_wav_writer_write().
+ * @return int 0 on success, negative errno otherwise.
+ */
+int CS_wav_writer_open(struct cs_wav_writer *w, const char *path, const struct cs_wav_format *fmt)
+{
+    uint8_t hdr[CS_WAV_DATA_OFFSET];
+
+    memset(w, 0, sizeof(*w));
+    if (!fmt->rate || !fmt->channels || (fmt->bits != 16 && fmt->bits != 24 && fmt->bits != 32) ||
+        !fmt->valid_bits || fmt->valid_bits > fmt->bits)
+        return -EINVAL;
+
+    w->fmt = *fmt;
+    w->block_align = fmt->channels * (fmt->bits / 8U);
+    w->peak_frames = fmt->rate / CS_WAV_PEAKS_PER_SECOND ? fmt->rate / CS_WAV_PEAKS_PER_SECOND : 1;
+    w->file = fopen(path, "wb");
+    if (!w->file)
+        return -errno;
+
+    cs_wav_build_header(hdr, fmt, w->block_align, 0, CS_WAV_DATA_OFFSET - 8);
+    if (cs_wav_write_block(w->file, hdr) < 0) {
+        fclose(w->file);
+        w->file = NULL;
+        return -EIO;
+    }
+    return 0;
+}
+
+/**
+ * @brief Moves the capture clock, e.g. after frames were lost in an xrun.
+ *
+ * @param w       Writer.
+ * @param time_us Capture time of the next frame, since the recording start.
+ */
+void CS_wav_writer_set_time(struct cs_wav_writer *w, uint64_t time_us)
+{
+    w->time_base_us = time_us;
+    w->base_frame = w->data_bytes / w->block_align;
+}
+
+/**
+ * @brief Appends interleaved little-endian frames in the writer's format.
+ *
+ * @return int 0 on success, -EFBIG once the 32-bit RIFF limit is reached,
+ *         other negative errno on failure.
+ */
+int CS_wav_writer_write(struct cs_wav_writer *w, const void *frames, size_t count)
+{
+    const uint8_t *p = frames;
+    uint64_t frame = w->data_bytes / w->block_align;
+    uint32_t time_ms = (uint32_t)((w->time_base_us + (frame - w->base_frame) * 1000000ULL /
+                                   w->fmt.rate) / 1000U);
+
+    if (w->data_bytes + (uint64_t)count * w->block_align > CS_WAV_MAX_DATA_BYTES)
+        return -EFBIG;
+
+    if (time_ms >= w->next_seek_ms) {
+        if (cs_wav_grow((void **)&w->seek, &w->seek_cap, w->seek_count, sizeof(*w->seek)) < 0)
+            return -ENOMEM;
+        w->seek[w->seek_count].time_ms = time_ms;
+        w->seek[w->seek_count].frame = (uint32_t)frame;
+        w->seek_count++;
+        w->next_seek_ms = (time_ms / CS_WAV_SEEK_INTERVAL_MS + 1) * CS_WAV_SEEK_INTERVAL_MS;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        uint16_t peak = cs_wav_frame_peak(p + i * w->block_align, &w->fmt);
+
+        if (peak > w->peak_cur)
+            w->peak_cur = peak;
+        if (++w->peak_fill == w->peak_frames) {
+            if (cs_wav_grow((void **)&w->peaks, &w->peak_cap, w->peak_count, sizeof(*w->peaks)) < 0)
+                return -ENOMEM;
+            w->peaks[w->peak_count++] = w->peak_cur;
+            w->peak_cur = 0;
+            w->peak_fill = 0;
+        }
+    }
+
+    if (fwrite(frames, w->block_align, count, w->file) != count)
+        return -EIO;
+    w->data_bytes += (uint64_t)count * w->block_align;
+    return 0;
+}
+
+static int cs_wav_write_chunk(FILE *file, const char *id, const uint32_t head[3],
+                              const void *payload, size_t bytes)
+{
+    uint8_t hdr[20];
+    static const uint8_t pad;
+
+    memcpy(hdr, id, 4);
+    cs_wav_le32(hdr + 4, (uint32_t)(12 + bytes));
+    for (int i = 0; i < 3; ++i)
+        cs_wav_le32(hdr + 8 + 4 * i, head[i]);
+    if (fwrite(hdr, sizeof(hdr), 1, file) != 1 ||
+        (bytes && fwrite(payload, bytes, 1, file) != 1) ||
+        (bytes & 1 && fwrite(&pad, 1, 1, file) != 1))
+        return -EIO;
+    return 0;
+}
+
+/**
+ * @brief Appends the seek table and peaks, finalises the header and closes.
+ *
+ * @return int 0 on success, negative errno otherwise. The file is closed
+ *         and the writer's memory released in every case.
+ */
+int CS_wav_writer_close(struct cs_wav_writer *w)
+{
+    uint8_t hdr[CS_WAV_DATA_OFFSET];
+    static const uint8_t pad;
+    int err = 0;
+    off_t end;
+
+    if (!w->file)
+        return -EBADF;
+
+    if (w->peak_fill && cs_wav_grow((void **)&w->peaks, &w->peak_cap, w->peak_count,
+                                    sizeof(*w->peaks)) == 0)
+        w->peaks[w->peak_count++] = w->peak_cur;
+
+    /* Custom chunks are stored in host order; both targets are little-endian */
+    if ((w->data_bytes & 1 && fwrite(&pad, 1, 1, w->file) != 1) ||
+        cs_wav_write_chunk(w->file, "cssk",
+                           (const uint32_t[3]){ CS_WAV_CHUNK_VERSION, CS_WAV_SEEK_INTERVAL_MS,
+                                                (uint32_t)w->seek_count },
+                           w->seek, w->seek_count * sizeof(*w->seek)) < 0 ||
+        cs_wav_write_chunk(w->file, "cspk",
+                           (const uint32_t[3]){ CS_WAV_CHUNK_VERSION, w->peak_frames,
+                                                (uint32_t)w->peak_count },
+                           w->peaks, w->peak_count * sizeof(*w->peaks)) < 0)
+        err = -EIO;
+
+    /* Without the end offset the header cannot be finalised: report it */
+    end = ftello(w->file);
+    if (!err && end < 0)
+        err = -errno;
+    if (!err && end > 8) {
+        cs_wav_build_header(hdr, &w->fmt, w->block_align, (uint32_t)w->data_bytes,
+                            (uint32_t)(end - 8));
+        err = cs_wav_write_block(w->file, hdr);
+    }
+    if (fclose(w->file) != 0 && !err)
+        err = -EIO;
+
+    free(w->seek);
+    free(w->peaks);
+    memset(w, 0, sizeof(*w));
+    return err;
+}
+
+static int cs_wav_parse_fmt(struct cs_wav_reader *r, const uint8_t *p, uint32_t size)
+{
+    uint16_t tag = cs_wav_get16(p);
+
+    if (size < 16)
+        return -EPROTO;
+    r->fmt.channels = cs_wav_get16(p + 2);
+    r->fmt.rate = cs_wav_get32(p + 4);
+    r->block_align = cs_wav_get16(p + 12);
+    r->fmt.bits = cs_wav_get16(p + 14);
+    r->fmt.valid_bits = r->fmt.bits;
+    if (tag == CS_WAV_FORMAT_EXTENSIBLE) {
+        if (size < 40 || memcmp(p + 24, cs_wav_pcm_guid, sizeof(cs_wav_pcm_guid)) != 0)
+            return -EPROTO;
+        r->fmt.valid_bits = cs_wav_get16(p + 18);
+    } else if (tag != CS_WAV_FORMAT_PCM) {
+        return -EPROTO;
+    }
+    if (!r->fmt.channels || !r->fmt.rate ||
+        (r->fmt.bits != 16 && r->fmt.bits != 24 && r->fmt.bits != 32) ||
+        r->block_align != r->fmt.channels * (r->fmt.bits / 8U))
+        return -EPROTO;
+    return 0;
+}
+
+/**
+ * @brief Opens a WAV file and indexes its chunks (no sample data is read).
+ *
+ * Works on any PCM WAV; seek table and peaks are used when present.
+ *
+ * @return int 0 on success, -EPROTO for unsupported files, negative errno otherwise.
+ */
+int CS_wav_reader_open(struct cs_wav_reader *r, const char *path)
+{
+    uint8_t buf[40];
+    int have_fmt = 0, err = -EPROTO;
+    off_t file_end;
+
+    memset(r, 0, sizeof(*r));
+    r->file = fopen(path, "rb");
+    if (!r->file)
+        return -errno;
+    if (fseeko(r->file, 0, SEEK_END) < 0 || (file_end = ftello(r->file)) < 0) {
+        err = -errno;
+        goto fail;
+    }
+    rewind(r->file);
+
+    if (fread(buf, 12, 1, r->file) != 1 || memcmp(buf, "RIFF", 4) || memcmp(buf + 8, "WAVE", 4))
+        goto fail;
+
+    while (fread(buf, 8, 1, r->file) == 1) {
+        uint32_t size = cs_wav_get32(buf + 4);
+        off_t pos = ftello(r->file);
+
+        if (!memcmp(buf, "fmt ", 4)) {
+            if (fread(buf, size < 40 ? size : 40, 1, r->file) != 1 ||
+                cs_wav_parse_fmt(r, buf, size) < 0)
+                goto fail;
+            have_fmt = 1;
+        } else if (!memcmp(buf, "data", 4)) {
+            r->data_offset = (uint64_t)pos;
+            /* An unfinished recording still has the placeholder size */
+            r->data_bytes = size && (uint64_t)pos + size <= (uint64_t)file_end
+                            ? size : (uint64_t)(file_end - pos);
+        } else if (!memcmp(buf, "cssk", 4) || !memcmp(buf, "cspk", 4)) {
+            if (size < 12 || fread(buf + 8, 12, 1, r->file) != 1 ||
+                cs_wav_get32(buf + 8) != CS_WAV_CHUNK_VERSION)
+                goto next;
+            if (buf[3] == 'k' && buf[2] == 's') {
+                r->seek_offset = (uint64_t)pos + 12;
+                r->seek_count = cs_wav_get32(buf + 16);
+            } else {
+                r->peak_frames = cs_wav_get32(buf + 12);
+                r->peak_offset = (uint64_t)pos + 12;
+                r->peak_count = cs_wav_get32(buf + 16);
+            }
+        }
+next:
+        if (pos < 0 || fseeko(r->file, pos + (off_t)size + (off_t)(size & 1), SEEK_SET) < 0)
+            break;
+    }
+
+    if (!have_fmt || !r->data_offset)
+        goto fail;
+    r->frames = r->data_bytes / r->block_align;
+    if (fseeko(r->file, (off_t)r->data_offset, SEEK_SET) < 0) {
+        err = -errno;
+        goto fail;
+    }
+    return 0;
+
+fail:
+    fclose(r->file);
+    r->file = NULL;
+    return err;
+}
+
+/**
+ * @brief Positions the reader at a capture time.
+ *
+ * Binary search over the on-disk seek table, then frame arithmetic inside
+ * the interval; without a table the time is converted directly.
+ *
+ * @return int 0 on success, negative errno otherwise.
+ */
+int CS_wav_reader_seek_time(struct cs_wav_reader *r, uint32_t time_ms)
+{
+    uint64_t frame = (uint64_t)time_ms * r->fmt.rate / 1000U;
+
+    if (r->seek_count) {
+        uint32_t lo = 0, hi = r->seek_count;
+        struct cs_wav_seek_entry e = { 0, 0 }, next;
+
+        /* Last entry with entry.time_ms <= time_ms */
+        while (hi - lo > 1) {
+            uint32_t mid = lo + (hi - lo) / 2;
+
+            if (fseeko(r->file, (off_t)(r->seek_offset + (uint64_t)mid * sizeof(e)), SEEK_SET) < 0 ||
+                fread(&next, sizeof(next), 1, r->file) != 1)
+                return -EIO;
+            if (next.time_ms <= time_ms)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        if (fseeko(r->file, (off_t)(r->seek_offset + (uint64_t)lo * sizeof(e)), SEEK_SET) < 0 ||
+            fread(&e, sizeof(e), 1, r->file) != 1)
+            return -EIO;
+        frame = time_ms >= e.time_ms ? e.frame + (uint64_t)(time_ms - e.time_ms) * r->fmt.rate / 1000U
+                                     : e.frame;
+        /* Across a gap the next entry starts earlier than the arithmetic says */
+        if (lo + 1 < r->seek_count && fread(&next, sizeof(next), 1, r->file) == 1 &&
+            frame > next.frame)
+            frame = next.frame;
+    }
+
+    if (frame > r->frames)
+        frame = r->frames;
+    if (fseeko(r->file, (off_t)(r->data_offset + frame * r->block_align), SEEK_SET) < 0)
+        return -errno;
+    r->position = frame;
+    return 0;
+}
+
+/**
+ * @brief Reads up to @p count frames in the file's format.
+ *
+ * @return long Frames read, 0 at the end of the data, negative errno on error.
+ */
+long CS_wav_reader_read(struct cs_wav_reader *r, void *frames, size_t count)
+{
+    size_t n;
+
+    if (count > r->frames - r->position)
+        count = (size_t)(r->frames - r->position);
+    n = fread(frames, r->block_align, count, r->file);
+    if (n < count && ferror(r->file))
+        return -EIO;
+    r->position += n;
+    return (long)n;
+}
+
+/**
+ * @brief Reduces the stored peaks to @p count points for an overview.
+ *
+ * Reads only the cspk chunk and leaves the read position unchanged.
+ *
+ * @return long Points written (fewer than @p count for short files),
+ *         -ENOENT when the file has no peak chunk.
+ */
+long CS_wav_reader_overview(struct cs_wav_reader *r, uint16_t *points, size_t count)
+{
+    uint16_t buf[512];
+    off_t saved = ftello(r->file);
+    size_t done = 0, out = 0;
+
+    if (!r->peak_count)
+        return -ENOENT;
+    if (count > r->peak_count)
+        count = r->peak_count;
+    if (!count || saved < 0 || fseeko(r->file, (off_t)r->peak_offset, SEEK_SET) < 0)
+        return 0;
+
+    memset(points, 0, count * sizeof(*points));
+    while (done < r->peak_count) {
+        size_t n = r->peak_count - done < 512 ? r->peak_count - done : 512;
+
+        if (fread(buf, sizeof(buf[0]), n, r->file) != n)
+            break;
+        for (size_t i = 0; i < n; ++i) {
+            out = (done + i) * count / r->peak_count;
+            if (buf[i] > points[out])
+                points[out] = buf[i];
+        }
+        done += n;
+    }
+    fseeko(r->file, saved, SEEK_SET);
+    return (long)count;
+}
+
+void CS_wav_reader_close(struct cs_wav_reader *r)
+{
+    if (r->file)
+        fclose(r->file);
+    memset(r, 0, sizeof(*r));
+}
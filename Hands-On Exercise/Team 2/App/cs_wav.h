@@ -0,0 +1,95 @@
+/**
+ * @file
+ * @brief Seekable WAV writer/reader shared by capgeminiSound and the recording service
+ *
+ * @details File layout written by CS_wav_writer_*:
+ * - offset 0: one 4 KiB header block, written in a single aligned write at
+ *   open and again at close: RIFF, "fmt " (WAVE_FORMAT_EXTENSIBLE for more
+ *   than 16 bits or 2 channels), a JUNK pad and the "data" chunk header, so
+ *   samples start page aligned at offset CS_WAV_DATA_OFFSET.
+ * - the samples.
+ * - "cssk": coarse seek table, one {time_ms, frame} entry per interval of
+ *   capture time. Time comes from the caller when the stream has gaps
+ *   (xruns), so seeking by wall-clock stays right where frame arithmetic
+ *   would drift.
+ * - "cspk": peak magnitude (Q15) per block of frames, for overview drawing.
+ * Players ignore the custom chunks. Readers find them by walking the chunk
+ * list, then binary-search the seek table in the file, so jumping to a
+ * timestamp reads a few hundred bytes whatever the recording length.
+ * All fields are little-endian, as are the ALSA formats used on the board.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: Moved header writer out of capgeminiSound.c
+ * - 19-10-2026: Writer/reader library with extensible format, seek table and peaks
+ */
+#ifndef CS_WAV_H
+#define CS_WAV_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define CS_WAV_DATA_OFFSET 4096U
+#define CS_WAV_SEEK_INTERVAL_MS 1000U
+#define CS_WAV_PEAKS_PER_SECOND 10U
+
+struct cs_wav_format {
+    uint32_t rate;
+    uint16_t channels;
+    uint16_t bits;                  /* container: 16, 24 (packed) or 32 */
+    uint16_t valid_bits;            /* <= bits, e.g. 24 in 32 for the INMP441 */
+};
+
+struct cs_wav_seek_entry {
+    uint32_t time_ms;
+    uint32_t frame;
+};
+
+struct cs_wav_writer {
+    FILE *file;
+    struct cs_wav_format fmt;
+    uint32_t block_align;
+    uint64_t data_bytes;
+    uint64_t time_base_us;          /* capture time of frame base_frame */
+    uint64_t base_frame;
+    uint32_t next_seek_ms;
+    struct cs_wav_seek_entry *seek;
+    size_t seek_count, seek_cap;
+    uint32_t peak_frames;           /* frames per peak block */
+    uint32_t peak_fill;             /* frames in the current block */
+    uint16_t peak_cur;
+    uint16_t *peaks;
+    size_t peak_count, peak_cap;
+};
+
+struct cs_wav_reader {
+    FILE *file;
+    struct cs_wav_format fmt;
+    uint32_t block_align;
+    uint64_t data_offset;
+    uint64_t data_bytes;
+    uint64_t frames;
+    uint64_t position;              /* next frame read */
+    uint64_t seek_offset;           /* first cssk entry, 0 if none */
+    uint32_t seek_count;
+    uint64_t peak_offset;           /* first cspk value, 0 if none */
+    uint32_t peak_count;
+    uint32_t peak_frames;
+};
+
+int CS_wav_writer_open(struct cs_wav_writer *w, const char *path, const struct cs_wav_format *fmt);
+int CS_wav_writer_write(struct cs_wav_writer *w, const void *frames, size_t count);
+void CS_wav_writer_set_time(struct cs_wav_writer *w, uint64_t time_us);
+int CS_wav_writer_close(struct cs_wav_writer *w);
+
+int CS_wav_reader_open(struct cs_wav_reader *r, const char *path);
+int CS_wav_reader_seek_time(struct cs_wav_reader *r, uint32_t time_ms);
+long CS_wav_reader_read(struct cs_wav_reader *r, void *frames, size_t count);
+long CS_wav_reader_overview(struct cs_wav_reader *r, uint16_t *points, size_t count);
+void CS_wav_reader_close(struct cs_wav_reader *r);
+
+#endif /* CS_WAV_H */
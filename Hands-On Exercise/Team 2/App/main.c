@@ -1,80 +1,540 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <unistd.h>
-#include <string.h>
-#include <errno.h>
-#include <signal.h>
-
-// Global flag for graceful shutdown
-volatile sig_atomic_t running = 1;
-
-// Signal handler for graceful shutdown
-void signal_handler(int sig) {
-    printf("\nReceived signal %d, shutting down gracefully...\n", sig);
-    running = 0;
-}
-
-// Function to display usage information
-void print_usage(const char *program_name) {
-    printf("Usage: %s [OPTIONS]\n", program_name);
-    printf("Options:\n");
-    printf("  -h, --help     Show this help message\n");
-    printf("  -v, --version  Show version information\n");
-    printf("  -n <name>      Specify a name (default: World)\n");
-}
-
-// Function to display version
-void print_version(void) {
-    printf("Simple Linux App v1.0\n");
-    printf("Built on %s at %s\n", __DATE__, __TIME__);
-}
-
-int main(int argc, char *argv[]) {
-    char name[256] = "World";
-    int opt;
-    
-    // Set up signal handlers
-    signal(SIGINT, signal_handler);   // Ctrl+C
-    signal(SIGTERM, signal_handler);  // Termination signal
-    
-    // Parse command line arguments
-    while ((opt = getopt(argc, argv, "hvn:")) != -1) {
-        switch (opt) {
-            case 'h':
-                print_usage(argv[0]);
-                return EXIT_SUCCESS;
-            case 'v':
-                print_version();
-                return EXIT_SUCCESS;
-            case 'n':
-                strncpy(name, optarg, sizeof(name) - 1);
-                name[sizeof(name) - 1] = '\0';
-                break;
-            default:
-                print_usage(argv[0]);
-                return EXIT_FAILURE;
-        }
-    }
-    
-    printf("Simple Linux Application Started\n");
-    printf("Process ID: %d\n", getpid());
-    printf("Hello, %s!\n", name);
-    
-    // Main application loop
-    int counter = 0;
-    while (running) {
-        printf("Running... (iteration %d)\n", ++counter);
-        
-        // Simulate some work
-        sleep(2);
-        
-        // Exit after 10 iterations for demo purposes
-        if (counter >= 10) {
-            printf("Completed 10 iterations, exiting...\n");
-            break;
-        }
-    }
-    
-    printf("Application shutting down...\n");
-    return EXIT_SUCCESS;
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <alsa/asoundlib.h>
+#include "capgeminiSound.h"
+#include "cs_dsp.h"
+#include "cs_pcm.h"
+#include "cs_resampler.h"
+#include "cs_wav.h"
+
+/*
+ * capgeminiSoundd - long-lived recording service.
+ *
+ * The capture PCM is opened and configured once and kept PREPARED, so a
+ * "record" command only has to snd_pcm_start() it: the first period is
+ * captured one period after the command instead of after a full
+ * open/hw_params/sw_params cycle. Everything runs from one epoll loop over
+ * a signalfd, a timerfd, the PCM poll descriptors and a Unix control socket.
+ *
+ * Control protocol, one command per line, one reply line each:
+ *   record <file.wav> [seconds] [rate]  -> OK | ERR <reason>
+ *   stop                                -> OK <frames>
+ *   status                              -> IDLE | RECORDING <file> <frames>
+ *   quit                                -> OK, then the service exits
+ * The client that started a recording also gets "DONE <file> <frames>"
+ * when it ends on its own. The socket is created 0600: a "record" writes
+ * to any path the service can, so only its own user may connect.
+ */
+
+#define SERVICE_SOCKET_PATH "/run/capgeminiSound.sock"
+#define SERVICE_MAX_EVENTS 16
+#define SERVICE_MAX_CLIENTS 8
+#define SERVICE_LINE_MAX 512
+// Longest "record" duration: keeps the frame count and the watchdog in range
+#define SERVICE_MAX_SECONDS 86400.0
+
+// epoll_event.data.u64: source type in the upper half, fd/index in the lower
+enum service_source {
+    SRC_SIGNAL = 1,
+    SRC_TIMER,
+    SRC_LISTEN,
+    SRC_CLIENT,
+    SRC_PCM,
+};
+#define SERVICE_TAG(type, n) (((uint64_t)(type) << 32) | (uint32_t)(n))
+
+struct client {
+    int fd;
+    size_t len;
+    char line[SERVICE_LINE_MAX];
+};
+
+struct recorder {
+    snd_pcm_t *pcm;
+    struct cs_pcm_config cfg;
+    struct pollfd *pfds;
+    int npfds;
+    char *buffer;
+    float *work;
+    float *resampled;
+    int16_t *samples;
+    size_t out_max;
+    struct cs_resampler *rs;
+    unsigned int out_rate;
+    struct cs_wav_writer wav;
+    struct timespec started;          // capture clock origin for the seek table
+    char path[256];
+    unsigned long long frames_in;
+    unsigned long long frames_limit;  // 0: until "stop"
+    unsigned long long frames_out;
+    int owner;                        // client fd notified on completion, -1 if none
+    int active;
+};
+
+// Global flag for graceful shutdown
+volatile sig_atomic_t running = 1;
+
+static int epfd = -1;
+static int timer_fd = -1;
+static struct client clients[SERVICE_MAX_CLIENTS];
+static struct recorder rec = { .owner = -1 };
+
+// Signal handling for graceful shutdown (delivered through the signalfd)
+void signal_handler(int sig) {
+    printf("\nReceived signal %d, shutting down gracefully...\n", sig);
+    running = 0;
+}
+
+// Function to display usage information
+void print_usage(const char *program_name) {
+    printf("Usage: %s [OPTIONS]\n", program_name);
+    printf("Options:\n");
+    printf("  -h, --help     Show this help message\n");
+    printf("  -v, --version  Show version information\n");
+    printf("  -s <path>      Control socket (default: %s)\n", SERVICE_SOCKET_PATH);
+    printf("  -d <device>    Capture device (default: %s)\n", CS_DEFAULT_DEVICE);
+}
+
+// Function to display version
+void print_version(void) {
+    printf("capgeminiSound recording service v2.0\n");
+    printf("Built on %s at %s\n", __DATE__, __TIME__);
+}
+
+static int epoll_add(int fd, uint32_t events, uint64_t tag) {
+    struct epoll_event ev = { .events = events, .data.u64 = tag };
+
+    return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static void client_reply(int fd, const char *fmt, ...) {
+    char msg[SERVICE_LINE_MAX];
+    va_list ap;
+    int len;
+
+    if (fd < 0)
+        return;
+    va_start(ap, fmt);
+    len = vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    if (len > 0)
+        send(fd, msg, (size_t)len < sizeof(msg) ? (size_t)len : sizeof(msg) - 1, MSG_NOSIGNAL);
+}
+
+// Open and configure the capture PCM once; it stays PREPARED between recordings
+static int recorder_open(const char *device) {
+    int err;
+
+    rec.cfg = (struct cs_pcm_config){ SND_PCM_FORMAT_UNKNOWN, CS_DEFAULT_CHANNELS,
+                                      CS_DEFAULT_RATE, CS_DEFAULT_FRAMES, 0, 0, 0 };
+    err = CS_pcm_open(&rec.pcm, device, SND_PCM_STREAM_CAPTURE, &rec.cfg);
+    if (err < 0)
+        return err;
+    err = CS_pcm_set_manual_start(rec.pcm, &rec.cfg);
+    if (err < 0)
+        return err;
+    snd_pcm_nonblock(rec.pcm, 1);
+
+    rec.npfds = snd_pcm_poll_descriptors_count(rec.pcm);
+    rec.pfds = calloc(rec.npfds, sizeof(*rec.pfds));
+    rec.buffer = malloc(snd_pcm_frames_to_bytes(rec.pcm, rec.cfg.period_frames));
+    rec.work = malloc(rec.cfg.period_frames * sizeof(float));
+    if (!rec.pfds || !rec.buffer || !rec.work)
+        return -ENOMEM;
+    snd_pcm_poll_descriptors(rec.pcm, rec.pfds, rec.npfds);
+    for (int i = 0; i < rec.npfds; ++i)
+        if (epoll_add(rec.pfds[i].fd, rec.pfds[i].events, SERVICE_TAG(SRC_PCM, i)) < 0)
+            return -errno;
+
+    printf("Capture ready: %s, %s, %u Hz, period %lu frames\n", device,
+           snd_pcm_format_name(rec.cfg.format), rec.cfg.rate,
+           (unsigned long)rec.cfg.period_frames);
+    return 0;
+}
+
+// Output buffers depend on the file rate; reallocate only when it changes
+static int recorder_set_rate(unsigned int out_rate) {
+    if (!out_rate)
+        out_rate = rec.cfg.rate;
+    if (rec.samples && out_rate == rec.out_rate) {
+        if (rec.rs)
+            CS_resampler_reset(rec.rs);
+        return 0;
+    }
+
+    CS_resampler_destroy(rec.rs);
+    rec.rs = NULL;
+    if (out_rate != rec.cfg.rate) {
+        rec.rs = CS_resampler_create(rec.cfg.rate, out_rate, 0);
+        if (!rec.rs)
+            return -EINVAL;
+    }
+    rec.out_rate = out_rate;
+    rec.out_max = rec.rs ? CS_resampler_max_output(rec.rs, rec.cfg.period_frames)
+                         : rec.cfg.period_frames;
+    free(rec.resampled);
+    free(rec.samples);
+    rec.resampled = malloc(rec.out_max * sizeof(float));
+    rec.samples = malloc(rec.out_max * CS_DEFAULT_CHANNELS * sizeof(int16_t));
+    return rec.resampled && rec.samples ? 0 : -ENOMEM;
+}
+
+static int recorder_start(const char *path, double seconds, unsigned int out_rate, int owner) {
+    struct cs_wav_format fmt = { 0, CS_DEFAULT_CHANNELS, 16, 16 };
+    struct itimerspec its = { 0 };
+    int err;
+
+    if (rec.active)
+        return -EBUSY;
+    // Also false for NaN; the casts below are undefined outside the range
+    if (!(seconds >= 0.0 && seconds <= SERVICE_MAX_SECONDS))
+        return -EINVAL;
+    err = recorder_set_rate(out_rate);
+    if (err < 0)
+        return err;
+
+    fmt.rate = rec.out_rate;
+    err = CS_wav_writer_open(&rec.wav, path, &fmt);
+    if (err < 0)
+        return err;
+
+    snprintf(rec.path, sizeof(rec.path), "%s", path);
+    rec.frames_in = 0;
+    rec.frames_out = 0;
+    rec.frames_limit = (unsigned long long)(seconds * rec.cfg.rate);
+    rec.owner = owner;
+
+    err = snd_pcm_start(rec.pcm);
+    if (err < 0) {
+        CS_wav_writer_close(&rec.wav);
+        return err;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &rec.started);
+    rec.active = 1;
+
+    // Watchdog: a recording whose PCM stalls still ends one second late
+    if (rec.frames_limit) {
+        its.it_value.tv_sec = (time_t)seconds + 1;
+        timerfd_settime(timer_fd, 0, &its, NULL);
+    }
+    return 0;
+}
+
+// Finish the file and bring the PCM back to PREPARED for the next command
+static void recorder_stop(const char *reason) {
+    struct itimerspec its = { 0 };
+
+    if (!rec.active)
+        return;
+    timerfd_settime(timer_fd, 0, &its, NULL);
+    snd_pcm_drop(rec.pcm);
+    snd_pcm_prepare(rec.pcm);
+
+    if (CS_wav_writer_close(&rec.wav) < 0)
+        reason = "truncated";
+    rec.active = 0;
+
+    printf("Recording %s: %s (%llu frames)\n", reason, rec.path, rec.frames_out);
+    client_reply(rec.owner, "DONE %s %llu\n", rec.path, rec.frames_out);
+    rec.owner = -1;
+}
+
+// Frames were dropped: realign the file's seek table with the capture clock
+static void recorder_mark_gap(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    CS_wav_writer_set_time(&rec.wav, (uint64_t)(now.tv_sec - rec.started.tv_sec) * 1000000ULL +
+                                     (now.tv_nsec - rec.started.tv_nsec) / 1000);
+}
+
+// Drain every complete period the PCM has; the fd is level-triggered
+static void recorder_read(void) {
+    while (rec.active) {
+        snd_pcm_uframes_t want = rec.cfg.period_frames;
+        snd_pcm_sframes_t n;
+        const float *stage = rec.work;
+        size_t count;
+
+        if (rec.frames_limit && rec.frames_limit - rec.frames_in < want)
+            want = rec.frames_limit - rec.frames_in;
+        n = snd_pcm_readi(rec.pcm, rec.buffer, want);
+        if (n == -EAGAIN)
+            return;
+        if (n < 0) {
+            fprintf(stderr, "Capture xrun: %s\n", snd_strerror((int)n));
+            if (snd_pcm_recover(rec.pcm, (int)n, 1) < 0 || snd_pcm_start(rec.pcm) < 0) {
+                recorder_stop("aborted");
+                return;
+            }
+            recorder_mark_gap();
+            continue;
+        }
+
+        rec.frames_in += n;
+        CS_dsp_to_float(rec.buffer, rec.cfg.format, rec.cfg.channels, rec.work, n);
+        count = n;
+        if (rec.rs) {
+            count = CS_resampler_process(rec.rs, rec.work, n, rec.resampled, rec.out_max);
+            stage = rec.resampled;
+        }
+        CS_dsp_from_float(stage, 1.0f, SND_PCM_FORMAT_S16_LE, CS_DEFAULT_CHANNELS,
+                          rec.samples, count);
+        if (CS_wav_writer_write(&rec.wav, rec.samples, count) < 0) {
+            recorder_stop("aborted");
+            return;
+        }
+        rec.frames_out += count;
+
+        if (rec.frames_limit && rec.frames_in >= rec.frames_limit)
+            recorder_stop("complete");
+    }
+}
+
+static void handle_pcm(uint32_t idx, uint32_t events) {
+    unsigned short revents = 0;
+    struct pollfd pfds[rec.npfds];
+
+    // ALSA may mangle poll events; let it translate what epoll reported
+    memcpy(pfds, rec.pfds, sizeof(pfds));
+    for (int i = 0; i < rec.npfds; ++i)
+        pfds[i].revents = (uint32_t)i == idx ? (short)events : 0;
+    snd_pcm_poll_descriptors_revents(rec.pcm, pfds, rec.npfds, &revents);
+    if (revents & (POLLIN | POLLERR))
+        recorder_read();
+}
+
+static void handle_command(struct client *c, char *line) {
+    char *cmd = strtok(line, " \t\r");
+    char *arg1 = strtok(NULL, " \t\r");
+    char *arg2 = strtok(NULL, " \t\r");
+    char *arg3 = strtok(NULL, " \t\r");
+    int err;
+
+    if (!cmd)
+        return;
+    if (strcmp(cmd, "record") == 0) {
+        if (!arg1) {
+            client_reply(c->fd, "ERR missing file\n");
+            return;
+        }
+        err = recorder_start(arg1, arg2 ? strtod(arg2, NULL) : 0.0,
+                             arg3 ? strtoul(arg3, NULL, 0) : 0, c->fd);
+        if (err < 0)
+            client_reply(c->fd, "ERR %s\n", snd_strerror(err));
+        else
+            client_reply(c->fd, "OK\n");
+    } else if (strcmp(cmd, "stop") == 0) {
+        unsigned long long frames = rec.frames_out;
+
+        if (rec.owner == c->fd)
+            rec.owner = -1;
+        recorder_stop("stopped");
+        client_reply(c->fd, "OK %llu\n", frames);
+    } else if (strcmp(cmd, "status") == 0) {
+        if (rec.active)
+            client_reply(c->fd, "RECORDING %s %llu\n", rec.path, rec.frames_out);
+        else
+            client_reply(c->fd, "IDLE\n");
+    } else if (strcmp(cmd, "quit") == 0) {
+        client_reply(c->fd, "OK\n");
+        running = 0;
+    } else {
+        client_reply(c->fd, "ERR unknown command\n");
+    }
+}
+
+static void client_close(struct client *c) {
+    if (rec.owner == c->fd)
+        rec.owner = -1;
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+}
+
+static void handle_client(struct client *c) {
+    ssize_t n = recv(c->fd, c->line + c->len, sizeof(c->line) - 1 - c->len, 0);
+    char *nl;
+
+    if (n <= 0) {
+        if (n == 0 || errno != EAGAIN)
+            client_close(c);
+        return;
+    }
+    c->len += n;
+    c->line[c->len] = '\0';
+
+    while (c->fd >= 0 && (nl = strchr(c->line, '\n'))) {
+        size_t used = nl - c->line + 1;
+
+        *nl = '\0';
+        handle_command(c, c->line);
+        memmove(c->line, c->line + used, c->len - used + 1);
+        c->len -= used;
+    }
+    // A line longer than the buffer is garbage: drop it
+    if (c->len == sizeof(c->line) - 1)
+        c->len = 0;
+}
+
+static void handle_listen(int listen_fd) {
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+    if (fd < 0)
+        return;
+    for (int i = 0; i < SERVICE_MAX_CLIENTS; ++i) {
+        if (clients[i].fd < 0) {
+            clients[i].fd = fd;
+            clients[i].len = 0;
+            epoll_add(fd, EPOLLIN, SERVICE_TAG(SRC_CLIENT, i));
+            return;
+        }
+    }
+    client_reply(fd, "ERR too many clients\n");
+    close(fd);
+}
+
+static int listen_socket(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    mode_t old_mask;
+    int err;
+
+    if (fd < 0)
+        return -1;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    unlink(path);
+    // bind() creates the node: umask it to 0600 so no other user can connect in between
+    old_mask = umask(0177);
+    err = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old_mask);
+    if (err < 0 || listen(fd, SERVICE_MAX_CLIENTS) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char *argv[]) {
+    const char *socket_path = SERVICE_SOCKET_PATH;
+    const char *device = CS_DEFAULT_DEVICE;
+    struct epoll_event events[SERVICE_MAX_EVENTS];
+    sigset_t mask;
+    int sig_fd, listen_fd;
+    int opt;
+
+    // Parse command line arguments
+    while ((opt = getopt(argc, argv, "hvs:d:")) != -1) {
+        switch (opt) {
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            case 'v':
+                print_version();
+                return EXIT_SUCCESS;
+            case 's':
+                socket_path = optarg;
+                break;
+            case 'd':
+                device = optarg;
+                break;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    // Set up signal handling: SIGINT/SIGTERM are read from a signalfd
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);   // Ctrl+C
+    sigaddset(&mask, SIGTERM);  // Termination signal
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    sig_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    listen_fd = listen_socket(socket_path);
+    if (sig_fd < 0 || timer_fd < 0 || epfd < 0 || listen_fd < 0) {
+        fprintf(stderr, "Service setup failed: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < SERVICE_MAX_CLIENTS; ++i)
+        clients[i].fd = -1;
+    epoll_add(sig_fd, EPOLLIN, SERVICE_TAG(SRC_SIGNAL, 0));
+    epoll_add(timer_fd, EPOLLIN, SERVICE_TAG(SRC_TIMER, 0));
+    epoll_add(listen_fd, EPOLLIN, SERVICE_TAG(SRC_LISTEN, 0));
+
+    if (recorder_open(device) < 0) {
+        unlink(socket_path);
+        return EXIT_FAILURE;
+    }
+
+    printf("capgeminiSound service started\n");
+    printf("Process ID: %d\n", getpid());
+    printf("Listening on %s\n", socket_path);
+
+    // Main application loop
+    while (running) {
+        int n = epoll_wait(epfd, events, SERVICE_MAX_EVENTS, -1);
+
+        if (n < 0 && errno != EINTR) {
+            fprintf(stderr, "epoll_wait: %s\n", strerror(errno));
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            uint32_t type = events[i].data.u64 >> 32;
+            uint32_t idx = (uint32_t)events[i].data.u64;
+
+            switch (type) {
+                case SRC_SIGNAL: {
+                    struct signalfd_siginfo si;
+
+                    if (read(sig_fd, &si, sizeof(si)) == sizeof(si))
+                        signal_handler((int)si.ssi_signo);
+                    break;
+                }
+                case SRC_TIMER: {
+                    uint64_t expirations;
+
+                    if (read(timer_fd, &expirations, sizeof(expirations)) > 0)
+                        recorder_stop("timed out");
+                    break;
+                }
+                case SRC_LISTEN:
+                    handle_listen(listen_fd);
+                    break;
+                case SRC_CLIENT:
+                    if (clients[idx].fd >= 0)
+                        handle_client(&clients[idx]);
+                    break;
+                case SRC_PCM:
+                    handle_pcm(idx, events[i].events);
+                    break;
+            }
+        }
+    }
+
+    printf("Application shutting down...\n");
+    recorder_stop("interrupted");
+    for (int i = 0; i < SERVICE_MAX_CLIENTS; ++i)
+        if (clients[i].fd >= 0)
+            client_close(&clients[i]);
+    snd_pcm_close(rec.pcm);
+    CS_resampler_destroy(rec.rs);
+    close(listen_fd);
+    unlink(socket_path);
+    return EXIT_SUCCESS;
 }
\ No newline at end of file
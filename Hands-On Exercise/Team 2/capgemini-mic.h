@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/**
+ * @file
+ * @brief User-space ABI of the capgemini-mic ring-buffer character device
+ *
+ * @details /dev/capgemini-mic exposes the microphone DMA ring directly:
+ * - mmap offset 0, CMIC_CTRL_SIZE bytes, read/write: struct cmic_ctrl.
+ * - mmap offset cmic_ctrl.ring_offset, cmic_ctrl.ring_bytes, read-only: the
+ *   samples, written by the DMA engine in place.
+ *
+ * Positions are free-running 32-bit byte counters (atomic on the A7) and
+ * ring_bytes is a power of two, so ring index = pos & (ring_bytes - 1) and
+ * fill = write_pos - read_pos, both across the wrap. The driver advances
+ * write_pos, the reader advances read_pos once it is done with the data.
+ * Only read_pos is taken back from the page: the driver keeps its own copy
+ * of everything else, so stray writes there cannot move the DMA or mmap.
+ * In steady state a reader only touches memory; poll() sleeps until
+ * write_pos - read_pos reaches the watermark.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: initial revision
+ * - 19-10-2026: overruns counts overrun events, not position updates
+ */
+#ifndef CAPGEMINI_MIC_H
+#define CAPGEMINI_MIC_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+#define CMIC_DEVICE "/dev/capgemini-mic"
+#define CMIC_ABI_VERSION 1
+#define CMIC_CTRL_SIZE 4096
+
+/* Sample format in the ring: CMIC_FORMAT_S32_LE, MSB aligned (24 valid bits) */
+#define CMIC_FORMAT_S32_LE 0
+
+struct cmic_ctrl {
+    /* Written once by the driver */
+    __u32 abi_version;
+    __u32 format;
+    __u32 rate;
+    __u32 channels;
+    __u32 frame_bytes;
+    __u32 ring_bytes;               /* power of two */
+    __u32 ring_offset;              /* mmap offset of the sample ring */
+    __u32 period_bytes;             /* granularity of write_pos updates */
+
+    /* Driver -> reader, on their own cache line */
+    __u32 write_pos __attribute__((aligned(64)));
+    __u32 overruns;                 /* times write_pos overtook read_pos by a full ring */
+    __u64 write_tstamp_ns;          /* CLOCK_MONOTONIC of the last write_pos update */
+
+    /* Reader -> driver */
+    __u32 read_pos __attribute__((aligned(64)));
+};
+
+/* Bytes pending before poll() reports POLLIN; clamped to [frame_bytes, ring_bytes] */
+#define CMIC_IOC_SET_WATERMARK _IOW('M', 0x01, __u32)
+/* Start/stop the DMA; START resets write_pos and read_pos to 0 */
+#define CMIC_IOC_START _IO('M', 0x02)
+#define CMIC_IOC_STOP _IO('M', 0x03)
+
+#endif /* CAPGEMINI_MIC_H */
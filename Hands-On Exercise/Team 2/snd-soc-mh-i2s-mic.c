@@ -10,12 +10,19 @@
  * @version 1.0
  * @note Changelog:
  * - 19-08-2025: initial revision — Victor Martinez
+ * - 19-10-2026: S16/S24/S32, symmetric params for the st,sync SAI pair,
+ *               MCLK set by the first stream only
+ * - 19-10-2026: sysclk read and written under the lock
  */
 
+#include <linux/clk.h>
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/kernel.h>
+#include <linux/mutex.h>
+#include <linux/platform_device.h>
 
+#include <sound/pcm_params.h>
 #include <sound/soc.h>
 
 
@@ -27,6 +34,114 @@ MODULE_VERSION("1.0");
 
 
 
+/* MCLK / LRCLK when the machine driver sets no sysclk (mclk-fs) */
+#define MH_I2S_MCLK_FS 256
+
+#define MH_I2S_FORMATS (SNDRV_PCM_FMTBIT_S16_LE | \
+                        SNDRV_PCM_FMTBIT_S24_LE | \
+                        SNDRV_PCM_FMTBIT_S32_LE)
+
+/*
+ * Playback and capture share one bit clock on the sai2a/sai2b pair
+ * (st,sync), so the clock belongs to whichever stream opens first: it
+ * programs MCLK, the second stream is held to the same parameters by the
+ * symmetric_* constraints and only joins.
+ */
+struct mh_i2s_priv {
+    struct clk *mclk;          /* optional "mclk" */
+    struct mutex lock;         /* active, mclk_rate, sysclk */
+    unsigned int active;       /* open streams */
+    unsigned long mclk_rate;   /* set by the first stream, 0 when idle */
+    unsigned long sysclk;      /* requested by set_sysclk, 0 for rate * fs */
+};
+
+/* MCLK for @fs_rate: the machine driver's sysclk, else fs_rate * MH_I2S_MCLK_FS */
+static int mh_i2s_set_mclk(struct snd_soc_dai *dai, unsigned int fs_rate)
+{
+    struct mh_i2s_priv *priv = snd_soc_dai_get_drvdata(dai);
+    unsigned long rate;
+    int ret = 0;
+
+    mutex_lock(&priv->lock);
+    rate = priv->sysclk ? priv->sysclk : (unsigned long)fs_rate * MH_I2S_MCLK_FS;
+    if (rate == priv->mclk_rate)
+        goto out;
+    /* The other direction is running on the current clock */
+    if (priv->mclk_rate && priv->active > 1) {
+        dev_err(dai->dev, "MCLK %lu Hz requested, %lu Hz in use by the other stream\n",
+                rate, priv->mclk_rate);
+        ret = -EBUSY;
+        goto out;
+    }
+    if (priv->mclk) {
+        if (!priv->mclk_rate) {
+            ret = clk_prepare_enable(priv->mclk);
+            if (ret)
+                goto out;
+        }
+        ret = clk_set_rate(priv->mclk, rate);
+        if (ret) {
+            if (!priv->mclk_rate)
+                clk_disable_unprepare(priv->mclk);
+            goto out;
+        }
+    }
+    priv->mclk_rate = rate;
+    dev_dbg(dai->dev, "MCLK set to %lu Hz\n", rate);
+out:
+    mutex_unlock(&priv->lock);
+    return ret;
+}
+
+static int mh_i2s_startup(struct snd_pcm_substream *substream, struct snd_soc_dai *dai)
+{
+    struct mh_i2s_priv *priv = snd_soc_dai_get_drvdata(dai);
+
+    mutex_lock(&priv->lock);
+    priv->active++;
+    mutex_unlock(&priv->lock);
+    return 0;
+}
+
+static void mh_i2s_shutdown(struct snd_pcm_substream *substream, struct snd_soc_dai *dai)
+{
+    struct mh_i2s_priv *priv = snd_soc_dai_get_drvdata(dai);
+
+    mutex_lock(&priv->lock);
+    if (!--priv->active) {
+        if (priv->mclk && priv->mclk_rate)
+            clk_disable_unprepare(priv->mclk);
+        priv->mclk_rate = 0;
+        priv->sysclk = 0;
+    }
+    mutex_unlock(&priv->lock);
+}
+
+/* simple-audio-card calls this with rate * mclk-fs before hw_params */
+static int mh_i2s_set_sysclk(struct snd_soc_dai *dai, int clk_id, unsigned int freq, int dir)
+{
+    struct mh_i2s_priv *priv = snd_soc_dai_get_drvdata(dai);
+
+    mutex_lock(&priv->lock);
+    priv->sysclk = freq;
+    mutex_unlock(&priv->lock);
+    return 0;
+}
+
+static int mh_i2s_hw_params(struct snd_pcm_substream *substream,
+                            struct snd_pcm_hw_params *params,
+                            struct snd_soc_dai *dai)
+{
+    return mh_i2s_set_mclk(dai, params_rate(params));
+}
+
+static const struct snd_soc_dai_ops mh_i2s_dai_ops = {
+    .startup = mh_i2s_startup,
+    .shutdown = mh_i2s_shutdown,
+    .set_sysclk = mh_i2s_set_sysclk,
+    .hw_params = mh_i2s_hw_params,
+};
+
 static struct snd_soc_dai_driver mh_i2s_dai = {
     .name = "mh-i2s-mic",
     .playback = {
@@ -34,15 +149,20 @@ static struct snd_soc_dai_driver mh_i2s_dai = {
         .channels_min = 1,
         .channels_max = 2,
         .rates = SNDRV_PCM_RATE_8000_48000,
-        .formats = SNDRV_PCM_FMTBIT_S16_LE,
+        .formats = MH_I2S_FORMATS,
     },
     .capture = {
         .stream_name = "Capture",
         .channels_min = 1,
         .channels_max = 2,
         .rates = SNDRV_PCM_RATE_8000_48000,
-        .formats = SNDRV_PCM_FMTBIT_S16_LE,
+        .formats = MH_I2S_FORMATS,
     },
+    .ops = &mh_i2s_dai_ops,
+    /* One LRCLK/BCLK for both directions: the second stream must match */
+    .symmetric_rate = 1,
+    .symmetric_channels = 1,
+    .symmetric_sample_bits = 1,
 };
 
 static struct snd_soc_component_driver mh_i2s_component = {
@@ -51,6 +171,18 @@ static struct snd_soc_component_driver mh_i2s_component = {
 
 static int mh_i2s_probe(struct platform_device *pdev)
 {
+    struct mh_i2s_priv *priv;
+
+    priv = devm_kzalloc(&pdev->dev, sizeof(*priv), GFP_KERNEL);
+    if (!priv)
+        return -ENOMEM;
+
+    priv->mclk = devm_clk_get_optional(&pdev->dev, "mclk");
+    if (IS_ERR(priv->mclk))
+        return dev_err_probe(&pdev->dev, PTR_ERR(priv->mclk), "failed to get mclk\n");
+    mutex_init(&priv->lock);
+    dev_set_drvdata(&pdev->dev, priv);
+
     return snd_soc_register_component(&pdev->dev, &mh_i2s_component, &mh_i2s_dai, 1);
 }
 
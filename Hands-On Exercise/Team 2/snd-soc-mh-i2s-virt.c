@@ -0,0 +1,774 @@
+/**
+ * @file
+ * @brief Hardware-free virtual I2S platform for the mic/amp codec drivers
+ *
+ * @details Stands in for the STM32 SAI2A/SAI2B pair so inmp441, max98357a and
+ * the rest of the audio stack can run on any Linux box (CI, x86 desktop,
+ * QEMU). It registers one ASoC component with two CPU DAIs:
+ * - "mh-i2s-virt-a": playback only, like SAI2A feeding the MAX98357A. The
+ *   sink consumes the ring at the nominal rate and records timing/level
+ *   statistics.
+ * - "mh-i2s-virt-b": capture only, like SAI2B reading the INMP441. It is fed
+ *   by a synthetic source: sine, white noise or a looped PCM file.
+ *
+ * DMA is emulated with one soft hrtimer per stream that fires once per
+ * period; the hardware pointer is derived from the elapsed time, so timer
+ * latency shows up as jitter in the statistics and not as a rate error.
+ * Statistics are read (and reset by writing 0) through the "stats" sysfs
+ * attribute of the platform device.
+ *
+ * Streams opened with period wakeups disabled (SNDRV_PCM_INFO_NO_PERIOD_WAKEUP)
+ * get no snd_pcm_period_elapsed() at all; the timer then only runs every half
+ * buffer and the pointer callback brings the position up to date, as a DMA
+ * residue read would, so timer-driven readers see an exact avail.
+ *
+ * The codecs bind either through the simple-audio-card overlay
+ * (mh-i2s-virt-overlay.dtso) or, on machines without a device tree, with
+ * standalone=1: the module then creates the inmp441/max98357a platform
+ * devices itself and registers the same two cards ("stm32mp1-inmp441" and
+ * "stm32mp1-max98357a"), so user space sees the board's ALSA devices.
+ *
+ * @author Team 2
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: initial revision, derived from snd-soc-mh-i2s-mic.c
+ * - 19-10-2026: support for disabled period wakeups
+ * - 19-10-2026: interpolated sine table, ring resync and xrun on late timers
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/firmware.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/spinlock.h>
+
+#include <sound/pcm.h>
+#include <sound/pcm_params.h>
+#include <sound/soc.h>
+
+
+/* Module metadata */
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Team 2");
+MODULE_DESCRIPTION("Virtual I2S platform/CPU DAI for hardware-free audio testing");
+MODULE_VERSION("1.0");
+
+#define VIRT_DRV_NAME "mh-i2s-virt"
+#define VIRT_FORMATS (SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S24_LE | \
+                      SNDRV_PCM_FMTBIT_S32_LE)
+#define VIRT_RATES SNDRV_PCM_RATE_8000_96000
+#define VIRT_BUFFER_BYTES_MAX (512 * 1024)
+
+/*
+ * Quarter-wave sine table, Q31, read with linear interpolation: the phase
+ * accumulator's top two bits pick the quadrant, the next VIRT_SINE_BITS the
+ * entry and the rest interpolate. The error stays below -130 dBFS, under
+ * what a 24-bit capture can resolve, so THD/SNR measurements see the stack
+ * and not the source.
+ */
+#define VIRT_SINE_BITS 10
+#define VIRT_SINE_SIZE (1U << VIRT_SINE_BITS)
+#define VIRT_SINE_FRAC_BITS (30 - VIRT_SINE_BITS)
+#define VIRT_HALF_PI_Q62 0x6487ed5110b4611aULL
+
+static char *source = "sine";
+module_param(source, charp, 0444);
+MODULE_PARM_DESC(source, "Capture source: sine, noise or file (default: sine)");
+
+static unsigned int sine_freq = 1000;
+module_param(sine_freq, uint, 0644);
+MODULE_PARM_DESC(sine_freq, "Sine source frequency in Hz (default: 1000)");
+
+static unsigned int amplitude = 50;
+module_param(amplitude, uint, 0644);
+MODULE_PARM_DESC(amplitude, "Source amplitude in percent of full scale (default: 50)");
+
+static char *source_file = "mh-i2s-virt.raw";
+module_param(source_file, charp, 0444);
+MODULE_PARM_DESC(source_file, "Firmware file looped by the file source, S16_LE mono (a WAV header is skipped)");
+
+static bool standalone;
+module_param(standalone, bool, 0444);
+MODULE_PARM_DESC(standalone, "Create codec devices and a card without device tree (default: false)");
+
+enum virt_source {
+    VIRT_SOURCE_SINE,
+    VIRT_SOURCE_NOISE,
+    VIRT_SOURCE_FILE,
+};
+
+/* Timing and level statistics, per stream direction */
+struct virt_stats {
+    u64 periods;
+    u64 frames;
+    u64 jitter_sum_ns;
+    u64 jitter_max_ns;
+    u64 xruns;                      /* timer fell more than a buffer behind */
+    u32 peak;                       /* playback: largest |sample|, Q31 */
+};
+
+struct virt_stream {
+    struct virt_priv *priv;
+    spinlock_t lock;
+    struct hrtimer timer;
+    struct snd_pcm_substream *substream;
+    ktime_t start;
+    ktime_t period_time;            /* timer interval */
+    u64 frames_done;                /* frames processed since start */
+    snd_pcm_uframes_t hw_ptr;
+    bool running;
+    bool xrun;                      /* overrun not yet reported to ALSA */
+    u32 phase;                      /* sine phase accumulator, 2^32 = one turn */
+    u32 lfsr;                       /* noise generator state */
+    size_t file_pos;
+    struct virt_stats stats;
+};
+
+struct virt_priv {
+    struct device *dev;
+    struct virt_stream streams[2];  /* indexed by SNDRV_PCM_STREAM_* */
+    enum virt_source source;
+    const struct firmware *fw;
+    const s16 *file_data;
+    size_t file_samples;
+};
+
+static const struct snd_pcm_hardware virt_pcm_hardware = {
+    .info = SNDRV_PCM_INFO_MMAP | SNDRV_PCM_INFO_MMAP_VALID |
+            SNDRV_PCM_INFO_INTERLEAVED | SNDRV_PCM_INFO_BLOCK_TRANSFER |
+            SNDRV_PCM_INFO_NO_PERIOD_WAKEUP,
+    .formats = VIRT_FORMATS,
+    .rates = VIRT_RATES,
+    .rate_min = 8000,
+    .rate_max = 96000,
+    .channels_min = 1,
+    .channels_max = 2,
+    .buffer_bytes_max = VIRT_BUFFER_BYTES_MAX,
+    .period_bytes_min = 32,
+    .period_bytes_max = VIRT_BUFFER_BYTES_MAX / 2,
+    .periods_min = 2,
+    .periods_max = 1024,
+};
+
+static s32 virt_sine_table[VIRT_SINE_SIZE + 1];
+
+/* sin(x) for x in [0, pi/2], argument and result Q62, from the Taylor series */
+static u64 virt_sin_q62(u64 x)
+{
+    u64 x2 = mul_u64_u64_shr(x, x, 62);
+    u64 term = x, sum = x;
+
+    for (unsigned int n = 1; term; ++n) {
+        term = div_u64(mul_u64_u64_shr(term, x2, 62), 2 * n * (2 * n + 1));
+        if (n & 1)
+            sum -= term;
+        else
+            sum += term;
+    }
+    return sum;
+}
+
+static void virt_sine_init(void)
+{
+    for (unsigned int i = 0; i <= VIRT_SINE_SIZE; ++i) {
+        u64 x = mul_u64_u64_shr(VIRT_HALF_PI_Q62, (u64)i << (63 - VIRT_SINE_BITS), 63);
+
+        virt_sine_table[i] = min_t(u64, (virt_sin_q62(x) + BIT_ULL(30)) >> 31, S32_MAX);
+    }
+}
+
+/* sin(2 * pi * phase / 2^32), Q31 */
+static s32 virt_sine(u32 phase)
+{
+    u32 q = phase & (BIT(30) - 1);
+    u32 i, frac;
+    s32 v;
+
+    /* Second and fourth quadrants run the table backwards */
+    if (phase & BIT(30))
+        q = BIT(30) - q;
+    i = q >> VIRT_SINE_FRAC_BITS;
+    frac = q & (BIT(VIRT_SINE_FRAC_BITS) - 1);
+    v = virt_sine_table[i];
+    if (frac)
+        v += (s32)(((s64)(virt_sine_table[i + 1] - v) * frac) >> VIRT_SINE_FRAC_BITS);
+    return phase & BIT(31) ? -v : v;
+}
+
+/* Next source sample, Q31 */
+static s32 virt_source_sample(struct virt_priv *priv, struct virt_stream *s,
+                              unsigned int rate)
+{
+    s64 value;
+
+    switch (priv->source) {
+    case VIRT_SOURCE_NOISE:
+        /* xorshift32: cheap, good enough for a noise floor */
+        s->lfsr ^= s->lfsr << 13;
+        s->lfsr ^= s->lfsr >> 17;
+        s->lfsr ^= s->lfsr << 5;
+        value = (s32)s->lfsr;
+        break;
+    case VIRT_SOURCE_FILE:
+        value = (s32)priv->file_data[s->file_pos] << 16;
+        if (++s->file_pos >= priv->file_samples)
+            s->file_pos = 0;
+        break;
+    case VIRT_SOURCE_SINE:
+    default:
+        value = virt_sine(s->phase);
+        s->phase += (u32)div_u64((u64)sine_freq << 32, rate);
+        break;
+    }
+    return (s32)div_s64(value * min(amplitude, 100U), 100);
+}
+
+static void virt_put_sample(void *dst, snd_pcm_format_t format, s32 value)
+{
+    switch (format) {
+    case SNDRV_PCM_FORMAT_S16_LE:
+        *(s16 *)dst = value >> 16;
+        break;
+    case SNDRV_PCM_FORMAT_S24_LE:
+        *(s32 *)dst = value >> 8;
+        break;
+    default:
+        *(s32 *)dst = value;
+        break;
+    }
+}
+
+static u32 virt_get_magnitude(const void *src, snd_pcm_format_t format)
+{
+    s32 value;
+
+    switch (format) {
+    case SNDRV_PCM_FORMAT_S16_LE:
+        value = (s32)*(const s16 *)src << 16;
+        break;
+    case SNDRV_PCM_FORMAT_S24_LE:
+        value = (s32)((u32)*(const s32 *)src << 8);
+        break;
+    default:
+        value = *(const s32 *)src;
+        break;
+    }
+    return value == S32_MIN ? S32_MAX : abs(value);
+}
+
+/*
+ * Emulates the DMA for @frames frames from the current hardware pointer:
+ * the capture side writes source samples into the ring, the playback side
+ * reads what the application queued and tracks its peak level.
+ */
+static void virt_transfer(struct virt_priv *priv, struct virt_stream *s,
+                          snd_pcm_uframes_t frames)
+{
+    struct snd_pcm_runtime *runtime = s->substream->runtime;
+    unsigned int sample_bytes = snd_pcm_format_physical_width(runtime->format) / 8;
+    bool capture = s->substream->stream == SNDRV_PCM_STREAM_CAPTURE;
+
+    while (frames--) {
+        u8 *frame = runtime->dma_area + frames_to_bytes(runtime, s->hw_ptr);
+        s32 value = capture ? virt_source_sample(priv, s, runtime->rate) : 0;
+
+        for (unsigned int ch = 0; ch < runtime->channels; ++ch) {
+            void *sample = frame + ch * sample_bytes;
+
+            if (capture)
+                virt_put_sample(sample, runtime->format, value);
+            else
+                s->stats.peak = max(s->stats.peak,
+                                    virt_get_magnitude(sample, runtime->format));
+        }
+        if (++s->hw_ptr >= runtime->buffer_size)
+            s->hw_ptr = 0;
+    }
+}
+
+/*
+ * Runs the emulated DMA up to @now; returns true when a period boundary was
+ * crossed. Falling more than a buffer behind sets s->xrun for the caller to
+ * report. Called with s->lock held.
+ */
+static bool virt_advance(struct virt_priv *priv, struct virt_stream *s, ktime_t now)
+{
+    struct snd_pcm_runtime *runtime = s->substream->runtime;
+    bool elapsed;
+    u64 frames;
+
+    /* Position follows wall time: a late timer is jitter, never a rate error */
+    frames = div_u64((u64)ktime_to_ns(ktime_sub(now, s->start)) * runtime->rate, NSEC_PER_SEC);
+    if (frames <= s->frames_done)
+        return false;
+    elapsed = div_u64(frames, runtime->period_size) != div_u64(s->frames_done, runtime->period_size);
+    if (frames - s->frames_done > runtime->buffer_size) {
+        u32 pos;
+
+        /* A real DMA would have lapped the ring: only the last buffer survives */
+        s->frames_done = frames - runtime->buffer_size;
+        div_u64_rem(s->frames_done, runtime->buffer_size, &pos);
+        s->hw_ptr = pos;
+        s->stats.xruns++;
+        s->xrun = true;
+    }
+    virt_transfer(priv, s, frames - s->frames_done);
+
+    s->stats.frames += frames - s->frames_done;
+    s->frames_done = frames;
+    return elapsed;
+}
+
+static enum hrtimer_restart virt_timer_fn(struct hrtimer *timer)
+{
+    struct virt_stream *s = container_of(timer, struct virt_stream, timer);
+    struct snd_pcm_runtime *runtime = s->substream->runtime;
+    ktime_t now = ktime_get();
+    s64 late_ns = ktime_to_ns(ktime_sub(now, hrtimer_get_expires(timer)));
+    bool elapsed, xrun;
+
+    spin_lock(&s->lock);
+    if (!s->running) {
+        spin_unlock(&s->lock);
+        return HRTIMER_NORESTART;
+    }
+
+    elapsed = virt_advance(s->priv, s, now);
+    s->stats.periods++;
+    if (late_ns > 0) {
+        s->stats.jitter_sum_ns += late_ns;
+        s->stats.jitter_max_ns = max_t(u64, s->stats.jitter_max_ns, late_ns);
+    }
+    xrun = s->xrun;
+    s->xrun = false;
+    hrtimer_forward(timer, now, s->period_time);
+    spin_unlock(&s->lock);
+
+    /* The stop lands in trigger, which the next tick sees as !running */
+    if (xrun)
+        snd_pcm_stop_xrun(s->substream);
+    else if (elapsed && !runtime->no_period_wakeup)
+        snd_pcm_period_elapsed(s->substream);
+    return HRTIMER_RESTART;
+}
+
+static int virt_pcm_open(struct snd_soc_component *component,
+                         struct snd_pcm_substream *substream)
+{
+    struct virt_priv *priv = snd_soc_component_get_drvdata(component);
+    struct virt_stream *s = &priv->streams[substream->stream];
+
+    s->substream = substream;
+    return snd_soc_set_runtime_hwparams(substream, &virt_pcm_hardware);
+}
+
+static int virt_pcm_prepare(struct snd_soc_component *component,
+                            struct snd_pcm_substream *substream)
+{
+    struct virt_priv *priv = snd_soc_component_get_drvdata(component);
+    struct virt_stream *s = &priv->streams[substream->stream];
+    struct snd_pcm_runtime *runtime = substream->runtime;
+
+    /* Without period wakeups the timer only has to keep up with the ring */
+    s->period_time = ns_to_ktime(div_u64((u64)(runtime->no_period_wakeup ? runtime->buffer_size / 2
+                                                                         : runtime->period_size) *
+                                         NSEC_PER_SEC, runtime->rate));
+    s->hw_ptr = 0;
+    s->frames_done = 0;
+    s->xrun = false;
+    return 0;
+}
+
+static int virt_pcm_trigger(struct snd_soc_component *component,
+                            struct snd_pcm_substream *substream, int cmd)
+{
+    struct virt_priv *priv = snd_soc_component_get_drvdata(component);
+    struct virt_stream *s = &priv->streams[substream->stream];
+    unsigned long flags;
+
+    switch (cmd) {
+    case SNDRV_PCM_TRIGGER_START:
+    case SNDRV_PCM_TRIGGER_RESUME:
+    case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
+        spin_lock_irqsave(&s->lock, flags);
+        /* Restart the clock so that frames_done maps to "now" */
+        s->start = ktime_sub_ns(ktime_get(),
+                                div_u64(s->frames_done * NSEC_PER_SEC, substream->runtime->rate));
+        s->running = true;
+        hrtimer_start(&s->timer, s->period_time, HRTIMER_MODE_REL_SOFT);
+        spin_unlock_irqrestore(&s->lock, flags);
+        break;
+    case SNDRV_PCM_TRIGGER_STOP:
+    case SNDRV_PCM_TRIGGER_SUSPEND:
+    case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
+        spin_lock_irqsave(&s->lock, flags);
+        s->running = false;
+        spin_unlock_irqrestore(&s->lock, flags);
+        /* Atomic context: a running callback sees !running and stops itself */
+        hrtimer_try_to_cancel(&s->timer);
+        break;
+    default:
+        return -EINVAL;
+    }
+    return 0;
+}
+
+static int virt_pcm_sync_stop(struct snd_soc_component *component,
+                              struct snd_pcm_substream *substream)
+{
+    struct virt_priv *priv = snd_soc_component_get_drvdata(component);
+
+    hrtimer_cancel(&priv->streams[substream->stream].timer);
+    return 0;
+}
+
+static snd_pcm_uframes_t virt_pcm_pointer(struct snd_soc_component *component,
+                                          struct snd_pcm_substream *substream)
+{
+    struct virt_priv *priv = snd_soc_component_get_drvdata(component);
+    struct virt_stream *s = &priv->streams[substream->stream];
+    snd_pcm_uframes_t pos;
+    unsigned long flags;
+
+    /* Catch up between timer ticks, like reading the DMA residue */
+    spin_lock_irqsave(&s->lock, flags);
+    if (s->running)
+        virt_advance(priv, s, ktime_get());
+    pos = s->xrun ? SNDRV_PCM_POS_XRUN : s->hw_ptr;
+    s->xrun = false;
+    spin_unlock_irqrestore(&s->lock, flags);
+    return pos;
+}
+
+static int virt_pcm_construct(struct snd_soc_component *component,
+                              struct snd_soc_pcm_runtime *rtd)
+{
+    snd_pcm_set_managed_buffer_all(rtd->pcm, SNDRV_DMA_TYPE_VMALLOC, NULL, 0, 0);
+    return 0;
+}
+
+/* The emulated SAI accepts whatever the card asks for; nothing to program */
+static int virt_dai_set_fmt(struct snd_soc_dai *dai, unsigned int fmt)
+{
+    return 0;
+}
+
+static int virt_dai_set_sysclk(struct snd_soc_dai *dai, int clk_id,
+                               unsigned int freq, int dir)
+{
+    dev_dbg(dai->dev, "%s: sysclk %u Hz\n", dai->name, freq);
+    return 0;
+}
+
+static const struct snd_soc_dai_ops virt_dai_ops = {
+    .set_fmt = virt_dai_set_fmt,
+    .set_sysclk = virt_dai_set_sysclk,
+};
+
+/* Index 0 and 1 are what #sound-dai-cells = <1> selects in the overlay */
+static struct snd_soc_dai_driver virt_dais[] = {
+    {
+        .name = "mh-i2s-virt-a",
+        .playback = {
+            .stream_name = "Playback",
+            .channels_min = 1,
+            .channels_max = 2,
+            .rates = VIRT_RATES,
+            .formats = VIRT_FORMATS,
+        },
+        .ops = &virt_dai_ops,
+    },
+    {
+        .name = "mh-i2s-virt-b",
+        .capture = {
+            .stream_name = "Capture",
+            .channels_min = 1,
+            .channels_max = 2,
+            .rates = VIRT_RATES,
+            .formats = VIRT_FORMATS,
+        },
+        .ops = &virt_dai_ops,
+    },
+};
+
+static const struct snd_soc_component_driver virt_component = {
+    .name = VIRT_DRV_NAME,
+    .open = virt_pcm_open,
+    .prepare = virt_pcm_prepare,
+    .trigger = virt_pcm_trigger,
+    .sync_stop = virt_pcm_sync_stop,
+    .pointer = virt_pcm_pointer,
+    .pcm_construct = virt_pcm_construct,
+};
+
+/*
+ * Cards used in standalone mode. Same topology and names as the overlay, so
+ * ALSA ids (and CS_MONITOR_*_DEVICE in the app) match the board.
+ */
+SND_SOC_DAILINK_DEFS(virt_mic,
+    DAILINK_COMP_ARRAY(COMP_CPU("mh-i2s-virt-b")),
+    DAILINK_COMP_ARRAY(COMP_CODEC("inmp441", "capgemini,inmp441")),
+    DAILINK_COMP_ARRAY(COMP_PLATFORM(VIRT_DRV_NAME)));
+
+SND_SOC_DAILINK_DEFS(virt_amp,
+    DAILINK_COMP_ARRAY(COMP_CPU("mh-i2s-virt-a")),
+    DAILINK_COMP_ARRAY(COMP_CODEC("max98357a", "HiFi")),
+    DAILINK_COMP_ARRAY(COMP_PLATFORM(VIRT_DRV_NAME)));
+
+static struct snd_soc_dai_link virt_mic_link = {
+    .name = "INMP441",
+    .stream_name = "Capture",
+    .dai_fmt = SND_SOC_DAIFMT_I2S | SND_SOC_DAIFMT_NB_NF | SND_SOC_DAIFMT_CBC_CFC,
+    .capture_only = 1,
+    SND_SOC_DAILINK_REG(virt_mic),
+};
+
+static struct snd_soc_dai_link virt_amp_link = {
+    .name = "MAX98357A",
+    .stream_name = "Playback",
+    .dai_fmt = SND_SOC_DAIFMT_I2S | SND_SOC_DAIFMT_NB_NF | SND_SOC_DAIFMT_CBC_CFC,
+    .playback_only = 1,
+    SND_SOC_DAILINK_REG(virt_amp),
+};
+
+static struct snd_soc_card virt_cards[] = {
+    {
+        .name = "stm32mp1-inmp441",
+        .owner = THIS_MODULE,
+        .dai_link = &virt_mic_link,
+        .num_links = 1,
+    },
+    {
+        .name = "stm32mp1-max98357a",
+        .owner = THIS_MODULE,
+        .dai_link = &virt_amp_link,
+        .num_links = 1,
+    },
+};
+
+static ssize_t stats_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct virt_priv *priv = dev_get_drvdata(dev);
+    static const char * const names[] = { "playback", "capture" };
+    int len = 0;
+
+    for (int i = 0; i < ARRAY_SIZE(priv->streams); ++i) {
+        struct virt_stream *s = &priv->streams[i];
+        struct virt_stats st;
+        unsigned long flags;
+
+        spin_lock_irqsave(&s->lock, flags);
+        st = s->stats;
+        spin_unlock_irqrestore(&s->lock, flags);
+
+        len += sysfs_emit_at(buf, len,
+                             "%s: periods %llu frames %llu jitter_avg_ns %llu jitter_max_ns %llu xruns %llu peak %u\n",
+                             names[i], st.periods, st.frames,
+                             st.periods ? div64_u64(st.jitter_sum_ns, st.periods) : 0,
+                             st.jitter_max_ns, st.xruns, st.peak);
+    }
+    return len;
+}
+
+static ssize_t stats_store(struct device *dev, struct device_attribute *attr,
+                           const char *buf, size_t count)
+{
+    struct virt_priv *priv = dev_get_drvdata(dev);
+
+    for (int i = 0; i < ARRAY_SIZE(priv->streams); ++i) {
+        struct virt_stream *s = &priv->streams[i];
+        unsigned long flags;
+
+        spin_lock_irqsave(&s->lock, flags);
+        memset(&s->stats, 0, sizeof(s->stats));
+        spin_unlock_irqrestore(&s->lock, flags);
+    }
+    return count;
+}
+static DEVICE_ATTR_RW(stats);
+
+static struct attribute *virt_attrs[] = {
+    &dev_attr_stats.attr,
+    NULL,
+};
+ATTRIBUTE_GROUPS(virt);
+
+static int virt_load_file(struct virt_priv *priv)
+{
+    const u8 *data;
+    size_t size;
+    int ret;
+
+    ret = request_firmware(&priv->fw, source_file, priv->dev);
+    if (ret)
+        return dev_err_probe(priv->dev, ret, "cannot load %s\n", source_file);
+
+    data = priv->fw->data;
+    size = priv->fw->size;
+    /* Canonical 44-byte WAV header in front of the samples: skip it */
+    if (size > 44 && !memcmp(data, "RIFF", 4)) {
+        data += 44;
+        size -= 44;
+    }
+    if (size < sizeof(s16)) {
+        release_firmware(priv->fw);
+        priv->fw = NULL;
+        return dev_err_probe(priv->dev, -EINVAL, "%s is empty\n", source_file);
+    }
+    priv->file_data = (const s16 *)data;
+    priv->file_samples = size / sizeof(s16);
+    return 0;
+}
+
+static void virt_release_file(void *data)
+{
+    struct virt_priv *priv = data;
+
+    release_firmware(priv->fw);
+}
+
+static int virt_probe(struct platform_device *pdev)
+{
+    struct virt_priv *priv;
+    int ret;
+
+    priv = devm_kzalloc(&pdev->dev, sizeof(*priv), GFP_KERNEL);
+    if (!priv)
+        return -ENOMEM;
+    priv->dev = &pdev->dev;
+
+    if (!strcmp(source, "noise")) {
+        priv->source = VIRT_SOURCE_NOISE;
+    } else if (!strcmp(source, "file")) {
+        priv->source = VIRT_SOURCE_FILE;
+        ret = virt_load_file(priv);
+        if (ret)
+            return ret;
+        ret = devm_add_action_or_reset(&pdev->dev, virt_release_file, priv);
+        if (ret)
+            return ret;
+    } else {
+        priv->source = VIRT_SOURCE_SINE;
+    }
+
+    for (int i = 0; i < ARRAY_SIZE(priv->streams); ++i) {
+        struct virt_stream *s = &priv->streams[i];
+
+        s->priv = priv;
+        spin_lock_init(&s->lock);
+        hrtimer_init(&s->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_SOFT);
+        s->timer.function = virt_timer_fn;
+        s->lfsr = 0x2545f491 + i;
+    }
+    platform_set_drvdata(pdev, priv);
+
+    return devm_snd_soc_register_component(&pdev->dev, &virt_component,
+                                           virt_dais, ARRAY_SIZE(virt_dais));
+}
+
+/*
+ * Standalone machine driver. Each card gets its own device: the card core
+ * takes over the device drvdata, which the component above relies on.
+ */
+static int virt_card_probe(struct platform_device *pdev)
+{
+    struct snd_soc_card *card;
+
+    if (pdev->id < 0 || pdev->id >= ARRAY_SIZE(virt_cards))
+        return -ENODEV;
+
+    card = &virt_cards[pdev->id];
+    card->dev = &pdev->dev;
+    /* Defers until the inmp441/max98357a modules are loaded */
+    return devm_snd_soc_register_card(&pdev->dev, card);
+}
+
+static const struct of_device_id virt_of_match[] = {
+    { .compatible = "capgemini,mh-i2s-virt" },
+    {}
+};
+MODULE_DEVICE_TABLE(of, virt_of_match);
+
+static struct platform_driver virt_driver = {
+    .driver = {
+        .name = VIRT_DRV_NAME,
+        .owner = THIS_MODULE,
+        .of_match_table = virt_of_match,
+        .dev_groups = virt_groups,
+    },
+    .probe = virt_probe,
+};
+
+static struct platform_driver virt_card_driver = {
+    .driver = {
+        .name = VIRT_DRV_NAME "-card",
+        .owner = THIS_MODULE,
+    },
+    .probe = virt_card_probe,
+};
+
+static struct platform_driver * const virt_drivers[] = {
+    &virt_driver,
+    &virt_card_driver,
+};
+
+/* Devices created in standalone mode: the platform, both codecs and both cards */
+static const struct {
+    const char *name;
+    int id;
+} virt_standalone_devices[] = {
+    { VIRT_DRV_NAME, PLATFORM_DEVID_NONE },
+    { "inmp441", PLATFORM_DEVID_NONE },
+    { "max98357a", PLATFORM_DEVID_NONE },
+    { VIRT_DRV_NAME "-card", 0 },
+    { VIRT_DRV_NAME "-card", 1 },
+};
+static struct platform_device *virt_pdevs[ARRAY_SIZE(virt_standalone_devices)];
+
+static void virt_unregister_devices(void)
+{
+    for (int i = ARRAY_SIZE(virt_pdevs) - 1; i >= 0; --i) {
+        if (!IS_ERR_OR_NULL(virt_pdevs[i]))
+            platform_device_unregister(virt_pdevs[i]);
+        virt_pdevs[i] = NULL;
+    }
+}
+
+static int __init virt_init(void)
+{
+    int ret;
+
+    virt_sine_init();
+    ret = platform_register_drivers(virt_drivers, ARRAY_SIZE(virt_drivers));
+    if (ret || !standalone)
+        return ret;
+
+    for (int i = 0; i < ARRAY_SIZE(virt_standalone_devices); ++i) {
+        virt_pdevs[i] = platform_device_register_simple(virt_standalone_devices[i].name,
+                                                        virt_standalone_devices[i].id,
+                                                        NULL, 0);
+        if (IS_ERR(virt_pdevs[i])) {
+            ret = PTR_ERR(virt_pdevs[i]);
+            virt_unregister_devices();
+            platform_unregister_drivers(virt_drivers, ARRAY_SIZE(virt_drivers));
+            return ret;
+        }
+    }
+    return 0;
+}
+
+static void __exit virt_exit(void)
+{
+    virt_unregister_devices();
+    platform_unregister_drivers(virt_drivers, ARRAY_SIZE(virt_drivers));
+}
+
+module_init(virt_init);
+module_exit(virt_exit);
@@ -0,0 +1,133 @@
+#!/bin/sh
+#
+# boot-audio-latency.sh -- time from power-on to the first audio on the DK1
+#
+# Run it as early as possible (e.g. from an init script or a oneshot unit
+# ordered before the audio application) and it reports, in ms since boot:
+#   - the codec drivers' own stamps: module load and component registered
+#     (the "boot:" lines of max98357a and inmp441),
+#   - when each sound card showed up in /proc/asound/cards,
+#   - time-to-first-audio: when a playback stream on the speaker card, and a
+#     capture stream on the mic card, reached the RUNNING state.
+# User-space times come from /proc/uptime, so they are 10 ms granular.
+#
+# Usage: boot-audio-latency.sh [-t timeout_s] [-m max_ms] [-w chime.wav]
+#   -t  give up waiting for the cards after this long (default 30 s)
+#   -m  exit 1 if time-to-first-audio exceeds max_ms (boot-time regression gate)
+#   -w  play this file instead of one second of silence
+#
+
+SPEAKER_CARD="stm32mp1-max98357a"
+MIC_CARD="stm32mp1-inmp441"
+TIMEOUT_S=30
+MAX_MS=0
+CHIME=""
+
+while getopts "t:m:w:" opt; do
+	case "$opt" in
+	t) TIMEOUT_S="$OPTARG" ;;
+	m) MAX_MS="$OPTARG" ;;
+	w) CHIME="$OPTARG" ;;
+	*) echo "usage: $0 [-t timeout_s] [-m max_ms] [-w chime.wav]" >&2; exit 2 ;;
+	esac
+done
+
+uptime_ms() {
+	awk '{ printf "%d\n", $1 * 1000 }' /proc/uptime
+}
+
+# Card index from its name, empty while the card is not registered
+card_index() {
+	awk -v name="$1" '$0 ~ "- " name "$" { print $1; exit }' /proc/asound/cards 2>/dev/null
+}
+
+# Prints the uptime (ms) at which $1's card appeared, "-" on timeout
+wait_card() {
+	deadline=$(( $(uptime_ms) + TIMEOUT_S * 1000 ))
+	while [ -z "$(card_index "$1")" ]; do
+		if [ "$(uptime_ms)" -ge "$deadline" ]; then
+			echo "-"
+			return 1
+		fi
+		sleep 0.01
+	done
+	uptime_ms
+}
+
+# Starts "$@" in the background and prints the uptime (ms) at which the
+# stream in status file $1 reached RUNNING, "-" if it never did
+first_running() {
+	status="$1"
+	shift
+	"$@" >/dev/null 2>&1 &
+	pid=$!
+	while kill -0 "$pid" 2>/dev/null; do
+		if grep -q "state: RUNNING" "$status" 2>/dev/null; then
+			uptime_ms
+			wait "$pid"
+			return 0
+		fi
+		sleep 0.01
+	done
+	echo "-"
+	return 1
+}
+
+start_ms=$(uptime_ms)
+echo "Script started at ${start_ms} ms"
+
+# A card that already existed reads as "<= start": we came too late to see it
+card_ms() {
+	if [ -n "$(card_index "$1")" ]; then
+		echo "<= ${start_ms}"
+	else
+		wait_card "$1"
+	fi
+}
+speaker_ms=$(card_ms "$SPEAKER_CARD")
+mic_ms=$(card_ms "$MIC_CARD")
+
+echo
+echo "Kernel (boottime, from the drivers):"
+dmesg | grep -E "(max98357a|inmp441).*boot: " |
+	sed -n 's/.*\] \([^ ]*\) \([^:]*\): boot: \([a-z_]*\) at \([0-9]*\) us, \([0-9]*\) us after module load/\1 \2 \3 \4 \5/p' |
+	while read -r drv dev stage at_us load_us; do
+		printf "  %-10s %-24s %-22s %8d ms  (+%d ms after load)\n" \
+			"$drv" "$dev" "$stage" $((at_us / 1000)) $((load_us / 1000))
+	done
+
+echo
+echo "Cards (uptime):"
+printf "  %-24s %s ms\n" "$SPEAKER_CARD" "$speaker_ms" "$MIC_CARD" "$mic_ms"
+
+play_ms="-"
+rec_ms="-"
+idx=$(card_index "$SPEAKER_CARD")
+if [ -n "$idx" ]; then
+	if [ -n "$CHIME" ]; then
+		play_ms=$(first_running "/proc/asound/card$idx/pcm0p/sub0/status" \
+			aplay -q -D "plughw:$idx,0" "$CHIME")
+	else
+		play_ms=$(first_running "/proc/asound/card$idx/pcm0p/sub0/status" \
+			aplay -q -D "plughw:$idx,0" -t raw -f S16_LE -r 48000 -c 2 -d 1 /dev/zero)
+	fi
+fi
+idx=$(card_index "$MIC_CARD")
+if [ -n "$idx" ]; then
+	rec_ms=$(first_running "/proc/asound/card$idx/pcm0c/sub0/status" \
+		arecord -q -D "plughw:$idx,0" -t raw -f S32_LE -r 48000 -c 2 -d 1 /dev/null)
+fi
+
+echo
+echo "Time to first audio (uptime):"
+printf "  %-24s %s ms\n" "playback running" "$play_ms" "capture running" "$rec_ms"
+
+if [ "$play_ms" = "-" ]; then
+	echo "FAIL: no playback stream started" >&2
+	exit 1
+fi
+if [ "$MAX_MS" -gt 0 ] && [ "$play_ms" -gt "$MAX_MS" ]; then
+	echo "FAIL: first audio at ${play_ms} ms, budget ${MAX_MS} ms" >&2
+	exit 1
+fi
+exit 0
@@ -0,0 +1,138 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * codec_stats.h -- debugfs event history and boot stamps for a codec driver
+ *
+ * Included by the codec driver of this directory only, so everything here
+ * is static and the static key is the module's own. Recording is off until
+ *   echo 1 > /sys/kernel/debug/<driver>/enable
+ * and while it is off codec_stats_on() is a jump patched out of the stream
+ * callbacks: no lock, no clock read. Without CONFIG_DEBUG_FS it is false at
+ * compile time.
+ */
+#ifndef _CODEC_STATS_H
+#define _CODEC_STATS_H
+
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/jump_label.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/timekeeping.h>
+
+/* Last events kept in debugfs "history" */
+#define CODEC_HISTORY	32
+
+struct codec_rec {
+	u64 ts_ns;
+	int type;
+	int arg;
+	u64 duration_ns;
+};
+
+/* Ring of the last CODEC_HISTORY records, under the owner's stats lock */
+struct codec_history {
+	struct codec_rec rec[CODEC_HISTORY];
+	unsigned int head;
+	unsigned int count;
+};
+
+/* CLOCK_BOOTTIME stamps of the codec's boot steps, 0 until reached */
+struct codec_boot {
+	u64 probe_ns;
+	u64 registered_ns;
+};
+
+static DEFINE_STATIC_KEY_FALSE(codec_stats_key);
+
+static inline bool codec_stats_on(void)
+{
+	return IS_ENABLED(CONFIG_DEBUG_FS) &&
+	       static_branch_unlikely(&codec_stats_key);
+}
+
+static void codec_history_add(struct codec_history *h, u64 ts_ns, int type,
+			      int arg, u64 duration_ns)
+{
+	struct codec_rec *rec = &h->rec[h->head];
+
+	rec->ts_ns = ts_ns;
+	rec->type = type;
+	rec->arg = arg;
+	rec->duration_ns = duration_ns;
+	h->head = (h->head + 1) % CODEC_HISTORY;
+	if (h->count < CODEC_HISTORY)
+		h->count++;
+}
+
+/* Oldest first: "<ktime_ns> <event> <arg> <duration_ns>" */
+static void codec_history_show(struct seq_file *s, spinlock_t *lock,
+			       const struct codec_history *h,
+			       const char * const *names)
+{
+	struct codec_history snap;
+	unsigned long flags;
+	unsigned int i;
+
+	spin_lock_irqsave(lock, flags);
+	snap = *h;
+	spin_unlock_irqrestore(lock, flags);
+
+	for (i = 0; i < snap.count; i++) {
+		const struct codec_rec *rec =
+			&snap.rec[(snap.head + CODEC_HISTORY - snap.count + i) %
+				  CODEC_HISTORY];
+
+		seq_printf(s, "%llu %s %d %llu\n", rec->ts_ns,
+			   names[rec->type], rec->arg, rec->duration_ns);
+	}
+}
+
+/* Returns the stamp; the caller stores it and fires its boot tracepoint */
+static u64 codec_boot_mark(struct device *dev, const char *stage, u64 load_ns)
+{
+	u64 ts_ns = ktime_get_boottime_ns();
+
+	dev_info(dev, "boot: %s at %llu us, %llu us after module load\n",
+		 stage, div_u64(ts_ns, NSEC_PER_USEC),
+		 div_u64(ts_ns - load_ns, NSEC_PER_USEC));
+	return ts_ns;
+}
+
+/* CLOCK_BOOTTIME ns of each step, 0 if not reached yet */
+static void codec_boot_show(struct seq_file *s, u64 load_ns,
+			    const struct codec_boot *boot)
+{
+	seq_printf(s, "module_load_ns: %llu\n", load_ns);
+	seq_printf(s, "probe_ns: %llu\n", boot->probe_ns);
+	seq_printf(s, "component_registered_ns: %llu\n", boot->registered_ns);
+}
+
+static int codec_stats_enable_get(void *data, u64 *val)
+{
+	*val = static_key_enabled(&codec_stats_key);
+	return 0;
+}
+
+static int codec_stats_enable_set(void *data, u64 val)
+{
+	if (val)
+		static_branch_enable(&codec_stats_key);
+	else
+		static_branch_disable(&codec_stats_key);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(codec_stats_enable_fops, codec_stats_enable_get,
+			 codec_stats_enable_set, "%llu\n");
+
+/* /sys/kernel/debug/<name>, with the "enable" knob for all its devices */
+static struct dentry *codec_stats_create_root(const char *name)
+{
+	struct dentry *root = debugfs_create_dir(name, NULL);
+
+	debugfs_create_file_unsafe("enable", 0644, root, NULL,
+				   &codec_stats_enable_fops);
+	return root;
+}
+
+#endif /* _CODEC_STATS_H */
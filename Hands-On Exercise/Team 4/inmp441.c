@@ -2,25 +2,141 @@
  * inmp441.c -- inmp441 ALSA SoC Codec driver
  */
 
+#include <linux/debugfs.h>
 #include <linux/gpio/consumer.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/timekeeping.h>
+#include <sound/pcm_params.h>
 #include <sound/soc.h>
 #include <linux/init.h>               
 
+#define CREATE_TRACE_POINTS
+#include "inmp441_trace.h"
+
+#include "codec_stats.h"
+
 #define DRV_NAME "inmp441"
 
+enum inmp441_rec_type {
+	INMP441_REC_TRIGGER,
+	INMP441_REC_HW_PARAMS,
+	INMP441_REC_SDMODE,
+};
+
+static const char * const inmp441_rec_names[] = {
+	[INMP441_REC_TRIGGER]   = "trigger",
+	[INMP441_REC_HW_PARAMS] = "hw_params",
+	[INMP441_REC_SDMODE]    = "sdmode",
+};
+
+/*
+ * Capture activity shown in debugfs. It is part of every inmp441_priv but
+ * only updated while codec_stats_on(); otherwise the counters stay put.
+ */
+struct inmp441_stats {
+	spinlock_t lock;
+	u64 starts;
+	u64 stops;
+	u64 hw_params;
+	u64 sdmode_on;
+	u64 sdmode_off;
+	u64 last_start_ns;
+	u64 streaming_ns;               // total time between start and stop
+	struct codec_history history;
+};
+
 /*
  * Private driver data structure for the INMP441 codec
  */
 struct inmp441_priv {
 	struct gpio_desc *sdmode_gpio; // Optional GPIO for mic shutdown/power
+	struct inmp441_stats stats;
+	struct codec_boot boot;        // card itself: boot-audio-latency.sh
 };
 
-/* DAI ops struct: trigger, set_fmt etc. can be implemented if needed */
+static struct dentry *inmp441_debugfs_root;
+static u64 inmp441_load_ns;
+
+/* Trigger runs atomic; a START..STOP pair adds its length to streaming_ns */
+static void inmp441_record(struct inmp441_priv *inmp,
+			   enum inmp441_rec_type type, int arg)
+{
+	struct inmp441_stats *st = &inmp->stats;
+	unsigned long flags;
+	u64 now;
+
+	if (!codec_stats_on())
+		return;
+
+	now = ktime_get_ns();
+	spin_lock_irqsave(&st->lock, flags);
+	switch (type) {
+	case INMP441_REC_TRIGGER:
+		if (arg == SNDRV_PCM_TRIGGER_START ||
+		    arg == SNDRV_PCM_TRIGGER_RESUME ||
+		    arg == SNDRV_PCM_TRIGGER_PAUSE_RELEASE) {
+			st->starts++;
+			st->last_start_ns = now;
+		} else {
+			st->stops++;
+			if (st->last_start_ns)
+				st->streaming_ns += now - st->last_start_ns;
+			st->last_start_ns = 0;
+		}
+		break;
+	case INMP441_REC_HW_PARAMS:
+		st->hw_params++;
+		break;
+	case INMP441_REC_SDMODE:
+		if (arg)
+			st->sdmode_on++;
+		else
+			st->sdmode_off++;
+		break;
+	}
+
+	codec_history_add(&st->history, now, type, arg, 0);
+	spin_unlock_irqrestore(&st->lock, flags);
+}
+
+static void inmp441_set_sdmode(struct device *dev, struct inmp441_priv *inmp,
+			       int value)
+{
+	gpiod_set_value_cansleep(inmp->sdmode_gpio, value);
+	trace_inmp441_sdmode(dev, value);
+	inmp441_record(inmp, INMP441_REC_SDMODE, value);
+}
+
+static int inmp441_dai_trigger(struct snd_pcm_substream *substream, int cmd,
+			       struct snd_soc_dai *dai)
+{
+	struct inmp441_priv *inmp = snd_soc_component_get_drvdata(dai->component);
+
+	trace_inmp441_trigger(dai->dev, substream->stream, cmd);
+	inmp441_record(inmp, INMP441_REC_TRIGGER, cmd);
+	return 0;
+}
+
+static int inmp441_dai_hw_params(struct snd_pcm_substream *substream,
+				 struct snd_pcm_hw_params *params,
+				 struct snd_soc_dai *dai)
+{
+	struct inmp441_priv *inmp = snd_soc_component_get_drvdata(dai->component);
+
+	trace_inmp441_hw_params(dai->dev, params_rate(params),
+				params_channels(params), params_width(params));
+	inmp441_record(inmp, INMP441_REC_HW_PARAMS, params_rate(params));
+	return 0;
+}
+
+/* DAI ops: only instrumentation, the mic itself has nothing to program */
 static const struct snd_soc_dai_ops inmp441_dai_ops = {
-	/* Implement trigger(), set_fmt(), hw_params(), etc if needed */
+	.trigger = inmp441_dai_trigger,
+	.hw_params = inmp441_dai_hw_params,
 };
 
 /* Capture DAI */
@@ -47,7 +163,7 @@ static int inmp441_component_probe(struct snd_soc_component *component)
 
 	/* Do codec-specific init here (previously in dai_probe) */
 	if (inmp && inmp->sdmode_gpio)
-		gpiod_set_value_cansleep(inmp->sdmode_gpio, 1); // Example: power on
+		inmp441_set_sdmode(component->dev, inmp, 1); // Example: power on
 
 	return 0;
 }
@@ -58,15 +174,84 @@ static const struct snd_soc_component_driver inmp441_component_driver = {
 	.name  = "inmp441",
 };
 
+static int inmp441_stats_show(struct seq_file *s, void *unused)
+{
+	struct inmp441_priv *inmp = s->private;
+	struct inmp441_stats *st = &inmp->stats;
+	u64 starts, stops, hw_params, sdmode_on, sdmode_off, streaming_ns;
+	unsigned long flags;
+
+	spin_lock_irqsave(&st->lock, flags);
+	starts = st->starts;
+	stops = st->stops;
+	hw_params = st->hw_params;
+	sdmode_on = st->sdmode_on;
+	sdmode_off = st->sdmode_off;
+	streaming_ns = st->streaming_ns;
+	if (st->last_start_ns)
+		streaming_ns += ktime_get_ns() - st->last_start_ns;
+	spin_unlock_irqrestore(&st->lock, flags);
+
+	seq_printf(s, "starts: %llu\n", starts);
+	seq_printf(s, "stops: %llu\n", stops);
+	seq_printf(s, "hw_params: %llu\n", hw_params);
+	seq_printf(s, "sdmode_on: %llu\n", sdmode_on);
+	seq_printf(s, "sdmode_off: %llu\n", sdmode_off);
+	seq_printf(s, "streaming_ns: %llu\n", streaming_ns);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(inmp441_stats);
+
+static int inmp441_history_show(struct seq_file *s, void *unused)
+{
+	struct inmp441_priv *inmp = s->private;
+
+	codec_history_show(s, &inmp->stats.lock, &inmp->stats.history,
+			   inmp441_rec_names);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(inmp441_history);
+
+static int inmp441_boot_show(struct seq_file *s, void *unused)
+{
+	struct inmp441_priv *inmp = s->private;
+
+	codec_boot_show(s, inmp441_load_ns, &inmp->boot);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(inmp441_boot);
+
+static void inmp441_debugfs_remove(void *data)
+{
+	debugfs_remove_recursive(data);
+}
+
+static int inmp441_debugfs_init(struct device *dev, struct inmp441_priv *inmp)
+{
+	struct dentry *dir;
+
+	spin_lock_init(&inmp->stats.lock);
+	if (!IS_ENABLED(CONFIG_DEBUG_FS))
+		return 0;
+
+	dir = debugfs_create_dir(dev_name(dev), inmp441_debugfs_root);
+	debugfs_create_file("stats", 0444, dir, inmp, &inmp441_stats_fops);
+	debugfs_create_file("history", 0444, dir, inmp, &inmp441_history_fops);
+	debugfs_create_file("boot", 0444, dir, inmp, &inmp441_boot_fops);
+	return devm_add_action_or_reset(dev, inmp441_debugfs_remove, dir);
+}
+
 /* Platform probe: register codec with ASoC */
 static int inmp441_probe(struct platform_device *pdev)
 {
 	struct inmp441_priv *inmp;
+	int ret;
 
 	/* Allocate private data for this device */
 	inmp = devm_kzalloc(&pdev->dev, sizeof(*inmp), GFP_KERNEL);
 	if (!inmp)
 		return -ENOMEM;
+	inmp->boot.probe_ns = ktime_get_boottime_ns();
 
 	/* Try to get the optional "sdmode" GPIO from device tree */
 	inmp->sdmode_gpio = devm_gpiod_get_optional(&pdev->dev,
@@ -75,14 +260,27 @@ static int inmp441_probe(struct platform_device *pdev)
 	if (IS_ERR(inmp->sdmode_gpio))
 		return PTR_ERR(inmp->sdmode_gpio);
 
+	ret = inmp441_debugfs_init(&pdev->dev, inmp);
+	if (ret)
+		return ret;
+
 	/* Attach private data to ALSA component */
 	platform_set_drvdata(pdev, inmp);
 
 	dev_info(&pdev->dev, "INMP441 platform probe ran\n");
 
-	return devm_snd_soc_register_component(&pdev->dev,
-					       &inmp441_component_driver,
-					       &inmp441_dai_driver, 1);
+	ret = devm_snd_soc_register_component(&pdev->dev,
+					      &inmp441_component_driver,
+					      &inmp441_dai_driver, 1);
+	if (ret)
+		return ret;
+
+	inmp->boot.registered_ns = codec_boot_mark(&pdev->dev,
+						   "component_registered",
+						   inmp441_load_ns);
+	trace_inmp441_boot(&pdev->dev, "component_registered",
+			   inmp->boot.registered_ns);
+	return 0;
 }
 
 static const struct of_device_id inmp441_of_match[] = {
@@ -96,10 +294,40 @@ static struct platform_driver inmp441_driver = {
 	.driver = {
 		.name = DRV_NAME,
 		.of_match_table = inmp441_of_match,
+		/* Probe does no I/O of its own: no need to hold up init */
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe = inmp441_probe,
 };
-module_platform_driver(inmp441_driver);
+
+static int __init inmp441_init(void)
+{
+	int ret;
+
+	inmp441_load_ns = ktime_get_boottime_ns();
+	/* /sys/kernel/debug/inmp441/{enable,<dev>/{stats,history,boot}} */
+	inmp441_debugfs_root = codec_stats_create_root(DRV_NAME);
+	ret = platform_driver_register(&inmp441_driver);
+	if (ret)
+		debugfs_remove_recursive(inmp441_debugfs_root);
+	return ret;
+}
+module_init(inmp441_init);
+
+static void __exit inmp441_exit(void)
+{
+	platform_driver_unregister(&inmp441_driver);
+	debugfs_remove_recursive(inmp441_debugfs_root);
+}
+module_exit(inmp441_exit);
+
+/*
+ * `make KUNIT=1` or CONFIG_SND_SOC_INMP441_KUNIT_TEST:
+ * the tests call the static callbacks above directly
+ */
+#ifdef INMP441_KUNIT_TEST
+#include "inmp441_kunit.c"
+#endif
 
 MODULE_DESCRIPTION("INMP441 MEMS Microphone Codec Driver");
 MODULE_LICENSE("GPL v2");
@@ -0,0 +1,243 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * inmp441_kunit.c -- KUnit tests for the inmp441 codec driver
+ *
+ * Included at the end of inmp441.c when built with `make KUNIT=1`, so the
+ * static callbacks are reachable; the suite runs when the module loads (the
+ * kernel needs CONFIG_KUNIT). The "sdmode" GPIO is a line of the fake GPIO
+ * chip of codec_kunit.h, handed to the driver as the platform probe would.
+ * Results are in dmesg and /sys/kernel/debug/kunit/inmp441/results.
+ * Copy this directory to sound/soc/codecs/inmp441, source its Kconfig from
+ * sound/soc/codecs/Kconfig, add `obj-y += inmp441/` to the Makefile there,
+ * and kunit.py runs the suite under QEMU:
+ *   ./tools/testing/kunit/kunit.py run --arch=x86_64 \
+ *	--kunitconfig=sound/soc/codecs/inmp441
+ * A failed test makes kunit.py exit non-zero. The trigger benchmark fails
+ * over INMP441_KUNIT_TRIGGER_NS_MAX: about 1 us per trigger on the DK1
+ * with a slack factor of 10 for emulation and a loaded host.
+ */
+
+#include <kunit/test.h>
+
+#include "codec_kunit.h"
+
+#ifndef INMP441_KUNIT_TRIGGER_NS_MAX
+#define INMP441_KUNIT_TRIGGER_NS_MAX	10000
+#endif
+#define INMP441_KUNIT_BENCH_LOOPS	10000
+#define INMP441_KUNIT_DEV		"inmp441-kunit"
+
+struct inmp441_test {
+	struct codec_kunit c;
+	struct inmp441_priv *priv;
+};
+
+static int inmp441_test_init(struct kunit *test)
+{
+	struct inmp441_test *t;
+
+	t = kunit_kzalloc(test, sizeof(*t), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, t);
+	test->priv = t;
+
+	t->priv = kunit_kzalloc(test, sizeof(*t->priv), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, t->priv);
+	spin_lock_init(&t->priv->stats.lock);
+
+	codec_kunit_init(test, &t->c, INMP441_KUNIT_DEV, t->priv,
+			 SNDRV_PCM_STREAM_CAPTURE);
+	return 0;
+}
+
+static void inmp441_test_exit(struct kunit *test)
+{
+	struct inmp441_test *t = test->priv;
+
+	if (!t)
+		return;
+	if (t->priv && !IS_ERR_OR_NULL(t->priv->sdmode_gpio))
+		gpiochip_free_own_desc(t->priv->sdmode_gpio);
+	codec_kunit_exit(&t->c);
+	static_branch_disable(&codec_stats_key);
+}
+
+/* Stats are off by default, like on a booted board */
+static void inmp441_test_stats_on(struct kunit *test)
+{
+	if (!IS_ENABLED(CONFIG_DEBUG_FS))
+		kunit_skip(test, "stats need CONFIG_DEBUG_FS");
+	static_branch_enable(&codec_stats_key);
+}
+
+/* What the platform probe finds when the device tree has "sdmode-gpios" */
+static void inmp441_test_add_gpio(struct kunit *test)
+{
+	struct inmp441_test *t = test->priv;
+
+	t->priv->sdmode_gpio = gpiochip_request_own_desc(&t->c.gpio->chip, 0,
+							 "sdmode",
+							 GPIO_ACTIVE_HIGH,
+							 GPIOD_OUT_LOW);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, t->priv->sdmode_gpio);
+}
+
+static void inmp441_test_trigger(struct kunit *test, int cmd)
+{
+	struct inmp441_test *t = test->priv;
+
+	KUNIT_EXPECT_EQ(test, inmp441_dai_trigger(t->c.substream, cmd, t->c.dai), 0);
+}
+
+/* The card bind powers the mic */
+static void inmp441_test_probe_powers_mic(struct kunit *test)
+{
+	struct inmp441_test *t = test->priv;
+
+	inmp441_test_add_gpio(test);
+	KUNIT_ASSERT_EQ(test, inmp441_component_probe(t->c.component), 0);
+	KUNIT_EXPECT_EQ(test, t->c.gpio->n_sets, 1);
+	KUNIT_EXPECT_EQ(test, t->c.gpio->level, 1);
+}
+
+/* Every bind powers it again, after a rebind too */
+static void inmp441_test_rebind(struct kunit *test)
+{
+	struct inmp441_test *t = test->priv;
+
+	inmp441_test_add_gpio(test);
+	KUNIT_ASSERT_EQ(test, inmp441_component_probe(t->c.component), 0);
+	KUNIT_ASSERT_EQ(test, inmp441_component_probe(t->c.component), 0);
+	KUNIT_EXPECT_EQ(test, t->c.gpio->n_sets, 2);
+	KUNIT_EXPECT_EQ(test, t->c.gpio->level, 1);
+}
+
+static void inmp441_test_probe_without_gpio(struct kunit *test)
+{
+	struct inmp441_test *t = test->priv;
+
+	KUNIT_ASSERT_EQ(test, inmp441_component_probe(t->c.component), 0);
+	KUNIT_EXPECT_EQ(test, t->c.gpio->n_sets, 0);
+}
+
+static void inmp441_test_trigger_sequence(struct kunit *test)
+{
+	static const int cmds[] = {
+		SNDRV_PCM_TRIGGER_START, SNDRV_PCM_TRIGGER_STOP,
+		SNDRV_PCM_TRIGGER_START, SNDRV_PCM_TRIGGER_PAUSE_PUSH,
+		SNDRV_PCM_TRIGGER_PAUSE_RELEASE, SNDRV_PCM_TRIGGER_STOP,
+	};
+	struct inmp441_stats *st =
+		&((struct inmp441_test *)test->priv)->priv->stats;
+	unsigned int i;
+
+	inmp441_test_stats_on(test);
+	for (i = 0; i < ARRAY_SIZE(cmds); i++)
+		inmp441_test_trigger(test, cmds[i]);
+
+	KUNIT_EXPECT_EQ(test, st->starts, 3);
+	KUNIT_EXPECT_EQ(test, st->stops, 3);
+	KUNIT_EXPECT_EQ(test, st->last_start_ns, 0);
+	KUNIT_EXPECT_GT(test, st->streaming_ns, 0);
+	KUNIT_ASSERT_EQ(test, st->history.count, ARRAY_SIZE(cmds));
+	for (i = 0; i < ARRAY_SIZE(cmds); i++) {
+		KUNIT_EXPECT_EQ(test, st->history.rec[i].type,
+				INMP441_REC_TRIGGER);
+		KUNIT_EXPECT_EQ(test, st->history.rec[i].arg, cmds[i]);
+	}
+	for (i = 1; i < ARRAY_SIZE(cmds); i++)
+		KUNIT_EXPECT_GE(test, st->history.rec[i].ts_ns,
+				st->history.rec[i - 1].ts_ns);
+}
+
+/* Until debugfs "enable" is set the trigger records nothing */
+static void inmp441_test_stats_off(struct kunit *test)
+{
+	struct inmp441_stats *st =
+		&((struct inmp441_test *)test->priv)->priv->stats;
+
+	inmp441_test_trigger(test, SNDRV_PCM_TRIGGER_START);
+	inmp441_test_trigger(test, SNDRV_PCM_TRIGGER_STOP);
+	KUNIT_EXPECT_EQ(test, st->starts, 0);
+	KUNIT_EXPECT_EQ(test, st->history.count, 0);
+}
+
+/* The history keeps the last CODEC_HISTORY events, oldest overwritten */
+static void inmp441_test_history_wrap(struct kunit *test)
+{
+	struct inmp441_stats *st =
+		&((struct inmp441_test *)test->priv)->priv->stats;
+	unsigned int i, newest;
+
+	inmp441_test_stats_on(test);
+	for (i = 0; i < CODEC_HISTORY + 8; i++)
+		inmp441_test_trigger(test, i & 1 ? SNDRV_PCM_TRIGGER_STOP :
+						   SNDRV_PCM_TRIGGER_START);
+
+	KUNIT_EXPECT_EQ(test, st->history.count, CODEC_HISTORY);
+	KUNIT_EXPECT_EQ(test, st->history.head, 8);
+	newest = (st->history.head + CODEC_HISTORY - 1) % CODEC_HISTORY;
+	KUNIT_EXPECT_EQ(test, st->history.rec[newest].arg,
+			SNDRV_PCM_TRIGGER_STOP);
+	KUNIT_EXPECT_EQ(test, st->starts, CODEC_HISTORY / 2 + 4);
+}
+
+static void inmp441_test_hw_params(struct kunit *test)
+{
+	struct inmp441_test *t = test->priv;
+	struct inmp441_stats *st = &t->priv->stats;
+	struct snd_pcm_hw_params *params;
+
+	inmp441_test_stats_on(test);
+	params = kunit_kzalloc(test, sizeof(*params), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, params);
+	snd_mask_set_format(hw_param_mask(params, SNDRV_PCM_HW_PARAM_FORMAT),
+			    SNDRV_PCM_FORMAT_S32_LE);
+	hw_param_interval(params, SNDRV_PCM_HW_PARAM_RATE)->min = 48000;
+	hw_param_interval(params, SNDRV_PCM_HW_PARAM_CHANNELS)->min = 1;
+
+	KUNIT_EXPECT_EQ(test, inmp441_dai_hw_params(t->c.substream, params, t->c.dai),
+			0);
+	KUNIT_EXPECT_EQ(test, st->hw_params, 1);
+	KUNIT_EXPECT_EQ(test, st->history.rec[0].type, INMP441_REC_HW_PARAMS);
+	KUNIT_EXPECT_EQ(test, st->history.rec[0].arg, 48000);
+}
+
+static void inmp441_bench_trigger(struct kunit *test)
+{
+	struct inmp441_test *t = test->priv;
+	u64 start_ns, ns;
+	unsigned int i;
+
+	start_ns = ktime_get_ns();
+	for (i = 0; i < INMP441_KUNIT_BENCH_LOOPS; i++) {
+		inmp441_dai_trigger(t->c.substream, SNDRV_PCM_TRIGGER_START, t->c.dai);
+		inmp441_dai_trigger(t->c.substream, SNDRV_PCM_TRIGGER_STOP, t->c.dai);
+	}
+	ns = div_u64(ktime_get_ns() - start_ns, 2 * INMP441_KUNIT_BENCH_LOOPS);
+
+	kunit_info(test, "%llu ns/trigger, budget %d ns\n", ns,
+		   INMP441_KUNIT_TRIGGER_NS_MAX);
+	/* 0 = report only */
+	if (INMP441_KUNIT_TRIGGER_NS_MAX)
+		KUNIT_EXPECT_LE(test, ns, INMP441_KUNIT_TRIGGER_NS_MAX);
+}
+
+static struct kunit_case inmp441_test_cases[] = {
+	KUNIT_CASE(inmp441_test_probe_powers_mic),
+	KUNIT_CASE(inmp441_test_rebind),
+	KUNIT_CASE(inmp441_test_probe_without_gpio),
+	KUNIT_CASE(inmp441_test_trigger_sequence),
+	KUNIT_CASE(inmp441_test_stats_off),
+	KUNIT_CASE(inmp441_test_history_wrap),
+	KUNIT_CASE(inmp441_test_hw_params),
+	KUNIT_CASE(inmp441_bench_trigger),
+	{}
+};
+
+static struct kunit_suite inmp441_test_suite = {
+	.name = "inmp441",
+	.init = inmp441_test_init,
+	.exit = inmp441_test_exit,
+	.test_cases = inmp441_test_cases,
+};
+kunit_test_suite(inmp441_test_suite);
@@ -0,0 +1,93 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * inmp441_trace.h -- INMP441 tracepoints
+ *
+ * Enable with e.g.
+ *   echo 1 > /sys/kernel/tracing/events/inmp441/enable
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM inmp441
+
+#if !defined(_INMP441_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _INMP441_TRACE_H
+
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(inmp441_trigger,
+	TP_PROTO(struct device *dev, int stream, int cmd),
+	TP_ARGS(dev, stream, cmd),
+	TP_STRUCT__entry(
+		__string(name, dev_name(dev))
+		__field(int, stream)
+		__field(int, cmd)
+	),
+	TP_fast_assign(
+		__assign_str(name, dev_name(dev));
+		__entry->stream = stream;
+		__entry->cmd = cmd;
+	),
+	TP_printk("%s stream=%d cmd=%d", __get_str(name),
+		  __entry->stream, __entry->cmd)
+);
+
+TRACE_EVENT(inmp441_hw_params,
+	TP_PROTO(struct device *dev, unsigned int rate, unsigned int channels,
+		 unsigned int width),
+	TP_ARGS(dev, rate, channels, width),
+	TP_STRUCT__entry(
+		__string(name, dev_name(dev))
+		__field(unsigned int, rate)
+		__field(unsigned int, channels)
+		__field(unsigned int, width)
+	),
+	TP_fast_assign(
+		__assign_str(name, dev_name(dev));
+		__entry->rate = rate;
+		__entry->channels = channels;
+		__entry->width = width;
+	),
+	TP_printk("%s rate=%u channels=%u width=%u", __get_str(name),
+		  __entry->rate, __entry->channels, __entry->width)
+);
+
+TRACE_EVENT(inmp441_sdmode,
+	TP_PROTO(struct device *dev, int value),
+	TP_ARGS(dev, value),
+	TP_STRUCT__entry(
+		__string(name, dev_name(dev))
+		__field(int, value)
+	),
+	TP_fast_assign(
+		__assign_str(name, dev_name(dev));
+		__entry->value = value;
+	),
+	TP_printk("%s sdmode=%d", __get_str(name), __entry->value)
+);
+
+/* ts_ns: CLOCK_BOOTTIME, comparable with the dmesg timestamps */
+TRACE_EVENT(inmp441_boot,
+	TP_PROTO(struct device *dev, const char *stage, u64 ts_ns),
+	TP_ARGS(dev, stage, ts_ns),
+	TP_STRUCT__entry(
+		__string(name, dev_name(dev))
+		__string(stage, stage)
+		__field(u64, ts_ns)
+	),
+	TP_fast_assign(
+		__assign_str(name, dev_name(dev));
+		__assign_str(stage, stage);
+		__entry->ts_ns = ts_ns;
+	),
+	TP_printk("%s stage=%s ts_ns=%llu", __get_str(name),
+		  __get_str(stage), __entry->ts_ns)
+);
+
+#endif /* _INMP441_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE inmp441_trace
+#include <trace/define_trace.h>
@@ -1,26 +1,539 @@
+/**
+ * @file
+ * @brief Minimal INMP441 capture path: SAI FIFO -> cyclic DMA -> mmap'd ring
+ *
+ * @details For always-on sensing the ALSA PCM + alsa-lib stack costs more CPU
+ * than the signal processing. This driver skips it: it runs SAI2 sub-block B
+ * as I2S master receiver, lets a cyclic DMA transfer copy the FIFO into a
+ * coherent ring and exposes that ring through /dev/capgemini-mic (ABI in
+ * capgemini-mic.h):
+ * - a shared control page with the write/read positions,
+ * - the ring itself, mapped read-only, written in place by the DMA,
+ * - poll() wakeups once the unread fill reaches a watermark.
+ * A reader in steady state only reads memory and advances read_pos; there
+ * are no per-period copies and no syscalls unless it has to sleep.
+ *
+ * The SAI2B node used by the ASoC card must be disabled while this driver
+ * owns the block. Device tree node (STM32MP157, SAI2 base 0x4400b000):
+ *
+ *	mic_ring: capgemini-mic@4400b024 {
+ *		compatible = "capgemini,mic-ring";
+ *		reg = <0x4400b024 0x20>;
+ *		clocks = <&rcc SAI2>, <&rcc SAI2_K>;
+ *		clock-names = "pclk", "sai_ck";
+ *		dmas = <&dmamux1 90 0x400 0x01>;
+ *		dma-names = "rx";
+ *		pinctrl-names = "default";
+ *		pinctrl-0 = <&sai2b_pins>;
+ *	};
+ *
+ * sai_ck must already run at a multiple of 64 * rate (assigned-clock-rates),
+ * e.g. 49.152 MHz for 48 kHz.
+ *
+ * @author Team 1
+ * @date 19-10-2026
+ *
+ * @version 1.0
+ * @note Changelog:
+ * - 19-10-2026: mmap'd DMA ring character device
+ */
+
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/kernel.h>
+#include <linux/bitfield.h>
+#include <linux/clk.h>
+#include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
+#include <linux/io.h>
+#include <linux/iopoll.h>
+#include <linux/kref.h>
+#include <linux/log2.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/mod_devicetable.h>
+#include <linux/platform_device.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/wait.h>
+
+#include "capgemini-mic.h"
 
 // Module metadata
 MODULE_LICENSE("GPL");
-MODULE_AUTHOR("Your Name");
-MODULE_DESCRIPTION("A basic kernel module template");
+MODULE_AUTHOR("Ulises G");
+MODULE_DESCRIPTION("INMP441 mmap'd DMA ring capture device");
 MODULE_VERSION("1.0");
 
-// Module initialization function
-static int __init hello_init(void)
+#define CMIC_DRV_NAME "capgemini-mic"
+
+/* STM32MP1 SAI sub-block registers, offsets from the sub-block base (RM0436) */
+#define SAI_XCR1 0x00
+#define SAI_XCR2 0x04
+#define SAI_XFRCR 0x08
+#define SAI_XSLOTR 0x0c
+#define SAI_XIM 0x10
+#define SAI_XSR 0x14
+#define SAI_XCLRFR 0x18
+#define SAI_XDR 0x1c
+
+#define SAI_XCR1_MODE GENMASK(1, 0)
+#define SAI_XCR1_MODE_MASTER_RX 1
+#define SAI_XCR1_DS GENMASK(7, 5)
+#define SAI_XCR1_DS_32 7
+#define SAI_XCR1_CKSTR BIT(9)
+#define SAI_XCR1_SAIEN BIT(16)
+#define SAI_XCR1_DMAEN BIT(17)
+#define SAI_XCR1_NODIV BIT(19)
+#define SAI_XCR1_MCKDIV GENMASK(25, 20)
+
+#define SAI_XCR2_FTH GENMASK(2, 0)
+#define SAI_XCR2_FTH_HALF 2
+#define SAI_XCR2_FFLUSH BIT(3)
+
+#define SAI_XFRCR_FRL GENMASK(7, 0)
+#define SAI_XFRCR_FSALL GENMASK(14, 8)
+#define SAI_XFRCR_FSDEF BIT(16)
+#define SAI_XFRCR_FSOFF BIT(18)
+
+#define SAI_XSLOTR_NBSLOT GENMASK(11, 8)
+#define SAI_XSLOTR_SLOTEN GENMASK(31, 16)
+
+#define SAI_XCLRFR_ALL 0x77
+
+/* I2S, two 32-bit slots per frame; only slot 0 (L/R tied low) reaches the FIFO */
+#define CMIC_SLOT_BITS 32
+#define CMIC_FRAME_BITS (2 * CMIC_SLOT_BITS)
+#define CMIC_FRAME_BYTES (CMIC_SLOT_BITS / 8)
+
+static unsigned int rate = 48000;
+module_param(rate, uint, 0444);
+MODULE_PARM_DESC(rate, "Sample rate in Hz (default: 48000)");
+
+static unsigned int ring_bytes = 65536;
+module_param(ring_bytes, uint, 0444);
+MODULE_PARM_DESC(ring_bytes, "Ring size in bytes, power of two (default: 65536)");
+
+static unsigned int period_bytes = 4096;
+module_param(period_bytes, uint, 0444);
+MODULE_PARM_DESC(period_bytes, "DMA interrupt granularity in bytes, power of two (default: 4096)");
+
+/*
+ * The control page is mapped writable by the reader, so the driver only
+ * ever reads read_pos from it; everything else it needs is kept here and
+ * published to the page. Open files hold a reference (mappings pin their
+ * file), so the ring and the page outlive an unbind until the last close.
+ */
+struct cmic {
+    struct kref ref;
+    struct device *dev;
+    struct miscdevice misc;
+    void __iomem *base;
+    phys_addr_t fifo_addr;
+    struct clk *sai_ck;
+    struct dma_chan *chan;
+    dma_cookie_t cookie;
+
+    struct cmic_ctrl *ctrl;     /* shared page */
+    void *ring;
+    dma_addr_t ring_dma;
+    u32 ring_bytes;
+    u32 ring_offset;
+    u32 write_pos;
+    u32 overruns;
+    bool overrun;               /* inside an overrun, counted once */
+
+    struct mutex lock;          /* open/ioctl vs. each other */
+    spinlock_t pos_lock;        /* position update: DMA callback vs. poll() */
+    wait_queue_head_t wait;
+    unsigned long busy;
+    bool running;
+    bool gone;                  /* unbound, only open files are left */
+    u32 dma_offset;             /* last ring offset seen from the DMA */
+    u32 watermark;
+};
+
+/*
+ * Publishes the DMA position to the control page and returns the unread
+ * fill. The residue gives the exact position, so poll() never reports stale
+ * data between two period interrupts.
+ */
+static u32 cmic_update_position(struct cmic *mic)
+{
+    struct cmic_ctrl *ctrl = mic->ctrl;
+    u32 mask = mic->ring_bytes - 1;
+    struct dma_tx_state state;
+    unsigned long flags;
+    u32 offset, fill;
+
+    spin_lock_irqsave(&mic->pos_lock, flags);
+    if (mic->running) {
+        dmaengine_tx_status(mic->chan, mic->cookie, &state);
+        offset = (mic->ring_bytes - state.residue) & mask;
+        mic->write_pos += (offset - mic->dma_offset) & mask;
+        mic->dma_offset = offset;
+
+        WRITE_ONCE(ctrl->write_tstamp_ns, ktime_get_ns());
+        /* Samples and timestamp are visible before the new position */
+        smp_store_release(&ctrl->write_pos, mic->write_pos);
+    }
+
+    fill = mic->write_pos - READ_ONCE(ctrl->read_pos);
+    if (fill <= mic->ring_bytes) {
+        mic->overrun = false;
+    } else if (!mic->overrun) {
+        mic->overrun = true;
+        WRITE_ONCE(ctrl->overruns, ++mic->overruns);
+    }
+    spin_unlock_irqrestore(&mic->pos_lock, flags);
+    return fill;
+}
+
+static void cmic_dma_complete(void *data)
+{
+    struct cmic *mic = data;
+
+    if (cmic_update_position(mic) >= READ_ONCE(mic->watermark))
+        wake_up_interruptible(&mic->wait);
+}
+
+static int cmic_sai_configure(struct cmic *mic)
+{
+    unsigned long sai_rate = clk_get_rate(mic->sai_ck);
+    unsigned long sck = (unsigned long)rate * CMIC_FRAME_BITS;
+    unsigned long div = DIV_ROUND_CLOSEST(sai_rate, sck);
+
+    /* With NODIV the bit clock is sai_ck / MCKDIV (0 meaning 1) */
+    if (!div || div > FIELD_MAX(SAI_XCR1_MCKDIV) || sai_rate / div != sck) {
+        dev_err(mic->dev, "sai_ck %lu Hz cannot make %lu Hz bit clock\n", sai_rate, sck);
+        return -EINVAL;
+    }
+
+    writel(SAI_XCR2_FFLUSH, mic->base + SAI_XCR2);
+    writel(FIELD_PREP(SAI_XFRCR_FRL, CMIC_FRAME_BITS - 1) |
+           FIELD_PREP(SAI_XFRCR_FSALL, CMIC_SLOT_BITS - 1) |
+           SAI_XFRCR_FSDEF | SAI_XFRCR_FSOFF, mic->base + SAI_XFRCR);
+    writel(FIELD_PREP(SAI_XSLOTR_NBSLOT, 1) | FIELD_PREP(SAI_XSLOTR_SLOTEN, BIT(0)),
+           mic->base + SAI_XSLOTR);
+    writel(FIELD_PREP(SAI_XCR1_MODE, SAI_XCR1_MODE_MASTER_RX) |
+           FIELD_PREP(SAI_XCR1_DS, SAI_XCR1_DS_32) | SAI_XCR1_CKSTR |
+           SAI_XCR1_NODIV | FIELD_PREP(SAI_XCR1_MCKDIV, div == 1 ? 0 : div) |
+           SAI_XCR1_DMAEN, mic->base + SAI_XCR1);
+    writel(FIELD_PREP(SAI_XCR2_FTH, SAI_XCR2_FTH_HALF), mic->base + SAI_XCR2);
+    writel(0, mic->base + SAI_XIM);
+    writel(SAI_XCLRFR_ALL, mic->base + SAI_XCLRFR);
+    return 0;
+}
+
+static void cmic_sai_disable(struct cmic *mic)
+{
+    u32 cr1 = readl(mic->base + SAI_XCR1);
+
+    writel(cr1 & ~SAI_XCR1_SAIEN, mic->base + SAI_XCR1);
+    /* SAIEN reads back 1 until the current frame is finished */
+    if (readl_poll_timeout(mic->base + SAI_XCR1, cr1, !(cr1 & SAI_XCR1_SAIEN), 10, 10000))
+        dev_warn(mic->dev, "SAI did not stop\n");
+}
+
+static int cmic_start(struct cmic *mic)
+{
+    struct dma_async_tx_descriptor *desc;
+    int ret;
+
+    if (mic->running)
+        return -EBUSY;
+
+    ret = clk_prepare_enable(mic->sai_ck);
+    if (ret)
+        return ret;
+    ret = cmic_sai_configure(mic);
+    if (ret)
+        goto err_clk;
+
+    desc = dmaengine_prep_dma_cyclic(mic->chan, mic->ring_dma, mic->ring_bytes, period_bytes,
+                                     DMA_DEV_TO_MEM, DMA_PREP_INTERRUPT);
+    if (!desc) {
+        ret = -ENOMEM;
+        goto err_clk;
+    }
+    desc->callback = cmic_dma_complete;
+    desc->callback_param = mic;
+
+    spin_lock_irq(&mic->pos_lock);
+    mic->write_pos = 0;
+    mic->overruns = 0;
+    mic->overrun = false;
+    mic->ctrl->write_pos = 0;
+    mic->ctrl->read_pos = 0;
+    mic->ctrl->overruns = 0;
+    mic->dma_offset = 0;
+    mic->cookie = dmaengine_submit(desc);
+    mic->running = true;
+    spin_unlock_irq(&mic->pos_lock);
+
+    dma_async_issue_pending(mic->chan);
+    writel(readl(mic->base + SAI_XCR1) | SAI_XCR1_SAIEN, mic->base + SAI_XCR1);
+    return 0;
+
+err_clk:
+    clk_disable_unprepare(mic->sai_ck);
+    return ret;
+}
+
+static void cmic_stop(struct cmic *mic)
+{
+    if (!mic->running)
+        return;
+
+    cmic_sai_disable(mic);
+    /* Last position update before the channel goes away */
+    cmic_update_position(mic);
+    spin_lock_irq(&mic->pos_lock);
+    mic->running = false;
+    spin_unlock_irq(&mic->pos_lock);
+    dmaengine_terminate_sync(mic->chan);
+    clk_disable_unprepare(mic->sai_ck);
+    wake_up_interruptible(&mic->wait);
+}
+
+static void cmic_free(struct kref *ref)
+{
+    struct cmic *mic = container_of(ref, struct cmic, ref);
+
+    if (mic->ctrl)
+        free_page((unsigned long)mic->ctrl);
+    if (mic->ring)
+        dma_free_coherent(mic->chan->device->dev, mic->ring_bytes, mic->ring, mic->ring_dma);
+    if (!IS_ERR_OR_NULL(mic->chan))
+        dma_release_channel(mic->chan);
+    kfree(mic);
+}
+
+static void cmic_put(void *data)
 {
-    printk(KERN_INFO "Hello: Module loaded successfully\n");
-    return 0; // Return 0 for success
+    struct cmic *mic = data;
+
+    kref_put(&mic->ref, cmic_free);
 }
 
-// Module cleanup function
-static void __exit hello_exit(void)
+static int cmic_open(struct inode *inode, struct file *file)
 {
-    printk(KERN_INFO "Hello: Module unloaded successfully\n");
+    struct cmic *mic = container_of(file->private_data, struct cmic, misc);
+
+    /* read_pos has a single owner */
+    if (test_and_set_bit(0, &mic->busy))
+        return -EBUSY;
+    /* misc_open() holds misc_mtx, so remove cannot drop the last reference here */
+    kref_get(&mic->ref);
+    file->private_data = mic;
+    return 0;
 }
 
+static int cmic_release(struct inode *inode, struct file *file)
+{
+    struct cmic *mic = file->private_data;
+
+    mutex_lock(&mic->lock);
+    cmic_stop(mic);
+    mutex_unlock(&mic->lock);
+    clear_bit(0, &mic->busy);
+    cmic_put(mic);
+    return 0;
+}
+
+static __poll_t cmic_poll(struct file *file, poll_table *wait)
+{
+    struct cmic *mic = file->private_data;
+
+    poll_wait(file, &mic->wait, wait);
+    if (cmic_update_position(mic) >= READ_ONCE(mic->watermark))
+        return EPOLLIN | EPOLLRDNORM;
+    return READ_ONCE(mic->running) ? 0 : EPOLLHUP;
+}
+
+static long cmic_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    struct cmic *mic = file->private_data;
+    long ret = 0;
+    u32 watermark;
+
+    mutex_lock(&mic->lock);
+    if (mic->gone) {
+        mutex_unlock(&mic->lock);
+        return -ENODEV;
+    }
+    switch (cmd) {
+    case CMIC_IOC_SET_WATERMARK:
+        if (get_user(watermark, (u32 __user *)arg)) {
+            ret = -EFAULT;
+            break;
+        }
+        WRITE_ONCE(mic->watermark, clamp_t(u32, watermark, CMIC_FRAME_BYTES, mic->ring_bytes));
+        break;
+    case CMIC_IOC_START:
+        ret = cmic_start(mic);
+        break;
+    case CMIC_IOC_STOP:
+        cmic_stop(mic);
+        break;
+    default:
+        ret = -ENOTTY;
+        break;
+    }
+    mutex_unlock(&mic->lock);
+    return ret;
+}
+
+static int cmic_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    struct cmic *mic = file->private_data;
+    unsigned long size = vma->vm_end - vma->vm_start;
+
+    if (READ_ONCE(mic->gone))
+        return -ENODEV;
+    if (vma->vm_pgoff == 0) {
+        if (size != PAGE_SIZE)
+            return -EINVAL;
+        return vm_insert_page(vma, vma->vm_start, virt_to_page(mic->ctrl));
+    }
+
+    if (vma->vm_pgoff == mic->ring_offset >> PAGE_SHIFT) {
+        /* The DMA owns the samples */
+        if (vma->vm_flags & VM_WRITE)
+            return -EPERM;
+        if (size > mic->ring_bytes)
+            return -EINVAL;
+        vm_flags_clear(vma, VM_MAYWRITE);
+        vma->vm_pgoff = 0;
+        return dma_mmap_coherent(mic->chan->device->dev, vma, mic->ring, mic->ring_dma,
+                                 mic->ring_bytes);
+    }
+    return -EINVAL;
+}
+
+static const struct file_operations cmic_fops = {
+    .owner = THIS_MODULE,
+    .open = cmic_open,
+    .release = cmic_release,
+    .poll = cmic_poll,
+    .unlocked_ioctl = cmic_ioctl,
+    .mmap = cmic_mmap,
+};
+
+static int cmic_probe(struct platform_device *pdev)
+{
+    struct dma_slave_config config = {
+        .direction = DMA_DEV_TO_MEM,
+        .src_addr_width = DMA_SLAVE_BUSWIDTH_4_BYTES,
+        .src_maxburst = 4,          /* FIFO threshold: half of 8 words */
+    };
+    struct device *dev = &pdev->dev;
+    struct resource *res;
+    struct clk *pclk;
+    struct cmic *mic;
+    int ret;
+
+    BUILD_BUG_ON(sizeof(struct cmic_ctrl) > CMIC_CTRL_SIZE);
+    if (PAGE_SIZE != CMIC_CTRL_SIZE || !is_power_of_2(ring_bytes) ||
+        !is_power_of_2(period_bytes) || period_bytes > ring_bytes / 2 ||
+        period_bytes < CMIC_FRAME_BYTES || ring_bytes % PAGE_SIZE)
+        return dev_err_probe(dev, -EINVAL, "invalid ring_bytes/period_bytes\n");
+
+    mic = kzalloc(sizeof(*mic), GFP_KERNEL);
+    if (!mic)
+        return -ENOMEM;
+    kref_init(&mic->ref);
+    /* The device's reference; channel, ring and page go with the last one */
+    ret = devm_add_action_or_reset(dev, cmic_put, mic);
+    if (ret)
+        return ret;
+    mic->dev = dev;
+    mutex_init(&mic->lock);
+    spin_lock_init(&mic->pos_lock);
+    init_waitqueue_head(&mic->wait);
+    mic->watermark = period_bytes;
+    mic->ring_bytes = ring_bytes;
+    mic->ring_offset = PAGE_SIZE;
+
+    mic->base = devm_platform_get_and_ioremap_resource(pdev, 0, &res);
+    if (IS_ERR(mic->base))
+        return PTR_ERR(mic->base);
+    mic->fifo_addr = res->start + SAI_XDR;
+
+    pclk = devm_clk_get_enabled(dev, "pclk");
+    if (IS_ERR(pclk))
+        return dev_err_probe(dev, PTR_ERR(pclk), "no pclk\n");
+    mic->sai_ck = devm_clk_get(dev, "sai_ck");
+    if (IS_ERR(mic->sai_ck))
+        return dev_err_probe(dev, PTR_ERR(mic->sai_ck), "no sai_ck\n");
+
+    mic->chan = dma_request_chan(dev, "rx");
+    if (IS_ERR(mic->chan))
+        return dev_err_probe(dev, PTR_ERR(mic->chan), "no rx DMA channel\n");
+    config.src_addr = mic->fifo_addr;
+    ret = dmaengine_slave_config(mic->chan, &config);
+    if (ret)
+        return dev_err_probe(dev, ret, "DMA slave config failed\n");
+
+    /* Allocated for the DMA controller, which is the device doing the writes */
+    mic->ring = dma_alloc_coherent(mic->chan->device->dev, mic->ring_bytes, &mic->ring_dma,
+                                   GFP_KERNEL);
+    if (!mic->ring)
+        return -ENOMEM;
+
+    mic->ctrl = (struct cmic_ctrl *)get_zeroed_page(GFP_KERNEL);
+    if (!mic->ctrl)
+        return -ENOMEM;
+    mic->ctrl->abi_version = CMIC_ABI_VERSION;
+    mic->ctrl->format = CMIC_FORMAT_S32_LE;
+    mic->ctrl->rate = rate;
+    mic->ctrl->channels = 1;
+    mic->ctrl->frame_bytes = CMIC_FRAME_BYTES;
+    mic->ctrl->ring_bytes = mic->ring_bytes;
+    mic->ctrl->ring_offset = mic->ring_offset;
+    mic->ctrl->period_bytes = period_bytes;
+
+    platform_set_drvdata(pdev, mic);
+    mic->misc.minor = MISC_DYNAMIC_MINOR;
+    mic->misc.name = CMIC_DRV_NAME;
+    mic->misc.fops = &cmic_fops;
+    mic->misc.parent = dev;
+    ret = misc_register(&mic->misc);
+    if (ret)
+        return ret;
+
+    dev_info(dev, "ring %u bytes, period %u bytes, %u Hz\n", ring_bytes, period_bytes, rate);
+    return 0;
+}
+
+static int cmic_remove(struct platform_device *pdev)
+{
+    struct cmic *mic = platform_get_drvdata(pdev);
+
+    /* No new opens after this; files already open keep their reference */
+    misc_deregister(&mic->misc);
+    mutex_lock(&mic->lock);
+    cmic_stop(mic);
+    WRITE_ONCE(mic->gone, true);
+    mutex_unlock(&mic->lock);
+    return 0;
+}
+
+static const struct of_device_id cmic_of_match[] = {
+    { .compatible = "capgemini,mic-ring" },
+    {}
+};
+MODULE_DEVICE_TABLE(of, cmic_of_match);
+
+static struct platform_driver cmic_driver = {
+    .driver = {
+        .name = CMIC_DRV_NAME,
+        .owner = THIS_MODULE,
+        .of_match_table = cmic_of_match,
+    },
+    .probe = cmic_probe,
+    .remove = cmic_remove,
+};
+
 // Register init and exit functions
-module_init(hello_init);
-module_exit(hello_exit);
\ No newline at end of file
+module_platform_driver(cmic_driver);
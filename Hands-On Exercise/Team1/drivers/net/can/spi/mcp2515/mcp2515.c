@@ -7,13 +7,1246 @@
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation; either version 2 of the License, or
  * (at your option) any later version.
+ *
+ * The register sequences run for every frame - READ STATUS, READ RX BUFFER
+ * 0/1, LOAD TX BUFFER 0 + RTS and BIT MODIFY CANINTF - use SPI messages
+ * built once at probe (and optimised by the SPI core where it can), so the
+ * hot paths only refill the transmit bytes and call spi_sync(). The
+ * "prebuilt" module parameter switches them back to a message built per
+ * call, for comparison. Everything else goes through a batch that merges
+ * accesses to contiguous registers into one READ/WRITE instruction and
+ * sends all instructions of the batch as one SPI message.
+ *
+ * Controllers on the same SPI bus share a struct mcp2515_bus. Each SPI
+ * message first takes the bus in one of three classes - RX draining, TX,
+ * housekeeping - and a waiting RX message goes first, up to
+ * MCP2515_BUS_RX_BURST in a row, so a busy receiver cannot starve the
+ * others' transmit path. Each device has its own kthread worker for its
+ * interrupt, TX and restart work; its CPU is set in
+ * /sys/bus/spi/devices/<spi device>/irq_cpu.
+ *
+ * Per-frame latencies and SPI time are kept in debugfs:
+ *   /sys/kernel/debug/mcp2515/<spi device>/stats
+ *   /sys/kernel/debug/mcp2515/bus-<spi controller>/stats
  */
 
 #include <linux/module.h>
 #include <linux/spi/spi.h>
+#include <linux/atomic.h>
 #include <linux/can.h>
 #include <linux/can/dev.h>
-#include <linux/gpio.h>
+#include <linux/can/skb.h>
+#include <linux/clk.h>
+#include <linux/cpumask.h>
+#include <linux/debugfs.h>
+#include <linux/delay.h>
 #include <linux/interrupt.h>
+#include <linux/iopoll.h>
+#include <linux/kthread.h>
+#include <linux/list.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/netdevice.h>
+#include <linux/property.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/timekeeping.h>
+#include <linux/version.h>
+#include <linux/wait.h>
+
+#include "mcp2515.h"
+
+#define DEVICE_NAME			"mcp2515"
+#define MCP2515_SPI_HZ_MAX		10000000
+#define MCP2515_OSC_MIN			1000000
+#define MCP2515_OSC_MAX			25000000
+/* Oscillator start-up after RESET, 128 OSC1 cycles plus margin */
+#define MCP2515_OST_DELAY_US		(5 * USEC_PER_MSEC)
+#define MCP2515_MODE_TIMEOUT_US		(10 * USEC_PER_MSEC)
+#define MCP2515_BATCH_OPS		8
+#define MCP2515_BATCH_BYTES		64
+/* RX messages granted in a row while TX or housekeeping wait for the bus */
+#define MCP2515_BUS_RX_BURST		8
+
+static bool prebuilt = true;
+module_param(prebuilt, bool, 0644);
+MODULE_PARM_DESC(prebuilt, "Use the SPI messages built at probe on the RX/TX paths (default: Y)");
+
+static const struct can_bittiming_const mcp2515_bittiming_const = {
+	.name = DEVICE_NAME,
+	.tseg1_min = 3,
+	.tseg1_max = 16,
+	.tseg2_min = 2,
+	.tseg2_max = 8,
+	.sjw_max = 4,
+	.brp_min = 1,
+	.brp_max = 64,
+	.brp_inc = 1,
+};
+
+enum mcp2515_seq {
+	MCP2515_SEQ_STATUS,	/* READ STATUS */
+	MCP2515_SEQ_RXB0,	/* READ RX BUFFER 0, clears RX0IF */
+	MCP2515_SEQ_RXB1,	/* READ RX BUFFER 1, clears RX1IF */
+	MCP2515_SEQ_TX,		/* LOAD TX BUFFER 0, then RTS TXB0 */
+	MCP2515_SEQ_CLR_INTF,	/* BIT MODIFY CANINTF, mask in tx[2] */
+	MCP2515_SEQ_NUM,
+};
+
+/* Bus arbitration classes, highest priority first */
+enum mcp2515_prio {
+	MCP2515_PRIO_RX,		/* READ STATUS and READ RX BUFFER */
+	MCP2515_PRIO_TX,		/* LOAD TX BUFFER + RTS, TX0IF acknowledge */
+	MCP2515_PRIO_HOUSEKEEPING,	/* batches: setup, mode changes, errors */
+	MCP2515_PRIO_NUM,
+};
+
+static const char * const mcp2515_prio_names[MCP2515_PRIO_NUM] = {
+	[MCP2515_PRIO_RX] = "rx",
+	[MCP2515_PRIO_TX] = "tx",
+	[MCP2515_PRIO_HOUSEKEEPING] = "housekeeping",
+};
+
+static const enum mcp2515_prio mcp2515_seq_prio[MCP2515_SEQ_NUM] = {
+	[MCP2515_SEQ_STATUS] = MCP2515_PRIO_RX,
+	[MCP2515_SEQ_RXB0] = MCP2515_PRIO_RX,
+	[MCP2515_SEQ_RXB1] = MCP2515_PRIO_RX,
+	[MCP2515_SEQ_TX] = MCP2515_PRIO_TX,
+	[MCP2515_SEQ_CLR_INTF] = MCP2515_PRIO_TX,
+};
+
+struct mcp2515_bus_stats {
+	u64 grants[MCP2515_PRIO_NUM];
+	u64 wait_ns[MCP2515_PRIO_NUM];	/* request to grant */
+	u64 wait_max_ns[MCP2515_PRIO_NUM];
+};
+
+/* One per SPI controller, shared by the MCP2515s on it */
+struct mcp2515_bus {
+	struct list_head node;
+	struct spi_controller *ctlr;
+	unsigned int users;		/* under mcp2515_buses_lock */
+	/* protects the arbitration state and stats below */
+	spinlock_t lock;
+	wait_queue_head_t wq;
+	bool busy;
+	unsigned int waiting[MCP2515_PRIO_NUM];
+	unsigned int rx_streak;
+	struct mcp2515_bus_stats stats;
+	atomic64_t rx_frames;
+	atomic64_t tx_frames;
+	atomic64_t drops;		/* rx_dropped + rx_over_errors */
+	struct dentry *debugfs;
+};
+
+/* A prebuilt sequence: up to two instructions, each ending on CS high */
+struct mcp2515_xfer {
+	struct spi_message msg;
+	struct spi_transfer t[2];
+	unsigned int len[2];
+	u8 tx[16] ____cacheline_aligned;
+	u8 rx[16] ____cacheline_aligned;
+};
+
+struct mcp2515_batch_read {
+	u8 offset;
+	u8 len;
+	u8 *dest;
+};
+
+/* Register accesses collected by mcp2515_batch_*() and sent by _run() */
+struct mcp2515_batch {
+	struct spi_message msg;
+	struct spi_transfer t[MCP2515_BATCH_OPS];
+	u8 instr[MCP2515_BATCH_OPS];
+	u8 reg[MCP2515_BATCH_OPS];
+	struct mcp2515_batch_read reads[MCP2515_BATCH_OPS];
+	unsigned int n_ops;
+	unsigned int n_reads;
+	unsigned int used;
+	int err;
+	u8 tx[MCP2515_BATCH_BYTES] ____cacheline_aligned;
+	u8 rx[MCP2515_BATCH_BYTES] ____cacheline_aligned;
+};
+
+struct mcp2515_stats {
+	u64 spi_msgs;
+	u64 spi_ns;
+	u64 irqs;
+	u64 tx_frames;
+	u64 tx_ns;		/* start_xmit to TX0IF handled */
+	u64 tx_max_ns;
+	u64 tx_spi_ns;		/* LOAD TX BUFFER + RTS */
+	u64 rx_frames;
+	u64 rx_ns;		/* IRQ to frame handed to the stack */
+	u64 rx_max_ns;
+	u64 rx_spi_ns;		/* READ RX BUFFER */
+};
+
+struct mcp2515_priv {
+	struct can_priv can;	/* must be first */
+	struct net_device *net;
+	struct spi_device *spi;
+	/* serialises the SPI sequences, their buffers and the stats */
+	struct mutex lock;
+	struct mcp2515_xfer *xfer;
+	struct mcp2515_batch *batch;
+	struct mcp2515_bus *bus;
+	/* runs irq_work, tx_work and restart_work, pinned with irq_cpu */
+	struct kthread_worker *worker;
+	struct kthread_work irq_work;
+	struct kthread_work tx_work;
+	struct kthread_work restart_work;
+	int irq_cpu;		/* -1: any CPU */
+	struct sk_buff *tx_skb;
+	u64 tx_start_ns;
+	u64 irq_ns;
+	struct mcp2515_stats stats;
+	struct dentry *debugfs;
+};
+
+static struct dentry *mcp2515_debugfs_root;
+static LIST_HEAD(mcp2515_buses);
+static DEFINE_MUTEX(mcp2515_buses_lock);
+
+static u64 mcp2515_avg(u64 total, u64 count)
+{
+	return count ? div64_u64(total, count) : 0;
+}
+
+/*
+ * RX goes first unless it already had MCP2515_BUS_RX_BURST grants in a row
+ * and someone else is waiting; TX goes before housekeeping.
+ */
+static bool mcp2515_bus_may_take(const struct mcp2515_bus *bus,
+				 enum mcp2515_prio prio)
+{
+	bool rx_burst_done = bus->rx_streak >= MCP2515_BUS_RX_BURST;
+
+	if (bus->busy)
+		return false;
+	switch (prio) {
+	case MCP2515_PRIO_RX:
+		return !rx_burst_done ||
+		       !(bus->waiting[MCP2515_PRIO_TX] +
+			 bus->waiting[MCP2515_PRIO_HOUSEKEEPING]);
+	case MCP2515_PRIO_TX:
+		return !bus->waiting[MCP2515_PRIO_RX] || rx_burst_done;
+	default:
+		return (!bus->waiting[MCP2515_PRIO_RX] || rx_burst_done) &&
+		       !bus->waiting[MCP2515_PRIO_TX];
+	}
+}
+
+static void mcp2515_bus_acquire(struct mcp2515_bus *bus, enum mcp2515_prio prio)
+{
+	u64 start_ns = ktime_get_ns(), ns;
+
+	spin_lock_irq(&bus->lock);
+	bus->waiting[prio]++;
+	wait_event_lock_irq(bus->wq, mcp2515_bus_may_take(bus, prio), bus->lock);
+	bus->waiting[prio]--;
+	bus->busy = true;
+	bus->rx_streak = prio == MCP2515_PRIO_RX ? bus->rx_streak + 1 : 0;
+	ns = ktime_get_ns() - start_ns;
+	bus->stats.grants[prio]++;
+	bus->stats.wait_ns[prio] += ns;
+	bus->stats.wait_max_ns[prio] = max(bus->stats.wait_max_ns[prio], ns);
+	spin_unlock_irq(&bus->lock);
+}
+
+static void mcp2515_bus_release(struct mcp2515_bus *bus)
+{
+	spin_lock_irq(&bus->lock);
+	bus->busy = false;
+	spin_unlock_irq(&bus->lock);
+	/* Few waiters, each re-checks its class against the others */
+	wake_up_all(&bus->wq);
+}
+
+static int mcp2515_bus_stats_show(struct seq_file *s, void *unused)
+{
+	struct mcp2515_bus *bus = s->private;
+	struct mcp2515_bus_stats st;
+	int i;
+
+	spin_lock_irq(&bus->lock);
+	st = bus->stats;
+	spin_unlock_irq(&bus->lock);
+
+	seq_printf(s, "devices: %u\n", READ_ONCE(bus->users));
+	seq_printf(s, "rx_frames: %lld\n", atomic64_read(&bus->rx_frames));
+	seq_printf(s, "tx_frames: %lld\n", atomic64_read(&bus->tx_frames));
+	seq_printf(s, "drops: %lld\n", atomic64_read(&bus->drops));
+	for (i = 0; i < MCP2515_PRIO_NUM; i++) {
+		seq_printf(s, "%s_grants: %llu\n", mcp2515_prio_names[i],
+			   st.grants[i]);
+		seq_printf(s, "%s_wait_ns_avg: %llu\n", mcp2515_prio_names[i],
+			   mcp2515_avg(st.wait_ns[i], st.grants[i]));
+		seq_printf(s, "%s_wait_ns_max: %llu\n", mcp2515_prio_names[i],
+			   st.wait_max_ns[i]);
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(mcp2515_bus_stats);
+
+/* The bus of spi's controller, created by its first MCP2515 */
+static struct mcp2515_bus *mcp2515_bus_get(struct spi_device *spi)
+{
+	struct mcp2515_bus *bus;
+
+	mutex_lock(&mcp2515_buses_lock);
+	list_for_each_entry(bus, &mcp2515_buses, node) {
+		if (bus->ctlr == spi->controller) {
+			bus->users++;
+			goto out;
+		}
+	}
+
+	bus = kzalloc(sizeof(*bus), GFP_KERNEL);
+	if (!bus)
+		goto out;
+	bus->ctlr = spi->controller;
+	bus->users = 1;
+	spin_lock_init(&bus->lock);
+	init_waitqueue_head(&bus->wq);
+	atomic64_set(&bus->rx_frames, 0);
+	atomic64_set(&bus->tx_frames, 0);
+	atomic64_set(&bus->drops, 0);
+	if (IS_ENABLED(CONFIG_DEBUG_FS)) {
+		char name[32];
+
+		snprintf(name, sizeof(name), "bus-%s", dev_name(&bus->ctlr->dev));
+		bus->debugfs = debugfs_create_dir(name, mcp2515_debugfs_root);
+		debugfs_create_file("stats", 0444, bus->debugfs, bus,
+				    &mcp2515_bus_stats_fops);
+	}
+	list_add(&bus->node, &mcp2515_buses);
+out:
+	mutex_unlock(&mcp2515_buses_lock);
+	return bus;
+}
+
+static void mcp2515_bus_put(struct mcp2515_bus *bus)
+{
+	mutex_lock(&mcp2515_buses_lock);
+	if (!--bus->users) {
+		list_del(&bus->node);
+		debugfs_remove_recursive(bus->debugfs);
+		kfree(bus);
+	}
+	mutex_unlock(&mcp2515_buses_lock);
+}
+
+static int mcp2515_sync(struct mcp2515_priv *priv, struct spi_message *msg,
+			enum mcp2515_prio prio)
+{
+	u64 start_ns;
+	int ret;
+
+	mcp2515_bus_acquire(priv->bus, prio);
+	start_ns = ktime_get_ns();
+	ret = spi_sync(priv->spi, msg);
+	priv->stats.spi_msgs++;
+	priv->stats.spi_ns += ktime_get_ns() - start_ns;
+	mcp2515_bus_release(priv->bus);
+	return ret;
+}
+
+static void mcp2515_xfer_fill(struct mcp2515_xfer *x, struct spi_message *msg,
+			      struct spi_transfer *t)
+{
+	memset(t, 0, 2 * sizeof(*t));
+	spi_message_init(msg);
+	t[0].tx_buf = x->tx;
+	t[0].rx_buf = x->rx;
+	t[0].len = x->len[0];
+	spi_message_add_tail(&t[0], msg);
+	if (x->len[1]) {
+		t[0].cs_change = 1;
+		t[1].tx_buf = x->tx + x->len[0];
+		t[1].len = x->len[1];
+		spi_message_add_tail(&t[1], msg);
+	}
+}
+
+/*
+ * Runs a hot sequence. Callers only change bytes in x->tx; with prebuilt=N
+ * the same transfers go out on a message set up here, as they would in a
+ * driver without prebuilt messages.
+ */
+static int mcp2515_run(struct mcp2515_priv *priv, enum mcp2515_seq seq)
+{
+	struct mcp2515_xfer *x = &priv->xfer[seq];
+	struct spi_transfer t[2];
+	struct spi_message msg;
+
+	lockdep_assert_held(&priv->lock);
+	if (READ_ONCE(prebuilt))
+		return mcp2515_sync(priv, &x->msg, mcp2515_seq_prio[seq]);
+	mcp2515_xfer_fill(x, &msg, t);
+	return mcp2515_sync(priv, &msg, mcp2515_seq_prio[seq]);
+}
+
+static int mcp2515_xfer_setup(struct mcp2515_priv *priv)
+{
+	static const struct {
+		u8 instr;
+		unsigned int len[2];
+	} seqs[MCP2515_SEQ_NUM] = {
+		[MCP2515_SEQ_STATUS]	= { MCP2515_INSTR_READ_STATUS, { 2, 0 } },
+		[MCP2515_SEQ_RXB0]	= { MCP2515_INSTR_READ_RXB(0), { 1 + MCP2515_BUF_LEN, 0 } },
+		[MCP2515_SEQ_RXB1]	= { MCP2515_INSTR_READ_RXB(1), { 1 + MCP2515_BUF_LEN, 0 } },
+		/* all 8 data bytes are loaded whatever the DLC: fixed length */
+		[MCP2515_SEQ_TX]	= { MCP2515_INSTR_LOAD_TXB(0), { 1 + MCP2515_BUF_LEN, 1 } },
+		[MCP2515_SEQ_CLR_INTF]	= { MCP2515_INSTR_BIT_MODIFY, { 4, 0 } },
+	};
+	int i, ret;
+
+	for (i = 0; i < MCP2515_SEQ_NUM; i++) {
+		struct mcp2515_xfer *x = &priv->xfer[i];
+
+		x->tx[0] = seqs[i].instr;
+		x->len[0] = seqs[i].len[0];
+		x->len[1] = seqs[i].len[1];
+		mcp2515_xfer_fill(x, &x->msg, x->t);
+	}
+	priv->xfer[MCP2515_SEQ_TX].tx[1 + MCP2515_BUF_LEN] = MCP2515_INSTR_RTS(0);
+	priv->xfer[MCP2515_SEQ_CLR_INTF].tx[1] = MCP2515_CANINTF;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 10, 0)
+	/* Validation and DMA mapping decisions done once, not per frame */
+	for (i = 0; i < MCP2515_SEQ_NUM; i++) {
+		ret = spi_optimize_message(priv->spi, &priv->xfer[i].msg);
+		if (ret) {
+			while (--i >= 0)
+				spi_unoptimize_message(&priv->xfer[i].msg);
+			return ret;
+		}
+	}
+#else
+	ret = 0;
+#endif
+	return ret;
+}
+
+static void mcp2515_xfer_release(struct mcp2515_priv *priv)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 10, 0)
+	int i;
+
+	for (i = 0; i < MCP2515_SEQ_NUM; i++)
+		spi_unoptimize_message(&priv->xfer[i].msg);
+#endif
+}
+
+static struct mcp2515_batch *mcp2515_batch_begin(struct mcp2515_priv *priv)
+{
+	struct mcp2515_batch *b = priv->batch;
+
+	lockdep_assert_held(&priv->lock);
+	b->n_ops = 0;
+	b->n_reads = 0;
+	b->used = 0;
+	b->err = 0;
+	return b;
+}
+
+/*
+ * Room for len data bytes of instr at reg. READ and WRITE auto-increment
+ * the address, so an access that continues the previous one of the same
+ * kind is merged into it; anything else starts a new instruction.
+ * Returns the offset of the data bytes in tx/rx, or -ENOSPC.
+ */
+static int mcp2515_batch_add(struct mcp2515_batch *b, u8 instr, u8 reg,
+			     unsigned int len)
+{
+	unsigned int head = instr == MCP2515_INSTR_RESET ? 1 : 2;
+	unsigned int last = b->n_ops - 1;
+	int offset;
+
+	if (b->n_ops && b->instr[last] == instr &&
+	    (instr == MCP2515_INSTR_READ || instr == MCP2515_INSTR_WRITE) &&
+	    b->reg[last] + b->t[last].len - 2 == reg &&
+	    b->used + len <= MCP2515_BATCH_BYTES) {
+		offset = b->used;
+		b->t[last].len += len;
+		b->used += len;
+		return offset;
+	}
+	if (b->n_ops == MCP2515_BATCH_OPS ||
+	    b->used + head + len > MCP2515_BATCH_BYTES) {
+		b->err = -ENOSPC;
+		return -ENOSPC;
+	}
+
+	memset(&b->t[b->n_ops], 0, sizeof(b->t[0]));
+	b->t[b->n_ops].tx_buf = b->tx + b->used;
+	b->t[b->n_ops].rx_buf = b->rx + b->used;
+	b->t[b->n_ops].len = head + len;
+	b->instr[b->n_ops] = instr;
+	b->reg[b->n_ops] = reg;
+	b->tx[b->used] = instr;
+	if (head > 1)
+		b->tx[b->used + 1] = reg;
+	b->n_ops++;
+	offset = b->used + head;
+	b->used += head + len;
+	return offset;
+}
+
+static void mcp2515_batch_read(struct mcp2515_batch *b, u8 reg, u8 *val,
+			       unsigned int len)
+{
+	int offset;
+
+	/* A merged read takes no new op, but still needs its own reads[] slot */
+	if (b->n_reads == ARRAY_SIZE(b->reads)) {
+		b->err = -ENOSPC;
+		return;
+	}
+	offset = mcp2515_batch_add(b, MCP2515_INSTR_READ, reg, len);
+	if (offset < 0)
+		return;
+	memset(b->tx + offset, 0, len);
+	b->reads[b->n_reads].offset = offset;
+	b->reads[b->n_reads].len = len;
+	b->reads[b->n_reads].dest = val;
+	b->n_reads++;
+}
+
+static void mcp2515_batch_write(struct mcp2515_batch *b, u8 reg, const u8 *val,
+				unsigned int len)
+{
+	int offset = mcp2515_batch_add(b, MCP2515_INSTR_WRITE, reg, len);
+
+	if (offset >= 0)
+		memcpy(b->tx + offset, val, len);
+}
+
+static void mcp2515_batch_write_reg(struct mcp2515_batch *b, u8 reg, u8 val)
+{
+	mcp2515_batch_write(b, reg, &val, 1);
+}
+
+static void mcp2515_batch_modify(struct mcp2515_batch *b, u8 reg, u8 mask,
+				 u8 val)
+{
+	int offset = mcp2515_batch_add(b, MCP2515_INSTR_BIT_MODIFY, reg, 2);
+
+	if (offset < 0)
+		return;
+	b->tx[offset] = mask;
+	b->tx[offset + 1] = val;
+}
+
+static void mcp2515_batch_reset(struct mcp2515_batch *b)
+{
+	mcp2515_batch_add(b, MCP2515_INSTR_RESET, 0, 0);
+}
+
+/* All instructions of the batch as one message, CS released between them */
+static int mcp2515_batch_run(struct mcp2515_priv *priv)
+{
+	struct mcp2515_batch *b = priv->batch;
+	unsigned int i;
+	int ret;
+
+	if (b->err)
+		return b->err;
+	if (!b->n_ops)
+		return 0;
+
+	spi_message_init(&b->msg);
+	for (i = 0; i < b->n_ops; i++) {
+		b->t[i].cs_change = i + 1 < b->n_ops;
+		spi_message_add_tail(&b->t[i], &b->msg);
+	}
+	ret = mcp2515_sync(priv, &b->msg, MCP2515_PRIO_HOUSEKEEPING);
+	if (ret)
+		return ret;
+	for (i = 0; i < b->n_reads; i++)
+		memcpy(b->reads[i].dest, b->rx + b->reads[i].offset,
+		       b->reads[i].len);
+	return 0;
+}
+
+static int mcp2515_read_reg(struct mcp2515_priv *priv, u8 reg, u8 *val)
+{
+	mcp2515_batch_read(mcp2515_batch_begin(priv), reg, val, 1);
+	return mcp2515_batch_run(priv);
+}
+
+static int mcp2515_set_mode(struct mcp2515_priv *priv, u8 reqop)
+{
+	u8 canstat = 0;
+	int ret;
+
+	mcp2515_batch_modify(mcp2515_batch_begin(priv), MCP2515_CANCTRL,
+			     MCP2515_CANCTRL_REQOP, reqop);
+	ret = mcp2515_batch_run(priv);
+	if (ret)
+		return ret;
+
+	/* The mode changes once the bus is idle */
+	return read_poll_timeout(mcp2515_read_reg, ret,
+				 ret || (canstat & MCP2515_CANSTAT_OPMOD) == reqop,
+				 100, MCP2515_MODE_TIMEOUT_US, false,
+				 priv, MCP2515_CANSTAT, &canstat) ?: ret;
+}
+
+static int mcp2515_hw_reset(struct mcp2515_priv *priv)
+{
+	u8 canctrl;
+	int ret;
+
+	mcp2515_batch_reset(mcp2515_batch_begin(priv));
+	ret = mcp2515_batch_run(priv);
+	if (ret)
+		return ret;
+	fsleep(MCP2515_OST_DELAY_US);
+
+	ret = mcp2515_read_reg(priv, MCP2515_CANCTRL, &canctrl);
+	if (ret)
+		return ret;
+	return canctrl == MCP2515_CANCTRL_RESET ? 0 : -ENODEV;
+}
+
+/* Called with priv->lock held */
+static int mcp2515_hw_start(struct mcp2515_priv *priv)
+{
+	const struct can_bittiming *bt = &priv->can.bittiming;
+	struct mcp2515_batch *b;
+	u8 cnf[3], reqop;
+	int ret;
+
+	ret = mcp2515_hw_reset(priv);
+	if (ret)
+		return ret;
+
+	mcp2515_bittiming_to_cnf(bt->brp, bt->sjw, bt->prop_seg,
+				 bt->phase_seg1, bt->phase_seg2,
+				 priv->can.ctrlmode & CAN_CTRLMODE_3_SAMPLES,
+				 cnf);
+	/*
+	 * CNF3, CNF2, CNF1 and CANINTE are 0x28..0x2b: one WRITE. The two
+	 * receive buffer controls follow as two more instructions of the
+	 * same message.
+	 */
+	b = mcp2515_batch_begin(priv);
+	mcp2515_batch_write_reg(b, MCP2515_CNF3, cnf[0]);
+	mcp2515_batch_write_reg(b, MCP2515_CNF2, cnf[1]);
+	mcp2515_batch_write_reg(b, MCP2515_CNF1, cnf[2]);
+	mcp2515_batch_write_reg(b, MCP2515_CANINTE,
+				MCP2515_INT_RX0I | MCP2515_INT_RX1I |
+				MCP2515_INT_TX0I | MCP2515_INT_ERRI |
+				MCP2515_INT_MERR);
+	mcp2515_batch_write_reg(b, MCP2515_RXB0CTRL,
+				MCP2515_RXB_RXM_ANY | MCP2515_RXB0CTRL_BUKT);
+	mcp2515_batch_write_reg(b, MCP2515_RXB1CTRL, MCP2515_RXB_RXM_ANY);
+	ret = mcp2515_batch_run(priv);
+	if (ret)
+		return ret;
+
+	if (priv->can.ctrlmode & CAN_CTRLMODE_LOOPBACK)
+		reqop = MCP2515_CANCTRL_REQOP_LOOPBACK;
+	else if (priv->can.ctrlmode & CAN_CTRLMODE_LISTENONLY)
+		reqop = MCP2515_CANCTRL_REQOP_LISTEN;
+	else
+		reqop = MCP2515_CANCTRL_REQOP_NORMAL;
+	ret = mcp2515_set_mode(priv, reqop);
+	if (ret)
+		return ret;
+
+	priv->can.state = CAN_STATE_ERROR_ACTIVE;
+	return 0;
+}
+
+/* Called with priv->lock held */
+static void mcp2515_hw_stop(struct mcp2515_priv *priv)
+{
+	mcp2515_batch_write_reg(mcp2515_batch_begin(priv), MCP2515_CANINTE, 0);
+	mcp2515_batch_run(priv);
+	mcp2515_set_mode(priv, MCP2515_CANCTRL_REQOP_CONFIG);
+	priv->can.state = CAN_STATE_STOPPED;
+}
+
+static void mcp2515_tx_work(struct kthread_work *work)
+{
+	struct mcp2515_priv *priv = container_of(work, struct mcp2515_priv,
+						 tx_work);
+	struct mcp2515_xfer *x = &priv->xfer[MCP2515_SEQ_TX];
+	struct net_device *net = priv->net;
+	struct sk_buff *skb;
+	u64 start_ns;
+
+	mutex_lock(&priv->lock);
+	skb = priv->tx_skb;
+	priv->tx_skb = NULL;
+	if (!skb || priv->can.state == CAN_STATE_BUS_OFF) {
+		if (skb) {
+			net->stats.tx_dropped++;
+			dev_kfree_skb(skb);
+		}
+		mutex_unlock(&priv->lock);
+		return;
+	}
+
+	mcp2515_frame_to_buf((struct can_frame *)skb->data, x->tx + 1);
+	start_ns = ktime_get_ns();
+	if (mcp2515_run(priv, MCP2515_SEQ_TX)) {
+		net->stats.tx_errors++;
+		dev_kfree_skb(skb);
+		netif_wake_queue(net);
+	} else {
+		priv->stats.tx_spi_ns += ktime_get_ns() - start_ns;
+		/* TX0IF cannot be handled before this: same worker as the IRQ */
+		can_put_echo_skb(skb, net, 0, 0);
+	}
+	mutex_unlock(&priv->lock);
+}
+
+static netdev_tx_t mcp2515_start_xmit(struct sk_buff *skb,
+				      struct net_device *net)
+{
+	struct mcp2515_priv *priv = netdev_priv(net);
+
+	if (can_dev_dropped_skb(net, skb))
+		return NETDEV_TX_OK;
+
+	/* One transmit buffer: the queue restarts on TX0IF */
+	netif_stop_queue(net);
+	priv->tx_skb = skb;
+	priv->tx_start_ns = ktime_get_ns();
+	kthread_queue_work(priv->worker, &priv->tx_work);
+	return NETDEV_TX_OK;
+}
+
+static void mcp2515_rx(struct mcp2515_priv *priv, int n)
+{
+	enum mcp2515_seq seq = n ? MCP2515_SEQ_RXB1 : MCP2515_SEQ_RXB0;
+	struct net_device *net = priv->net;
+	struct can_frame *cf;
+	struct sk_buff *skb;
+	u64 start_ns, ns;
+	int ret;
+
+	skb = alloc_can_skb(net, &cf);
+	/* The buffer is read even without an skb: that is what releases it */
+	start_ns = ktime_get_ns();
+	ret = mcp2515_run(priv, seq);
+	priv->stats.rx_spi_ns += ktime_get_ns() - start_ns;
+	if (!skb || ret) {
+		net->stats.rx_dropped++;
+		atomic64_inc(&priv->bus->drops);
+		kfree_skb(skb);
+		return;
+	}
+
+	mcp2515_buf_to_frame(priv->xfer[seq].rx + 1, cf);
+	net->stats.rx_packets++;
+	if (!(cf->can_id & CAN_RTR_FLAG))
+		net->stats.rx_bytes += cf->len;
+	netif_rx(skb);
+
+	ns = ktime_get_ns() - priv->irq_ns;
+	priv->stats.rx_frames++;
+	priv->stats.rx_ns += ns;
+	priv->stats.rx_max_ns = max(priv->stats.rx_max_ns, ns);
+	atomic64_inc(&priv->bus->rx_frames);
+}
+
+static void mcp2515_tx_done(struct mcp2515_priv *priv)
+{
+	struct mcp2515_xfer *x = &priv->xfer[MCP2515_SEQ_CLR_INTF];
+	struct net_device *net = priv->net;
+	u64 ns;
+
+	x->tx[2] = MCP2515_INT_TX0I;
+	x->tx[3] = 0;
+	mcp2515_run(priv, MCP2515_SEQ_CLR_INTF);
+
+	net->stats.tx_bytes += can_get_echo_skb(net, 0, NULL);
+	net->stats.tx_packets++;
+	ns = ktime_get_ns() - priv->tx_start_ns;
+	priv->stats.tx_frames++;
+	priv->stats.tx_ns += ns;
+	priv->stats.tx_max_ns = max(priv->stats.tx_max_ns, ns);
+	atomic64_inc(&priv->bus->tx_frames);
+	netif_wake_queue(net);
+}
+
+static enum can_state mcp2515_eflg_state(u8 eflg, u8 bo, u8 passive, u8 warn)
+{
+	if (eflg & bo)
+		return CAN_STATE_BUS_OFF;
+	if (eflg & passive)
+		return CAN_STATE_ERROR_PASSIVE;
+	if (eflg & warn)
+		return CAN_STATE_ERROR_WARNING;
+	return CAN_STATE_ERROR_ACTIVE;
+}
+
+/* Error interrupts: nothing on the RX/TX fast path comes through here */
+static void mcp2515_error(struct mcp2515_priv *priv, u8 intf, u8 eflg,
+			  const u8 *tec_rec)
+{
+	struct net_device *net = priv->net;
+	enum can_state tx_state, rx_state;
+	struct can_frame *cf = NULL;
+	struct sk_buff *skb;
+	bool report = false;
+
+	tx_state = mcp2515_eflg_state(eflg, MCP2515_EFLG_TXBO,
+				      MCP2515_EFLG_TXEP, MCP2515_EFLG_TXWAR);
+	rx_state = mcp2515_eflg_state(eflg, 0, MCP2515_EFLG_RXEP,
+				      MCP2515_EFLG_RXWAR);
+
+	skb = alloc_can_err_skb(net, &cf);
+	if (max(tx_state, rx_state) != priv->can.state) {
+		can_change_state(net, cf, tx_state, rx_state);
+		report = true;
+	}
+	if (eflg & (MCP2515_EFLG_RX0OVR | MCP2515_EFLG_RX1OVR)) {
+		net->stats.rx_over_errors++;
+		net->stats.rx_errors++;
+		atomic64_inc(&priv->bus->drops);
+		if (cf) {
+			cf->can_id |= CAN_ERR_CRTL;
+			cf->data[1] |= CAN_ERR_CRTL_RX_OVERFLOW;
+		}
+		report = true;
+	}
+	/* MERRF: a frame was corrupted on the bus, either direction */
+	if (intf & MCP2515_INT_MERR)
+		priv->can.can_stats.bus_error++;
+	if (skb && report) {
+		cf->can_id |= CAN_ERR_CNT;
+		cf->data[6] = tec_rec[0];
+		cf->data[7] = tec_rec[1];
+		netif_rx(skb);
+	} else {
+		kfree_skb(skb);
+	}
+
+	if (priv->can.state == CAN_STATE_BUS_OFF) {
+		mcp2515_batch_write_reg(mcp2515_batch_begin(priv),
+					MCP2515_CANINTE, 0);
+		mcp2515_batch_run(priv);
+		can_bus_off(net);
+	}
+}
+
+/*
+ * The line stays masked until the worker has drained the controller, as
+ * with a oneshot threaded IRQ, but the bottom half runs on the device's
+ * own worker: GPIO interrupt lines rarely allow their affinity to be set,
+ * a kthread always can.
+ */
+static irqreturn_t mcp2515_hardirq(int irq, void *dev_id)
+{
+	struct mcp2515_priv *priv = dev_id;
+
+	priv->irq_ns = ktime_get_ns();
+	disable_irq_nosync(irq);
+	kthread_queue_work(priv->worker, &priv->irq_work);
+	return IRQ_HANDLED;
+}
+
+/* Called with priv->lock held: runs until the controller has nothing pending */
+static void mcp2515_handle_irq(struct mcp2515_priv *priv)
+{
+	struct mcp2515_xfer *status = &priv->xfer[MCP2515_SEQ_STATUS];
+	struct mcp2515_batch *b;
+	u8 intf_eflg[2], tec_rec[2];
+
+	priv->stats.irqs++;
+	while (priv->can.state != CAN_STATE_BUS_OFF) {
+		u8 stat;
+
+		/* Fast path: one 2-byte READ STATUS tells RX and TX apart */
+		if (mcp2515_run(priv, MCP2515_SEQ_STATUS))
+			break;
+		stat = status->rx[1];
+		if (stat & MCP2515_STAT_RX0IF)
+			mcp2515_rx(priv, 0);
+		if (stat & MCP2515_STAT_RX1IF)
+			mcp2515_rx(priv, 1);
+		if (stat & MCP2515_STAT_TX0IF)
+			mcp2515_tx_done(priv);
+		if (stat & (MCP2515_STAT_RX0IF | MCP2515_STAT_RX1IF |
+			    MCP2515_STAT_TX0IF))
+			continue;
+
+		/* Slow path: CANINTF+EFLG and TEC+REC, two READs in one message */
+		b = mcp2515_batch_begin(priv);
+		mcp2515_batch_read(b, MCP2515_CANINTF, intf_eflg, 2);
+		mcp2515_batch_read(b, MCP2515_TEC, tec_rec, 2);
+		if (mcp2515_batch_run(priv))
+			break;
+		if (!(intf_eflg[0] & ~(MCP2515_INT_RX0I | MCP2515_INT_RX1I |
+				       MCP2515_INT_TX0I)))
+			break;
+
+		mcp2515_error(priv, intf_eflg[0], intf_eflg[1], tec_rec);
+		b = mcp2515_batch_begin(priv);
+		mcp2515_batch_modify(b, MCP2515_EFLG, MCP2515_EFLG_RX0OVR |
+				     MCP2515_EFLG_RX1OVR, 0);
+		mcp2515_batch_modify(b, MCP2515_CANINTF,
+				     (u8)~(MCP2515_INT_RX0I | MCP2515_INT_RX1I |
+					   MCP2515_INT_TX0I), 0);
+		if (mcp2515_batch_run(priv))
+			break;
+	}
+}
+
+static void mcp2515_irq_work(struct kthread_work *work)
+{
+	struct mcp2515_priv *priv = container_of(work, struct mcp2515_priv,
+						 irq_work);
+
+	mutex_lock(&priv->lock);
+	mcp2515_handle_irq(priv);
+	mutex_unlock(&priv->lock);
+	enable_irq(priv->spi->irq);
+}
+
+static void mcp2515_restart_work(struct kthread_work *work)
+{
+	struct mcp2515_priv *priv = container_of(work, struct mcp2515_priv,
+						 restart_work);
+	int ret;
+
+	mutex_lock(&priv->lock);
+	ret = mcp2515_hw_start(priv);
+	mutex_unlock(&priv->lock);
+	if (ret) {
+		netdev_err(priv->net, "restart failed: %d\n", ret);
+		return;
+	}
+	netif_wake_queue(priv->net);
+}
+
+static int mcp2515_do_set_mode(struct net_device *net, enum can_mode mode)
+{
+	struct mcp2515_priv *priv = netdev_priv(net);
+
+	if (mode != CAN_MODE_START)
+		return -EOPNOTSUPP;
+	kthread_queue_work(priv->worker, &priv->restart_work);
+	return 0;
+}
+
+static int mcp2515_open(struct net_device *net)
+{
+	struct mcp2515_priv *priv = netdev_priv(net);
+	int ret;
+
+	ret = open_candev(net);
+	if (ret)
+		return ret;
+
+	/* Trigger type comes from the device tree */
+	ret = request_irq(priv->spi->irq, mcp2515_hardirq, 0,
+			  dev_name(&priv->spi->dev), priv);
+	if (ret) {
+		netdev_err(net, "failed to request IRQ %d: %d\n",
+			   priv->spi->irq, ret);
+		goto err_close;
+	}
+
+	mutex_lock(&priv->lock);
+	ret = mcp2515_hw_start(priv);
+	mutex_unlock(&priv->lock);
+	if (ret)
+		goto err_irq;
+
+	netif_start_queue(net);
+	return 0;
+
+err_irq:
+	free_irq(priv->spi->irq, priv);
+err_close:
+	close_candev(net);
+	return ret;
+}
+
+static int mcp2515_stop(struct net_device *net)
+{
+	struct mcp2515_priv *priv = netdev_priv(net);
+
+	netif_stop_queue(net);
+	/* A queued irq_work re-enables the line: let it run before freeing */
+	disable_irq(priv->spi->irq);
+	kthread_flush_work(&priv->irq_work);
+	free_irq(priv->spi->irq, priv);
+	kthread_cancel_work_sync(&priv->tx_work);
+	kthread_cancel_work_sync(&priv->restart_work);
+
+	mutex_lock(&priv->lock);
+	mcp2515_hw_stop(priv);
+	if (priv->tx_skb) {
+		dev_kfree_skb(priv->tx_skb);
+		priv->tx_skb = NULL;
+	}
+	can_free_echo_skb(net, 0, NULL);
+	mutex_unlock(&priv->lock);
+
+	close_candev(net);
+	return 0;
+}
+
+static const struct net_device_ops mcp2515_netdev_ops = {
+	.ndo_open = mcp2515_open,
+	.ndo_stop = mcp2515_stop,
+	.ndo_start_xmit = mcp2515_start_xmit,
+	.ndo_change_mtu = can_change_mtu,
+};
+
+static int mcp2515_stats_show(struct seq_file *s, void *unused)
+{
+	struct mcp2515_priv *priv = s->private;
+	struct mcp2515_stats st;
+
+	mutex_lock(&priv->lock);
+	st = priv->stats;
+	mutex_unlock(&priv->lock);
+
+	seq_printf(s, "prebuilt: %d\n", READ_ONCE(prebuilt));
+	seq_printf(s, "bus: %s\n", dev_name(&priv->bus->ctlr->dev));
+	seq_printf(s, "irq_cpu: %d\n", READ_ONCE(priv->irq_cpu));
+	seq_printf(s, "irqs: %llu\n", st.irqs);
+	seq_printf(s, "spi_msgs: %llu\n", st.spi_msgs);
+	seq_printf(s, "spi_ns: %llu\n", st.spi_ns);
+	seq_printf(s, "spi_ns_avg: %llu\n", mcp2515_avg(st.spi_ns, st.spi_msgs));
+	seq_printf(s, "tx_frames: %llu\n", st.tx_frames);
+	seq_printf(s, "tx_ns: %llu\n", st.tx_ns);
+	seq_printf(s, "tx_ns_avg: %llu\n", mcp2515_avg(st.tx_ns, st.tx_frames));
+	seq_printf(s, "tx_ns_max: %llu\n", st.tx_max_ns);
+	seq_printf(s, "tx_spi_ns: %llu\n", st.tx_spi_ns);
+	seq_printf(s, "rx_frames: %llu\n", st.rx_frames);
+	seq_printf(s, "rx_ns: %llu\n", st.rx_ns);
+	seq_printf(s, "rx_ns_avg: %llu\n", mcp2515_avg(st.rx_ns, st.rx_frames));
+	seq_printf(s, "rx_ns_max: %llu\n", st.rx_max_ns);
+	seq_printf(s, "rx_spi_ns: %llu\n", st.rx_spi_ns);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(mcp2515_stats);
+
+static ssize_t irq_cpu_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct mcp2515_priv *priv = spi_get_drvdata(to_spi_device(dev));
+
+	return sysfs_emit(buf, "%d\n", READ_ONCE(priv->irq_cpu));
+}
+
+/* CPU for the device's worker, -1 for any */
+static ssize_t irq_cpu_store(struct device *dev, struct device_attribute *attr,
+			     const char *buf, size_t count)
+{
+	struct mcp2515_priv *priv = spi_get_drvdata(to_spi_device(dev));
+	const struct cpumask *mask;
+	int cpu, ret;
+
+	ret = kstrtoint(buf, 0, &cpu);
+	if (ret)
+		return ret;
+	if (cpu < 0) {
+		cpu = -1;
+		mask = cpu_possible_mask;
+	} else if (cpu >= nr_cpu_ids || !cpu_online(cpu)) {
+		return -EINVAL;
+	} else {
+		mask = cpumask_of(cpu);
+	}
+	ret = set_cpus_allowed_ptr(priv->worker->task, mask);
+	if (ret)
+		return ret;
+	WRITE_ONCE(priv->irq_cpu, cpu);
+	return count;
+}
+static DEVICE_ATTR_RW(irq_cpu);
+
+static struct attribute *mcp2515_attrs[] = {
+	&dev_attr_irq_cpu.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(mcp2515);
+
+static int mcp2515_probe(struct spi_device *spi)
+{
+	struct mcp2515_priv *priv;
+	struct net_device *net;
+	struct clk *clk;
+	u32 freq = 0;
+	int ret;
+
+	clk = devm_clk_get_optional_enabled(&spi->dev, NULL);
+	if (IS_ERR(clk))
+		return dev_err_probe(&spi->dev, PTR_ERR(clk), "failed to get clock\n");
+	if (clk)
+		freq = clk_get_rate(clk);
+	if (!freq)
+		device_property_read_u32(&spi->dev, "clock-frequency", &freq);
+	if (freq < MCP2515_OSC_MIN || freq > MCP2515_OSC_MAX)
+		return dev_err_probe(&spi->dev, -ERANGE,
+				     "oscillator %u Hz out of range\n", freq);
+
+	spi->bits_per_word = 8;
+	spi->mode = SPI_MODE_0;
+	if (!spi->max_speed_hz || spi->max_speed_hz > MCP2515_SPI_HZ_MAX)
+		spi->max_speed_hz = MCP2515_SPI_HZ_MAX;
+	ret = spi_setup(spi);
+	if (ret)
+		return ret;
+
+	net = alloc_candev(sizeof(*priv), 1);
+	if (!net)
+		return -ENOMEM;
+	priv = netdev_priv(net);
+	priv->net = net;
+	priv->spi = spi;
+	priv->can.clock.freq = freq / 2;
+	priv->can.bittiming_const = &mcp2515_bittiming_const;
+	priv->can.do_set_mode = mcp2515_do_set_mode;
+	priv->can.ctrlmode_supported = CAN_CTRLMODE_3_SAMPLES |
+				       CAN_CTRLMODE_LOOPBACK |
+				       CAN_CTRLMODE_LISTENONLY;
+	net->netdev_ops = &mcp2515_netdev_ops;
+	net->flags |= IFF_ECHO;
+	SET_NETDEV_DEV(net, &spi->dev);
+	mutex_init(&priv->lock);
+	kthread_init_work(&priv->irq_work, mcp2515_irq_work);
+	kthread_init_work(&priv->tx_work, mcp2515_tx_work);
+	kthread_init_work(&priv->restart_work, mcp2515_restart_work);
+	priv->irq_cpu = -1;
+	spi_set_drvdata(spi, priv);
+
+	/* kmalloc memory: the transfer buffers in them are DMA safe */
+	priv->xfer = devm_kcalloc(&spi->dev, MCP2515_SEQ_NUM,
+				  sizeof(*priv->xfer), GFP_KERNEL);
+	priv->batch = devm_kzalloc(&spi->dev, sizeof(*priv->batch), GFP_KERNEL);
+	if (!priv->xfer || !priv->batch) {
+		ret = -ENOMEM;
+		goto err_free;
+	}
+	priv->bus = mcp2515_bus_get(spi);
+	if (!priv->bus) {
+		ret = -ENOMEM;
+		goto err_free;
+	}
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 14, 0)
+	priv->worker = kthread_run_worker(0, "mcp2515-%s", dev_name(&spi->dev));
+#else
+	priv->worker = kthread_create_worker(0, "mcp2515-%s", dev_name(&spi->dev));
+#endif
+	if (IS_ERR(priv->worker)) {
+		ret = PTR_ERR(priv->worker);
+		goto err_bus;
+	}
+	/* Same class as the IRQ thread it replaces */
+	sched_set_fifo(priv->worker->task);
+	ret = mcp2515_xfer_setup(priv);
+	if (ret)
+		goto err_worker;
+
+	mutex_lock(&priv->lock);
+	ret = mcp2515_hw_reset(priv);
+	mutex_unlock(&priv->lock);
+	if (ret) {
+		dev_err_probe(&spi->dev, ret, "MCP2515 not found\n");
+		goto err_xfer;
+	}
+
+	ret = register_candev(net);
+	if (ret)
+		goto err_xfer;
+
+	if (IS_ENABLED(CONFIG_DEBUG_FS)) {
+		priv->debugfs = debugfs_create_dir(dev_name(&spi->dev),
+						   mcp2515_debugfs_root);
+		debugfs_create_file("stats", 0444, priv->debugfs, priv,
+				    &mcp2515_stats_fops);
+	}
+
+	netdev_info(net, "MCP2515 on %s, %u Hz oscillator, SPI %u Hz, bus %s\n",
+		    dev_name(&spi->dev), freq, spi->max_speed_hz,
+		    dev_name(&priv->bus->ctlr->dev));
+	return 0;
+
+err_xfer:
+	mcp2515_xfer_release(priv);
+err_worker:
+	kthread_destroy_worker(priv->worker);
+err_bus:
+	mcp2515_bus_put(priv->bus);
+err_free:
+	free_candev(net);
+	return ret;
+}
+
+static void mcp2515_remove(struct spi_device *spi)
+{
+	struct mcp2515_priv *priv = spi_get_drvdata(spi);
+
+	unregister_candev(priv->net);
+	debugfs_remove_recursive(priv->debugfs);
+	mcp2515_xfer_release(priv);
+	kthread_destroy_worker(priv->worker);
+	mcp2515_bus_put(priv->bus);
+	free_candev(priv->net);
+}
+
+static const struct of_device_id mcp2515_of_match[] = {
+	{ .compatible = "microchip,mcp2515" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, mcp2515_of_match);
+
+static const struct spi_device_id mcp2515_id_table[] = {
+	{ "mcp2515" },
+	{ }
+};
+MODULE_DEVICE_TABLE(spi, mcp2515_id_table);
+
+static struct spi_driver mcp2515_driver = {
+	.driver = {
+		.name = DEVICE_NAME,
+		.of_match_table = mcp2515_of_match,
+		.dev_groups = mcp2515_groups,
+	},
+	.id_table = mcp2515_id_table,
+	.probe = mcp2515_probe,
+	.remove = mcp2515_remove,
+};
+
+static int __init mcp2515_init(void)
+{
+	int ret;
+
+	/* Per-device and per-bus directories go below /sys/kernel/debug/mcp2515 */
+	mcp2515_debugfs_root = debugfs_create_dir(DEVICE_NAME, NULL);
+	ret = spi_register_driver(&mcp2515_driver);
+	if (ret)
+		debugfs_remove_recursive(mcp2515_debugfs_root);
+	return ret;
+}
+module_init(mcp2515_init);
+
+static void __exit mcp2515_exit(void)
+{
+	spi_unregister_driver(&mcp2515_driver);
+	debugfs_remove_recursive(mcp2515_debugfs_root);
+}
+module_exit(mcp2515_exit);
+
+/* The tests reach the static functions above, so they are built in here */
+#if IS_ENABLED(CONFIG_MCP2515_KUNIT_TEST)
+#include "mcp2515_kunit.c"
+#endif
 
-/* Driver code will go here */
+MODULE_DESCRIPTION("Microchip MCP2515 CAN controller driver");
+MODULE_LICENSE("GPL");
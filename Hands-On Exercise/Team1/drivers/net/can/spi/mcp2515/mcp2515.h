@@ -0,0 +1,149 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Microchip MCP2515 CAN controller - registers, SPI instructions and the
+ * frame <-> buffer encoding. The helpers here touch no hardware so they can
+ * be unit tested on their own.
+ */
+#ifndef _MCP2515_H
+#define _MCP2515_H
+
+#include <linux/bits.h>
+#include <linux/can.h>
+#include <linux/can/length.h>
+#include <linux/minmax.h>
+#include <linux/string.h>
+#include <linux/types.h>
+
+/* SPI instructions */
+#define MCP2515_INSTR_RESET		0xc0
+#define MCP2515_INSTR_READ		0x03
+#define MCP2515_INSTR_READ_RXB(n)	(0x90 | ((n) << 2))	/* from RXBnSIDH */
+#define MCP2515_INSTR_WRITE		0x02
+#define MCP2515_INSTR_LOAD_TXB(n)	(0x40 | ((n) << 1))	/* from TXBnSIDH */
+#define MCP2515_INSTR_RTS(n)		(0x80 | BIT(n))
+#define MCP2515_INSTR_READ_STATUS	0xa0
+#define MCP2515_INSTR_BIT_MODIFY	0x05
+
+/* READ STATUS result */
+#define MCP2515_STAT_RX0IF		BIT(0)
+#define MCP2515_STAT_RX1IF		BIT(1)
+#define MCP2515_STAT_TX0IF		BIT(3)
+
+/* Registers */
+#define MCP2515_CANSTAT			0x0e
+#define MCP2515_CANSTAT_OPMOD		GENMASK(7, 5)
+#define MCP2515_CANCTRL			0x0f
+#define MCP2515_CANCTRL_REQOP		GENMASK(7, 5)
+#define MCP2515_CANCTRL_REQOP_NORMAL	0x00
+#define MCP2515_CANCTRL_REQOP_SLEEP	0x20
+#define MCP2515_CANCTRL_REQOP_LOOPBACK	0x40
+#define MCP2515_CANCTRL_REQOP_LISTEN	0x60
+#define MCP2515_CANCTRL_REQOP_CONFIG	0x80
+#define MCP2515_CANCTRL_RESET		0x87	/* config mode, CLKOUT /8 */
+#define MCP2515_TEC			0x1c
+#define MCP2515_REC			0x1d
+#define MCP2515_CNF3			0x28
+#define MCP2515_CNF2			0x29
+#define MCP2515_CNF2_BTLMODE		BIT(7)
+#define MCP2515_CNF2_SAM		BIT(6)
+#define MCP2515_CNF1			0x2a
+#define MCP2515_CANINTE			0x2b
+#define MCP2515_CANINTF			0x2c
+#define MCP2515_INT_RX0I		BIT(0)
+#define MCP2515_INT_RX1I		BIT(1)
+#define MCP2515_INT_TX0I		BIT(2)
+#define MCP2515_INT_ERRI		BIT(5)
+#define MCP2515_INT_MERR		BIT(7)
+#define MCP2515_EFLG			0x2d
+#define MCP2515_EFLG_EWARN		BIT(0)
+#define MCP2515_EFLG_RXWAR		BIT(1)
+#define MCP2515_EFLG_TXWAR		BIT(2)
+#define MCP2515_EFLG_RXEP		BIT(3)
+#define MCP2515_EFLG_TXEP		BIT(4)
+#define MCP2515_EFLG_TXBO		BIT(5)
+#define MCP2515_EFLG_RX0OVR		BIT(6)
+#define MCP2515_EFLG_RX1OVR		BIT(7)
+#define MCP2515_TXB0CTRL		0x30
+#define MCP2515_RXB0CTRL		0x60
+#define MCP2515_RXB0CTRL_BUKT		BIT(2)	/* roll over into RXB1 */
+#define MCP2515_RXB_RXM_ANY		GENMASK(6, 5)	/* filters off */
+#define MCP2515_RXB1CTRL		0x70
+
+/* SIDH SIDL EID8 EID0 DLC D0..D7, as READ RX / LOAD TX BUFFER move them */
+#define MCP2515_BUF_SIDH		0
+#define MCP2515_BUF_SIDL		1
+#define MCP2515_BUF_EID8		2
+#define MCP2515_BUF_EID0		3
+#define MCP2515_BUF_DLC			4
+#define MCP2515_BUF_DATA		5
+#define MCP2515_BUF_LEN			13
+#define MCP2515_SIDL_IDE		BIT(3)
+#define MCP2515_SIDL_SRR		BIT(4)
+#define MCP2515_DLC_RTR			BIT(6)
+#define MCP2515_DLC_MASK		0x0f
+
+/* Register values for a can_frame, loaded with LOAD TX BUFFER */
+static inline void mcp2515_frame_to_buf(const struct can_frame *cf, u8 *buf)
+{
+	u32 id = cf->can_id;
+
+	if (id & CAN_EFF_FLAG) {
+		id &= CAN_EFF_MASK;
+		buf[MCP2515_BUF_SIDH] = id >> 21;
+		buf[MCP2515_BUF_SIDL] = (((id >> 18) & 0x7) << 5) |
+					MCP2515_SIDL_IDE | ((id >> 16) & 0x3);
+		buf[MCP2515_BUF_EID8] = id >> 8;
+		buf[MCP2515_BUF_EID0] = id;
+	} else {
+		id &= CAN_SFF_MASK;
+		buf[MCP2515_BUF_SIDH] = id >> 3;
+		buf[MCP2515_BUF_SIDL] = (id & 0x7) << 5;
+		buf[MCP2515_BUF_EID8] = 0;
+		buf[MCP2515_BUF_EID0] = 0;
+	}
+	buf[MCP2515_BUF_DLC] = min_t(u8, cf->len, CAN_MAX_DLEN) |
+			       ((cf->can_id & CAN_RTR_FLAG) ? MCP2515_DLC_RTR : 0);
+	memcpy(buf + MCP2515_BUF_DATA, cf->data, CAN_MAX_DLEN);
+}
+
+/* can_frame from the registers read with READ RX BUFFER */
+static inline void mcp2515_buf_to_frame(const u8 *buf, struct can_frame *cf)
+{
+	u8 sidl = buf[MCP2515_BUF_SIDL];
+
+	if (sidl & MCP2515_SIDL_IDE) {
+		cf->can_id = CAN_EFF_FLAG |
+			     (buf[MCP2515_BUF_SIDH] << 21) |
+			     ((sidl >> 5) << 18) | ((sidl & 0x3) << 16) |
+			     (buf[MCP2515_BUF_EID8] << 8) | buf[MCP2515_BUF_EID0];
+		if (buf[MCP2515_BUF_DLC] & MCP2515_DLC_RTR)
+			cf->can_id |= CAN_RTR_FLAG;
+	} else {
+		cf->can_id = (buf[MCP2515_BUF_SIDH] << 3) | (sidl >> 5);
+		if (sidl & MCP2515_SIDL_SRR)
+			cf->can_id |= CAN_RTR_FLAG;
+	}
+	/* DLC 9..15 still means 8 bytes on classic CAN */
+	cf->len = can_cc_dlc2len(buf[MCP2515_BUF_DLC] & MCP2515_DLC_MASK);
+	if (cf->can_id & CAN_RTR_FLAG)
+		memset(cf->data, 0, CAN_MAX_DLEN);
+	else
+		memcpy(cf->data, buf + MCP2515_BUF_DATA, cf->len);
+}
+
+/*
+ * CNF1..3 for a bit timing: the three registers are contiguous
+ * (CNF3, CNF2, CNF1 at 0x28..0x2a) and written with a single WRITE.
+ */
+static inline void mcp2515_bittiming_to_cnf(u32 brp, u32 sjw, u32 prop_seg,
+					    u32 phase_seg1, u32 phase_seg2,
+					    bool triple_sampling, u8 cnf[3])
+{
+	cnf[0] = (phase_seg2 - 1) & 0x7;
+	cnf[1] = MCP2515_CNF2_BTLMODE |
+		 (triple_sampling ? MCP2515_CNF2_SAM : 0) |
+		 (((phase_seg1 - 1) & 0x7) << 3) | ((prop_seg - 1) & 0x7);
+	cnf[2] = (((sjw - 1) & 0x3) << 6) | ((brp - 1) & 0x3f);
+}
+
+#endif /* _MCP2515_H */
@@ -0,0 +1,632 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * KUnit tests for the MCP2515 driver. Included at the end of mcp2515.c
+ * with CONFIG_MCP2515_KUNIT_TEST, so the static functions are reachable.
+ *
+ * The register-level tests run the driver against a fake MCP2515: a fake
+ * SPI controller that executes the instruction set on a 128-byte register
+ * file, including loopback mode. Run them with
+ *   ./tools/testing/kunit/kunit.py run --arch=x86_64 \
+ *	--kunitconfig=drivers/net/can/spi/mcp2515
+ * (SPI needs HAS_IOMEM, so QEMU rather than UML). A failed test makes
+ * kunit.py exit non-zero, and so does the encode/decode benchmark when a
+ * frame takes longer than CONFIG_MCP2515_KUNIT_FRAME_NS_MAX.
+ */
+
+#include <kunit/test.h>
+#include <linux/device.h>
+
+#define MCP2515_KUNIT_BENCH_LOOPS	100000
+
+/* The fake chip: register file and what the driver made it do */
+struct mcp2515_fake {
+	u8 regs[128];
+	bool absent;		/* nothing on CS: MISO reads as 0 */
+	unsigned int msgs;
+	unsigned int rts;
+};
+
+struct mcp2515_test {
+	struct device *parent;
+	struct spi_controller *ctlr;
+	struct spi_device *spi;
+	struct mcp2515_fake *fake;
+	struct net_device *net;
+	struct mcp2515_priv *priv;
+	bool xfer_ready;
+};
+
+static void mcp2515_fake_write(struct mcp2515_fake *fake, u8 reg, u8 val)
+{
+	fake->regs[reg & 0x7f] = val;
+	/* Mode changes are immediate: the fake bus is always idle */
+	if ((reg & 0x7f) == MCP2515_CANCTRL)
+		fake->regs[MCP2515_CANSTAT] =
+			(fake->regs[MCP2515_CANSTAT] & ~MCP2515_CANSTAT_OPMOD) |
+			(val & MCP2515_CANCTRL_REQOP);
+}
+
+/* TXB0 into RXB0 as the chip's loopback mode does, then both flags */
+static void mcp2515_fake_loopback(struct mcp2515_fake *fake)
+{
+	u8 *txb = &fake->regs[MCP2515_TXB0CTRL + 1];
+	u8 *rxb = &fake->regs[MCP2515_RXB0CTRL + 1];
+
+	memcpy(rxb, txb, MCP2515_BUF_LEN);
+	/* A received standard remote frame has SRR set in SIDL */
+	if (!(rxb[MCP2515_BUF_SIDL] & MCP2515_SIDL_IDE) &&
+	    (rxb[MCP2515_BUF_DLC] & MCP2515_DLC_RTR))
+		rxb[MCP2515_BUF_SIDL] |= MCP2515_SIDL_SRR;
+	fake->regs[MCP2515_CANINTF] |= MCP2515_INT_RX0I;
+}
+
+/* One instruction: the driver releases CS after every transfer */
+static void mcp2515_fake_instr(struct mcp2515_fake *fake, const u8 *tx,
+			       u8 *rx, unsigned int len)
+{
+	u8 intf = fake->regs[MCP2515_CANINTF];
+	unsigned int i;
+
+	if (rx)
+		memset(rx, 0, len);
+	switch (tx[0]) {
+	case MCP2515_INSTR_RESET:
+		memset(fake->regs, 0, sizeof(fake->regs));
+		fake->regs[MCP2515_CANCTRL] = MCP2515_CANCTRL_RESET;
+		fake->regs[MCP2515_CANSTAT] = MCP2515_CANCTRL_REQOP_CONFIG;
+		break;
+	case MCP2515_INSTR_READ:
+		for (i = 2; i < len; i++)
+			rx[i] = fake->regs[(tx[1] + i - 2) & 0x7f];
+		break;
+	case MCP2515_INSTR_WRITE:
+		for (i = 2; i < len; i++)
+			mcp2515_fake_write(fake, tx[1] + i - 2, tx[i]);
+		break;
+	case MCP2515_INSTR_BIT_MODIFY:
+		mcp2515_fake_write(fake, tx[1],
+				   (fake->regs[tx[1] & 0x7f] & ~tx[2]) |
+				   (tx[3] & tx[2]));
+		break;
+	case MCP2515_INSTR_READ_STATUS:
+		for (i = 1; i < len; i++)
+			rx[i] = (intf & MCP2515_INT_RX0I ? MCP2515_STAT_RX0IF : 0) |
+				(intf & MCP2515_INT_RX1I ? MCP2515_STAT_RX1IF : 0) |
+				(intf & MCP2515_INT_TX0I ? MCP2515_STAT_TX0IF : 0);
+		break;
+	case MCP2515_INSTR_READ_RXB(0):
+	case MCP2515_INSTR_READ_RXB(1): {
+		int n = tx[0] == MCP2515_INSTR_READ_RXB(1);
+		u8 base = (n ? MCP2515_RXB1CTRL : MCP2515_RXB0CTRL) + 1;
+
+		for (i = 1; i < len; i++)
+			rx[i] = fake->regs[(base + i - 1) & 0x7f];
+		fake->regs[MCP2515_CANINTF] &= ~(n ? MCP2515_INT_RX1I :
+						    MCP2515_INT_RX0I);
+		break;
+	}
+	case MCP2515_INSTR_LOAD_TXB(0):
+		for (i = 1; i < len; i++)
+			fake->regs[MCP2515_TXB0CTRL + i] = tx[i];
+		break;
+	case MCP2515_INSTR_RTS(0):
+		fake->rts++;
+		if ((fake->regs[MCP2515_CANSTAT] & MCP2515_CANSTAT_OPMOD) ==
+		    MCP2515_CANCTRL_REQOP_LOOPBACK)
+			mcp2515_fake_loopback(fake);
+		fake->regs[MCP2515_CANINTF] |= MCP2515_INT_TX0I;
+		break;
+	}
+}
+
+static int mcp2515_fake_transfer(struct spi_controller *ctlr,
+				 struct spi_message *msg)
+{
+	struct mcp2515_fake *fake = spi_controller_get_devdata(ctlr);
+	struct spi_transfer *t;
+
+	list_for_each_entry(t, &msg->transfers, transfer_list) {
+		if (!fake->absent)
+			mcp2515_fake_instr(fake, t->tx_buf, t->rx_buf, t->len);
+		else if (t->rx_buf)
+			memset(t->rx_buf, 0, t->len);
+		msg->actual_length += t->len;
+	}
+	fake->msgs++;
+	msg->status = 0;
+	spi_finalize_current_message(ctlr);
+	return 0;
+}
+
+static int mcp2515_test_init(struct kunit *test)
+{
+	struct mcp2515_test *ctx;
+	struct mcp2515_priv *priv;
+	int ret;
+
+	ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ctx);
+	test->priv = ctx;
+
+	ctx->parent = root_device_register("mcp2515-kunit");
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ctx->parent);
+	ctx->ctlr = spi_alloc_host(ctx->parent, sizeof(*ctx->fake));
+	KUNIT_ASSERT_NOT_NULL(test, ctx->ctlr);
+	ctx->fake = spi_controller_get_devdata(ctx->ctlr);
+	ctx->ctlr->bus_num = -1;
+	ctx->ctlr->num_chipselect = 1;
+	ctx->ctlr->transfer_one_message = mcp2515_fake_transfer;
+	ret = spi_register_controller(ctx->ctlr);
+	if (ret) {
+		spi_controller_put(ctx->ctlr);
+		ctx->ctlr = NULL;
+	}
+	KUNIT_ASSERT_EQ(test, ret, 0);
+	ctx->spi = spi_alloc_device(ctx->ctlr);
+	KUNIT_ASSERT_NOT_NULL(test, ctx->spi);
+	ctx->spi->bits_per_word = 8;
+	ctx->spi->max_speed_hz = MCP2515_SPI_HZ_MAX;
+
+	/* The parts of probe the register paths need, without a netdev */
+	ctx->net = alloc_candev(sizeof(*priv), 1);
+	KUNIT_ASSERT_NOT_NULL(test, ctx->net);
+	ctx->net->flags |= IFF_ECHO;
+	priv = netdev_priv(ctx->net);
+	ctx->priv = priv;
+	priv->net = ctx->net;
+	priv->spi = ctx->spi;
+	priv->can.clock.freq = 4000000;
+	mutex_init(&priv->lock);
+	kthread_init_work(&priv->tx_work, mcp2515_tx_work);
+	priv->xfer = kunit_kcalloc(test, MCP2515_SEQ_NUM, sizeof(*priv->xfer),
+				   GFP_KERNEL);
+	priv->batch = kunit_kzalloc(test, sizeof(*priv->batch), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, priv->xfer);
+	KUNIT_ASSERT_NOT_NULL(test, priv->batch);
+	priv->bus = mcp2515_bus_get(ctx->spi);
+	KUNIT_ASSERT_NOT_NULL(test, priv->bus);
+	KUNIT_ASSERT_EQ(test, mcp2515_xfer_setup(priv), 0);
+	ctx->xfer_ready = true;
+	return 0;
+}
+
+static void mcp2515_test_exit(struct kunit *test)
+{
+	struct mcp2515_test *ctx = test->priv;
+
+	if (!ctx)
+		return;
+	if (ctx->priv) {
+		if (ctx->xfer_ready)
+			mcp2515_xfer_release(ctx->priv);
+		if (ctx->priv->bus)
+			mcp2515_bus_put(ctx->priv->bus);
+	}
+	if (ctx->net)
+		free_candev(ctx->net);
+	if (ctx->spi)
+		spi_dev_put(ctx->spi);
+	if (ctx->ctlr)
+		spi_unregister_controller(ctx->ctlr);
+	if (!IS_ERR_OR_NULL(ctx->parent))
+		root_device_unregister(ctx->parent);
+}
+
+/* 500 kbit/s from the 4 MHz CAN clock: 8 TQ of 250 ns */
+static void mcp2515_test_start(struct kunit *test, u32 ctrlmode)
+{
+	struct mcp2515_priv *priv = ((struct mcp2515_test *)test->priv)->priv;
+	int ret;
+
+	priv->can.bittiming.brp = 1;
+	priv->can.bittiming.sjw = 1;
+	priv->can.bittiming.prop_seg = 2;
+	priv->can.bittiming.phase_seg1 = 3;
+	priv->can.bittiming.phase_seg2 = 2;
+	priv->can.ctrlmode = ctrlmode;
+	mutex_lock(&priv->lock);
+	ret = mcp2515_hw_start(priv);
+	mutex_unlock(&priv->lock);
+	KUNIT_ASSERT_EQ(test, ret, 0);
+}
+
+static void mcp2515_test_irq(struct mcp2515_priv *priv)
+{
+	mutex_lock(&priv->lock);
+	mcp2515_handle_irq(priv);
+	mutex_unlock(&priv->lock);
+}
+
+static void mcp2515_test_sff_layout(struct kunit *test)
+{
+	struct can_frame cf = { .can_id = 0x123, .len = 3,
+				.data = { 0xde, 0xad, 0xbe } };
+	u8 buf[MCP2515_BUF_LEN];
+
+	mcp2515_frame_to_buf(&cf, buf);
+	KUNIT_EXPECT_EQ(test, buf[MCP2515_BUF_SIDH], 0x24);
+	KUNIT_EXPECT_EQ(test, buf[MCP2515_BUF_SIDL], 0x60);
+	KUNIT_EXPECT_EQ(test, buf[MCP2515_BUF_EID8], 0);
+	KUNIT_EXPECT_EQ(test, buf[MCP2515_BUF_EID0], 0);
+	KUNIT_EXPECT_EQ(test, buf[MCP2515_BUF_DLC], 3);
+	KUNIT_EXPECT_MEMEQ(test, buf + MCP2515_BUF_DATA, cf.data, 3);
+}
+
+static void mcp2515_test_eff_layout(struct kunit *test)
+{
+	struct can_frame cf = { .can_id = 0x12345678 | CAN_EFF_FLAG |
+					  CAN_RTR_FLAG };
+	u8 buf[MCP2515_BUF_LEN];
+
+	mcp2515_frame_to_buf(&cf, buf);
+	KUNIT_EXPECT_EQ(test, buf[MCP2515_BUF_SIDH], 0x91);
+	KUNIT_EXPECT_EQ(test, buf[MCP2515_BUF_SIDL], 0xa8);
+	KUNIT_EXPECT_EQ(test, buf[MCP2515_BUF_EID8], 0x56);
+	KUNIT_EXPECT_EQ(test, buf[MCP2515_BUF_EID0], 0x78);
+	KUNIT_EXPECT_EQ(test, buf[MCP2515_BUF_DLC], MCP2515_DLC_RTR);
+}
+
+static const struct can_frame mcp2515_test_frames[] = {
+	{ .can_id = 0x000, .len = 0 },
+	{ .can_id = 0x7ff, .len = 8, .data = { 1, 2, 3, 4, 5, 6, 7, 8 } },
+	{ .can_id = 0x555 | CAN_RTR_FLAG, .len = 4 },
+	{ .can_id = CAN_EFF_MASK | CAN_EFF_FLAG, .len = 5,
+	  .data = { 0xff, 0, 0xff, 0, 0xff } },
+	{ .can_id = 0x1 | CAN_EFF_FLAG | CAN_RTR_FLAG, .len = 0 },
+};
+
+/* Encode, receive as the chip does (SRR for standard RTR), decode */
+static void mcp2515_test_round_trip(struct kunit *test)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(mcp2515_test_frames); i++) {
+		const struct can_frame *in = &mcp2515_test_frames[i];
+		struct can_frame out;
+		u8 buf[MCP2515_BUF_LEN];
+
+		memset(&out, 0xaa, sizeof(out));
+		mcp2515_frame_to_buf(in, buf);
+		if (!(buf[MCP2515_BUF_SIDL] & MCP2515_SIDL_IDE) &&
+		    (buf[MCP2515_BUF_DLC] & MCP2515_DLC_RTR))
+			buf[MCP2515_BUF_SIDL] |= MCP2515_SIDL_SRR;
+		mcp2515_buf_to_frame(buf, &out);
+
+		KUNIT_EXPECT_EQ_MSG(test, out.can_id, in->can_id, "frame %u", i);
+		if (in->can_id & CAN_RTR_FLAG)
+			continue;
+		KUNIT_EXPECT_EQ_MSG(test, out.len, in->len, "frame %u", i);
+		KUNIT_EXPECT_MEMEQ_MSG(test, out.data, in->data, in->len,
+				       "frame %u", i);
+	}
+}
+
+static void mcp2515_test_dlc_clamp(struct kunit *test)
+{
+	u8 buf[MCP2515_BUF_LEN] = { [MCP2515_BUF_DLC] = 15 };
+	struct can_frame cf;
+
+	mcp2515_buf_to_frame(buf, &cf);
+	KUNIT_EXPECT_EQ(test, cf.len, CAN_MAX_DLEN);
+}
+
+static void mcp2515_test_bittiming(struct kunit *test)
+{
+	u8 cnf[3];
+
+	mcp2515_bittiming_to_cnf(1, 1, 2, 3, 2, false, cnf);
+	KUNIT_EXPECT_EQ(test, cnf[0], 0x01);
+	KUNIT_EXPECT_EQ(test, cnf[1], 0x91);
+	KUNIT_EXPECT_EQ(test, cnf[2], 0x00);
+
+	/* Field limits: BRP 64, SJW 4, 8 TQ segments, triple sampling */
+	mcp2515_bittiming_to_cnf(64, 4, 8, 8, 8, true, cnf);
+	KUNIT_EXPECT_EQ(test, cnf[0], 0x07);
+	KUNIT_EXPECT_EQ(test, cnf[1], 0xff);
+	KUNIT_EXPECT_EQ(test, cnf[2], 0xff);
+}
+
+static void mcp2515_bench_frame(struct kunit *test)
+{
+	struct can_frame cf = { .len = 8 }, out;
+	u8 buf[MCP2515_BUF_LEN] = { [MCP2515_BUF_DLC] = 8 };
+	u64 start_ns, enc_ns, dec_ns;
+	u32 sum = 0;
+	unsigned int i;
+
+	start_ns = ktime_get_ns();
+	for (i = 0; i < MCP2515_KUNIT_BENCH_LOOPS; i++) {
+		cf.can_id = i & 1 ? i | CAN_EFF_FLAG : i & CAN_SFF_MASK;
+		mcp2515_frame_to_buf(&cf, buf);
+		sum += buf[MCP2515_BUF_SIDH];
+	}
+	enc_ns = ktime_get_ns() - start_ns;
+
+	start_ns = ktime_get_ns();
+	for (i = 0; i < MCP2515_KUNIT_BENCH_LOOPS; i++) {
+		buf[MCP2515_BUF_SIDL] = i & 1 ? MCP2515_SIDL_IDE : 0;
+		buf[MCP2515_BUF_EID0] = i;
+		mcp2515_buf_to_frame(buf, &out);
+		sum += out.can_id;
+	}
+	dec_ns = ktime_get_ns() - start_ns;
+
+	enc_ns = div_u64(enc_ns, MCP2515_KUNIT_BENCH_LOOPS);
+	dec_ns = div_u64(dec_ns, MCP2515_KUNIT_BENCH_LOOPS);
+	kunit_info(test, "encode %llu ns/frame, decode %llu ns/frame, budget %d ns (sum %u)\n",
+		   enc_ns, dec_ns, CONFIG_MCP2515_KUNIT_FRAME_NS_MAX, sum);
+	if (!CONFIG_MCP2515_KUNIT_FRAME_NS_MAX)
+		return;
+	KUNIT_EXPECT_LE(test, enc_ns, CONFIG_MCP2515_KUNIT_FRAME_NS_MAX);
+	KUNIT_EXPECT_LE(test, dec_ns, CONFIG_MCP2515_KUNIT_FRAME_NS_MAX);
+}
+
+static struct kunit_case mcp2515_frame_cases[] = {
+	KUNIT_CASE(mcp2515_test_sff_layout),
+	KUNIT_CASE(mcp2515_test_eff_layout),
+	KUNIT_CASE(mcp2515_test_round_trip),
+	KUNIT_CASE(mcp2515_test_dlc_clamp),
+	KUNIT_CASE(mcp2515_test_bittiming),
+	KUNIT_CASE(mcp2515_bench_frame),
+	{}
+};
+
+static struct kunit_suite mcp2515_frame_suite = {
+	.name = "mcp2515-frame",
+	.test_cases = mcp2515_frame_cases,
+};
+
+/* CNF3..CANINTE continue each other: one WRITE; RXBnCTRL do not */
+static void mcp2515_test_batch_merge(struct kunit *test)
+{
+	struct mcp2515_batch *b = kunit_kzalloc(test, sizeof(*b), GFP_KERNEL);
+	static const u8 expect[] = { MCP2515_INSTR_WRITE, MCP2515_CNF3,
+				     1, 2, 3, 4 };
+	u8 val[2];
+
+	KUNIT_ASSERT_NOT_NULL(test, b);
+	mcp2515_batch_write_reg(b, MCP2515_CNF3, 1);
+	mcp2515_batch_write_reg(b, MCP2515_CNF2, 2);
+	mcp2515_batch_write_reg(b, MCP2515_CNF1, 3);
+	mcp2515_batch_write_reg(b, MCP2515_CANINTE, 4);
+	KUNIT_EXPECT_EQ(test, b->n_ops, 1);
+	KUNIT_EXPECT_EQ(test, b->t[0].len, sizeof(expect));
+	KUNIT_EXPECT_MEMEQ(test, b->tx, expect, sizeof(expect));
+
+	mcp2515_batch_write_reg(b, MCP2515_RXB0CTRL, 5);
+	mcp2515_batch_write_reg(b, MCP2515_RXB1CTRL, 6);
+	KUNIT_EXPECT_EQ(test, b->n_ops, 3);
+
+	/* Same registers, different instruction: no merge */
+	mcp2515_batch_read(b, MCP2515_RXB1CTRL + 1, val, 2);
+	mcp2515_batch_modify(b, MCP2515_CANINTF, 0xff, 0);
+	KUNIT_EXPECT_EQ(test, b->n_ops, 5);
+	KUNIT_EXPECT_EQ(test, b->n_reads, 1);
+	KUNIT_EXPECT_EQ(test, b->err, 0);
+}
+
+static void mcp2515_test_batch_full(struct kunit *test)
+{
+	struct mcp2515_batch *b = kunit_kzalloc(test, sizeof(*b), GFP_KERNEL);
+	unsigned int i;
+
+	KUNIT_ASSERT_NOT_NULL(test, b);
+	/* Every other register: nothing merges */
+	for (i = 0; i < MCP2515_BATCH_OPS; i++)
+		mcp2515_batch_write_reg(b, 2 * i, i);
+	KUNIT_EXPECT_EQ(test, b->err, 0);
+	mcp2515_batch_write_reg(b, 2 * i, i);
+	KUNIT_EXPECT_EQ(test, b->err, -ENOSPC);
+	KUNIT_EXPECT_EQ(test, b->n_ops, MCP2515_BATCH_OPS);
+}
+
+/* Adjacent reads merge into one op but each keeps a reads[] slot */
+static void mcp2515_test_batch_reads_full(struct kunit *test)
+{
+	struct mcp2515_batch *b = kunit_kzalloc(test, sizeof(*b), GFP_KERNEL);
+	u8 val[ARRAY_SIZE(b->reads) + 1];
+	unsigned int i;
+
+	KUNIT_ASSERT_NOT_NULL(test, b);
+	for (i = 0; i < ARRAY_SIZE(b->reads); i++)
+		mcp2515_batch_read(b, i, &val[i], 1);
+	KUNIT_EXPECT_EQ(test, b->err, 0);
+	KUNIT_EXPECT_EQ(test, b->n_ops, 1);
+	mcp2515_batch_read(b, i, &val[i], 1);
+	KUNIT_EXPECT_EQ(test, b->err, -ENOSPC);
+	KUNIT_EXPECT_EQ(test, b->n_reads, ARRAY_SIZE(b->reads));
+}
+
+/* RX first, up to MCP2515_BUS_RX_BURST grants, then TX, then housekeeping */
+static void mcp2515_test_bus_arbitration(struct kunit *test)
+{
+	struct mcp2515_bus *bus = kunit_kzalloc(test, sizeof(*bus), GFP_KERNEL);
+
+	KUNIT_ASSERT_NOT_NULL(test, bus);
+	bus->waiting[MCP2515_PRIO_RX] = 1;
+	bus->waiting[MCP2515_PRIO_TX] = 1;
+	bus->waiting[MCP2515_PRIO_HOUSEKEEPING] = 1;
+	KUNIT_EXPECT_TRUE(test, mcp2515_bus_may_take(bus, MCP2515_PRIO_RX));
+	KUNIT_EXPECT_FALSE(test, mcp2515_bus_may_take(bus, MCP2515_PRIO_TX));
+	KUNIT_EXPECT_FALSE(test, mcp2515_bus_may_take(bus, MCP2515_PRIO_HOUSEKEEPING));
+
+	bus->rx_streak = MCP2515_BUS_RX_BURST;
+	KUNIT_EXPECT_FALSE(test, mcp2515_bus_may_take(bus, MCP2515_PRIO_RX));
+	KUNIT_EXPECT_TRUE(test, mcp2515_bus_may_take(bus, MCP2515_PRIO_TX));
+	KUNIT_EXPECT_FALSE(test, mcp2515_bus_may_take(bus, MCP2515_PRIO_HOUSEKEEPING));
+
+	bus->waiting[MCP2515_PRIO_TX] = 0;
+	KUNIT_EXPECT_TRUE(test, mcp2515_bus_may_take(bus, MCP2515_PRIO_HOUSEKEEPING));
+
+	/* Nobody else waiting: the burst limit does not apply */
+	bus->waiting[MCP2515_PRIO_HOUSEKEEPING] = 0;
+	KUNIT_EXPECT_TRUE(test, mcp2515_bus_may_take(bus, MCP2515_PRIO_RX));
+
+	bus->busy = true;
+	KUNIT_EXPECT_FALSE(test, mcp2515_bus_may_take(bus, MCP2515_PRIO_RX));
+}
+
+static struct kunit_case mcp2515_batch_cases[] = {
+	KUNIT_CASE(mcp2515_test_batch_merge),
+	KUNIT_CASE(mcp2515_test_batch_full),
+	KUNIT_CASE(mcp2515_test_batch_reads_full),
+	KUNIT_CASE(mcp2515_test_bus_arbitration),
+	{}
+};
+
+static struct kunit_suite mcp2515_batch_suite = {
+	.name = "mcp2515-batch",
+	.test_cases = mcp2515_batch_cases,
+};
+
+/* Reset, configuration and mode change: five SPI messages */
+static void mcp2515_test_hw_start(struct kunit *test)
+{
+	struct mcp2515_test *ctx = test->priv;
+	u8 *regs = ctx->fake->regs;
+
+	mcp2515_test_start(test, 0);
+	KUNIT_EXPECT_EQ(test, ctx->fake->msgs, 5);
+	KUNIT_EXPECT_EQ(test, regs[MCP2515_CNF3], 0x01);
+	KUNIT_EXPECT_EQ(test, regs[MCP2515_CNF2], 0x91);
+	KUNIT_EXPECT_EQ(test, regs[MCP2515_CNF1], 0x00);
+	KUNIT_EXPECT_EQ(test, regs[MCP2515_CANINTE],
+			MCP2515_INT_RX0I | MCP2515_INT_RX1I | MCP2515_INT_TX0I |
+			MCP2515_INT_ERRI | MCP2515_INT_MERR);
+	KUNIT_EXPECT_EQ(test, regs[MCP2515_RXB0CTRL],
+			MCP2515_RXB_RXM_ANY | MCP2515_RXB0CTRL_BUKT);
+	KUNIT_EXPECT_EQ(test, regs[MCP2515_CANSTAT] & MCP2515_CANSTAT_OPMOD,
+			MCP2515_CANCTRL_REQOP_NORMAL);
+	KUNIT_EXPECT_EQ(test, ctx->priv->can.state, CAN_STATE_ERROR_ACTIVE);
+}
+
+/* Probe's check: CANCTRL must read back its reset value */
+static void mcp2515_test_no_chip(struct kunit *test)
+{
+	struct mcp2515_test *ctx = test->priv;
+	int ret;
+
+	mutex_lock(&ctx->priv->lock);
+	ret = mcp2515_hw_reset(ctx->priv);
+	mutex_unlock(&ctx->priv->lock);
+	KUNIT_EXPECT_EQ(test, ret, 0);
+
+	ctx->fake->absent = true;
+	mutex_lock(&ctx->priv->lock);
+	ret = mcp2515_hw_reset(ctx->priv);
+	mutex_unlock(&ctx->priv->lock);
+	KUNIT_EXPECT_EQ(test, ret, -ENODEV);
+}
+
+/* start_xmit's work, then the interrupt: TX0IF and the looped back RX0IF */
+static void mcp2515_test_loopback(struct kunit *test)
+{
+	struct mcp2515_test *ctx = test->priv;
+	struct mcp2515_priv *priv = ctx->priv;
+	unsigned int i;
+
+	mcp2515_test_start(test, CAN_CTRLMODE_LOOPBACK);
+	for (i = 0; i < ARRAY_SIZE(mcp2515_test_frames); i++) {
+		const struct can_frame *in = &mcp2515_test_frames[i];
+		struct can_frame *cf, out;
+		struct sk_buff *skb;
+		u8 buf[MCP2515_BUF_LEN];
+
+		skb = alloc_can_skb(ctx->net, &cf);
+		KUNIT_ASSERT_NOT_NULL(test, skb);
+		*cf = *in;
+		priv->tx_skb = skb;
+		priv->tx_start_ns = ktime_get_ns();
+		mcp2515_tx_work(&priv->tx_work);
+		KUNIT_EXPECT_EQ(test, ctx->fake->rts, i + 1);
+		mcp2515_frame_to_buf(in, buf);
+		KUNIT_EXPECT_MEMEQ(test, &ctx->fake->regs[MCP2515_TXB0CTRL + 1],
+				   buf, MCP2515_BUF_LEN);
+
+		priv->irq_ns = ktime_get_ns();
+		mcp2515_test_irq(priv);
+		KUNIT_EXPECT_EQ(test, ctx->fake->regs[MCP2515_CANINTF], 0);
+		mcp2515_buf_to_frame(priv->xfer[MCP2515_SEQ_RXB0].rx + 1, &out);
+		KUNIT_EXPECT_EQ(test, out.can_id, in->can_id);
+	}
+	KUNIT_EXPECT_EQ(test, ctx->net->stats.tx_packets, i);
+	KUNIT_EXPECT_EQ(test, ctx->net->stats.rx_packets, i);
+	KUNIT_EXPECT_EQ(test, priv->stats.rx_frames, i);
+	KUNIT_EXPECT_EQ(test, priv->stats.tx_frames, i);
+	KUNIT_EXPECT_EQ(test, atomic64_read(&priv->bus->rx_frames), i);
+	KUNIT_EXPECT_EQ(test, atomic64_read(&priv->bus->tx_frames), i);
+}
+
+/* Both buffers full: drained in one interrupt, no slow path work */
+static void mcp2515_test_rx_both(struct kunit *test)
+{
+	struct mcp2515_test *ctx = test->priv;
+	u8 *regs = ctx->fake->regs;
+	unsigned int msgs;
+
+	mcp2515_test_start(test, 0);
+	mcp2515_frame_to_buf(&mcp2515_test_frames[1], &regs[MCP2515_RXB0CTRL + 1]);
+	mcp2515_frame_to_buf(&mcp2515_test_frames[3], &regs[MCP2515_RXB1CTRL + 1]);
+	regs[MCP2515_CANINTF] = MCP2515_INT_RX0I | MCP2515_INT_RX1I;
+
+	msgs = ctx->fake->msgs;
+	mcp2515_test_irq(ctx->priv);
+	KUNIT_EXPECT_EQ(test, regs[MCP2515_CANINTF], 0);
+	KUNIT_EXPECT_EQ(test, ctx->net->stats.rx_packets, 2);
+	KUNIT_EXPECT_EQ(test, ctx->net->stats.rx_bytes,
+			mcp2515_test_frames[1].len + mcp2515_test_frames[3].len);
+	/* STATUS, RXB0, RXB1, STATUS, then the one slow-path batch */
+	KUNIT_EXPECT_EQ(test, ctx->fake->msgs - msgs, 5);
+}
+
+static void mcp2515_test_overflow(struct kunit *test)
+{
+	struct mcp2515_test *ctx = test->priv;
+	u8 *regs = ctx->fake->regs;
+
+	mcp2515_test_start(test, 0);
+	regs[MCP2515_EFLG] = MCP2515_EFLG_RX0OVR;
+	regs[MCP2515_CANINTF] = MCP2515_INT_ERRI;
+	mcp2515_test_irq(ctx->priv);
+	KUNIT_EXPECT_EQ(test, regs[MCP2515_EFLG], 0);
+	KUNIT_EXPECT_EQ(test, regs[MCP2515_CANINTF], 0);
+	KUNIT_EXPECT_EQ(test, ctx->net->stats.rx_over_errors, 1);
+	KUNIT_EXPECT_EQ(test, atomic64_read(&ctx->priv->bus->drops), 1);
+	KUNIT_EXPECT_EQ(test, ctx->priv->can.state, CAN_STATE_ERROR_ACTIVE);
+}
+
+static void mcp2515_test_bus_off(struct kunit *test)
+{
+	struct mcp2515_test *ctx = test->priv;
+	u8 *regs = ctx->fake->regs;
+
+	mcp2515_test_start(test, 0);
+	regs[MCP2515_EFLG] = MCP2515_EFLG_TXBO | MCP2515_EFLG_TXEP;
+	regs[MCP2515_TEC] = 255;
+	regs[MCP2515_CANINTF] = MCP2515_INT_ERRI;
+	mcp2515_test_irq(ctx->priv);
+	KUNIT_EXPECT_EQ(test, ctx->priv->can.state, CAN_STATE_BUS_OFF);
+	KUNIT_EXPECT_EQ(test, ctx->priv->can.can_stats.bus_off, 1);
+	/* Interrupts off until restart */
+	KUNIT_EXPECT_EQ(test, regs[MCP2515_CANINTE], 0);
+}
+
+static struct kunit_case mcp2515_fake_cases[] = {
+	KUNIT_CASE(mcp2515_test_hw_start),
+	KUNIT_CASE(mcp2515_test_no_chip),
+	KUNIT_CASE(mcp2515_test_loopback),
+	KUNIT_CASE(mcp2515_test_rx_both),
+	KUNIT_CASE(mcp2515_test_overflow),
+	KUNIT_CASE(mcp2515_test_bus_off),
+	{}
+};
+
+static struct kunit_suite mcp2515_fake_suite = {
+	.name = "mcp2515-fake-spi",
+	.init = mcp2515_test_init,
+	.exit = mcp2515_test_exit,
+	.test_cases = mcp2515_fake_cases,
+};
+
+kunit_test_suites(&mcp2515_frame_suite, &mcp2515_batch_suite,
+		  &mcp2515_fake_suite);
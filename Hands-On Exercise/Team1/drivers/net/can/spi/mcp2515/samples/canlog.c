@@ -0,0 +1,619 @@
+/*
+ * canlog.c - binary CAN bus logger
+ *
+ * Receives up to -b frames per recvmmsg() call with their kernel receive
+ * timestamps, appends them as 24-byte records to a preallocated segment
+ * mapped MAP_SHARED, and rotates to a new segment when one is full. The
+ * time index is kept as records arrive; the per-ID index is a hash of the
+ * IDs seen plus a counting-sort pass over the segment when it is closed,
+ * so closing stays linear in the number of records.
+ *
+ * Usage: canlog [-i iface] [-d dir] [-s seg_MiB] [-n seg_records] [-k keep]
+ *               [-b batch] [-q]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <net/if.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+#include "canlog.h"
+
+#define CANLOG_DEFAULT_SEG_MIB  64U
+#define CANLOG_BATCH_MAX        256U
+#define CANLOG_DEFAULT_BATCH    64U
+#define CANLOG_RCVBUF           (4 * 1024 * 1024)
+
+struct canlog_id {
+    uint32_t can_id;
+    uint32_t count;
+};
+
+// IDs of the open segment: open addressing, slot holds index into ids[] + 1
+struct canlog_idmap {
+    uint32_t *slot;
+    uint32_t mask;
+    struct canlog_id *ids;
+    uint32_t n;
+    uint32_t cap;
+};
+
+struct canlog_writer {
+    const char *dir;
+    char ifname[IFNAMSIZ];
+    uint64_t capacity;          // records per segment
+    unsigned long long seq;
+    unsigned long long keep;    // segments kept on disk, 0 = all
+    int fd;
+    struct canlog_seg_hdr *hdr;
+    uint64_t count;             // records in the open segment; hdr->count lags a batch
+    struct canlog_rec *rec;
+    size_t map_len;
+    struct canlog_time_ent *time;
+    uint32_t n_time;
+    struct canlog_idmap idmap;
+    uint32_t *postings;         // capacity, filled at close
+    uint32_t *cursor;           // per ID, used at close
+    unsigned long segments;
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void signal_handler(int sig)
+{
+    (void)sig;
+    running = 0;
+}
+
+static void print_usage(const char *program_name)
+{
+    printf("Usage: %s [OPTIONS]\n", program_name);
+    printf("Options:\n");
+    printf("  -i <iface>    CAN interface (default: can0)\n");
+    printf("  -d <dir>      Log directory (default: .)\n");
+    printf("  -s <MiB>      Segment size (default: %u)\n", CANLOG_DEFAULT_SEG_MIB);
+    printf("  -n <records>  Segment size in records, overrides -s\n");
+    printf("  -k <count>    Keep only the newest <count> segments (default: all)\n");
+    printf("  -b <frames>   Frames per recvmmsg() (default: %u, max %u)\n",
+           CANLOG_DEFAULT_BATCH, CANLOG_BATCH_MAX);
+    printf("  -q            No statistics on exit\n");
+}
+
+static inline uint32_t idmap_hash(uint32_t can_id, uint32_t mask)
+{
+    return (can_id * 2654435761u) & mask;
+}
+
+static int idmap_init(struct canlog_idmap *m)
+{
+    m->mask = 255;
+    m->cap = 128;
+    m->slot = calloc(m->mask + 1, sizeof(*m->slot));
+    m->ids = malloc(m->cap * sizeof(*m->ids));
+    m->n = 0;
+    return m->slot && m->ids ? 0 : -ENOMEM;
+}
+
+static void idmap_free(struct canlog_idmap *m)
+{
+    free(m->slot);
+    free(m->ids);
+}
+
+// Index into ids[] of can_id, -1 if not seen in this segment
+static int64_t idmap_find(const struct canlog_idmap *m, uint32_t can_id)
+{
+    for (uint32_t h = idmap_hash(can_id, m->mask); m->slot[h]; h = (h + 1) & m->mask) {
+        if (m->ids[m->slot[h] - 1].can_id == can_id)
+            return m->slot[h] - 1;
+    }
+    return -1;
+}
+
+static int idmap_grow(struct canlog_idmap *m)
+{
+    uint32_t mask = m->mask * 2 + 1;
+    uint32_t *slot = calloc(mask + 1, sizeof(*slot));
+    struct canlog_id *ids = realloc(m->ids, m->cap * 2 * sizeof(*ids));
+
+    if (!slot || !ids) {
+        free(slot);
+        if (ids)
+            m->ids = ids;
+        return -ENOMEM;
+    }
+    m->ids = ids;
+    m->cap *= 2;
+    for (uint32_t i = 0; i < m->n; ++i) {
+        uint32_t h = idmap_hash(ids[i].can_id, mask);
+
+        while (slot[h])
+            h = (h + 1) & mask;
+        slot[h] = i + 1;
+    }
+    free(m->slot);
+    m->slot = slot;
+    m->mask = mask;
+    return 0;
+}
+
+static int idmap_count(struct canlog_idmap *m, uint32_t can_id)
+{
+    uint32_t h = idmap_hash(can_id, m->mask);
+
+    for (; m->slot[h]; h = (h + 1) & m->mask) {
+        if (m->ids[m->slot[h] - 1].can_id == can_id) {
+            m->ids[m->slot[h] - 1].count++;
+            return 0;
+        }
+    }
+    // Keep the load under 1/2, and ids[] no larger than the table allows
+    if (m->n == m->cap) {
+        if (idmap_grow(m) < 0)
+            return -ENOMEM;
+        return idmap_count(m, can_id);
+    }
+    m->ids[m->n].can_id = can_id;
+    m->ids[m->n].count = 1;
+    m->slot[h] = ++m->n;
+    return 0;
+}
+
+static int cmp_id(const void *a, const void *b)
+{
+    uint32_t x = ((const struct canlog_id *)a)->can_id;
+    uint32_t y = ((const struct canlog_id *)b)->can_id;
+
+    return x < y ? -1 : x > y;
+}
+
+static int write_all(int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+
+    while (len) {
+        ssize_t n = write(fd, p, len);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// seg-N.idx, written to a temporary name and renamed into place
+static int writer_write_idx(struct canlog_writer *w)
+{
+    struct canlog_idmap *m = &w->idmap;
+    struct canlog_idx_hdr ih;
+    char path[4096], tmp[4112];
+    uint64_t count = w->count, first = 0;
+    uint32_t *cursor;
+    int fd, err;
+
+    cursor = realloc(w->cursor, (m->n + 1) * sizeof(*cursor));
+    if (!cursor)
+        return -ENOMEM;
+    w->cursor = cursor;
+
+    // Stable order: IDs sorted, each ID's postings in record order
+    qsort(m->ids, m->n, sizeof(*m->ids), cmp_id);
+    memset(m->slot, 0, (m->mask + 1) * sizeof(*m->slot));
+    for (uint32_t i = 0; i < m->n; ++i) {
+        uint32_t h = idmap_hash(m->ids[i].can_id, m->mask);
+
+        while (m->slot[h])
+            h = (h + 1) & m->mask;
+        m->slot[h] = i + 1;
+        w->cursor[i] = (uint32_t)first;
+        first += m->ids[i].count;
+    }
+    for (uint64_t r = 0; r < count; ++r)
+        w->postings[w->cursor[idmap_find(m, w->rec[r].can_id)]++] = (uint32_t)r;
+
+    memset(&ih, 0, sizeof(ih));
+    memcpy(ih.magic, CANLOG_IDX_MAGIC, 8);
+    ih.version = CANLOG_VERSION;
+    ih.time_stride = CANLOG_TIME_STRIDE;
+    ih.seq = w->seq;
+    ih.count = count;
+    ih.first_ns = w->hdr->first_ns;
+    ih.last_ns = w->hdr->last_ns;
+    ih.n_time = w->n_time;
+    ih.n_ids = m->n;
+
+    snprintf(path, sizeof(path), CANLOG_IDX_FMT, w->dir, w->seq);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return -errno;
+    err = write_all(fd, &ih, sizeof(ih));
+    if (!err)
+        err = write_all(fd, w->time, w->n_time * sizeof(*w->time));
+    first = 0;
+    for (uint32_t i = 0; !err && i < m->n; ++i) {
+        struct canlog_id_ent e = { m->ids[i].can_id, m->ids[i].count, first };
+
+        err = write_all(fd, &e, sizeof(e));
+        first += m->ids[i].count;
+    }
+    if (!err)
+        err = write_all(fd, w->postings, count * sizeof(*w->postings));
+    if (close(fd) < 0 && !err)
+        err = -errno;
+    if (!err && rename(tmp, path) < 0)
+        err = -errno;
+    if (err)
+        unlink(tmp);
+    return err;
+}
+
+static int writer_open_segment(struct canlog_writer *w)
+{
+    char path[4096];
+    int err;
+
+    snprintf(path, sizeof(path), CANLOG_SEG_FMT, w->dir, w->seq);
+    w->fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (w->fd < 0)
+        return -errno;
+    w->map_len = CANLOG_HDR_SIZE + w->capacity * sizeof(struct canlog_rec);
+    // Reserve the blocks now: a full disk fails here, not as SIGBUS later
+    err = posix_fallocate(w->fd, 0, w->map_len);
+    if (err) {
+        close(w->fd);
+        unlink(path);
+        return -err;
+    }
+    w->hdr = mmap(NULL, w->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, w->fd, 0);
+    if (w->hdr == MAP_FAILED) {
+        err = -errno;
+        close(w->fd);
+        unlink(path);
+        return err;
+    }
+    w->rec = (struct canlog_rec *)((char *)w->hdr + CANLOG_HDR_SIZE);
+    madvise(w->rec, w->capacity * sizeof(struct canlog_rec), MADV_SEQUENTIAL);
+
+    memset(w->hdr, 0, sizeof(*w->hdr));
+    w->hdr->version = CANLOG_VERSION;
+    w->hdr->rec_size = sizeof(struct canlog_rec);
+    w->hdr->seq = w->seq;
+    w->hdr->capacity = w->capacity;
+    memcpy(w->hdr->ifname, w->ifname, sizeof(w->hdr->ifname));
+    // Magic last, so a reader never sees a half-initialised header as valid
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(w->hdr->magic, CANLOG_MAGIC, 8);
+
+    w->count = 0;
+    w->n_time = 0;
+    w->idmap.n = 0;
+    memset(w->idmap.slot, 0, (w->idmap.mask + 1) * sizeof(*w->idmap.slot));
+    w->segments++;
+    return 0;
+}
+
+// Readers load count with acquire, so the records below it are complete
+static void writer_publish(struct canlog_writer *w)
+{
+    __atomic_store_n(&w->hdr->count, w->count, __ATOMIC_RELEASE);
+}
+
+// Called once the new segment holds a record, so -k N leaves exactly N files
+static void writer_prune(struct canlog_writer *w)
+{
+    char path[4096];
+
+    if (!w->keep || w->seq < w->keep)
+        return;
+    snprintf(path, sizeof(path), CANLOG_SEG_FMT, w->dir, w->seq - w->keep);
+    unlink(path);
+    snprintf(path, sizeof(path), CANLOG_IDX_FMT, w->dir, w->seq - w->keep);
+    unlink(path);
+}
+
+static int writer_close_segment(struct canlog_writer *w)
+{
+    size_t used;
+    int err;
+
+    writer_publish(w);
+    err = writer_write_idx(w);
+    used = CANLOG_HDR_SIZE + w->count * sizeof(struct canlog_rec);
+    munmap(w->hdr, w->map_len);
+    w->hdr = NULL;
+    // Give back the unused preallocation of a partly filled segment
+    if (ftruncate(w->fd, used) < 0 && !err)
+        err = -errno;
+    close(w->fd);
+    w->fd = -1;
+    return err;
+}
+
+static int writer_append(struct canlog_writer *w, const struct can_frame *cf, uint64_t ts_ns)
+{
+    struct canlog_rec *r;
+    uint64_t n = w->count;
+    int err;
+
+    if (n == w->capacity) {
+        err = writer_close_segment(w);
+        if (err < 0)
+            fprintf(stderr, "canlog: index of segment %llu: %s\n", w->seq, strerror(-err));
+        w->seq++;
+        err = writer_open_segment(w);
+        if (err < 0)
+            return err;
+        n = 0;
+    }
+    if (n % CANLOG_TIME_STRIDE == 0) {
+        w->time[w->n_time].ts_ns = ts_ns;
+        w->time[w->n_time].rec = n;
+        w->n_time++;
+    }
+    if (idmap_count(&w->idmap, cf->can_id) < 0)
+        return -ENOMEM;
+
+    r = &w->rec[n];
+    r->ts_ns = ts_ns;
+    r->can_id = cf->can_id;
+    r->len = cf->len;
+    r->flags = 0;
+    r->reserved = 0;
+    memcpy(r->data, cf->data, sizeof(r->data));
+    if (!n) {
+        w->hdr->first_ns = ts_ns;
+        writer_prune(w);
+    }
+    w->hdr->last_ns = ts_ns;
+    // hdr->count is published by the caller once per batch
+    w->count = n + 1;
+    return 0;
+}
+
+static int open_socket(const char *ifname)
+{
+    struct sockaddr_can addr;
+    struct ifreq ifr;
+    int fd, on = 1, rcvbuf = CANLOG_RCVBUF;
+
+    fd = socket(PF_CAN, SOCK_RAW | SOCK_CLOEXEC, CAN_RAW);
+    if (fd < 0)
+        return -errno;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+    if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0)
+        goto fail;
+    // Kernel receive time and the socket's drop counter come with each frame
+    setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+    setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on));
+    // Room for bursts while a segment is being indexed; FORCE needs CAP_NET_ADMIN
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0)
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+        goto fail;
+    return fd;
+fail:
+    on = -errno;
+    close(fd);
+    return on;
+}
+
+static int next_seq(const char *dir, unsigned long long *seq)
+{
+    unsigned long long *seqs;
+    size_t n;
+    int err = canlog_list(dir, &seqs, &n);
+
+    if (err < 0)
+        return err;
+    *seq = n ? seqs[n - 1] + 1 : 0;
+    free(seqs);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static struct can_frame frames[CANLOG_BATCH_MAX];
+    static struct iovec iov[CANLOG_BATCH_MAX];
+    static struct mmsghdr msgs[CANLOG_BATCH_MAX];
+    static char ctrl[CANLOG_BATCH_MAX][CMSG_SPACE(sizeof(struct timespec)) +
+                                       CMSG_SPACE(sizeof(uint32_t))];
+    struct canlog_writer w;
+    struct sigaction sa;
+    struct rusage ru;
+    const char *ifname = "can0";
+    unsigned long long seg_mib = CANLOG_DEFAULT_SEG_MIB, records = 0;
+    unsigned long long frames_total = 0, dropped_total = 0, calls = 0;
+    unsigned int batch = CANLOG_DEFAULT_BATCH;
+    uint32_t last_ovfl = 0;
+    int fd, opt, quiet = 0, err = 0;
+
+    memset(&w, 0, sizeof(w));
+    w.dir = ".";
+    w.fd = -1;
+    while ((opt = getopt(argc, argv, "hi:d:s:n:k:b:q")) != -1) {
+        switch (opt) {
+            case 'i':
+                ifname = optarg;
+                break;
+            case 'd':
+                w.dir = optarg;
+                break;
+            case 's':
+                seg_mib = strtoull(optarg, NULL, 0);
+                break;
+            case 'n':
+                records = strtoull(optarg, NULL, 0);
+                break;
+            case 'k':
+                w.keep = strtoull(optarg, NULL, 0);
+                break;
+            case 'b':
+                batch = (unsigned int)strtoul(optarg, NULL, 0);
+                break;
+            case 'q':
+                quiet = 1;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (!batch || batch > CANLOG_BATCH_MAX)
+        batch = CANLOG_BATCH_MAX;
+    w.capacity = records ? records :
+                 seg_mib * 1024 * 1024 / sizeof(struct canlog_rec);
+    // Postings are 32-bit record numbers
+    if (!w.capacity || w.capacity > UINT32_MAX) {
+        fprintf(stderr, "canlog: segment size out of range\n");
+        return EXIT_FAILURE;
+    }
+    strncpy(w.ifname, ifname, sizeof(w.ifname) - 1);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_handler;   // no SA_RESTART: recvmmsg() must return
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    fd = open_socket(ifname);
+    if (fd < 0) {
+        fprintf(stderr, "canlog: %s: %s\n", ifname, strerror(-fd));
+        return EXIT_FAILURE;
+    }
+    if (mkdir(w.dir, 0755) < 0 && errno != EEXIST) {
+        fprintf(stderr, "canlog: %s: %s\n", w.dir, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    err = next_seq(w.dir, &w.seq);
+    if (!err)
+        err = idmap_init(&w.idmap);
+    w.time = malloc((w.capacity / CANLOG_TIME_STRIDE + 1) * sizeof(*w.time));
+    w.postings = malloc(w.capacity * sizeof(*w.postings));
+    if (!err && (!w.time || !w.postings))
+        err = -ENOMEM;
+    if (!err)
+        err = writer_open_segment(&w);
+    if (err < 0) {
+        fprintf(stderr, "canlog: %s: %s\n", w.dir, strerror(-err));
+        return EXIT_FAILURE;
+    }
+
+    for (unsigned int i = 0; i < batch; ++i) {
+        iov[i].iov_base = &frames[i];
+        iov[i].iov_len = sizeof(frames[i]);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_control = ctrl[i];
+    }
+
+    while (running) {
+        int n;
+
+        for (unsigned int i = 0; i < batch; ++i)
+            msgs[i].msg_hdr.msg_controllen = sizeof(ctrl[i]);
+        // Block for the first frame, then take whatever else is queued
+        n = recvmmsg(fd, msgs, batch, MSG_WAITFORONE, NULL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            err = -errno;
+            fprintf(stderr, "canlog: recvmmsg: %s\n", strerror(errno));
+            break;
+        }
+        calls++;
+        for (int i = 0; i < n; ++i) {
+            struct msghdr *mh = &msgs[i].msg_hdr;
+            uint64_t ts_ns = 0;
+
+            if (msgs[i].msg_len != sizeof(struct can_frame))
+                continue;
+            for (struct cmsghdr *c = CMSG_FIRSTHDR(mh); c; c = CMSG_NXTHDR(mh, c)) {
+                if (c->cmsg_level != SOL_SOCKET)
+                    continue;
+                if (c->cmsg_type == SCM_TIMESTAMPNS) {
+                    struct timespec ts;
+
+                    memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                    ts_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+                } else if (c->cmsg_type == SO_RXQ_OVFL) {
+                    uint32_t ovfl;
+
+                    memcpy(&ovfl, CMSG_DATA(c), sizeof(ovfl));
+                    if (ovfl != last_ovfl) {
+                        w.hdr->dropped += ovfl - last_ovfl;
+                        dropped_total += ovfl - last_ovfl;
+                        last_ovfl = ovfl;
+                    }
+                }
+            }
+            if (!ts_ns) {
+                struct timespec ts;
+
+                clock_gettime(CLOCK_REALTIME, &ts);
+                ts_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+            }
+            err = writer_append(&w, &frames[i], ts_ns);
+            if (err < 0) {
+                fprintf(stderr, "canlog: segment %llu: %s\n", w.seq, strerror(-err));
+                running = 0;
+                break;
+            }
+            frames_total++;
+        }
+        if (w.hdr)
+            writer_publish(&w);
+    }
+
+    if (w.hdr && !w.count) {
+        // Nothing arrived since the last rotation: leave no empty segment
+        char path[4096];
+
+        munmap(w.hdr, w.map_len);
+        close(w.fd);
+        snprintf(path, sizeof(path), CANLOG_SEG_FMT, w.dir, w.seq);
+        unlink(path);
+        w.segments--;
+    } else if (w.hdr && writer_close_segment(&w) < 0) {
+        fprintf(stderr, "canlog: index of segment %llu failed\n", w.seq);
+    }
+    close(fd);
+
+    if (!quiet) {
+        getrusage(RUSAGE_SELF, &ru);
+        printf("canlog: %llu frames in %lu segment(s), %llu dropped, %.1f frames/call, CPU %.3f s\n",
+               frames_total, w.segments, dropped_total,
+               calls ? (double)frames_total / calls : 0.0,
+               ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+               (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6);
+    }
+    idmap_free(&w.idmap);
+    free(w.time);
+    free(w.postings);
+    free(w.cursor);
+    return err < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+/*
+ * canlog.h - on-disk format of the binary CAN log (canlog / canreplay)
+ *
+ * A log is a directory of segments, seg-00000000.canlog, seg-00000001.canlog,
+ * ... Each segment is a 4 KiB header followed by fixed-size 24-byte records
+ * in receive order. It is preallocated to its full size and written through
+ * a shared mapping; when it is full (or the logger stops) it is truncated to
+ * the records actually written and a seg-NNNNNNNN.idx file is written next
+ * to it with:
+ *   - a sparse time index, one entry every CANLOG_TIME_STRIDE records,
+ *   - the distinct CAN IDs of the segment, sorted, each with its count,
+ *   - the record numbers of every frame grouped by CAN ID ("postings").
+ * A segment without an .idx is the one still being written (or the last one
+ * of a logger that crashed); readers fall back to searching its records.
+ *
+ * All fields are little-endian host order; the tools are not meant to move
+ * logs between machines of different endianness.
+ */
+#ifndef CANLOG_H
+#define CANLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CANLOG_MAGIC        "CANLOG1"
+#define CANLOG_IDX_MAGIC    "CANIDX1"
+#define CANLOG_VERSION      1U
+#define CANLOG_HDR_SIZE     4096U   // records start page aligned
+#define CANLOG_TIME_STRIDE  1024U   // records per time index entry
+#define CANLOG_SEG_FMT      "%s/seg-%08llu.canlog"
+#define CANLOG_IDX_FMT      "%s/seg-%08llu.idx"
+
+// One classic CAN frame (the MCP2515 has no CAN FD)
+struct canlog_rec {
+    uint64_t ts_ns;     // kernel receive time, CLOCK_REALTIME
+    uint32_t can_id;    // as struct can_frame: CAN_EFF_FLAG / CAN_RTR_FLAG / CAN_ERR_FLAG
+    uint8_t len;
+    uint8_t flags;      // reserved, 0
+    uint16_t reserved;
+    uint8_t data[8];
+};
+
+_Static_assert(sizeof(struct canlog_rec) == 24, "canlog record must be 24 bytes");
+
+struct canlog_seg_hdr {
+    char magic[8];
+    uint32_t version;
+    uint32_t rec_size;
+    uint64_t seq;
+    uint64_t capacity;  // records that fit the preallocated file
+    uint64_t count;     // records written; release-stored once per batch
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint64_t dropped;   // frames the socket dropped while this segment was open
+    char ifname[16];
+};
+
+struct canlog_idx_hdr {
+    char magic[8];
+    uint32_t version;
+    uint32_t time_stride;
+    uint64_t seq;
+    uint64_t count;
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint32_t n_time;
+    uint32_t n_ids;
+    // followed by n_time canlog_time_ent, n_ids canlog_id_ent, count uint32_t postings
+};
+
+struct canlog_time_ent {
+    uint64_t ts_ns;
+    uint64_t rec;
+};
+
+struct canlog_id_ent {
+    uint32_t can_id;
+    uint32_t count;
+    uint64_t first;     // offset of this ID's postings
+};
+
+// A segment mapped read-only, with its index when it has one
+struct canlog_seg {
+    unsigned long long seq;
+    const struct canlog_seg_hdr *hdr;
+    const struct canlog_rec *rec;
+    uint64_t count;
+    void *map;
+    size_t map_len;
+    void *idx_map;
+    size_t idx_len;
+    const struct canlog_idx_hdr *idx;
+    const struct canlog_time_ent *time;
+    const struct canlog_id_ent *ids;
+    const uint32_t *postings;
+};
+
+int canlog_list(const char *dir, unsigned long long **seqs, size_t *count);
+int canlog_seg_open(struct canlog_seg *seg, const char *dir, unsigned long long seq);
+void canlog_seg_close(struct canlog_seg *seg);
+uint64_t canlog_seg_lower_bound(const struct canlog_seg *seg, uint64_t ts_ns);
+const struct canlog_id_ent *canlog_seg_find_id(const struct canlog_seg *seg, uint32_t can_id);
+
+#endif // CANLOG_H
@@ -0,0 +1,232 @@
+/*
+ * canlog_seg.c - read side of the binary CAN log, shared by the tools
+ */
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "canlog.h"
+
+static int cmp_seq(const void *a, const void *b)
+{
+    unsigned long long x = *(const unsigned long long *)a;
+    unsigned long long y = *(const unsigned long long *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+// Segment numbers found in dir, ascending; *seqs is malloc'd
+int canlog_list(const char *dir, unsigned long long **seqs, size_t *count)
+{
+    unsigned long long *list = NULL, *grown, seq;
+    size_t n = 0, cap = 0;
+    struct dirent *de;
+    DIR *d;
+    char tail;
+
+    d = opendir(dir);
+    if (!d)
+        return -errno;
+    while ((de = readdir(d)) != NULL) {
+        if (sscanf(de->d_name, "seg-%llu.canlo%c", &seq, &tail) != 2 || tail != 'g')
+            continue;
+        if (n == cap) {
+            cap = cap ? cap * 2 : 64;
+            grown = realloc(list, cap * sizeof(*list));
+            if (!grown) {
+                free(list);
+                closedir(d);
+                return -ENOMEM;
+            }
+            list = grown;
+        }
+        list[n++] = seq;
+    }
+    closedir(d);
+    qsort(list, n, sizeof(*list), cmp_seq);
+    *seqs = list;
+    *count = n;
+    return 0;
+}
+
+static void *map_file(const char *path, size_t *len)
+{
+    struct stat st;
+    void *map;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+    *len = st.st_size;
+    return map;
+}
+
+// Every record number the readers follow must be inside the segment, and
+// the binary searches need the order the writer produced: time entries and
+// IDs ascending, each ID's postings contiguous and in record order
+static int seg_idx_valid(const struct canlog_seg *seg)
+{
+    const struct canlog_idx_hdr *idx = seg->idx;
+    uint64_t i, j, first = 0;
+
+    for (i = 0; i < idx->n_time; ++i) {
+        if (seg->time[i].rec >= seg->count ||
+            (i && seg->time[i].rec <= seg->time[i - 1].rec))
+            return 0;
+    }
+    for (i = 0; i < idx->n_ids; ++i) {
+        const struct canlog_id_ent *ent = &seg->ids[i];
+
+        if ((i && ent->can_id <= seg->ids[i - 1].can_id) || ent->first != first ||
+            ent->count > seg->count - first)
+            return 0;
+        for (j = first; j < first + ent->count; ++j) {
+            if (seg->postings[j] >= seg->count ||
+                (j > first && seg->postings[j] <= seg->postings[j - 1]))
+                return 0;
+        }
+        first += ent->count;
+    }
+    return first == seg->count;
+}
+
+static void seg_load_idx(struct canlog_seg *seg, const char *dir)
+{
+    const struct canlog_idx_hdr *idx;
+    char path[4096];
+    uint64_t need;
+
+    snprintf(path, sizeof(path), CANLOG_IDX_FMT, dir, seg->seq);
+    seg->idx_map = map_file(path, &seg->idx_len);
+    if (!seg->idx_map)
+        return;
+    idx = seg->idx_map;
+    // A stale, torn or corrupt index is ignored, never trusted
+    if (seg->idx_len < sizeof(*idx) || memcmp(idx->magic, CANLOG_IDX_MAGIC, 8) ||
+        idx->version != CANLOG_VERSION || idx->count != seg->count)
+        goto bad;
+    // 64-bit: no overflow even with a 32-bit size_t
+    need = sizeof(*idx) + (uint64_t)idx->n_time * sizeof(struct canlog_time_ent) +
+           (uint64_t)idx->n_ids * sizeof(struct canlog_id_ent) + idx->count * sizeof(uint32_t);
+    if (seg->idx_len < need)
+        goto bad;
+    seg->idx = idx;
+    seg->time = (const struct canlog_time_ent *)(idx + 1);
+    seg->ids = (const struct canlog_id_ent *)(seg->time + idx->n_time);
+    seg->postings = (const uint32_t *)(seg->ids + idx->n_ids);
+    if (seg_idx_valid(seg))
+        return;
+    seg->idx = NULL;
+    seg->time = NULL;
+    seg->ids = NULL;
+    seg->postings = NULL;
+bad:
+    munmap(seg->idx_map, seg->idx_len);
+    seg->idx_map = NULL;
+}
+
+int canlog_seg_open(struct canlog_seg *seg, const char *dir, unsigned long long seq)
+{
+    const struct canlog_seg_hdr *hdr;
+    char path[4096];
+    uint64_t fits;
+
+    memset(seg, 0, sizeof(*seg));
+    seg->seq = seq;
+    snprintf(path, sizeof(path), CANLOG_SEG_FMT, dir, seq);
+    seg->map = map_file(path, &seg->map_len);
+    if (!seg->map)
+        return -errno ? -errno : -EINVAL;
+    hdr = seg->map;
+    if (seg->map_len < CANLOG_HDR_SIZE || memcmp(hdr->magic, CANLOG_MAGIC, 8) ||
+        hdr->version != CANLOG_VERSION || hdr->rec_size != sizeof(struct canlog_rec)) {
+        munmap(seg->map, seg->map_len);
+        return -EINVAL;
+    }
+    seg->hdr = hdr;
+    seg->rec = (const struct canlog_rec *)((const char *)seg->map + CANLOG_HDR_SIZE);
+    // The logger may be appending: count is what was complete at map time,
+    // and the acquire pairs with its release so those records are visible
+    fits = (seg->map_len - CANLOG_HDR_SIZE) / sizeof(struct canlog_rec);
+    seg->count = __atomic_load_n(&hdr->count, __ATOMIC_ACQUIRE);
+    if (seg->count > fits)
+        seg->count = fits;
+    seg_load_idx(seg, dir);
+    return 0;
+}
+
+void canlog_seg_close(struct canlog_seg *seg)
+{
+    if (seg->idx_map)
+        munmap(seg->idx_map, seg->idx_len);
+    if (seg->map)
+        munmap(seg->map, seg->map_len);
+    memset(seg, 0, sizeof(*seg));
+}
+
+// First record with ts_ns >= ts_ns (records are in receive order)
+uint64_t canlog_seg_lower_bound(const struct canlog_seg *seg, uint64_t ts_ns)
+{
+    uint64_t lo = 0, hi = seg->count;
+
+    // Narrow to one stride with the time index, then search the records
+    if (seg->idx && seg->idx->n_time) {
+        uint32_t l = 0, h = seg->idx->n_time;
+
+        while (l < h) {
+            uint32_t m = l + (h - l) / 2;
+
+            if (seg->time[m].ts_ns < ts_ns)
+                l = m + 1;
+            else
+                h = m;
+        }
+        if (l > 0)
+            lo = seg->time[l - 1].rec;
+        if (l < seg->idx->n_time)
+            hi = seg->time[l].rec;
+    }
+    while (lo < hi) {
+        uint64_t m = lo + (hi - lo) / 2;
+
+        if (seg->rec[m].ts_ns < ts_ns)
+            lo = m + 1;
+        else
+            hi = m;
+    }
+    return lo;
+}
+
+const struct canlog_id_ent *canlog_seg_find_id(const struct canlog_seg *seg, uint32_t can_id)
+{
+    uint32_t lo = 0, hi;
+
+    if (!seg->idx)
+        return NULL;
+    hi = seg->idx->n_ids;
+    while (lo < hi) {
+        uint32_t m = lo + (hi - lo) / 2;
+
+        if (seg->ids[m].can_id < can_id)
+            lo = m + 1;
+        else
+            hi = m;
+    }
+    return lo < seg->idx->n_ids && seg->ids[lo].can_id == can_id ? &seg->ids[lo] : NULL;
+}
@@ -0,0 +1,354 @@
+/*
+ * canreplay.c - list, print or re-inject a window of a canlog log
+ *
+ * Frames are sent at their original spacing (scaled by -x) against an
+ * absolute CLOCK_MONOTONIC schedule, so a late wakeup does not push every
+ * later frame back. The start of the window is found with the segments'
+ * time index; with -I the ID index is used to visit only that ID's frames.
+ * Printed output (-p) is in candump -L format, so it also feeds canplayer.
+ *
+ * Usage: canreplay [-l] [-p] [-i iface] [-s start] [-e end] [-I id] [-x speed] dir
+ *   start/end: seconds since the epoch, or "+N" seconds from the first frame
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <net/if.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+#include "canlog.h"
+
+struct replay {
+    const char *ifname;
+    int fd;                     // -1 with -p
+    double speed;               // 0: as fast as possible
+    uint64_t start_ns, end_ns;
+    int have_id;
+    uint32_t can_id;
+    // schedule
+    int started;
+    uint64_t base_log_ns;
+    uint64_t base_mono_ns;
+    unsigned long long sent;
+    uint64_t max_late_ns;
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void signal_handler(int sig)
+{
+    (void)sig;
+    running = 0;
+}
+
+static void print_usage(const char *program_name)
+{
+    printf("Usage: %s [OPTIONS] <dir>\n", program_name);
+    printf("Options:\n");
+    printf("  -l            List the segments and exit\n");
+    printf("  -p            Print the frames (candump -L format) instead of sending\n");
+    printf("  -i <iface>    Interface to send on (default: vcan0)\n");
+    printf("  -s <time>     Window start: epoch seconds, or +seconds from the first frame\n");
+    printf("  -e <time>     Window end, same format (default: end of log)\n");
+    printf("  -I <id>       Only this CAN ID (hex; add 0x80000000 for extended)\n");
+    printf("  -x <speed>    Timing factor, 2 = twice as fast, 0 = no pacing (default: 1)\n");
+}
+
+static uint64_t mono_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// "+N" is relative to base_ns, anything else absolute epoch seconds
+static uint64_t parse_time(const char *arg, uint64_t base_ns)
+{
+    double s = strtod(arg[0] == '+' ? arg + 1 : arg, NULL);
+    uint64_t ns = s > 0.0 ? (uint64_t)(s * 1e9) : 0;
+
+    return arg[0] == '+' ? base_ns + ns : ns;
+}
+
+static int open_socket(const char *ifname)
+{
+    struct sockaddr_can addr;
+    struct ifreq ifr;
+    int fd, err;
+
+    fd = socket(PF_CAN, SOCK_RAW | SOCK_CLOEXEC, CAN_RAW);
+    if (fd < 0)
+        return -errno;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0)
+        goto fail;
+    addr.can_ifindex = ifr.ifr_ifindex;
+    // Send only: nothing is read from this socket
+    setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FILTER, NULL, 0);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+        goto fail;
+    return fd;
+fail:
+    err = -errno;
+    close(fd);
+    return err;
+}
+
+static void print_rec(const struct canlog_rec *r, const char *ifname)
+{
+    char data[2 * 8 + 1];
+
+    for (unsigned int i = 0; i < r->len && i < 8; ++i)
+        sprintf(data + 2 * i, "%02X", r->data[i]);
+    data[r->len < 8 ? 2 * r->len : 16] = '\0';
+    printf("(%llu.%06llu) %s ", (unsigned long long)(r->ts_ns / 1000000000ULL),
+           (unsigned long long)(r->ts_ns % 1000000000ULL) / 1000, ifname);
+    if (r->can_id & CAN_EFF_FLAG)
+        printf("%08X#", r->can_id & CAN_EFF_MASK);
+    else
+        printf("%03X#", r->can_id & CAN_SFF_MASK);
+    printf("%s\n", r->can_id & CAN_RTR_FLAG ? "R" : data);
+}
+
+static int send_rec(struct replay *rp, const struct canlog_rec *r)
+{
+    struct can_frame cf;
+    uint64_t now;
+
+    if (rp->speed > 0.0) {
+        uint64_t target;
+        struct timespec ts;
+
+        if (!rp->started) {
+            rp->base_log_ns = r->ts_ns;
+            rp->base_mono_ns = mono_ns();
+            rp->started = 1;
+        }
+        target = rp->base_mono_ns +
+                 (uint64_t)((double)(r->ts_ns - rp->base_log_ns) / rp->speed);
+        ts.tv_sec = target / 1000000000ULL;
+        ts.tv_nsec = target % 1000000000ULL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+            if (!running)
+                return 0;
+        }
+        now = mono_ns();
+        if (now > target && now - target > rp->max_late_ns)
+            rp->max_late_ns = now - target;
+    }
+
+    if (rp->fd < 0) {
+        print_rec(r, rp->ifname);
+        rp->sent++;
+        return 0;
+    }
+    memset(&cf, 0, sizeof(cf));
+    cf.can_id = r->can_id;
+    cf.len = r->len;
+    memcpy(cf.data, r->data, sizeof(cf.data));
+    while (write(rp->fd, &cf, sizeof(cf)) != sizeof(cf)) {
+        struct pollfd pfd = { rp->fd, POLLOUT, 0 };
+
+        // TX queue full: wait for the controller to drain it
+        if (errno == ENOBUFS || errno == EAGAIN)
+            poll(&pfd, 1, 100);
+        else if (errno != EINTR)
+            return -errno;
+        if (!running)
+            return 0;
+    }
+    rp->sent++;
+    return 0;
+}
+
+static int replay_segment(struct replay *rp, const struct canlog_seg *seg)
+{
+    const struct canlog_id_ent *ent;
+    uint64_t r = canlog_seg_lower_bound(seg, rp->start_ns);
+    int err;
+
+    if (rp->have_id && seg->idx) {
+        const uint32_t *post, *end;
+
+        ent = canlog_seg_find_id(seg, rp->can_id);
+        if (!ent)
+            return 0;
+        post = seg->postings + ent->first;
+        end = post + ent->count;
+        // Postings are in record order: skip to the window start
+        while (post < end) {
+            const uint32_t *mid = post + (end - post) / 2;
+
+            if (*mid < r)
+                post = mid + 1;
+            else
+                end = mid;
+        }
+        for (end = seg->postings + ent->first + ent->count; post < end && running; ++post) {
+            if (seg->rec[*post].ts_ns > rp->end_ns)
+                break;
+            err = send_rec(rp, &seg->rec[*post]);
+            if (err < 0)
+                return err;
+        }
+        return 0;
+    }
+
+    for (; r < seg->count && running; ++r) {
+        if (seg->rec[r].ts_ns > rp->end_ns)
+            break;
+        if (rp->have_id && seg->rec[r].can_id != rp->can_id)
+            continue;
+        err = send_rec(rp, &seg->rec[r]);
+        if (err < 0)
+            return err;
+    }
+    return 0;
+}
+
+static void list_segment(const struct canlog_seg *seg)
+{
+    const struct canlog_seg_hdr *h = seg->hdr;
+    double span = seg->count ? (h->last_ns - h->first_ns) / 1e9 : 0.0;
+
+    printf("seg %08llu  %-8s %10llu frames  %llu.%06llu +%.3f s  %llu dropped  ",
+           seg->seq, h->ifname, (unsigned long long)seg->count,
+           (unsigned long long)(h->first_ns / 1000000000ULL),
+           (unsigned long long)(h->first_ns % 1000000000ULL) / 1000, span,
+           (unsigned long long)h->dropped);
+    if (seg->idx)
+        printf("%u IDs\n", seg->idx->n_ids);
+    else
+        printf("not indexed (open)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    struct replay rp;
+    struct canlog_seg seg;
+    struct sigaction sa;
+    unsigned long long *seqs;
+    const char *dir, *start_arg = NULL, *end_arg = NULL;
+    uint64_t log_first_ns = 0;
+    size_t n;
+    int opt, list = 0, print = 0, err;
+
+    memset(&rp, 0, sizeof(rp));
+    rp.ifname = "vcan0";
+    rp.fd = -1;
+    rp.speed = 1.0;
+    rp.end_ns = UINT64_MAX;
+    while ((opt = getopt(argc, argv, "hlpi:s:e:I:x:")) != -1) {
+        switch (opt) {
+            case 'l':
+                list = 1;
+                break;
+            case 'p':
+                print = 1;
+                break;
+            case 'i':
+                rp.ifname = optarg;
+                break;
+            case 's':
+                start_arg = optarg;
+                break;
+            case 'e':
+                end_arg = optarg;
+                break;
+            case 'I':
+                rp.have_id = 1;
+                rp.can_id = (uint32_t)strtoul(optarg, NULL, 16);
+                break;
+            case 'x':
+                rp.speed = strtod(optarg, NULL);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    dir = argv[optind];
+
+    err = canlog_list(dir, &seqs, &n);
+    if (err < 0) {
+        fprintf(stderr, "canreplay: %s: %s\n", dir, strerror(-err));
+        return EXIT_FAILURE;
+    }
+
+    if (list) {
+        for (size_t i = 0; i < n; ++i) {
+            if (canlog_seg_open(&seg, dir, seqs[i]) < 0)
+                continue;
+            list_segment(&seg);
+            canlog_seg_close(&seg);
+        }
+        free(seqs);
+        return EXIT_SUCCESS;
+    }
+
+    // "+N" times are relative to the first frame of the log
+    for (size_t i = 0; i < n && !log_first_ns; ++i) {
+        if (canlog_seg_open(&seg, dir, seqs[i]) < 0)
+            continue;
+        if (seg.count)
+            log_first_ns = seg.rec[0].ts_ns;
+        canlog_seg_close(&seg);
+    }
+    if (start_arg)
+        rp.start_ns = parse_time(start_arg, log_first_ns);
+    if (end_arg)
+        rp.end_ns = parse_time(end_arg, log_first_ns);
+
+    if (!print) {
+        rp.fd = open_socket(rp.ifname);
+        if (rp.fd < 0) {
+            fprintf(stderr, "canreplay: %s: %s\n", rp.ifname, strerror(-rp.fd));
+            free(seqs);
+            return EXIT_FAILURE;
+        }
+    }
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_handler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    err = 0;
+    for (size_t i = 0; i < n && running && !err; ++i) {
+        if (canlog_seg_open(&seg, dir, seqs[i]) < 0)
+            continue;
+        if (seg.count && seg.rec[seg.count - 1].ts_ns >= rp.start_ns &&
+            seg.rec[0].ts_ns <= rp.end_ns)
+            err = replay_segment(&rp, &seg);
+        canlog_seg_close(&seg);
+    }
+    if (err < 0)
+        fprintf(stderr, "canreplay: %s: %s\n", rp.ifname, strerror(-err));
+
+    if (!print || rp.speed > 0.0)
+        fprintf(stderr, "canreplay: %llu frames, max lateness %.1f us\n",
+                rp.sent, rp.max_late_ns / 1e3);
+    if (rp.fd >= 0)
+        close(rp.fd);
+    free(seqs);
+    return err < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# Per-frame cost of the mcp2515 driver with and without prebuilt SPI messages.
+# The controller runs in internal loopback, so every frame sent is also
+# received: both the TX and the RX path are measured, no bus needed.
+# Needs root and cangen (can-utils). Usage: ./mcp2515_bench.sh [iface [frames]]
+set -e
+
+IFACE=${1:-can0}
+FRAMES=${2:-5000}
+PARAM=/sys/module/mcp2515/parameters/prebuilt
+SPI_DEV=$(basename "$(readlink -f /sys/class/net/"$IFACE"/device)")
+STATS=/sys/kernel/debug/mcp2515/$SPI_DEV/stats
+
+stat() {
+    awk -v key="$1:" '$1 == key { print $2 }' "$STATS"
+}
+
+ip link set "$IFACE" down
+ip link set "$IFACE" type can bitrate 1000000 loopback on
+ip link set "$IFACE" up
+trap 'ip link set "$IFACE" down; ip link set "$IFACE" type can loopback off' EXIT
+
+printf "%-10s %10s %10s %12s %12s %10s\n" prebuilt frames "spi us/msg" "tx us/frame" "rx us/frame" "msgs/frame"
+for mode in 0 1; do
+    echo $mode > $PARAM
+    msgs0=$(stat spi_msgs); spi0=$(stat spi_ns)
+    txf0=$(stat tx_frames); tx0=$(stat tx_ns)
+    rxf0=$(stat rx_frames); rx0=$(stat rx_ns)
+
+    # -g 0 with the single TX buffer: the driver's own pace is the limit
+    cangen "$IFACE" -g 0 -p 10 -I 123 -L 8 -D i -n "$FRAMES"
+    sleep 0.5
+
+    msgs=$(( $(stat spi_msgs) - msgs0 )); spi=$(( $(stat spi_ns) - spi0 ))
+    txf=$(( $(stat tx_frames) - txf0 )); tx=$(( $(stat tx_ns) - tx0 ))
+    rxf=$(( $(stat rx_frames) - rxf0 )); rx=$(( $(stat rx_ns) - rx0 ))
+    awk -v m=$mode -v f=$txf -v msgs=$msgs -v spi=$spi -v tx=$tx -v rxf=$rxf -v rx=$rx 'BEGIN {
+        printf "%-10s %10d %10.2f %12.2f %12.2f %10.2f\n", m ? "yes" : "no", f,
+               msgs ? spi / msgs / 1e3 : 0, f ? tx / f / 1e3 : 0,
+               rxf ? rx / rxf / 1e3 : 0, f ? msgs / f : 0 }'
+done
+echo 1 > $PARAM
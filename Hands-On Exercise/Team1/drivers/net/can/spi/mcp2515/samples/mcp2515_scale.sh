@@ -0,0 +1,77 @@
+#!/bin/bash
+
+# Aggregate throughput of several mcp2515 controllers as they are added.
+# Every controller runs in internal loopback; step n floods the first n at
+# once with cangen and sums frames/s and drops from the interface counters.
+# The per-bus arbitration stats are printed at the end.
+# Needs root and cangen (can-utils).
+# Usage: ./mcp2515_scale.sh [seconds [iface...]]   (default: all mcp2515 ifaces)
+# PIN=1 pins controller i's worker to CPU i mod nproc through irq_cpu.
+set -e
+
+SECS=${1:-5}
+shift || true
+IFACES=("$@")
+if [ ${#IFACES[@]} -eq 0 ]; then
+    for d in /sys/class/net/*; do
+        [ "$(basename "$(readlink -f "$d/device/driver")")" = mcp2515 ] &&
+            IFACES+=("$(basename "$d")")
+    done
+fi
+[ ${#IFACES[@]} -gt 0 ] || { echo "no mcp2515 interfaces" >&2; exit 1; }
+
+counter() {
+    cat /sys/class/net/"$1"/statistics/"$2"
+}
+
+# Frames received plus frames lost, summed over the first $1 interfaces
+totals() {
+    local rx=0 drops=0 i
+    for i in "${IFACES[@]:0:$1}"; do
+        rx=$(( rx + $(counter "$i" rx_packets) ))
+        drops=$(( drops + $(counter "$i" rx_dropped) + $(counter "$i" rx_over_errors) ))
+    done
+    echo "$rx $drops"
+}
+
+cleanup() {
+    kill $(jobs -p) 2>/dev/null || true
+    for i in "${IFACES[@]}"; do
+        ip link set "$i" down
+        ip link set "$i" type can loopback off
+    done
+}
+trap cleanup EXIT
+
+cpus=$(nproc)
+for idx in "${!IFACES[@]}"; do
+    i=${IFACES[$idx]}
+    ip link set "$i" down
+    ip link set "$i" type can bitrate 1000000 loopback on
+    ip link set "$i" up
+    if [ "${PIN:-0}" = 1 ]; then
+        echo $(( idx % cpus )) > "$(readlink -f /sys/class/net/"$i"/device)/irq_cpu"
+    fi
+done
+
+printf "%-6s %12s %12s %10s %8s\n" ctrls "frames/s" "per ctrl" drops "drop %"
+for n in $(seq 1 ${#IFACES[@]}); do
+    read -r rx0 drops0 < <(totals "$n")
+    for i in "${IFACES[@]:0:n}"; do
+        cangen "$i" -g 0 -p 10 -I i -L 8 -D i &
+    done
+    sleep "$SECS"
+    kill $(jobs -p)
+    wait 2>/dev/null || true
+    sleep 0.5
+    read -r rx1 drops1 < <(totals "$n")
+    awk -v n=$n -v s="$SECS" -v rx=$(( rx1 - rx0 )) -v d=$(( drops1 - drops0 )) 'BEGIN {
+        printf "%-6d %12.0f %12.0f %10d %8.3f\n", n, rx / s, rx / s / n, d,
+               rx + d ? 100 * d / (rx + d) : 0 }'
+done
+
+for f in /sys/kernel/debug/mcp2515/bus-*/stats; do
+    [ -r "$f" ] || continue
+    echo "== $(basename "$(dirname "$f")")"
+    cat "$f"
+done
@@ -0,0 +1,132 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * codec_kunit.h -- KUnit fixture for a GPIO-driven ASoC codec
+ *
+ * A fake one-line GPIO chip that logs every level it is set to, and just
+ * enough ASoC around the codec callbacks for drvdata and the stream: a root
+ * device, a component, a DAI and a substream. Included by the *_kunit.c
+ * file of this directory only, so everything here is static.
+ */
+#ifndef _CODEC_KUNIT_H
+#define _CODEC_KUNIT_H
+
+#include <kunit/test.h>
+#include <linux/device.h>
+#include <linux/gpio/driver.h>
+#include <linux/version.h>
+#include <sound/soc.h>
+
+#define CODEC_KUNIT_GPIO_LOG	16
+
+struct codec_kunit_gpio {
+	struct gpio_chip chip;
+	int level;
+	unsigned int n_sets;
+	int log[CODEC_KUNIT_GPIO_LOG];
+};
+
+struct codec_kunit {
+	struct device *dev;
+	struct codec_kunit_gpio *gpio;
+	struct snd_soc_component *component;
+	struct snd_soc_dai *dai;
+	struct snd_pcm_substream *substream;
+};
+
+static void codec_kunit_gpio_log(struct codec_kunit_gpio *gpio, int value)
+{
+	if (gpio->n_sets < CODEC_KUNIT_GPIO_LOG)
+		gpio->log[gpio->n_sets] = value;
+	gpio->n_sets++;
+	gpio->level = value;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 17, 0)
+static int codec_kunit_gpio_set(struct gpio_chip *gc, unsigned int offset,
+				int value)
+{
+	codec_kunit_gpio_log(gpiochip_get_data(gc), value);
+	return 0;
+}
+#else
+static void codec_kunit_gpio_set(struct gpio_chip *gc, unsigned int offset,
+				 int value)
+{
+	codec_kunit_gpio_log(gpiochip_get_data(gc), value);
+}
+#endif
+
+static int codec_kunit_gpio_get(struct gpio_chip *gc, unsigned int offset)
+{
+	struct codec_kunit_gpio *gpio = gpiochip_get_data(gc);
+
+	return gpio->level;
+}
+
+/* The initial GPIOD_OUT_LOW lands here, so it is not in the log */
+static int codec_kunit_gpio_output(struct gpio_chip *gc, unsigned int offset,
+				   int value)
+{
+	struct codec_kunit_gpio *gpio = gpiochip_get_data(gc);
+
+	gpio->level = value;
+	return 0;
+}
+
+static int codec_kunit_gpio_get_direction(struct gpio_chip *gc,
+					  unsigned int offset)
+{
+	return GPIO_LINE_DIRECTION_OUT;
+}
+
+/*
+ * Registers the root device and the GPIO chip, both named name, and sets
+ * drvdata on the component. Undo with codec_kunit_exit().
+ */
+static void codec_kunit_init(struct kunit *test, struct codec_kunit *c,
+			     const char *name, void *drvdata, int stream)
+{
+	struct gpio_chip *chip;
+
+	c->dev = root_device_register(name);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, c->dev);
+
+	c->gpio = kunit_kzalloc(test, sizeof(*c->gpio), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, c->gpio);
+	chip = &c->gpio->chip;
+	chip->label = name;
+	chip->owner = THIS_MODULE;
+	chip->base = -1;
+	chip->ngpio = 1;
+	chip->set = codec_kunit_gpio_set;
+	chip->get = codec_kunit_gpio_get;
+	chip->direction_output = codec_kunit_gpio_output;
+	chip->get_direction = codec_kunit_gpio_get_direction;
+	KUNIT_ASSERT_EQ(test, gpiochip_add_data(chip, c->gpio), 0);
+
+	c->component = kunit_kzalloc(test, sizeof(*c->component), GFP_KERNEL);
+	c->dai = kunit_kzalloc(test, sizeof(*c->dai), GFP_KERNEL);
+	c->substream = kunit_kzalloc(test, sizeof(*c->substream), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, c->component);
+	KUNIT_ASSERT_NOT_NULL(test, c->dai);
+	KUNIT_ASSERT_NOT_NULL(test, c->substream);
+	c->component->dev = c->dev;
+	snd_soc_component_set_drvdata(c->component, drvdata);
+	c->dai->component = c->component;
+	c->dai->dev = c->dev;
+	c->substream->stream = stream;
+}
+
+/*
+ * Unregistering the device first releases any devm GPIO taken on it;
+ * descriptors requested another way must be freed before this.
+ */
+static void codec_kunit_exit(struct codec_kunit *c)
+{
+	if (!IS_ERR_OR_NULL(c->dev))
+		root_device_unregister(c->dev);
+	if (c->gpio && c->gpio->chip.gpiodev)
+		gpiochip_remove(&c->gpio->chip);
+}
+
+#endif /* _CODEC_KUNIT_H */
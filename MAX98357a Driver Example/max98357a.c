@@ -5,6 +5,7 @@
  */
 
 #include <linux/acpi.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
 #include <linux/err.h>
@@ -15,23 +16,135 @@
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/timekeeping.h>
 #include <sound/pcm.h>
+#include <sound/pcm_params.h>
 #include <sound/soc.h>
 #include <sound/soc-dai.h>
 #include <sound/soc-dapm.h>
 
+#define CREATE_TRACE_POINTS
+#include "max98357a_trace.h"
+
+#include "codec_stats.h"
+
+enum max98357a_rec_type {
+	MAX98357A_REC_TRIGGER,
+	MAX98357A_REC_HW_PARAMS,
+	MAX98357A_REC_DAPM,
+	MAX98357A_REC_SDMODE,
+};
+
+static const char * const max98357a_rec_names[] = {
+	[MAX98357A_REC_TRIGGER]		= "trigger",
+	[MAX98357A_REC_HW_PARAMS]	= "hw_params",
+	[MAX98357A_REC_DAPM]		= "dapm",
+	[MAX98357A_REC_SDMODE]		= "sdmode",
+};
+
+/*
+ * Stream, DAPM and SD_MODE activity for debugfs, with the time a trigger
+ * took to switch SD_MODE. Only updated while codec_stats_on().
+ */
+struct max98357a_stats {
+	spinlock_t lock;
+	u64 starts;
+	u64 stops;
+	u64 hw_params;
+	u64 dapm_pmu;
+	u64 dapm_pmd;
+	u64 sdmode_on;
+	u64 sdmode_off;
+	u64 sdmode_seq_last_ns;
+	u64 sdmode_seq_max_ns;
+	struct codec_history history;
+};
+
 struct max98357a_priv {
 	struct gpio_desc *sdmode;
 	unsigned int sdmode_delay;
 	int sdmode_switch;
+	struct max98357a_stats stats;
+	/* The card itself is timed by boot-audio-latency.sh */
+	struct codec_boot boot;
 };
 
+static struct dentry *max98357a_debugfs_root;
+static u64 max98357a_load_ns;
+
+/* @duration_ns is trigger entry to SD_MODE write, 0 for the other records */
+static void max98357a_record(struct max98357a_priv *max98357a,
+		enum max98357a_rec_type type, int arg, u64 duration_ns)
+{
+	struct max98357a_stats *st = &max98357a->stats;
+	unsigned long flags;
+
+	if (!codec_stats_on())
+		return;
+
+	spin_lock_irqsave(&st->lock, flags);
+	switch (type) {
+	case MAX98357A_REC_TRIGGER:
+		if (arg == SNDRV_PCM_TRIGGER_START ||
+		    arg == SNDRV_PCM_TRIGGER_RESUME ||
+		    arg == SNDRV_PCM_TRIGGER_PAUSE_RELEASE)
+			st->starts++;
+		else
+			st->stops++;
+		break;
+	case MAX98357A_REC_HW_PARAMS:
+		st->hw_params++;
+		break;
+	case MAX98357A_REC_DAPM:
+		if (arg & SND_SOC_DAPM_POST_PMU)
+			st->dapm_pmu++;
+		else
+			st->dapm_pmd++;
+		break;
+	case MAX98357A_REC_SDMODE:
+		if (arg) {
+			st->sdmode_on++;
+			st->sdmode_seq_last_ns = duration_ns;
+			st->sdmode_seq_max_ns = max(st->sdmode_seq_max_ns,
+						    duration_ns);
+		} else {
+			st->sdmode_off++;
+		}
+		break;
+	}
+
+	codec_history_add(&st->history, ktime_get_ns(), type, arg, duration_ns);
+	spin_unlock_irqrestore(&st->lock, flags);
+}
+
+static void max98357a_set_sdmode(struct snd_soc_component *component,
+		struct max98357a_priv *max98357a, int value, u64 start_ns)
+{
+	u64 seq_ns = 0;
+
+	gpiod_set_value(max98357a->sdmode, value);
+	if (start_ns)
+		seq_ns = ktime_get_ns() - start_ns;
+	trace_max98357a_sdmode(component->dev, value, seq_ns);
+	max98357a_record(max98357a, MAX98357A_REC_SDMODE, value, seq_ns);
+	dev_dbg(component->dev, "set sdmode to %d", value);
+}
+
 static int max98357a_daiops_trigger(struct snd_pcm_substream *substream,
 		int cmd, struct snd_soc_dai *dai)
 {
 	struct snd_soc_component *component = dai->component;
 	struct max98357a_priv *max98357a =
 		snd_soc_component_get_drvdata(component);
+	u64 start_ns = 0;
+
+	/* Only time the SD_MODE sequence when someone is looking at it */
+	if (codec_stats_on() || trace_max98357a_sdmode_enabled())
+		start_ns = ktime_get_ns();
+	trace_max98357a_trigger(component->dev, substream->stream, cmd);
+	max98357a_record(max98357a, MAX98357A_REC_TRIGGER, cmd, 0);
 
 	if (!max98357a->sdmode)
 		return 0;
@@ -41,22 +154,34 @@ static int max98357a_daiops_trigger(struct snd_pcm_substream *substream,
 	case SNDRV_PCM_TRIGGER_RESUME:
 	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
 		mdelay(max98357a->sdmode_delay);
-		if (max98357a->sdmode_switch) {
-			gpiod_set_value(max98357a->sdmode, 1);
-			dev_dbg(component->dev, "set sdmode to 1");
-		}
+		if (max98357a->sdmode_switch)
+			max98357a_set_sdmode(component, max98357a, 1, start_ns);
 		break;
 	case SNDRV_PCM_TRIGGER_STOP:
 	case SNDRV_PCM_TRIGGER_SUSPEND:
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
-		gpiod_set_value(max98357a->sdmode, 0);
-		dev_dbg(component->dev, "set sdmode to 0");
+		max98357a_set_sdmode(component, max98357a, 0, start_ns);
 		break;
 	}
 
 	return 0;
 }
 
+static int max98357a_daiops_hw_params(struct snd_pcm_substream *substream,
+		struct snd_pcm_hw_params *params, struct snd_soc_dai *dai)
+{
+	struct max98357a_priv *max98357a =
+		snd_soc_component_get_drvdata(dai->component);
+
+	trace_max98357a_hw_params(dai->dev, params_rate(params),
+				  params_channels(params),
+				  params_width(params));
+	max98357a_record(max98357a, MAX98357A_REC_HW_PARAMS,
+			 params_rate(params), 0);
+
+	return 0;
+}
+
 static int max98357a_sdmode_event(struct snd_soc_dapm_widget *w,
 		struct snd_kcontrol *kcontrol, int event)
 {
@@ -65,6 +190,9 @@ static int max98357a_sdmode_event(struct snd_soc_dapm_widget *w,
 	struct max98357a_priv *max98357a =
 		snd_soc_component_get_drvdata(component);
 
+	trace_max98357a_dapm_event(component->dev, w->name, event);
+	max98357a_record(max98357a, MAX98357A_REC_DAPM, event, 0);
+
 	if (event & SND_SOC_DAPM_POST_PMU)
 		max98357a->sdmode_switch = 1;
 	else if (event & SND_SOC_DAPM_POST_PMD)
@@ -97,6 +225,7 @@ static const struct snd_soc_component_driver max98357a_component_driver = {
 
 static const struct snd_soc_dai_ops max98357a_dai_ops = {
 	.trigger        = max98357a_daiops_trigger,
+	.hw_params      = max98357a_daiops_hw_params,
 };
 
 static struct snd_soc_dai_driver max98357a_dai_driver = {
@@ -121,6 +250,72 @@ static struct snd_soc_dai_driver max98357a_dai_driver = {
 	.ops    = &max98357a_dai_ops,
 };
 
+static int max98357a_stats_show(struct seq_file *s, void *unused)
+{
+	struct max98357a_priv *max98357a = s->private;
+	struct max98357a_stats *st = &max98357a->stats, snap;
+	unsigned long flags;
+
+	spin_lock_irqsave(&st->lock, flags);
+	snap = *st;
+	spin_unlock_irqrestore(&st->lock, flags);
+
+	seq_printf(s, "starts: %llu\n", snap.starts);
+	seq_printf(s, "stops: %llu\n", snap.stops);
+	seq_printf(s, "hw_params: %llu\n", snap.hw_params);
+	seq_printf(s, "dapm_pmu: %llu\n", snap.dapm_pmu);
+	seq_printf(s, "dapm_pmd: %llu\n", snap.dapm_pmd);
+	seq_printf(s, "sdmode_on: %llu\n", snap.sdmode_on);
+	seq_printf(s, "sdmode_off: %llu\n", snap.sdmode_off);
+	seq_printf(s, "sdmode_seq_last_ns: %llu\n", snap.sdmode_seq_last_ns);
+	seq_printf(s, "sdmode_seq_max_ns: %llu\n", snap.sdmode_seq_max_ns);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(max98357a_stats);
+
+static int max98357a_history_show(struct seq_file *s, void *unused)
+{
+	struct max98357a_priv *max98357a = s->private;
+
+	codec_history_show(s, &max98357a->stats.lock,
+			   &max98357a->stats.history, max98357a_rec_names);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(max98357a_history);
+
+static int max98357a_boot_show(struct seq_file *s, void *unused)
+{
+	struct max98357a_priv *max98357a = s->private;
+
+	codec_boot_show(s, max98357a_load_ns, &max98357a->boot);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(max98357a_boot);
+
+static void max98357a_debugfs_remove(void *data)
+{
+	debugfs_remove_recursive(data);
+}
+
+static int max98357a_debugfs_init(struct device *dev,
+		struct max98357a_priv *max98357a)
+{
+	struct dentry *dir;
+
+	spin_lock_init(&max98357a->stats.lock);
+	if (!IS_ENABLED(CONFIG_DEBUG_FS))
+		return 0;
+
+	dir = debugfs_create_dir(dev_name(dev), max98357a_debugfs_root);
+	debugfs_create_file("stats", 0444, dir, max98357a,
+			    &max98357a_stats_fops);
+	debugfs_create_file("history", 0444, dir, max98357a,
+			    &max98357a_history_fops);
+	debugfs_create_file("boot", 0444, dir, max98357a,
+			    &max98357a_boot_fops);
+	return devm_add_action_or_reset(dev, max98357a_debugfs_remove, dir);
+}
+
 static int max98357a_platform_probe(struct platform_device *pdev)
 {
 	struct max98357a_priv *max98357a;
@@ -129,6 +324,7 @@ static int max98357a_platform_probe(struct platform_device *pdev)
 	max98357a = devm_kzalloc(&pdev->dev, sizeof(*max98357a), GFP_KERNEL);
 	if (!max98357a)
 		return -ENOMEM;
+	max98357a->boot.probe_ns = ktime_get_boottime_ns();
 
 	max98357a->sdmode = devm_gpiod_get_optional(&pdev->dev,
 				"sdmode", GPIOD_OUT_LOW);
@@ -144,11 +340,23 @@ static int max98357a_platform_probe(struct platform_device *pdev)
 			"default: no delay\n");
 	}
 
+	ret = max98357a_debugfs_init(&pdev->dev, max98357a);
+	if (ret)
+		return ret;
+
 	dev_set_drvdata(&pdev->dev, max98357a);
 
-	return devm_snd_soc_register_component(&pdev->dev,
+	ret = devm_snd_soc_register_component(&pdev->dev,
 			&max98357a_component_driver,
 			&max98357a_dai_driver, 1);
+	if (ret)
+		return ret;
+
+	max98357a->boot.registered_ns = codec_boot_mark(&pdev->dev,
+			"component_registered", max98357a_load_ns);
+	trace_max98357a_boot(&pdev->dev, "component_registered",
+			     max98357a->boot.registered_ns);
+	return 0;
 }
 
 #ifdef CONFIG_OF
@@ -174,10 +382,40 @@ static struct platform_driver max98357a_platform_driver = {
 		.name = "max98357a",
 		.of_match_table = of_match_ptr(max98357a_device_id),
 		.acpi_match_table = ACPI_PTR(max98357a_acpi_match),
+		/* Probe does no I/O of its own; let it run off the init thread */
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe	= max98357a_platform_probe,
 };
-module_platform_driver(max98357a_platform_driver);
+
+static int __init max98357a_init(void)
+{
+	int ret;
+
+	max98357a_load_ns = ktime_get_boottime_ns();
+	/* One directory per amp: stereo boards have a left and a right one */
+	max98357a_debugfs_root = codec_stats_create_root("max98357a");
+	ret = platform_driver_register(&max98357a_platform_driver);
+	if (ret)
+		debugfs_remove_recursive(max98357a_debugfs_root);
+	return ret;
+}
+module_init(max98357a_init);
+
+static void __exit max98357a_exit(void)
+{
+	platform_driver_unregister(&max98357a_platform_driver);
+	debugfs_remove_recursive(max98357a_debugfs_root);
+}
+module_exit(max98357a_exit);
+
+/*
+ * `make KUNIT=1` or CONFIG_SND_SOC_MAX98357A_EXAMPLE_KUNIT_TEST:
+ * the tests call the static callbacks above directly
+ */
+#ifdef MAX98357A_KUNIT_TEST
+#include "max98357a_kunit.c"
+#endif
 
 MODULE_DESCRIPTION("Maxim MAX98357A Codec Driver");
 MODULE_LICENSE("GPL v2");
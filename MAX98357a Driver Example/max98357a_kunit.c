@@ -0,0 +1,269 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * max98357a_kunit.c -- KUnit tests for the MAX98357A codec driver
+ *
+ * Included at the end of max98357a.c when built with `make KUNIT=1`, so
+ * the static DAI ops and DAPM event are reachable; the suite runs when the
+ * module loads (the kernel needs CONFIG_KUNIT). SD_MODE is the fake GPIO
+ * chip of codec_kunit.h, which logs every level the driver sets. Results are
+ * in dmesg and /sys/kernel/debug/kunit/max98357a/results. Copy this
+ * directory to sound/soc/codecs/max98357a-example, source its Kconfig from
+ * sound/soc/codecs/Kconfig, add `obj-y += max98357a-example/` to the
+ * Makefile there, and kunit.py runs the suite under QEMU:
+ *   ./tools/testing/kunit/kunit.py run --arch=x86_64 \
+ *	--kunitconfig=sound/soc/codecs/max98357a-example
+ * A failed test makes kunit.py exit non-zero. The trigger benchmark fails
+ * over MAX98357A_KUNIT_TRIGGER_NS_MAX: about 1 us per trigger on the DK1
+ * with a slack factor of 10 for emulation and a loaded host.
+ */
+
+#include <kunit/test.h>
+
+#include "codec_kunit.h"
+
+#ifndef MAX98357A_KUNIT_TRIGGER_NS_MAX
+#define MAX98357A_KUNIT_TRIGGER_NS_MAX	10000
+#endif
+#define MAX98357A_KUNIT_BENCH_LOOPS	10000
+
+struct max98357a_test {
+	struct codec_kunit c;
+	struct max98357a_priv *priv;
+	struct snd_soc_dapm_widget *widget;
+};
+
+static int max98357a_test_init(struct kunit *test)
+{
+	struct max98357a_test *t;
+
+	t = kunit_kzalloc(test, sizeof(*t), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, t);
+	test->priv = t;
+
+	t->priv = kunit_kzalloc(test, sizeof(*t->priv), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, t->priv);
+	spin_lock_init(&t->priv->stats.lock);
+
+	codec_kunit_init(test, &t->c, "max98357a-kunit", t->priv,
+			 SNDRV_PCM_STREAM_PLAYBACK);
+	t->priv->sdmode = gpiochip_request_own_desc(&t->c.gpio->chip, 0,
+						    "sdmode", GPIO_ACTIVE_HIGH,
+						    GPIOD_OUT_LOW);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, t->priv->sdmode);
+
+	t->widget = kunit_kzalloc(test, sizeof(*t->widget), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, t->widget);
+	t->widget->dapm = &t->c.component->dapm;
+	t->widget->name = "SD_MODE";
+	return 0;
+}
+
+static void max98357a_test_exit(struct kunit *test)
+{
+	struct max98357a_test *t = test->priv;
+
+	if (!t)
+		return;
+	if (t->priv && !IS_ERR_OR_NULL(t->priv->sdmode))
+		gpiochip_free_own_desc(t->priv->sdmode);
+	codec_kunit_exit(&t->c);
+	static_branch_disable(&codec_stats_key);
+}
+
+/* Stats are off by default, like on a booted board */
+static void max98357a_test_stats_on(struct kunit *test)
+{
+	if (!IS_ENABLED(CONFIG_DEBUG_FS))
+		kunit_skip(test, "stats need CONFIG_DEBUG_FS");
+	static_branch_enable(&codec_stats_key);
+}
+
+static void max98357a_test_trigger(struct kunit *test, int cmd)
+{
+	struct max98357a_test *t = test->priv;
+
+	KUNIT_EXPECT_EQ(test, max98357a_daiops_trigger(t->c.substream, cmd,
+						       t->c.dai), 0);
+}
+
+static void max98357a_test_dapm(struct kunit *test, int event)
+{
+	struct max98357a_test *t = test->priv;
+
+	KUNIT_EXPECT_EQ(test, max98357a_sdmode_event(t->widget, NULL, event), 0);
+}
+
+static void max98357a_test_expect_log(struct kunit *test, const int *log,
+		unsigned int n)
+{
+	struct codec_kunit_gpio *gpio =
+		((struct max98357a_test *)test->priv)->c.gpio;
+
+	KUNIT_ASSERT_EQ(test, gpio->n_sets, n);
+	if (n)
+		KUNIT_EXPECT_MEMEQ(test, gpio->log, log, n * sizeof(*log));
+}
+
+/* Before the SD_MODE widget powers up, START must not unmute */
+static void max98357a_test_start_needs_dapm(struct kunit *test)
+{
+	static const int log[] = { 0 };
+
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_START);
+	max98357a_test_expect_log(test, NULL, 0);
+	/* STOP always mutes */
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_STOP);
+	max98357a_test_expect_log(test, log, ARRAY_SIZE(log));
+}
+
+static void max98357a_test_playback_sequence(struct kunit *test)
+{
+	static const int log[] = { 1, 0, 1, 0 };
+	struct max98357a_test *t = test->priv;
+
+	max98357a_test_dapm(test, SND_SOC_DAPM_POST_PMU);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_START);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_PAUSE_PUSH);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_PAUSE_RELEASE);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_STOP);
+	max98357a_test_dapm(test, SND_SOC_DAPM_POST_PMD);
+	max98357a_test_expect_log(test, log, ARRAY_SIZE(log));
+	KUNIT_EXPECT_EQ(test, t->c.gpio->level, 0);
+	KUNIT_EXPECT_EQ(test, t->priv->sdmode_switch, 0);
+}
+
+static void max98357a_test_suspend_resume(struct kunit *test)
+{
+	static const int log[] = { 1, 0, 1 };
+
+	max98357a_test_dapm(test, SND_SOC_DAPM_POST_PMU);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_START);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_SUSPEND);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_RESUME);
+	max98357a_test_expect_log(test, log, ARRAY_SIZE(log));
+}
+
+/* After the widget powers down, a late START leaves the amp muted */
+static void max98357a_test_start_after_pmd(struct kunit *test)
+{
+	max98357a_test_dapm(test, SND_SOC_DAPM_POST_PMU);
+	max98357a_test_dapm(test, SND_SOC_DAPM_POST_PMD);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_START);
+	max98357a_test_expect_log(test, NULL, 0);
+}
+
+static void max98357a_test_no_gpio(struct kunit *test)
+{
+	struct max98357a_test *t = test->priv;
+	struct gpio_desc *sdmode = t->priv->sdmode;
+
+	t->priv->sdmode = NULL;
+	max98357a_test_dapm(test, SND_SOC_DAPM_POST_PMU);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_START);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_STOP);
+	t->priv->sdmode = sdmode;
+	max98357a_test_expect_log(test, NULL, 0);
+}
+
+static void max98357a_test_stats(struct kunit *test)
+{
+	struct max98357a_stats *st =
+		&((struct max98357a_test *)test->priv)->priv->stats;
+
+	max98357a_test_stats_on(test);
+	max98357a_test_dapm(test, SND_SOC_DAPM_POST_PMU);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_START);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_STOP);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_START);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_STOP);
+	max98357a_test_dapm(test, SND_SOC_DAPM_POST_PMD);
+	KUNIT_EXPECT_EQ(test, st->starts, 2);
+	KUNIT_EXPECT_EQ(test, st->stops, 2);
+	KUNIT_EXPECT_EQ(test, st->dapm_pmu, 1);
+	KUNIT_EXPECT_EQ(test, st->dapm_pmd, 1);
+	KUNIT_EXPECT_EQ(test, st->sdmode_on, 2);
+	KUNIT_EXPECT_EQ(test, st->sdmode_off, 2);
+	KUNIT_EXPECT_LE(test, st->sdmode_seq_last_ns, st->sdmode_seq_max_ns);
+	/* 2 DAPM events, 4 triggers, 4 SD_MODE changes */
+	KUNIT_EXPECT_EQ(test, st->history.count, 10);
+}
+
+/* Until debugfs "enable" is set nothing is recorded or timed */
+static void max98357a_test_stats_off(struct kunit *test)
+{
+	struct max98357a_stats *st =
+		&((struct max98357a_test *)test->priv)->priv->stats;
+
+	max98357a_test_dapm(test, SND_SOC_DAPM_POST_PMU);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_START);
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_STOP);
+	KUNIT_EXPECT_EQ(test, st->starts, 0);
+	KUNIT_EXPECT_EQ(test, st->sdmode_on, 0);
+	KUNIT_EXPECT_EQ(test, st->history.count, 0);
+}
+
+/* sdmode-delay holds the unmute back by that many ms */
+static void max98357a_test_sdmode_delay(struct kunit *test)
+{
+	struct max98357a_test *t = test->priv;
+	u64 start_ns, ns;
+
+	t->priv->sdmode_delay = 2;
+	if (IS_ENABLED(CONFIG_DEBUG_FS))
+		static_branch_enable(&codec_stats_key);
+	max98357a_test_dapm(test, SND_SOC_DAPM_POST_PMU);
+	start_ns = ktime_get_ns();
+	max98357a_test_trigger(test, SNDRV_PCM_TRIGGER_START);
+	ns = ktime_get_ns() - start_ns;
+	KUNIT_EXPECT_GE(test, ns, 2 * NSEC_PER_MSEC);
+	KUNIT_EXPECT_EQ(test, t->c.gpio->level, 1);
+	if (IS_ENABLED(CONFIG_DEBUG_FS))
+		KUNIT_EXPECT_GE(test, t->priv->stats.sdmode_seq_last_ns,
+				2 * NSEC_PER_MSEC);
+}
+
+/* START/STOP pairs with SD_MODE switching: the per-trigger cost */
+static void max98357a_bench_trigger(struct kunit *test)
+{
+	struct max98357a_test *t = test->priv;
+	u64 start_ns, ns;
+	unsigned int i;
+
+	max98357a_test_dapm(test, SND_SOC_DAPM_POST_PMU);
+	start_ns = ktime_get_ns();
+	for (i = 0; i < MAX98357A_KUNIT_BENCH_LOOPS; i++) {
+		max98357a_daiops_trigger(t->c.substream, SNDRV_PCM_TRIGGER_START,
+					 t->c.dai);
+		max98357a_daiops_trigger(t->c.substream, SNDRV_PCM_TRIGGER_STOP,
+					 t->c.dai);
+	}
+	ns = div_u64(ktime_get_ns() - start_ns, 2 * MAX98357A_KUNIT_BENCH_LOOPS);
+
+	kunit_info(test, "%llu ns/trigger, budget %d ns\n", ns,
+		   MAX98357A_KUNIT_TRIGGER_NS_MAX);
+	KUNIT_EXPECT_EQ(test, t->c.gpio->n_sets, 2 * MAX98357A_KUNIT_BENCH_LOOPS);
+	/* 0 = report only */
+	if (MAX98357A_KUNIT_TRIGGER_NS_MAX)
+		KUNIT_EXPECT_LE(test, ns, MAX98357A_KUNIT_TRIGGER_NS_MAX);
+}
+
+static struct kunit_case max98357a_test_cases[] = {
+	KUNIT_CASE(max98357a_test_start_needs_dapm),
+	KUNIT_CASE(max98357a_test_playback_sequence),
+	KUNIT_CASE(max98357a_test_suspend_resume),
+	KUNIT_CASE(max98357a_test_start_after_pmd),
+	KUNIT_CASE(max98357a_test_no_gpio),
+	KUNIT_CASE(max98357a_test_stats),
+	KUNIT_CASE(max98357a_test_stats_off),
+	KUNIT_CASE(max98357a_test_sdmode_delay),
+	KUNIT_CASE(max98357a_bench_trigger),
+	{}
+};
+
+static struct kunit_suite max98357a_test_suite = {
+	.name = "max98357a",
+	.init = max98357a_test_init,
+	.exit = max98357a_test_exit,
+	.test_cases = max98357a_test_cases,
+};
+kunit_test_suite(max98357a_test_suite);
@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * max98357a_trace.h -- MAX98357A tracepoints
+ *
+ * Enable with e.g.
+ *   echo 1 > /sys/kernel/tracing/events/max98357a/enable
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM max98357a
+
+#if !defined(_MAX98357A_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _MAX98357A_TRACE_H
+
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(max98357a_trigger,
+	TP_PROTO(struct device *dev, int stream, int cmd),
+	TP_ARGS(dev, stream, cmd),
+	TP_STRUCT__entry(
+		__string(name, dev_name(dev))
+		__field(int, stream)
+		__field(int, cmd)
+	),
+	TP_fast_assign(
+		__assign_str(name, dev_name(dev));
+		__entry->stream = stream;
+		__entry->cmd = cmd;
+	),
+	TP_printk("%s stream=%d cmd=%d", __get_str(name),
+		  __entry->stream, __entry->cmd)
+);
+
+TRACE_EVENT(max98357a_hw_params,
+	TP_PROTO(struct device *dev, unsigned int rate, unsigned int channels,
+		 unsigned int width),
+	TP_ARGS(dev, rate, channels, width),
+	TP_STRUCT__entry(
+		__string(name, dev_name(dev))
+		__field(unsigned int, rate)
+		__field(unsigned int, channels)
+		__field(unsigned int, width)
+	),
+	TP_fast_assign(
+		__assign_str(name, dev_name(dev));
+		__entry->rate = rate;
+		__entry->channels = channels;
+		__entry->width = width;
+	),
+	TP_printk("%s rate=%u channels=%u width=%u", __get_str(name),
+		  __entry->rate, __entry->channels, __entry->width)
+);
+
+TRACE_EVENT(max98357a_dapm_event,
+	TP_PROTO(struct device *dev, const char *widget, int event),
+	TP_ARGS(dev, widget, event),
+	TP_STRUCT__entry(
+		__string(name, dev_name(dev))
+		__string(widget, widget)
+		__field(int, event)
+	),
+	TP_fast_assign(
+		__assign_str(name, dev_name(dev));
+		__assign_str(widget, widget);
+		__entry->event = event;
+	),
+	TP_printk("%s widget=%s event=0x%x", __get_str(name),
+		  __get_str(widget), __entry->event)
+);
+
+/* seq_ns: from trigger entry to the GPIO write, sdmode-delay included */
+TRACE_EVENT(max98357a_sdmode,
+	TP_PROTO(struct device *dev, int value, u64 seq_ns),
+	TP_ARGS(dev, value, seq_ns),
+	TP_STRUCT__entry(
+		__string(name, dev_name(dev))
+		__field(int, value)
+		__field(u64, seq_ns)
+	),
+	TP_fast_assign(
+		__assign_str(name, dev_name(dev));
+		__entry->value = value;
+		__entry->seq_ns = seq_ns;
+	),
+	TP_printk("%s sdmode=%d seq_ns=%llu", __get_str(name),
+		  __entry->value, __entry->seq_ns)
+);
+
+/* ts_ns: CLOCK_BOOTTIME, comparable with the dmesg timestamps */
+TRACE_EVENT(max98357a_boot,
+	TP_PROTO(struct device *dev, const char *stage, u64 ts_ns),
+	TP_ARGS(dev, stage, ts_ns),
+	TP_STRUCT__entry(
+		__string(name, dev_name(dev))
+		__string(stage, stage)
+		__field(u64, ts_ns)
+	),
+	TP_fast_assign(
+		__assign_str(name, dev_name(dev));
+		__assign_str(stage, stage);
+		__entry->ts_ns = ts_ns;
+	),
+	TP_printk("%s stage=%s ts_ns=%llu", __get_str(name),
+		  __get_str(stage), __entry->ts_ns)
+);
+
+#endif /* _MAX98357A_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE max98357a_trace
+#include <trace/define_trace.h>